@@ -0,0 +1,59 @@
+// atom.cpp
+//
+// Identifiers are interned into a global table of atoms as they are parsed. Each atom has its hash computed
+// once, and two names are equal exactly when their atoms are, so the checker's scopes are keyed by atoms
+// and compare names by pointer rather than by byte. The table is split into shards, each with its own lock,
+// so the parser threads rarely contend on it.
+
+struct Atom {
+	String string; // NOTE: Owned by the table
+	u64    hash;
+};
+
+#define ATOM_TABLE_SHARD_COUNT 64
+
+struct AtomTableShard {
+	gbMutex     mutex;
+	Map<Atom *> atoms; // Key: String
+	Arena       arena;
+};
+
+gb_global AtomTableShard global_atom_table[ATOM_TABLE_SHARD_COUNT] = {};
+
+
+void init_global_atom_table(void) {
+	for (isize i = 0; i < ATOM_TABLE_SHARD_COUNT; i++) {
+		AtomTableShard *shard = &global_atom_table[i];
+		gb_mutex_init(&shard->mutex);
+		map_init(&shard->atoms, heap_allocator(), 1024);
+		arena_init(&shard->arena, heap_allocator(), 64*1024);
+		shard->arena.single_threaded = true; // NOTE: Guarded by the shard's mutex
+	}
+}
+
+Atom *atom_intern(String s) {
+	HashKey key = hash_string(s);
+	AtomTableShard *shard = &global_atom_table[(key.key >> 32) % ATOM_TABLE_SHARD_COUNT];
+
+	gb_mutex_lock(&shard->mutex);
+	defer (gb_mutex_unlock(&shard->mutex));
+
+	Atom **found = map_get(&shard->atoms, key);
+	if (found != nullptr) {
+		return *found;
+	}
+	gbAllocator a = arena_allocator(&shard->arena);
+	Atom *atom = gb_alloc_item(a, Atom);
+	atom->string = copy_string(a, s);
+	atom->hash   = key.key;
+	map_set(&shard->atoms, hash_string(atom->string), atom);
+	return atom;
+}
+
+// NOTE: Equal to 'hash_string' of the atom's string, so either key finds the other in a map
+gb_inline HashKey hash_atom(Atom const *atom) {
+	HashKey h = {HashKey_Atom};
+	h.key = atom->hash;
+	h.string = atom->string;
+	return h;
+}
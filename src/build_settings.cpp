@@ -119,11 +119,19 @@ struct BuildContext {
 	bool   show_timings;
 	bool   show_more_timings;
 	bool   keep_temp_files;
+	bool   llvm_in_process; // NOTE: Set when built with ODIN_LLVM_C_API, unless -keep-temp-files asks for the text path
+	bool   llvm_bitcode;    // NOTE: Writes bitcode rather than textual IR for each codegen unit, see 'ir_bitcode.cpp'
 	bool   ignore_unknown_attributes;
 	bool   no_bounds_check;
 	bool   no_output_files;
 	bool   no_crt;
 	bool   use_lld;
+	bool   stream_tokens;
+	String cache_dir;
+	bool   parallel_check;
+	bool   watch;
+	String trace_file;
+	String check_profile_file;
 	bool   vet;
 	bool   cross_compiling;
 	bool   use_subsystem_windows;
@@ -132,14 +140,19 @@ struct BuildContext {
 
 	gbAffinity affinity;
 	isize      thread_count;
+	isize      codegen_units;
 
 	Map<ExactValue> defined_values; // Key:
 };
 
 
-
 gb_global BuildContext build_context = {0};
 
+// NOTE: Extension of the file each codegen unit's IR is written to, for 'opt' to read
+char const *llvm_ir_file_extension(void) {
+	return build_context.llvm_bitcode ? ".ir.bc" : ".ll";
+}
+
 
 gb_global TargetMetrics target_windows_386 = {
 	TargetOs_windows,
@@ -565,6 +578,9 @@ void init_build_context(TargetMetrics *cross_target) {
 	if (bc->thread_count == 0) {
 		bc->thread_count = gb_max(bc->affinity.thread_count, 1);
 	}
+	if (bc->codegen_units == 0) {
+		bc->codegen_units = 1;
+	}
 
 	bc->ODIN_VENDOR  = str_lit("odin");
 	bc->ODIN_VERSION = ODIN_VERSION;
@@ -679,6 +695,10 @@ void init_build_context(TargetMetrics *cross_target) {
 
 	bc->opt_flags = make_string_c(opt_flags);
 
+#if defined(ODIN_LLVM_C_API)
+	bc->llvm_in_process = !bc->keep_temp_files;
+#endif
+
 
 	#undef LINK_FLAG_X64
 	#undef LINK_FLAG_386
@@ -346,7 +346,7 @@ void override_entity_in_scope(Entity *original_entity, Entity *new_entity) {
 
 	// GB_ASSERT_MSG(found_entity == original_entity, "%.*s == %.*s", LIT(found_entity->token.string), LIT(new_entity->token.string));
 
-	map_set(&found_scope->elements, hash_string(original_name), new_entity);
+	scope_elements_set(&found_scope->elements, atom_intern(original_name), new_entity);
 }
 
 
@@ -583,7 +583,7 @@ void init_entity_foreign_library(CheckerContext *ctx, Entity *e) {
 		} else {
 			// TODO(bill): Extra stuff to do with library names?
 			*foreign_library = found;
-			found->flags |= EntityFlag_Used;
+			entity_set_used(found);
 			add_entity_use(ctx, ident, found);
 		}
 	}
@@ -737,7 +737,7 @@ void check_proc_decl(CheckerContext *ctx, Entity *e, DeclInfo *d) {
 
 		GB_ASSERT(pl->body->kind == Ast_BlockStmt);
 		if (!pt->is_polymorphic) {
-			check_procedure_later(ctx->checker, ctx->file, e->token, d, proc_type, pl->body, pl->tags);
+			check_procedure_later(ctx, ctx->file, e->token, d, proc_type, pl->body, pl->tags);
 		}
 	} else if (!is_foreign) {
 		if (e->Procedure.is_export) {
@@ -759,7 +759,11 @@ void check_proc_decl(CheckerContext *ctx, Entity *e, DeclInfo *d) {
 
 	if (ac.deferred_procedure.entity != nullptr) {
 		e->Procedure.deferred_procedure = ac.deferred_procedure;
-		array_add(&ctx->checker->procs_with_deferred_to_check, e);
+		if (ctx->proc_task != nullptr) {
+			array_add(&ctx->proc_task->procs_with_deferred_to_check, e);
+		} else {
+			array_add(&ctx->checker->procs_with_deferred_to_check, e);
+		}
 	}
 
 	if (is_foreign) {
@@ -772,6 +776,9 @@ void check_proc_decl(CheckerContext *ctx, Entity *e, DeclInfo *d) {
 
 		init_entity_foreign_library(ctx, e);
 
+		gb_mutex_lock(&ctx->info->foreign_mutex);
+		defer (gb_mutex_unlock(&ctx->info->foreign_mutex));
+
 		auto *fp = &ctx->info->foreigns;
 		HashKey key = hash_string(name);
 		Entity **found = map_get(fp, key);
@@ -804,6 +811,9 @@ void check_proc_decl(CheckerContext *ctx, Entity *e, DeclInfo *d) {
 			name = e->Procedure.link_name;
 		}
 		if (e->Procedure.link_name.len > 0 || is_export) {
+			gb_mutex_lock(&ctx->info->foreign_mutex);
+			defer (gb_mutex_unlock(&ctx->info->foreign_mutex));
+
 			auto *fp = &ctx->info->foreigns;
 			HashKey key = hash_string(name);
 			Entity **found = map_get(fp, key);
@@ -888,6 +898,9 @@ void check_global_variable_decl(CheckerContext *ctx, Entity *e, Ast *type_expr,
 			name = e->Variable.link_name;
 		}
 
+		gb_mutex_lock(&ctx->info->foreign_mutex);
+		defer (gb_mutex_unlock(&ctx->info->foreign_mutex));
+
 		auto *fp = &ctx->info->foreigns;
 		HashKey key = hash_string(name);
 		Entity **found = map_get(fp, key);
@@ -1095,6 +1108,10 @@ void check_entity_decl(CheckerContext *ctx, Entity *e, DeclInfo *d, Type *named_
 	e->parent_proc_decl = c.curr_proc_decl;
 	e->state = EntityState_InProgress;
 
+	CheckProfileFrame profile_frame = {};
+	check_profile_begin(&profile_frame);
+	defer (check_profile_end(&profile_frame, CheckProfile_Decl, e, e->token));
+
 	switch (e->kind) {
 	case Entity_Variable:
 		check_global_variable_decl(&c, e, d->type_expr, d->init_expr);
@@ -1176,8 +1193,8 @@ void check_proc_body(CheckerContext *ctx_, Token token, DeclInfo *decl, Type *ty
 						scope = scope_of_node(t->Struct.node);
 					}
 					GB_ASSERT(scope != nullptr);
-					for_array(i, scope->elements.entries) {
-						Entity *f = scope->elements.entries[i].value;
+					for (isize i = 0; i < scope->elements.count; i++) {
+						Entity *f = scope_entries(scope)[i].entity;
 						if (f->kind == Entity_Variable) {
 							Entity *uvar = alloc_entity_using_variable(e, f->token, f->type, nullptr);
 							if (is_value) uvar->flags |= EntityFlag_Value;
@@ -1239,25 +1256,34 @@ void check_proc_body(CheckerContext *ctx_, Token token, DeclInfo *decl, Type *ty
 
 	check_scope_usage(ctx->checker, ctx->scope);
 
-#if 1
 	if (decl->parent != nullptr) {
-		Scope *ps = decl->parent->scope;
-		if (ps->flags & (ScopeFlag_File & ScopeFlag_Pkg & ScopeFlag_Global)) {
-			return;
+		if (ctx->proc_task != nullptr) {
+			// NOTE: The parent's dependency sets are shared, so these are added once the batch has finished
+			array_add(&ctx->proc_task->child_decls, decl);
 		} else {
-			// NOTE(bill): Add the dependencies from the procedure literal (lambda)
-			// But only at the procedure level
-			for_array(i, decl->deps.entries) {
-				Entity *e = decl->deps.entries[i].ptr;
-				ptr_set_add(&decl->parent->deps, e);
-			}
-			for_array(i, decl->type_info_deps.entries) {
-				Type *t = decl->type_info_deps.entries[i].ptr;
-				ptr_set_add(&decl->parent->type_info_deps, t);
-			}
+			add_deps_from_child_to_parent(decl);
 		}
 	}
-#endif
+}
+
+void add_deps_from_child_to_parent(DeclInfo *decl) {
+	if (decl == nullptr || decl->parent == nullptr) {
+		return;
+	}
+	Scope *ps = decl->parent->scope;
+	if (ps->flags & (ScopeFlag_File & ScopeFlag_Pkg & ScopeFlag_Global)) {
+		return;
+	}
+	// NOTE(bill): Add the dependencies from the procedure literal (lambda)
+	// But only at the procedure level
+	for_array(i, decl->deps.entries) {
+		Entity *e = decl->deps.entries[i].ptr;
+		ptr_set_add(&decl->parent->deps, e);
+	}
+	for_array(i, decl->type_info_deps.entries) {
+		Type *t = decl->type_info_deps.entries[i].ptr;
+		ptr_set_add(&decl->parent->type_info_deps, t);
+	}
 }
 
 
@@ -138,8 +138,8 @@ void check_scope_decls(CheckerContext *c, Array<Ast *> const &nodes, isize reser
 
 	check_collect_entities(c, nodes);
 
-	for_array(i, s->elements.entries) {
-		Entity *e = s->elements.entries[i].value;
+	for (isize i = 0; i < s->elements.count; i++) {
+		Entity *e = scope_entries(s)[i].entity;
 		switch (e->kind) {
 		case Entity_Constant:
 		case Entity_TypeName:
@@ -191,6 +191,130 @@ isize check_is_assignable_to_using_subtype(Type *src, Type *dst, isize level = 0
 	return 0;
 }
 
+// NOTE: Types which are identical hash the same, so that 'gen_proc_cache' can compare them with 'are_types_identical'
+u64 poly_proc_cache_type_hash(Type *t) {
+	t = strip_type_aliasing(t);
+	if (t == nullptr) {
+		return 0;
+	}
+	u64 h = cast(u64)t->kind;
+	switch (t->kind) {
+	case Type_Basic:        return h*31 + cast(u64)t->Basic.kind;
+	case Type_Named:        return h*31 + cast(u64)cast(uintptr)t->Named.type_name;
+	case Type_Enum:         return h*31 + cast(u64)cast(uintptr)t;
+	case Type_Pointer:      return h*31 + poly_proc_cache_type_hash(t->Pointer.elem);
+	case Type_Slice:        return h*31 + poly_proc_cache_type_hash(t->Slice.elem);
+	case Type_DynamicArray: return h*31 + poly_proc_cache_type_hash(t->DynamicArray.elem);
+	case Type_Array:        return (h*31 + cast(u64)t->Array.count)*31 + poly_proc_cache_type_hash(t->Array.elem);
+	}
+	return h;
+}
+
+// NOTE: Operands which are polymorphic themselves are not cached, as what they mean depends on the scope
+bool poly_proc_cache_hash(Array<Operand> const &operands, u64 *hash_) {
+	u64 h = cast(u64)operands.count;
+	for_array(i, operands) {
+		Operand const &o = operands[i];
+		if (o.mode == Addressing_Invalid || o.type == nullptr || is_type_polymorphic(o.type)) {
+			return false;
+		}
+		h = h*31 + cast(u64)o.mode;
+		h = h*31 + poly_proc_cache_type_hash(o.type);
+	}
+	*hash_ = h;
+	return true;
+}
+
+// NOTE: Values which cannot be compared, e.g. compound literals, are never equal, so they are not reused
+bool poly_proc_cache_values_equal(ExactValue x, ExactValue y) {
+	if (x.kind != y.kind) {
+		return false;
+	}
+	switch (x.kind) {
+	case ExactValue_Bool:
+	case ExactValue_String:
+	case ExactValue_Integer:
+	case ExactValue_Float:
+	case ExactValue_Complex:
+		return compare_exact_values(Token_CmpEq, x, y);
+	case ExactValue_Procedure:
+		return x.value_procedure == y.value_procedure;
+	case ExactValue_Typeid:
+		return are_types_identical(x.value_typeid, y.value_typeid);
+	}
+	return false;
+}
+
+// NOTE: Constant values only distinguish the operands of constant parameters, e.g. '$N: int'
+bool poly_proc_cache_operands_match(Type *params, Array<Operand> const &x, Array<Operand> const &y) {
+	if (x.count != y.count) {
+		return false;
+	}
+	for_array(i, x) {
+		if (x[i].mode != y[i].mode || !are_types_identical(x[i].type, y[i].type)) {
+			return false;
+		}
+		if (x[i].mode != Addressing_Constant) {
+			continue;
+		}
+		bool is_constant_param = true;
+		if (params != nullptr && i < params->Tuple.variables.count) {
+			is_constant_param = params->Tuple.variables[i]->kind == Entity_Constant;
+		}
+		if (is_constant_param && !poly_proc_cache_values_equal(x[i].value, y[i].value)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// NOTE: Must be called with 'gen_mutex' held
+Entity *poly_proc_cache_find(CheckerInfo *info, Entity *base_entity, u64 hash, Array<Operand> const &operands) {
+	auto *found = map_get(&info->gen_proc_cache, hash_pointer(base_entity->identifier));
+	if (found == nullptr) {
+		return nullptr;
+	}
+	Type *params = base_type(base_entity->type)->Proc.params;
+	for_array(i, *found) {
+		PolyProcCacheEntry *entry = &(*found)[i];
+		if (entry->hash == hash && poly_proc_cache_operands_match(params, entry->operands, operands)) {
+			return entry->entity;
+		}
+	}
+	return nullptr;
+}
+
+void poly_proc_cache_add(CheckerInfo *info, Entity *base_entity, u64 hash, Array<Operand> const &operands, Entity *entity) {
+	PolyProcCacheEntry entry = {};
+	entry.hash = hash;
+	entry.entity = entity;
+	array_init(&entry.operands, heap_allocator(), 0, operands.count);
+	for_array(i, operands) {
+		Operand o = {};
+		o.mode  = operands[i].mode;
+		o.type  = operands[i].type;
+		o.value = operands[i].value;
+		array_add(&entry.operands, o);
+	}
+
+	HashKey key = hash_pointer(base_entity->identifier);
+	auto *found = map_get(&info->gen_proc_cache, key);
+	if (found != nullptr) {
+		array_add(found, entry);
+	} else {
+		auto array = array_make<PolyProcCacheEntry>(heap_allocator());
+		array_add(&array, entry);
+		map_set(&info->gen_proc_cache, key, array);
+	}
+}
+
+// NOTE: Must be called with 'gen_mutex' held
+void add_gen_proc_use(CheckerContext *c, Entity *entity) {
+	if (c->proc_task != nullptr) {
+		array_add(&c->proc_task->gen_procs, entity);
+	}
+}
+
 bool find_or_generate_polymorphic_procedure(CheckerContext *c, Entity *base_entity, Type *type,
                                             Array<Operand> *param_operands, Ast *poly_def_node, PolyProcData *poly_proc_data) {
 	///////////////////////////////////////////////////////////////////////////////
@@ -242,7 +366,10 @@ bool find_or_generate_polymorphic_procedure(CheckerContext *c, Entity *base_enti
 		return false;
 	}
 
-
+	// NOTE: Procedure bodies may be checked on several threads, so the lookup and the
+	// insertion into 'gen_procs' must happen as one step
+	gb_mutex_lock(&c->info->gen_mutex);
+	defer (gb_mutex_unlock(&c->info->gen_mutex));
 
 	gbAllocator a = heap_allocator();
 
@@ -263,10 +390,45 @@ bool find_or_generate_polymorphic_procedure(CheckerContext *c, Entity *base_enti
 		array_free(&operands);
 	});
 
+	// NOTE: Calls with the same arguments as an earlier one reuse its specialization before any scope or
+	// type is built for them
+	u64 cache_hash = 0;
+	bool cacheable = poly_proc_cache_hash(operands, &cache_hash);
+	if (cacheable) {
+		Entity *cached = poly_proc_cache_find(c->info, base_entity, cache_hash, operands);
+		if (cached != nullptr) {
+			add_gen_proc_use(c, cached);
+			if (poly_proc_data) {
+				poly_proc_data->gen_entity = cached;
+			}
+			return true;
+		}
+	}
 
 
 	CheckerContext nctx = *c;
 
+	// NOTE: On a worker thread, what generating the specialization adds is kept apart from the task, as it is
+	// merged with the first task to use it rather than with whichever generated it first, see 'merge_proc_body_task'
+	ProcBodyTask *gen_task = nullptr;
+	ProcBodyTask *prev_task = nullptr;
+	bool keep_gen_task = false;
+	if (c->proc_task != nullptr) {
+		gen_task = gb_alloc_item(a, ProcBodyTask);
+		proc_body_task_init(gen_task, c->checker, ProcInfo{});
+		nctx.proc_task = gen_task;
+		nctx.untyped   = &gen_task->untyped;
+		prev_task = set_curr_proc_task(gen_task);
+	}
+	defer (if (gen_task != nullptr) {
+		set_curr_proc_task(prev_task);
+		if (!keep_gen_task) {
+			proc_body_task_append(c->proc_task, gen_task);
+			proc_body_task_destroy(gen_task);
+			gb_free(heap_allocator(), gen_task);
+		}
+	});
+
 	Scope *scope = create_scope(base_entity->scope, a);
 	scope->flags |= ScopeFlag_Proc;
 	nctx.scope = scope;
@@ -298,6 +460,10 @@ bool find_or_generate_polymorphic_procedure(CheckerContext *c, Entity *base_enti
 			Entity *other = procs[i];
 			Type *pt = base_type(other->type);
 			if (are_types_identical(pt, final_proc_type)) {
+				if (cacheable) {
+					poly_proc_cache_add(c->info, base_entity, cache_hash, operands, other);
+				}
+				add_gen_proc_use(c, other);
 				if (poly_proc_data) {
 					poly_proc_data->gen_entity = other;
 				}
@@ -334,6 +500,10 @@ bool find_or_generate_polymorphic_procedure(CheckerContext *c, Entity *base_enti
 				Entity *other = procs[i];
 				Type *pt = base_type(other->type);
 				if (are_types_identical(pt, final_proc_type)) {
+					if (cacheable) {
+						poly_proc_cache_add(c->info, base_entity, cache_hash, operands, other);
+					}
+					add_gen_proc_use(c, other);
 					if (poly_proc_data) {
 						poly_proc_data->gen_entity = other;
 					}
@@ -406,6 +576,14 @@ bool find_or_generate_polymorphic_procedure(CheckerContext *c, Entity *base_enti
 		array_add(&array, entity);
 		map_set(&nctx.checker->info.gen_procs, hash_pointer(base_entity->identifier), array);
 	}
+	if (cacheable) {
+		poly_proc_cache_add(c->info, base_entity, cache_hash, operands, entity);
+	}
+	if (gen_task != nullptr) {
+		keep_gen_task = true;
+		map_set(&c->info->gen_proc_tasks, hash_pointer(entity), gen_task);
+	}
+	add_gen_proc_use(c, entity);
 
 	GB_ASSERT(entity != nullptr);
 
@@ -415,7 +593,7 @@ bool find_or_generate_polymorphic_procedure(CheckerContext *c, Entity *base_enti
 	}
 
 	// NOTE(bill): Check the newly generated procedure body
-	check_procedure_later(nctx.checker, proc_info);
+	check_procedure_later(&nctx, proc_info);
 
 	return true;
 }
@@ -1040,7 +1218,7 @@ Entity *check_ident(CheckerContext *c, Operand *o, Ast *n, Type *named_type, Typ
 	o->expr = n;
 	String name = n->Ident.token.string;
 
-	Entity *e = scope_lookup(c->scope, name);
+	Entity *e = scope_lookup(c->scope, scope_key_of_ident(n));
 	if (e == nullptr) {
 		if (is_blank_ident(name)) {
 			error(n, "'_' cannot be used as a value type");
@@ -1116,7 +1294,7 @@ Entity *check_ident(CheckerContext *c, Operand *o, Ast *n, Type *named_type, Typ
 		return nullptr;
 	}
 
-	e->flags |= EntityFlag_Used;
+	entity_set_used(e);
 
 	Type *type = e->type;
 	switch (e->kind) {
@@ -1133,7 +1311,7 @@ Entity *check_ident(CheckerContext *c, Operand *o, Ast *n, Type *named_type, Typ
 		break;
 
 	case Entity_Variable:
-		e->flags |= EntityFlag_Used;
+		entity_set_used(e);
 		if (type == t_invalid) {
 			o->type = t_invalid;
 			return e;
@@ -2018,7 +2196,7 @@ void check_shift(CheckerContext *c, Operand *x, Operand *y, Ast *node, Type *typ
 
 		TokenPos pos = ast_token(x->expr).pos;
 		if (x_is_untyped) {
-			ExprInfo *info = check_get_expr_info(&c->checker->info, x->expr);
+			ExprInfo *info = check_get_expr_info(c, x->expr);
 			if (info != nullptr) {
 				info->is_lhs = true;
 			}
@@ -2691,7 +2869,7 @@ void check_binary_expr(CheckerContext *c, Operand *x, Ast *node, Type *type_hint
 
 
 void update_expr_type(CheckerContext *c, Ast *e, Type *type, bool final) {
-	ExprInfo *found = check_get_expr_info(&c->checker->info, e);
+	ExprInfo *found = check_get_expr_info(c, e);
 	if (found == nullptr) {
 		return;
 	}
@@ -2730,12 +2908,12 @@ void update_expr_type(CheckerContext *c, Ast *e, Type *type, bool final) {
 
 	if (!final && is_type_untyped(type)) {
 		old.type = base_type(type);
-		check_set_expr_info(&c->checker->info, e, old);
+		check_set_expr_info(c, e, old);
 		return;
 	}
 
 	// We need to remove it and then give it a new one
-	check_remove_expr_info(&c->checker->info, e);
+	check_remove_expr_info(c, e);
 
 	if (old.is_lhs && !is_type_integer(type)) {
 		gbString expr_str = expr_to_string(e);
@@ -2750,7 +2928,7 @@ void update_expr_type(CheckerContext *c, Ast *e, Type *type, bool final) {
 }
 
 void update_expr_value(CheckerContext *c, Ast *e, ExactValue value) {
-	ExprInfo *found = check_get_expr_info(&c->checker->info, e);
+	ExprInfo *found = check_get_expr_info(c, e);
 	if (found) {
 		found->value = value;
 	}
@@ -3406,7 +3584,7 @@ Entity *check_selector(CheckerContext *c, Operand *operand, Ast *node, Type *typ
 
 	if (op_expr->kind == Ast_Ident) {
 		String op_name = op_expr->Ident.token.string;
-		Entity *e = scope_lookup(c->scope, op_name);
+		Entity *e = scope_lookup(c->scope, scope_key_of_ident(op_expr));
 		add_entity_use(c, op_expr, e);
 		expr_entity = e;
 
@@ -3420,7 +3598,7 @@ Entity *check_selector(CheckerContext *c, Operand *operand, Ast *node, Type *typ
 			String entity_name = selector->Ident.token.string;
 
 			check_op_expr = false;
-			entity = scope_lookup_current(import_scope, entity_name);
+			entity = scope_lookup_current(import_scope, scope_key_of_ident(selector));
 			bool is_declared = entity != nullptr;
 			bool allow_builtin = false;
 			if (is_declared) {
@@ -3653,16 +3831,15 @@ bool is_type_normal_pointer(Type *ptr, Type **elem) {
 
 bool check_identifier_exists(Scope *s, Ast *node, bool nested = false, Scope **out_scope = nullptr) {
 	switch (node->kind) {
-	case_ast_node(i, Ident, node);
-		String name = i->token.string;
+	case Ast_Ident: {
 		if (nested) {
-			Entity *e = scope_lookup_current(s, name);
+			Entity *e = scope_lookup_current(s, scope_key_of_ident(node));
 			if (e != nullptr) {
 				if (out_scope) *out_scope = e->scope;
 				return true;
 			}
 		} else {
-			Entity *e = scope_lookup(s, name);
+			Entity *e = scope_lookup(s, scope_key_of_ident(node));
 			if (e != nullptr) {
 				if (out_scope) *out_scope = e->scope;
 				return true;
@@ -6344,8 +6521,8 @@ bool evaluate_where_clauses(CheckerContext *ctx, Ast *call_expr, Scope *scope, A
 
 					if (scope != nullptr) {
 						isize print_count = 0;
-						for_array(j, scope->elements.entries) {
-							Entity *e = scope->elements.entries[j].value;
+						for (isize j = 0; j < scope->elements.count; j++) {
+							Entity *e = scope_entries(scope)[j].entity;
 							switch (e->kind) {
 							case Entity_TypeName: {
 								if (print_count == 0) error_line("\n\tWith the following definitions:\n");
@@ -7044,6 +7221,9 @@ CallArgumentError check_polymorphic_record_type(CheckerContext *c, Operand *oper
 	{
 		gbAllocator a = c->allocator;
 
+		gb_mutex_lock(&c->info->gen_mutex);
+		defer (gb_mutex_unlock(&c->info->gen_mutex));
+
 		bool failure = false;
 		Entity *found_entity = find_polymorphic_record_entity(c, original_type, param_count, ordered_operands, &failure);
 		if (found_entity) {
@@ -7672,7 +7852,7 @@ ExprKind check_expr_base_internal(CheckerContext *c, Operand *o, Ast *node, Type
 				return kind;
 			}
 
-			check_procedure_later(ctx.checker, ctx.file, empty_token, decl, type, pl->body, pl->tags);
+			check_procedure_later(&ctx, ctx.file, empty_token, decl, type, pl->body, pl->tags);
 		}
 		check_close_scope(&ctx);
 
@@ -9230,6 +9410,7 @@ ExprKind check_expr_base_internal(CheckerContext *c, Operand *o, Ast *node, Type
 }
 
 ExprKind check_expr_base(CheckerContext *c, Operand *o, Ast *node, Type *type_hint) {
+	thread_checked_expr_count += 1;
 	ExprKind kind = check_expr_base_internal(c, o, node, type_hint);
 	Type *type = nullptr;
 	ExactValue value = {ExactValue_Invalid};
@@ -9250,7 +9431,7 @@ ExprKind check_expr_base(CheckerContext *c, Operand *o, Ast *node, Type *type_hi
 	}
 
 	if (type != nullptr && is_type_untyped(type)) {
-		add_untyped(&c->checker->info, node, false, o->mode, type, value);
+		add_untyped(c, node, false, o->mode, type, value);
 	}
 	add_type_and_value(&c->checker->info, node, o->mode, type, value);
 
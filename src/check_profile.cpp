@@ -0,0 +1,224 @@
+// check_profile.cpp
+//
+// -profile-check:<file> reports what checking each global declaration, procedure body, and polymorphic
+// specialization cost: the time, the expressions checked, and the allocations made. The costs of a
+// declaration exclude those of the declarations it caused to be checked, which are reported on their own.
+
+enum CheckProfileKind : u8 {
+	CheckProfile_Decl,
+	CheckProfile_ProcBody,
+	CheckProfile_PolySpecialization,
+
+	CheckProfile_COUNT,
+};
+
+char const *check_profile_kind_strings[CheckProfile_COUNT] = {
+	"decl",
+	"proc_body",
+	"poly_specialization",
+};
+
+struct CheckProfileCounters {
+	u64 time;
+	i64 expr_count;
+	i64 allocation_count;
+	i64 allocation_bytes;
+};
+
+struct CheckProfileFrame {
+	CheckProfileFrame *  parent;
+	CheckProfileCounters start;
+	CheckProfileCounters children;
+};
+
+struct CheckProfileEntry {
+	CheckProfileKind     kind;
+	Entity *             entity;
+	Token                token;
+	Type *               type;
+	CheckProfileCounters self;
+	u64                  total_time;
+};
+
+struct CheckProfileState {
+	bool                          enabled;
+	gbMutex                       mutex;
+	Array<Array<CheckProfileEntry> *> thread_entries;
+};
+
+gb_global CheckProfileState global_check_profile = {};
+gb_thread_local CheckProfileFrame *       check_profile_curr_frame = nullptr;
+gb_thread_local Array<CheckProfileEntry> *check_profile_thread_entries = nullptr;
+gb_thread_local i64                       thread_checked_expr_count = 0;
+
+
+void check_profile_init(void) {
+	global_check_profile.enabled = true;
+	gb_mutex_init(&global_check_profile.mutex);
+	array_init(&global_check_profile.thread_entries, heap_allocator());
+}
+
+CheckProfileCounters check_profile_counters_now(void) {
+	CheckProfileCounters c = {};
+	c.time             = time_stamp_time_now();
+	c.expr_count       = thread_checked_expr_count;
+	c.allocation_count = thread_allocation_count;
+	c.allocation_bytes = thread_allocation_bytes;
+	return c;
+}
+
+void check_profile_begin(CheckProfileFrame *frame) {
+	if (!global_check_profile.enabled) {
+		return;
+	}
+	frame->parent = check_profile_curr_frame;
+	frame->start = check_profile_counters_now();
+	check_profile_curr_frame = frame;
+}
+
+void check_profile_end(CheckProfileFrame *frame, CheckProfileKind kind, Entity *entity, Token token, Type *type = nullptr) {
+	if (!global_check_profile.enabled) {
+		return;
+	}
+	GB_ASSERT(check_profile_curr_frame == frame);
+	CheckProfileCounters now = check_profile_counters_now();
+	CheckProfileCounters total = {};
+	total.time             = now.time             - frame->start.time;
+	total.expr_count       = now.expr_count       - frame->start.expr_count;
+	total.allocation_count = now.allocation_count - frame->start.allocation_count;
+	total.allocation_bytes = now.allocation_bytes - frame->start.allocation_bytes;
+
+	CheckProfileEntry entry = {};
+	entry.kind   = kind;
+	entry.entity = entity;
+	entry.token  = token;
+	entry.type   = type;
+	entry.self.time             = total.time             - frame->children.time;
+	entry.self.expr_count       = total.expr_count       - frame->children.expr_count;
+	entry.self.allocation_count = total.allocation_count - frame->children.allocation_count;
+	entry.self.allocation_bytes = total.allocation_bytes - frame->children.allocation_bytes;
+	entry.total_time = total.time;
+
+	CheckProfileFrame *parent = frame->parent;
+	if (parent != nullptr) {
+		parent->children.time             += total.time;
+		parent->children.expr_count       += total.expr_count;
+		parent->children.allocation_count += total.allocation_count;
+		parent->children.allocation_bytes += total.allocation_bytes;
+	}
+	check_profile_curr_frame = parent;
+
+	if (check_profile_thread_entries == nullptr) {
+		check_profile_thread_entries = gb_alloc_item(heap_allocator(), Array<CheckProfileEntry>);
+		array_init(check_profile_thread_entries, heap_allocator(), 0, 1024);
+		gb_mutex_lock(&global_check_profile.mutex);
+		array_add(&global_check_profile.thread_entries, check_profile_thread_entries);
+		gb_mutex_unlock(&global_check_profile.mutex);
+	}
+	array_add(check_profile_thread_entries, entry);
+}
+
+GB_COMPARE_PROC(check_profile_entry_cmp) {
+	CheckProfileEntry const *x = *cast(CheckProfileEntry const **)a;
+	CheckProfileEntry const *y = *cast(CheckProfileEntry const **)b;
+	if (x->self.time != y->self.time) {
+		return x->self.time > y->self.time ? -1 : +1;
+	}
+	return x->token.pos.offset < y->token.pos.offset ? -1 : x->token.pos.offset > y->token.pos.offset;
+}
+
+gbString check_profile_append_csv_field(gbString s, String str) {
+	s = gb_string_appendc(s, "\"");
+	for (isize i = 0; i < str.len; i++) {
+		u8 c = str[i];
+		if (c == '"') {
+			s = gb_string_appendc(s, "\"\"");
+		} else {
+			s = gb_string_append_length(s, &c, 1);
+		}
+	}
+	return gb_string_appendc(s, "\"");
+}
+
+// NOTE: Written as JSON when 'path' ends in ".json", and as CSV otherwise, with the costliest entries first
+void check_profile_write(String path) {
+	if (!global_check_profile.enabled) {
+		return;
+	}
+	bool json = string_ends_with(path, str_lit(".json"));
+	u64 freq = time_stamp__freq();
+
+	auto entries = array_make<CheckProfileEntry *>(heap_allocator());
+	defer (array_free(&entries));
+	for_array(i, global_check_profile.thread_entries) {
+		Array<CheckProfileEntry> *thread_entries = global_check_profile.thread_entries[i];
+		for_array(j, *thread_entries) {
+			array_add(&entries, &(*thread_entries)[j]);
+		}
+	}
+	gb_sort_array(entries.data, entries.count, check_profile_entry_cmp);
+
+	gbString s = gb_string_make_reserve(heap_allocator(), 1<<20);
+	defer (gb_string_free(s));
+	if (json) {
+		s = gb_string_appendc(s, "[");
+	} else {
+		s = gb_string_appendc(s, "kind,name,type,file,line,column,self_us,total_us,expressions,allocations,allocated_bytes\n");
+	}
+	for_array(i, entries) {
+		CheckProfileEntry *e = entries[i];
+		String name = e->entity != nullptr ? e->entity->token.string : e->token.string;
+		if (name.len == 0 || e->token.kind != Token_Ident) {
+			name = str_lit("(anonymous-procedure)");
+		}
+		gbString type_str = nullptr;
+		if (e->type != nullptr) {
+			type_str = type_to_string(e->type);
+		}
+		defer (if (type_str != nullptr) gb_string_free(type_str));
+		String type = type_str != nullptr ? make_string(cast(u8 *)type_str, gb_string_length(type_str)) : String{};
+		TokenPos pos = e->token.pos;
+		f64 self_us  = 1000000.0*cast(f64)e->self.time/cast(f64)freq;
+		f64 total_us = 1000000.0*cast(f64)e->total_time/cast(f64)freq;
+
+		if (json) {
+			s = gb_string_appendc(s, i > 0 ? ",\n{" : "\n{");
+			s = gb_string_append_fmt(s, "\"kind\":\"%s\",\"name\":", check_profile_kind_strings[e->kind]);
+			s = trace_append_json_string(s, name);
+			s = gb_string_appendc(s, ",\"type\":");
+			s = trace_append_json_string(s, type);
+			s = gb_string_appendc(s, ",\"file\":");
+			s = trace_append_json_string(s, pos.file);
+			s = gb_string_append_fmt(s, ",\"line\":%td,\"column\":%td,\"self_us\":%.3f,\"total_us\":%.3f,\"expressions\":%lld,\"allocations\":%lld,\"allocated_bytes\":%lld}",
+			                         pos.line, pos.column, self_us, total_us,
+			                         cast(long long)e->self.expr_count,
+			                         cast(long long)e->self.allocation_count,
+			                         cast(long long)e->self.allocation_bytes);
+		} else {
+			s = gb_string_append_fmt(s, "%s,", check_profile_kind_strings[e->kind]);
+			s = check_profile_append_csv_field(s, name);
+			s = gb_string_appendc(s, ",");
+			s = check_profile_append_csv_field(s, type);
+			s = gb_string_appendc(s, ",");
+			s = check_profile_append_csv_field(s, pos.file);
+			s = gb_string_append_fmt(s, ",%td,%td,%.3f,%.3f,%lld,%lld,%lld\n",
+			                         pos.line, pos.column, self_us, total_us,
+			                         cast(long long)e->self.expr_count,
+			                         cast(long long)e->self.allocation_count,
+			                         cast(long long)e->self.allocation_bytes);
+		}
+	}
+	if (json) {
+		s = gb_string_appendc(s, "\n]\n");
+	}
+
+	char *path_c = alloc_cstring(heap_allocator(), path);
+	defer (gb_free(heap_allocator(), path_c));
+	gbFile f = {};
+	if (gb_file_create(&f, path_c) != gbFileError_None) {
+		gb_printf_err("Unable to create the check profile '%.*s'\n", LIT(path));
+		return;
+	}
+	gb_file_write(&f, s, gb_string_length(s));
+	gb_file_close(&f);
+}
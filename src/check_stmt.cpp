@@ -238,8 +238,7 @@ Type *check_assignment_variable(CheckerContext *ctx, Operand *lhs, Operand *rhs)
 		}
 	} else {
 		if (node->kind == Ast_Ident) {
-			ast_node(i, Ident, node);
-			e = scope_lookup(ctx->scope, i->token.string);
+			e = scope_lookup(ctx->scope, scope_key_of_ident(node));
 			if (e != nullptr && e->kind == Entity_Variable) {
 				used = (e->flags & EntityFlag_Used) != 0; // TODO(bill): Make backup just in case
 			}
@@ -248,7 +247,7 @@ Type *check_assignment_variable(CheckerContext *ctx, Operand *lhs, Operand *rhs)
 	}
 
 	if (e != nullptr && used) {
-		e->flags |= EntityFlag_Used;
+		entity_set_used(e);
 	}
 
 	Type *assignment_type = lhs->type;
@@ -468,9 +467,9 @@ bool check_using_stmt_entity(CheckerContext *ctx, AstUsingStmt *us, Ast *expr, b
 
 	case Entity_ImportName: {
 		Scope *scope = e->ImportName.scope;
-		for_array(i, scope->elements.entries) {
-			String name = scope->elements.entries[i].key.string;
-			Entity *decl = scope->elements.entries[i].value;
+		for (isize i = 0; i < scope->elements.count; i++) {
+			String name = scope_entries(scope)[i].name->string;
+			Entity *decl = scope_entries(scope)[i].entity;
 			if (!is_entity_exported(decl)) continue;
 
 			Entity *found = scope_insert_with_name(ctx->scope, name, decl);
@@ -497,8 +496,8 @@ bool check_using_stmt_entity(CheckerContext *ctx, AstUsingStmt *us, Ast *expr, b
 		if (t->kind == Type_Struct) {
 			// TODO(bill): Make it work for unions too
 			Scope *found = scope_of_node(t->Struct.node);
-			for_array(i, found->elements.entries) {
-				Entity *f = found->elements.entries[i].value;
+			for (isize i = 0; i < found->elements.count; i++) {
+				Entity *f = scope_entries(found)[i].entity;
 				if (f->kind == Entity_Variable) {
 					Entity *uvar = alloc_entity_using_variable(e, f->token, f->type, expr);
 					if (e->flags & EntityFlag_Value) uvar->flags |= EntityFlag_Value;
@@ -1940,6 +1939,9 @@ void check_stmt_internal(CheckerContext *ctx, Ast *node, u32 flags) {
 					}
 					init_entity_foreign_library(ctx, e);
 
+					gb_mutex_lock(&ctx->info->foreign_mutex);
+					defer (gb_mutex_unlock(&ctx->info->foreign_mutex));
+
 					auto *fp = &ctx->checker->info.foreigns;
 					HashKey key = hash_string(name);
 					Entity **found = map_get(fp, key);
@@ -1994,8 +1996,8 @@ void check_stmt_internal(CheckerContext *ctx, Ast *node, u32 flags) {
 						error(token, "'using' cannot be applied variable declared as '_'");
 					} else if (is_type_struct(t) || is_type_raw_union(t)) {
 						Scope *scope = scope_of_node(t->Struct.node);
-						for_array(i, scope->elements.entries) {
-							Entity *f = scope->elements.entries[i].value;
+						for (isize i = 0; i < scope->elements.count; i++) {
+							Entity *f = scope_entries(scope)[i].entity;
 							if (f->kind == Entity_Variable) {
 								Entity *uvar = alloc_entity_using_variable(e, f->token, f->type, nullptr);
 								uvar->flags |= (e->flags & EntityFlag_Value);
@@ -1754,8 +1754,8 @@ Type *check_get_params(CheckerContext *ctx, Scope *scope, Ast *_params, bool *is
 
 	isize specialization_count = 0;
 	if (scope != nullptr) {
-		for_array(i, scope->elements.entries) {
-			Entity *e = scope->elements.entries[i].value;
+		for (isize i = 0; i < scope->elements.count; i++) {
+			Entity *e = scope_entries(scope)[i].entity;
 			if (e->kind == Entity_TypeName) {
 				Type *t = e->type;
 				if (t->kind == Type_Generic &&
@@ -2733,7 +2733,6 @@ void check_map_type(CheckerContext *ctx, Type *type, Ast *node) {
 
 
 	init_core_map_type(ctx->checker);
-	init_map_internal_types(type);
 
 	// error(node, "'map' types are not yet implemented");
 }
@@ -3432,6 +3431,8 @@ bool check_type_internal(CheckerContext *ctx, Ast *e, Type **type, Type *named_t
 		*type = alloc_type(Type_Map);
 		set_base_type(named_type, *type);
 		check_map_type(ctx, *type, e);
+		*type = intern_map_type(*type);
+		set_base_type(named_type, *type);
 		return true;
 	case_end;
 
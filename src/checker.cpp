@@ -1,5 +1,6 @@
 #include "entity.cpp"
 #include "types.cpp"
+#include "check_profile.cpp"
 
 void check_expr(CheckerContext *c, Operand *operand, Ast *expression);
 
@@ -24,19 +25,93 @@ bool is_operand_undef(Operand o) {
 	return o.mode == Addressing_Value && o.type == t_untyped_undef;
 }
 
+bool scope_elements_is_large(ScopeElements *elems) {
+	return elems->large.data != nullptr;
+}
+
+ScopeEntry *scope_entries(Scope *s) {
+	ScopeElements *elems = &s->elements;
+	return scope_elements_is_large(elems) ? elems->large.data : elems->small;
+}
+
+void scope_elements_promote(ScopeElements *elems, isize capacity) {
+	GB_ASSERT(!scope_elements_is_large(elems));
+	capacity = gb_max(capacity, 2*SCOPE_SMALL_ELEMENT_COUNT);
+	array_init(&elems->large, heap_allocator(), 0, capacity);
+	map_init(&elems->index, heap_allocator(), capacity);
+	for (isize i = 0; i < elems->count; i++) {
+		array_add(&elems->large, elems->small[i]);
+		map_set(&elems->index, hash_atom(elems->small[i].name), i);
+	}
+}
+
+ScopeEntry *scope_elements_find(ScopeElements *elems, HashKey key) {
+	if (scope_elements_is_large(elems)) {
+		isize *found = map_get(&elems->index, key);
+		return found != nullptr ? &elems->large[*found] : nullptr;
+	}
+	for (isize i = 0; i < elems->count; i++) {
+		ScopeEntry *entry = &elems->small[i];
+		if (entry->hash != key.key) {
+			continue;
+		}
+		if (key.kind == HashKey_Atom ? entry->name->string.text == key.string.text : entry->name->string == key.string) {
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+// NOTE: Replaces the entity of 'name' if it is already in the scope
+void scope_elements_set(ScopeElements *elems, Atom *name, Entity *entity) {
+	HashKey key = hash_atom(name);
+	ScopeEntry *found = scope_elements_find(elems, key);
+	if (found != nullptr) {
+		found->entity = entity;
+		return;
+	}
+	ScopeEntry entry = {name->hash, name, entity};
+	if (!scope_elements_is_large(elems) && elems->count == SCOPE_SMALL_ELEMENT_COUNT) {
+		scope_elements_promote(elems, 0);
+	}
+	if (scope_elements_is_large(elems)) {
+		map_set(&elems->index, key, elems->large.count);
+		array_add(&elems->large, entry);
+	} else {
+		elems->small[elems->count] = entry;
+	}
+	elems->count += 1;
+}
+
+void scope_elements_destroy(ScopeElements *elems) {
+	if (scope_elements_is_large(elems)) {
+		array_free(&elems->large);
+		map_destroy(&elems->index);
+		elems->large = {};
+		elems->index = {};
+	}
+	elems->count = 0;
+}
+
 void scope_reset(Scope *scope) {
 	if (scope == nullptr) return;
 
 	scope->first_child = nullptr;
 	scope->last_child  = nullptr;
-	map_clear    (&scope->elements);
+	scope_elements_destroy(&scope->elements);
 	ptr_set_clear(&scope->imported);
 }
 
 void scope_reserve(Scope *scope, isize capacity) {
-	isize cap = 2*capacity;
-	if (cap > scope->elements.hashes.count) {
-		map_rehash(&scope->elements, capacity);
+	ScopeElements *elems = &scope->elements;
+	if (capacity <= SCOPE_SMALL_ELEMENT_COUNT) {
+		return;
+	}
+	if (!scope_elements_is_large(elems)) {
+		scope_elements_promote(elems, capacity);
+	} else if (2*capacity > elems->index.hashes.count) {
+		array_reserve(&elems->large, capacity);
+		map_rehash(&elems->index, capacity);
 	}
 }
 
@@ -218,17 +293,41 @@ bool decl_info_has_init(DeclInfo *d) {
 
 
 
-Scope *create_scope(Scope *parent, gbAllocator allocator, isize init_elements_capacity=16) {
+// NOTE: Guards the child lists of scopes, as procedure bodies checked in parallel may share a parent scope
+gb_global gbMutex scope_children_mutex;
+
+// NOTE: Per thread as procedure bodies may be checked in parallel
+gb_thread_local CheckerContext *checker_curr_ctx = nullptr;
+gb_thread_local ProcBodyTask *  checker_curr_proc_task = nullptr; // NOTE: Set while a worker thread checks a procedure body
+
+// NOTE: Directs what this thread adds to the shared checker state into 'task', or back to the checker when it
+// is null, and returns the previous task
+ProcBodyTask *set_curr_proc_task(ProcBodyTask *task) {
+	ProcBodyTask *prev = checker_curr_proc_task;
+	checker_curr_proc_task = task;
+	thread_deferred_errors = task != nullptr ? &task->errors       : nullptr;
+	thread_new_entities    = task != nullptr ? &task->new_entities : nullptr;
+	return prev;
+}
+
+void proc_body_task_init(ProcBodyTask *task, Checker *c, ProcInfo const &pi);
+void proc_body_task_destroy(ProcBodyTask *task);
+void proc_body_task_append(ProcBodyTask *dst, ProcBodyTask *src);
+
+
+Scope *create_scope(Scope *parent, gbAllocator allocator, isize init_elements_capacity=0) {
 	Scope *s = gb_alloc_item(allocator, Scope);
 	s->parent = parent;
-	map_init(&s->elements, heap_allocator(), init_elements_capacity);
+	scope_reserve(s, init_elements_capacity);
 	ptr_set_init(&s->imported, heap_allocator(), 0);
 
 	s->delayed_imports.allocator = heap_allocator();
 	s->delayed_directives.allocator = heap_allocator();
 
 	if (parent != nullptr && parent != builtin_pkg->scope) {
+		gb_mutex_lock(&scope_children_mutex);
 		DLIST_APPEND(parent->first_child, parent->last_child, s);
+		gb_mutex_unlock(&scope_children_mutex);
 	}
 	return s;
 }
@@ -280,8 +379,8 @@ Scope *create_scope_from_package(CheckerContext *c, AstPackage *pkg) {
 }
 
 void destroy_scope(Scope *scope) {
-	for_array(i, scope->elements.entries) {
-		Entity *e =scope->elements.entries[i].value;
+	for (isize i = 0; i < scope->elements.count; i++) {
+		Entity *e = scope_entries(scope)[i].entity;
 		if (e->kind == Entity_Variable) {
 			if (!(e->flags & EntityFlag_Used)) {
 #if 0
@@ -295,7 +394,7 @@ void destroy_scope(Scope *scope) {
 		destroy_scope(child);
 	}
 
-	map_destroy(&scope->elements);
+	scope_elements_destroy(&scope->elements);
 	array_free(&scope->delayed_imports);
 	array_free(&scope->delayed_directives);
 	ptr_set_destroy(&scope->imported);
@@ -340,23 +439,34 @@ void check_close_scope(CheckerContext *c) {
 }
 
 
-Entity *scope_lookup_current(Scope *s, String name) {
-	HashKey key = hash_string(name);
-	Entity **found = map_get(&s->elements, key);
+// NOTE: The key of an identifier's name in a scope, which is its atom when it has one
+HashKey scope_key_of_ident(Ast *ident) {
+	GB_ASSERT(ident->kind == Ast_Ident);
+	if (ident->Ident.atom != nullptr) {
+		return hash_atom(ident->Ident.atom);
+	}
+	return hash_string(ident->Ident.token.string);
+}
+
+Entity *scope_lookup_current(Scope *s, HashKey key) {
+	ScopeEntry *found = scope_elements_find(&s->elements, key);
 	if (found) {
-		return *found;
+		return found->entity;
 	}
 	return nullptr;
 }
 
-void scope_lookup_parent(Scope *scope, String name, Scope **scope_, Entity **entity_) {
+Entity *scope_lookup_current(Scope *s, String name) {
+	return scope_lookup_current(s, hash_string(name));
+}
+
+void scope_lookup_parent(Scope *scope, HashKey key, Scope **scope_, Entity **entity_) {
 	bool gone_thru_proc = false;
 	bool gone_thru_package = false;
-	HashKey key = hash_string(name);
 	for (Scope *s = scope; s != nullptr; s = s->parent) {
-		Entity **found = map_get(&s->elements, key);
+		ScopeEntry *found = scope_elements_find(&s->elements, key);
 		if (found) {
-			Entity *e = *found;
+			Entity *e = found->entity;
 			if (gone_thru_proc) {
 				// IMPORTANT TODO(bill): Is this correct?!
 				if (e->kind == Entity_Label) {
@@ -386,34 +496,43 @@ void scope_lookup_parent(Scope *scope, String name, Scope **scope_, Entity **ent
 	if (scope_) *scope_ = nullptr;
 }
 
-Entity *scope_lookup(Scope *s, String name) {
+void scope_lookup_parent(Scope *scope, String name, Scope **scope_, Entity **entity_) {
+	scope_lookup_parent(scope, hash_string(name), scope_, entity_);
+}
+
+Entity *scope_lookup(Scope *s, HashKey key) {
 	Entity *entity = nullptr;
-	scope_lookup_parent(s, name, nullptr, &entity);
+	scope_lookup_parent(s, key, nullptr, &entity);
 	return entity;
 }
 
+Entity *scope_lookup(Scope *s, String name) {
+	return scope_lookup(s, hash_string(name));
+}
+
 
 
 Entity *scope_insert_with_name(Scope *s, String name, Entity *entity) {
 	if (name == "") {
 		return nullptr;
 	}
-	HashKey key = hash_string(name);
-	Entity **found = map_get(&s->elements, key);
+	Atom *atom = atom_intern(name);
+	HashKey key = hash_atom(atom);
+	ScopeEntry *found = scope_elements_find(&s->elements, key);
 
 	if (found) {
-		return *found;
+		return found->entity;
 	}
 	if (s->parent != nullptr && (s->parent->flags & ScopeFlag_Proc) != 0) {
-		Entity **found = map_get(&s->parent->elements, key);
+		ScopeEntry *found = scope_elements_find(&s->parent->elements, key);
 		if (found) {
-			if ((*found)->flags & EntityFlag_Result) {
-				return *found;
+			if (found->entity->flags & EntityFlag_Result) {
+				return found->entity;
 			}
 		}
 	}
 
-	map_set(&s->elements, key, entity);
+	scope_elements_set(&s->elements, atom, entity);
 	if (entity->scope == nullptr) {
 		entity->scope = s;
 	}
@@ -546,8 +665,8 @@ void check_scope_usage(Checker *c, Scope *scope) {
 	Array<VettedEntity> vetted_entities = {};
 	array_init(&vetted_entities, heap_allocator());
 
-	for_array(i, scope->elements.entries) {
-		Entity *e = scope->elements.entries[i].value;
+	for (isize i = 0; i < scope->elements.count; i++) {
+		Entity *e = scope_entries(scope)[i].entity;
 		if (e == nullptr) continue;
 		VettedEntity ve = {};
 		if (vet_unused && check_vet_unused(c, e, &ve)) {
@@ -673,6 +792,9 @@ void init_universal(void) {
 	// NOTE(bill): No need to free these
 	gbAllocator a = heap_allocator();
 
+	gb_mutex_init(&scope_children_mutex);
+	init_type_intern_table();
+
 	builtin_pkg = gb_alloc_item(a, AstPackage);
 	builtin_pkg->name = str_lit("builtin");
 	builtin_pkg->kind = Package_Normal;
@@ -791,20 +913,108 @@ void init_universal(void) {
 
 
 
+void untyped_table_init(UntypedTable *t, gbAllocator a) {
+	array_init(&t->exprs, a);
+	array_init(&t->infos, a);
+	array_init(&t->valid, a);
+	t->count = 0;
+}
+
+void untyped_table_destroy(UntypedTable *t) {
+	array_free(&t->exprs);
+	array_free(&t->infos);
+	array_free(&t->valid);
+	t->count = 0;
+}
+
+gb_inline bool untyped_table_is_valid(UntypedTable *t, isize index) {
+	return (t->valid[index/64] & (1ull<<(index%64))) != 0;
+}
+
+// NOTE: The slot of 'expr' in the table, valid or not, or -1
+gb_inline isize untyped_table_slot(UntypedTable *t, Ast *expr) {
+	isize index = expr->untyped_index;
+	if (0 <= index && index < t->exprs.count && t->exprs[index] == expr) {
+		return index;
+	}
+	return -1;
+}
+
+ExprInfo *untyped_table_get(UntypedTable *t, Ast *expr) {
+	isize index = untyped_table_slot(t, expr);
+	if (index >= 0 && untyped_table_is_valid(t, index)) {
+		return &t->infos[index];
+	}
+	return nullptr;
+}
+
+void untyped_table_set(UntypedTable *t, Ast *expr, ExprInfo info) {
+	isize index = untyped_table_slot(t, expr);
+	if (index < 0) {
+		index = t->exprs.count;
+		GB_ASSERT(index < I32_MAX);
+		array_add(&t->exprs, expr);
+		array_add(&t->infos, info);
+		if (index/64 >= t->valid.count) {
+			array_add(&t->valid, cast(u64)0);
+		}
+		expr->untyped_index = cast(i32)index;
+	} else {
+		t->infos[index] = info;
+	}
+	if (!untyped_table_is_valid(t, index)) {
+		t->valid[index/64] |= 1ull<<(index%64);
+		t->count += 1;
+	}
+}
+
+void untyped_table_remove(UntypedTable *t, Ast *expr) {
+	isize index = untyped_table_slot(t, expr);
+	if (index >= 0 && untyped_table_is_valid(t, index)) {
+		t->valid[index/64] &= ~(1ull<<(index%64));
+		t->count -= 1;
+	}
+}
+
+// NOTE: The first valid slot at or after 'index', or 'exprs.count' if there is none
+isize untyped_table_next(UntypedTable *t, isize index) {
+	while (index < t->exprs.count) {
+		u64 word = t->valid[index/64] >> (index%64);
+		if (word != 0) {
+		#if defined(GB_COMPILER_MSVC)
+			unsigned long bit = 0;
+			_BitScanForward64(&bit, word);
+			return index + cast(isize)bit;
+		#else
+			return index + cast(isize)__builtin_ctzll(word);
+		#endif
+		}
+		index = (index/64 + 1)*64;
+	}
+	return t->exprs.count;
+}
+
+#define for_untyped_table(index_, table_) for (isize index_ = untyped_table_next(&(table_), 0); index_ < (table_).exprs.count; index_ = untyped_table_next(&(table_), index_+1))
+
+
 void init_checker_info(CheckerInfo *i) {
 	gbAllocator a = heap_allocator();
 	array_init(&i->definitions,   a);
 	array_init(&i->entities,      a);
-	map_init(&i->untyped,         a);
+	untyped_table_init(&i->untyped, a);
 	map_init(&i->foreigns,        a);
 	map_init(&i->gen_procs,       a);
 	map_init(&i->gen_types,       a);
+	map_init(&i->gen_proc_cache,  a);
+	map_init(&i->gen_proc_tasks,  a);
 	array_init(&i->type_info_types, a);
 	map_init(&i->type_info_map,   a);
 	map_init(&i->files,           a);
 	map_init(&i->packages,        a);
 	array_init(&i->variable_init_order, a);
 	array_init(&i->required_foreign_imports_through_force, a);
+	gb_mutex_init(&i->gen_mutex);
+	gb_mutex_init(&i->foreign_mutex);
 
 	i->allow_identifier_uses = build_context.query_data_set_settings.kind == QueryDataSet_GoToDefinitions;
 	if (i->allow_identifier_uses) {
@@ -815,10 +1025,12 @@ void init_checker_info(CheckerInfo *i) {
 void destroy_checker_info(CheckerInfo *i) {
 	array_free(&i->definitions);
 	array_free(&i->entities);
-	map_destroy(&i->untyped);
+	untyped_table_destroy(&i->untyped);
 	map_destroy(&i->foreigns);
 	map_destroy(&i->gen_procs);
 	map_destroy(&i->gen_types);
+	map_destroy(&i->gen_proc_cache);
+	map_destroy(&i->gen_proc_tasks);
 	array_free(&i->type_info_types);
 	map_destroy(&i->type_info_map);
 	map_destroy(&i->files);
@@ -826,13 +1038,15 @@ void destroy_checker_info(CheckerInfo *i) {
 	array_free(&i->variable_init_order);
 	array_free(&i->identifier_uses);
 	array_free(&i->required_foreign_imports_through_force);
-
+	gb_mutex_destroy(&i->gen_mutex);
+	gb_mutex_destroy(&i->foreign_mutex);
 }
 
 CheckerContext make_checker_context(Checker *c) {
 	CheckerContext ctx = c->init_ctx;
 	ctx.checker   = c;
 	ctx.info      = &c->info;
+	ctx.untyped   = &c->info.untyped;
 	ctx.allocator = c->allocator;
 	ctx.scope     = builtin_pkg->scope;
 	ctx.pkg       = builtin_pkg;
@@ -861,6 +1075,8 @@ bool init_checker(Checker *c, Parser *parser) {
 
 	array_init(&c->procs_to_check, a);
 	array_init(&c->procs_with_deferred_to_check, a);
+	array_init(&c->package_groups, a);
+	ptr_set_init(&c->unchanged_packages, a);
 
 	// NOTE(bill): Is this big enough or too small?
 	isize item_size = gb_max3(gb_size_of(Entity), gb_size_of(Type), gb_size_of(Scope));
@@ -878,6 +1094,11 @@ void destroy_checker(Checker *c) {
 
 	array_free(&c->procs_to_check);
 	array_free(&c->procs_with_deferred_to_check);
+	for_array(i, c->package_groups) {
+		array_free(&c->package_groups[i].packages);
+	}
+	array_free(&c->package_groups);
+	ptr_set_destroy(&c->unchanged_packages);
 
 	destroy_checker_context(&c->init_ctx);
 }
@@ -962,14 +1183,14 @@ AstFile *ast_file_of_filename(CheckerInfo *i, String filename) {
 Scope *scope_of_node(Ast *node) {
 	return node->scope;
 }
-ExprInfo *check_get_expr_info(CheckerInfo *i, Ast *expr) {
-	return map_get(&i->untyped, hash_node(expr));
+ExprInfo *check_get_expr_info(CheckerContext *c, Ast *expr) {
+	return untyped_table_get(c->untyped, expr);
 }
-void check_set_expr_info(CheckerInfo *i, Ast *expr, ExprInfo info) {
-	map_set(&i->untyped, hash_node(expr), info);
+void check_set_expr_info(CheckerContext *c, Ast *expr, ExprInfo info) {
+	untyped_table_set(c->untyped, expr, info);
 }
-void check_remove_expr_info(CheckerInfo *i, Ast *expr) {
-	map_remove(&i->untyped, hash_node(expr));
+void check_remove_expr_info(CheckerContext *c, Ast *expr) {
+	untyped_table_remove(c->untyped, expr);
 }
 
 
@@ -1008,7 +1229,7 @@ isize type_info_index(CheckerInfo *info, Type *type, bool error_on_failure) {
 }
 
 
-void add_untyped(CheckerInfo *i, Ast *expression, bool lhs, AddressingMode mode, Type *type, ExactValue value) {
+void add_untyped(CheckerContext *c, Ast *expression, bool lhs, AddressingMode mode, Type *type, ExactValue value) {
 	if (expression == nullptr) {
 		return;
 	}
@@ -1018,7 +1239,7 @@ void add_untyped(CheckerInfo *i, Ast *expression, bool lhs, AddressingMode mode,
 	if (mode == Addressing_Constant && type == t_invalid) {
 		compiler_error("add_untyped - invalid type: %s", type_to_string(type));
 	}
-	map_set(&i->untyped, hash_node(expression), make_expr_info(mode, type, value, lhs));
+	untyped_table_set(c->untyped, expression, make_expr_info(mode, type, value, lhs));
 }
 
 void add_type_and_value(CheckerInfo *i, Ast *expr, AddressingMode mode, Type *type, ExactValue value) {
@@ -1054,7 +1275,11 @@ void add_entity_definition(CheckerInfo *i, Ast *identifier, Entity *entity) {
 	GB_ASSERT(entity != nullptr);
 	identifier->Ident.entity = entity;
 	entity->identifier = identifier;
-	array_add(&i->definitions, entity);
+	if (checker_curr_proc_task != nullptr) {
+		array_add(&checker_curr_proc_task->definitions, entity);
+	} else {
+		array_add(&i->definitions, entity);
+	}
 }
 
 bool redeclaration_error(String name, Entity *prev, Entity *found) {
@@ -1112,8 +1337,8 @@ bool add_entity_with_name(Checker *c, Scope *scope, Ast *identifier, Entity *ent
 	}
 	if (identifier != nullptr) {
 		if (entity->file == nullptr) {
-			GB_ASSERT(c->curr_ctx != nullptr);
-			entity->file = c->curr_ctx->file;
+			GB_ASSERT(checker_curr_ctx != nullptr);
+			entity->file = checker_curr_ctx->file;
 		}
 		add_entity_definition(&c->info, identifier, entity);
 	}
@@ -1131,13 +1356,15 @@ void add_entity_use(CheckerContext *c, Ast *identifier, Entity *entity) {
 		if (identifier->kind != Ast_Ident) {
 			return;
 		}
-		if (entity->identifier == nullptr) {
-			entity->identifier = identifier;
-		}
+		entity_set_identifier(entity, identifier);
 		identifier->Ident.entity = entity;
 
 		if (c->info->allow_identifier_uses) {
-			array_add(&c->info->identifier_uses, identifier);
+			if (c->proc_task != nullptr) {
+				array_add(&c->proc_task->identifier_uses, identifier);
+			} else {
+				array_add(&c->info->identifier_uses, identifier);
+			}
 		}
 
 		String dmsg = entity->deprecated_message;
@@ -1145,7 +1372,7 @@ void add_entity_use(CheckerContext *c, Ast *identifier, Entity *entity) {
 			warning(identifier, "%.*s is deprecated: %.*s", LIT(entity->token.string), LIT(dmsg));
 		}
 	}
-	entity->flags |= EntityFlag_Used;
+	entity_set_used(entity);
 	add_declaration_dependency(c, entity);
 	if (entity_has_deferred_procedure(entity)) {
 		Entity *deferred = entity->Procedure.deferred_procedure.entity;
@@ -1177,8 +1404,13 @@ void add_entity_and_decl_info(CheckerContext *c, Ast *identifier, Entity *e, Dec
 	GB_ASSERT(e->decl_info == nullptr);
 	e->decl_info = d;
 	d->entity = e;
-	array_add(&c->checker->info.entities, e);
-	e->order_in_src = c->checker->info.entities.count;
+	if (c->proc_task != nullptr) {
+		// NOTE: 'order_in_src' is set when the task is merged
+		array_add(&c->proc_task->entities, e);
+	} else {
+		array_add(&c->checker->info.entities, e);
+		e->order_in_src = c->checker->info.entities.count;
+	}
 	e->pkg = c->pkg;
 }
 
@@ -1211,6 +1443,14 @@ void add_type_info_type(CheckerContext *c, Type *t) {
 
 	add_type_info_dependency(c->decl, t);
 
+	if (c->proc_task != nullptr) {
+		// NOTE: Added once the batch of procedure bodies has been checked so that the order of
+		// 'type_info_types' does not depend on thread timing
+		DeferredTypeInfo dti = {c->decl, t};
+		array_add(&c->proc_task->type_info_types, dti);
+		return;
+	}
+
 	auto found = map_get(&c->info->type_info_map, hash_type(t));
 	if (found != nullptr) {
 		// Types have already been added
@@ -1348,8 +1588,8 @@ void add_type_info_type(CheckerContext *c, Type *t) {
 
 	case Type_Struct:
 		if (bt->Struct.scope != nullptr) {
-			for_array(i, bt->Struct.scope->elements.entries) {
-				Entity *e = bt->Struct.scope->elements.entries[i].value;
+			for (isize i = 0; i < bt->Struct.scope->elements.count; i++) {
+				Entity *e = scope_entries(bt->Struct.scope)[i].entity;
 				switch (bt->Struct.soa_kind) {
 				case StructSoa_Dynamic:
 					add_type_info_type(c, t_allocator);
@@ -1399,12 +1639,16 @@ void add_type_info_type(CheckerContext *c, Type *t) {
 	}
 }
 
-void check_procedure_later(Checker *c, ProcInfo info) {
+void check_procedure_later(CheckerContext *c, ProcInfo info) {
 	GB_ASSERT(info.decl != nullptr);
-	array_add(&c->procs_to_check, info);
+	if (c->proc_task != nullptr) {
+		array_add(&c->proc_task->procs_to_check, info);
+	} else {
+		array_add(&c->checker->procs_to_check, info);
+	}
 }
 
-void check_procedure_later(Checker *c, AstFile *file, Token token, DeclInfo *decl, Type *type, Ast *body, u64 tags) {
+void check_procedure_later(CheckerContext *c, AstFile *file, Token token, DeclInfo *decl, Type *type, Ast *body, u64 tags) {
 	ProcInfo info = {};
 	info.file  = file;
 	info.token = token;
@@ -1417,13 +1661,15 @@ void check_procedure_later(Checker *c, AstFile *file, Token token, DeclInfo *dec
 
 void add_curr_ast_file(CheckerContext *ctx, AstFile *file) {
 	if (file != nullptr) {
-		TokenPos zero_pos = {};
-		global_error_collector.prev = zero_pos;
+		if (ctx->proc_task == nullptr) {
+			TokenPos zero_pos = {};
+			global_error_collector.prev = zero_pos;
+		}
 		ctx->file  = file;
 		ctx->decl  = file->pkg->decl_info;
 		ctx->scope = file->scope;
 		ctx->pkg   = file->pkg;
-		ctx->checker->curr_ctx = ctx;
+		checker_curr_ctx = ctx;
 	}
 }
 
@@ -1554,8 +1800,8 @@ void add_min_dep_type_info(Checker *c, Type *t) {
 			add_min_dep_type_info(c, f->type);
 		}
 		if (bt->Struct.scope != nullptr) {
-			for_array(i, bt->Struct.scope->elements.entries) {
-				Entity *e = bt->Struct.scope->elements.entries[i].value;
+			for (isize i = 0; i < bt->Struct.scope->elements.count; i++) {
+				Entity *e = scope_entries(bt->Struct.scope)[i].entity;
 				add_min_dep_type_info(c, e->type);
 			}
 		}
@@ -1855,7 +2101,7 @@ Array<EntityGraphNode *> generate_entity_dependency_graph(CheckerInfo *info) {
 }
 
 
-void check_single_global_entity(Checker *c, Entity *e, DeclInfo *d);
+void check_single_global_entity(Checker *c, Entity *e, DeclInfo *d, ProcBodyTask *task=nullptr);
 
 
 Entity *find_core_entity(Checker *c, String name) {
@@ -2062,7 +2308,8 @@ void init_core_map_type(Checker *c) {
 	if (t_map_key == nullptr) {
 		Entity *e = find_core_entity(c, str_lit("Map_Key"));
 		if (e->state == EntityState_Unresolved) {
-			auto ctx = c->init_ctx;
+			auto ctx = make_checker_context(c);
+			defer (destroy_checker_context(&ctx));
 			check_entity_decl(&ctx, e, nullptr, nullptr);
 		}
 		t_map_key = e->type;
@@ -2072,7 +2319,8 @@ void init_core_map_type(Checker *c) {
 	if (t_map_header == nullptr) {
 		Entity *e = find_core_entity(c, str_lit("Map_Header"));
 		if (e->state == EntityState_Unresolved) {
-			auto ctx = c->init_ctx;
+			auto ctx = make_checker_context(c);
+			defer (destroy_checker_context(&ctx));
 			check_entity_decl(&ctx, e, nullptr, nullptr);
 		}
 		t_map_header = e->type;
@@ -2903,7 +3151,7 @@ void check_collect_entities(CheckerContext *c, Array<Ast *> const &nodes) {
 }
 
 
-void check_single_global_entity(Checker *c, Entity *e, DeclInfo *d) {
+void check_single_global_entity(Checker *c, Entity *e, DeclInfo *d, ProcBodyTask *task) {
 	GB_ASSERT(e != nullptr);
 	GB_ASSERT(d != nullptr);
 
@@ -2915,6 +3163,15 @@ void check_single_global_entity(Checker *c, Entity *e, DeclInfo *d) {
 	}
 
 	CheckerContext ctx = c->init_ctx;
+	if (task != nullptr) {
+		// NOTE: A worker needs its own type and polymorphic paths, see 'check_type_path_push'
+		ctx = make_checker_context(c);
+		ctx.proc_task = task;
+		ctx.untyped   = &task->untyped;
+	}
+	defer (if (task != nullptr) {
+		destroy_checker_context(&ctx);
+	});
 
 	GB_ASSERT(d->scope->flags&ScopeFlag_File);
 	AstFile *file = d->scope->file;
@@ -3269,9 +3526,9 @@ void check_add_import_decl(CheckerContext *ctx, Ast *decl) {
 		}
 
 		// NOTE(bill): Add imported entities to this file's scope
-		for_array(elem_index, scope->elements.entries) {
-			String name = scope->elements.entries[elem_index].key.string;
-			Entity *e = scope->elements.entries[elem_index].value;
+		for (isize elem_index = 0; elem_index < scope->elements.count; elem_index++) {
+			String name = scope_entries(scope)[elem_index].name->string;
+			Entity *e = scope_entries(scope)[elem_index].entity;
 			if (e->scope == parent_scope) continue;
 
 			if (is_entity_exported(e, true)) {
@@ -3351,7 +3608,11 @@ void check_add_foreign_import_decl(CheckerContext *ctx, Ast *decl) {
 	AttributeContext ac = {};
 	check_decl_attributes(ctx, fl->attributes, foreign_import_decl_attribute, &ac);
 	if (ac.force_foreign_import) {
-		array_add(&ctx->info->required_foreign_imports_through_force, e);
+		if (ctx->proc_task != nullptr) {
+			array_add(&ctx->proc_task->required_foreign_imports, e);
+		} else {
+			array_add(&ctx->info->required_foreign_imports_through_force, e);
+		}
 		add_entity_use(ctx, nullptr, e);
 	}
 }
@@ -3518,8 +3779,228 @@ bool collect_file_decls(CheckerContext *ctx, Array<Ast *> const &decls) {
 	return false;
 }
 
+struct PackageComponents {
+	Map<isize>                index;     // Key: ImportGraphNode *
+	Map<isize>                lowlink;   // Key: ImportGraphNode *
+	Map<isize>                component; // Key: ImportGraphNode *
+	Array<ImportGraphNode *>  stack;
+	PtrSet<ImportGraphNode *> on_stack;
+	isize                     component_count;
+};
+
+// NOTE: Tarjan's algorithm, which numbers a component after every component it imports
+void package_components_visit(PackageComponents *pc, ImportGraphNode *n) {
+	isize index = pc->index.entries.count;
+	isize low = index;
+	map_set(&pc->index, hash_pointer(n), index);
+	array_add(&pc->stack, n);
+	ptr_set_add(&pc->on_stack, n);
+
+	for_array(i, n->succ.entries) {
+		ImportGraphNode *m = n->succ.entries[i].ptr;
+		isize *found = map_get(&pc->index, hash_pointer(m));
+		if (found == nullptr) {
+			package_components_visit(pc, m);
+			low = gb_min(low, *map_get(&pc->lowlink, hash_pointer(m)));
+		} else if (ptr_set_exists(&pc->on_stack, m)) {
+			low = gb_min(low, *found);
+		}
+	}
+	map_set(&pc->lowlink, hash_pointer(n), low);
+
+	if (low == index) {
+		isize component = pc->component_count++;
+		for (;;) {
+			ImportGraphNode *m = array_pop(&pc->stack);
+			ptr_set_remove(&pc->on_stack, m);
+			map_set(&pc->component, hash_pointer(m), component);
+			if (m == n) {
+				break;
+			}
+		}
+	}
+}
+
+// NOTE: The groups of a wave do not import each other, so their global entities may be checked at the
+// same time once the earlier waves have been checked. The first wave is the runtime and everything it
+// imports, as every package may refer to the types of the runtime without importing it.
+void generate_package_groups(Checker *c, Array<ImportGraphNode *> const &package_order) {
+	gbAllocator a = heap_allocator();
+	PackageComponents pc = {};
+	map_init(&pc.index,     a, 2*package_order.count);
+	map_init(&pc.lowlink,   a, 2*package_order.count);
+	map_init(&pc.component, a, 2*package_order.count);
+	array_init(&pc.stack, a);
+	ptr_set_init(&pc.on_stack, a);
+	defer ({
+		map_destroy(&pc.index);
+		map_destroy(&pc.lowlink);
+		map_destroy(&pc.component);
+		array_free(&pc.stack);
+		ptr_set_destroy(&pc.on_stack);
+	});
+
+	for_array(i, package_order) {
+		if (map_get(&pc.index, hash_pointer(package_order[i])) == nullptr) {
+			package_components_visit(&pc, package_order[i]);
+		}
+	}
+
+	auto waves = array_make<isize>(a, pc.component_count);
+	defer (array_free(&waves));
+	auto first_wave = array_make<bool>(a, pc.component_count);
+	defer (array_free(&first_wave));
+	auto members = array_make<Array<ImportGraphNode *> >(a, pc.component_count);
+	defer ({
+		for_array(i, members) {
+			array_free(&members[i]);
+		}
+		array_free(&members);
+	});
+	for_array(i, members) {
+		waves[i] = 0;
+		first_wave[i] = false;
+		array_init(&members[i], a);
+	}
+	auto component_order = array_make<isize>(a, 0, pc.component_count);
+	defer (array_free(&component_order));
+	for_array(i, package_order) {
+		ImportGraphNode *n = package_order[i];
+		isize component = *map_get(&pc.component, hash_pointer(n));
+		if (members[component].count == 0) {
+			array_add(&component_order, component);
+		}
+		array_add(&members[component], n);
+	}
+
+	auto stack = array_make<ImportGraphNode *>(a);
+	defer (array_free(&stack));
+	for_array(i, package_order) {
+		if (package_order[i]->pkg->kind == Package_Runtime) {
+			array_add(&stack, package_order[i]);
+		}
+	}
+	while (stack.count > 0) {
+		ImportGraphNode *n = array_pop(&stack);
+		isize component = *map_get(&pc.component, hash_pointer(n));
+		if (first_wave[component]) {
+			continue;
+		}
+		first_wave[component] = true;
+		for_array(i, members[component]) {
+			ImportGraphNode *m = members[component][i];
+			for_array(j, m->succ.entries) {
+				array_add(&stack, m->succ.entries[j].ptr);
+			}
+		}
+	}
+
+	isize wave_count = 1;
+	for (isize component = 0; component < pc.component_count; component++) {
+		if (first_wave[component]) {
+			continue;
+		}
+		isize wave = 1;
+		for_array(i, members[component]) {
+			ImportGraphNode *n = members[component][i];
+			for_array(j, n->succ.entries) {
+				isize other = *map_get(&pc.component, hash_pointer(n->succ.entries[j].ptr));
+				if (other != component) {
+					wave = gb_max(wave, waves[other]+1);
+				}
+			}
+		}
+		waves[component] = wave;
+		wave_count = gb_max(wave_count, wave+1);
+	}
+
+	for (isize wave = 0; wave < wave_count; wave++) {
+		for_array(i, component_order) {
+			isize component = component_order[i];
+			if (waves[component] != wave) {
+				continue;
+			}
+			PackageGroup group = {};
+			group.wave = wave;
+			array_init(&group.packages, a);
+			for_array(j, members[component]) {
+				AstPackage *pkg = members[component][j]->pkg;
+				if (pkg->used) {
+					array_add(&group.packages, pkg);
+				}
+			}
+			if (group.packages.count > 0) {
+				array_add(&c->package_groups, group);
+			} else {
+				array_free(&group.packages);
+			}
+		}
+	}
+}
+
+// NOTE: For 'odin check -watch', finds the packages whose procedure bodies need not be checked again: those
+// which passed the last check and neither changed since nor import, directly or not, a package which did.
+// A change to the runtime, or to a package it imports, affects every package.
+void find_unchanged_packages(Checker *c, Array<ImportGraphNode *> const &dep_graph) {
+	if (!watch_worker_active() || watch_clean_dirs.entries.count == 0) {
+		return;
+	}
+	gbAllocator a = heap_allocator();
+
+	PtrSet<ImportGraphNode *> affected = {};
+	ptr_set_init(&affected, a);
+	defer (ptr_set_destroy(&affected));
+
+	auto stack = array_make<ImportGraphNode *>(a);
+	defer (array_free(&stack));
+	for_array(i, dep_graph) {
+		if (!string_set_exists(&watch_clean_dirs, watch_package_dir(dep_graph[i]->pkg))) {
+			array_add(&stack, dep_graph[i]);
+		}
+	}
+	while (stack.count > 0) {
+		ImportGraphNode *n = array_pop(&stack);
+		if (ptr_set_exists(&affected, n)) {
+			continue;
+		}
+		ptr_set_add(&affected, n);
+		for_array(i, n->pred.entries) {
+			array_add(&stack, n->pred.entries[i].ptr);
+		}
+	}
+
+	PtrSet<ImportGraphNode *> runtime_deps = {};
+	ptr_set_init(&runtime_deps, a);
+	defer (ptr_set_destroy(&runtime_deps));
+	for_array(i, dep_graph) {
+		if (dep_graph[i]->pkg->kind == Package_Runtime) {
+			array_add(&stack, dep_graph[i]);
+		}
+	}
+	while (stack.count > 0) {
+		ImportGraphNode *n = array_pop(&stack);
+		if (ptr_set_exists(&runtime_deps, n)) {
+			continue;
+		}
+		if (ptr_set_exists(&affected, n)) {
+			return;
+		}
+		ptr_set_add(&runtime_deps, n);
+		for_array(i, n->succ.entries) {
+			array_add(&stack, n->succ.entries[i].ptr);
+		}
+	}
+
+	for_array(i, dep_graph) {
+		if (!ptr_set_exists(&affected, dep_graph[i])) {
+			ptr_set_add(&c->unchanged_packages, dep_graph[i]->pkg);
+		}
+	}
+}
+
 void check_import_entities(Checker *c) {
 	Array<ImportGraphNode *> dep_graph = generate_import_dependency_graph(c);
+	find_unchanged_packages(c, dep_graph);
 	defer ({
 		for_array(i, dep_graph) {
 			import_graph_node_destroy(dep_graph[i], heap_allocator());
@@ -3661,6 +4142,8 @@ void check_import_entities(Checker *c) {
 		ImportGraphNode *node = package_order[i];
 		GB_ASSERT(node->scope->flags&ScopeFlag_Pkg);
 		AstPackage *pkg = node->scope->pkg;
+		u64 trace_start = trace_time_now();
+		defer (trace_add_event("import entities", pkg->fullpath, trace_start));
 
 		for_array(i, pkg->files) {
 			AstFile *f = pkg->files[i];
@@ -3684,6 +4167,8 @@ void check_import_entities(Checker *c) {
 			}
 		}
 	}
+
+	generate_package_groups(c, package_order);
 }
 
 Array<Entity *> find_entity_path(Entity *start, Entity *end, Map<Entity *> *visited = nullptr) {
@@ -3808,16 +4293,31 @@ void calculate_global_init_order(Checker *c) {
 }
 
 
-void check_proc_info(Checker *c, ProcInfo pi) {
+void check_proc_info(Checker *c, ProcInfo pi, ProcBodyTask *task) {
 	if (pi.type == nullptr) {
 		return;
 	}
+	if (!pi.generated_from_polymorphic && pi.file != nullptr && ptr_set_exists(&c->unchanged_packages, pi.file->pkg)) {
+		// NOTE: It passed the last check, see 'find_unchanged_packages'
+		return;
+	}
+
+	u64 trace_start = trace_time_now();
+	defer (trace_add_event("check proc", pi.token.string, trace_start));
 
 	CheckerContext ctx = make_checker_context(c);
 	defer (destroy_checker_context(&ctx));
+	if (task != nullptr) {
+		ctx.proc_task = task;
+		ctx.untyped   = &task->untyped;
+	}
 	add_curr_ast_file(&ctx, pi.file);
 	ctx.decl = pi.decl;
 
+	CheckerContext *prev_curr_ctx = checker_curr_ctx;
+	checker_curr_ctx = &ctx;
+	defer (checker_curr_ctx = prev_curr_ctx);
+
 	TypeProc *pt = &pi.type->Proc;
 	String name = pi.token.string;
 	if (pt->is_polymorphic && !pt->is_poly_specialized) {
@@ -3848,20 +4348,381 @@ void check_proc_info(Checker *c, ProcInfo pi) {
 		ctx.state_flags &= ~StateFlag_bounds_check;
 	}
 
+	CheckProfileFrame profile_frame = {};
+	check_profile_begin(&profile_frame);
 	check_proc_body(&ctx, pi.token, pi.decl, pi.type, pi.body);
+	if (pt->is_poly_specialized) {
+		check_profile_end(&profile_frame, CheckProfile_PolySpecialization, pi.decl->entity, pi.token, pi.type);
+	} else {
+		check_profile_end(&profile_frame, CheckProfile_ProcBody, pi.decl->entity, pi.token);
+	}
+}
+
+void proc_body_task_init(ProcBodyTask *task, Checker *c, ProcInfo const &pi) {
+	gbAllocator a = heap_allocator();
+	task->checker = c;
+	task->info    = pi;
+	task->pkg     = nullptr;
+	task->global_entities = {};
+	untyped_table_init(&task->untyped, a);
+	array_init(&task->type_info_types, a);
+	array_init(&task->definitions, a);
+	array_init(&task->entities, a);
+	array_init(&task->identifier_uses, a);
+	array_init(&task->procs_to_check, a);
+	array_init(&task->procs_with_deferred_to_check, a);
+	array_init(&task->child_decls, a);
+	array_init(&task->required_foreign_imports, a);
+	array_init(&task->errors, a);
+	array_init(&task->new_entities, a);
+	array_init(&task->gen_procs, a);
+}
+
+void proc_body_task_destroy(ProcBodyTask *task) {
+	untyped_table_destroy(&task->untyped);
+	array_free(&task->type_info_types);
+	array_free(&task->definitions);
+	array_free(&task->entities);
+	array_free(&task->identifier_uses);
+	array_free(&task->procs_to_check);
+	array_free(&task->procs_with_deferred_to_check);
+	array_free(&task->child_decls);
+	array_free(&task->required_foreign_imports);
+	array_free(&task->errors);
+	array_free(&task->new_entities);
+	array_free(&task->gen_procs);
+}
+
+// NOTE: Moves what 'src' added to the end of 'dst'
+void proc_body_task_append(ProcBodyTask *dst, ProcBodyTask *src) {
+	for_untyped_table(i, src->untyped) {
+		untyped_table_set(&dst->untyped, src->untyped.exprs[i], src->untyped.infos[i]);
+	}
+	array_add_elems(&dst->type_info_types,              src->type_info_types.data,              src->type_info_types.count);
+	array_add_elems(&dst->definitions,                  src->definitions.data,                  src->definitions.count);
+	array_add_elems(&dst->entities,                     src->entities.data,                     src->entities.count);
+	array_add_elems(&dst->identifier_uses,              src->identifier_uses.data,              src->identifier_uses.count);
+	array_add_elems(&dst->procs_to_check,               src->procs_to_check.data,               src->procs_to_check.count);
+	array_add_elems(&dst->procs_with_deferred_to_check, src->procs_with_deferred_to_check.data, src->procs_with_deferred_to_check.count);
+	array_add_elems(&dst->child_decls,                  src->child_decls.data,                  src->child_decls.count);
+	array_add_elems(&dst->required_foreign_imports,     src->required_foreign_imports.data,     src->required_foreign_imports.count);
+	array_add_elems(&dst->errors,                       src->errors.data,                       src->errors.count);
+	array_add_elems(&dst->new_entities,                 src->new_entities.data,                 src->new_entities.count);
+	array_add_elems(&dst->gen_procs,                    src->gen_procs.data,                    src->gen_procs.count);
+}
+
+WORKER_TASK_PROC(check_proc_body_worker_proc) {
+	ProcBodyTask *task = cast(ProcBodyTask *)data;
+	set_curr_proc_task(task);
+	check_proc_info(task->checker, task->info, task);
+	set_curr_proc_task(nullptr);
+	return 0;
+}
+
+// NOTE: Called on the main thread in 'procs_to_check' order
+void merge_proc_body_task(Checker *c, ProcBodyTask *task) {
+	CheckerInfo *info = &c->info;
+	for_array(i, task->new_entities) {
+		Entity *e = task->new_entities[i];
+		e->id = cast(u64)gb_atomic64_fetch_add(&global_entity_id, 1) + 1;
+	}
+	for_untyped_table(i, task->untyped) {
+		untyped_table_set(&info->untyped, task->untyped.exprs[i], task->untyped.infos[i]);
+	}
+	for_array(i, task->definitions) {
+		array_add(&info->definitions, task->definitions[i]);
+	}
+	for_array(i, task->entities) {
+		Entity *e = task->entities[i];
+		array_add(&info->entities, e);
+		e->order_in_src = info->entities.count;
+	}
+	for_array(i, task->identifier_uses) {
+		array_add(&info->identifier_uses, task->identifier_uses[i]);
+	}
+	for_array(i, task->procs_to_check) {
+		array_add(&c->procs_to_check, task->procs_to_check[i]);
+	}
+	for_array(i, task->procs_with_deferred_to_check) {
+		array_add(&c->procs_with_deferred_to_check, task->procs_with_deferred_to_check[i]);
+	}
+	for_array(i, task->child_decls) {
+		add_deps_from_child_to_parent(task->child_decls[i]);
+	}
+	for_array(i, task->required_foreign_imports) {
+		array_add(&info->required_foreign_imports_through_force, task->required_foreign_imports[i]);
+	}
+	if (task->type_info_types.count > 0) {
+		CheckerContext ctx = make_checker_context(c);
+		defer (destroy_checker_context(&ctx));
+		for_array(i, task->type_info_types) {
+			DeferredTypeInfo dti = task->type_info_types[i];
+			ctx.decl = dti.decl;
+			add_type_info_type(&ctx, dti.type);
+		}
+	}
+	if (task->info.file != nullptr) {
+		// NOTE: Same as 'add_curr_ast_file' does when checking serially
+		TokenPos zero_pos = {};
+		global_error_collector.prev = zero_pos;
+	}
+	report_deferred_errors(&task->errors);
+
+	// NOTE: What generating a specialization added is merged with the first task to use it, in merge order,
+	// rather than with whichever task happened to generate it first
+	for_array(i, task->gen_procs) {
+		HashKey key = hash_pointer(task->gen_procs[i]);
+		ProcBodyTask **found = map_get(&info->gen_proc_tasks, key);
+		if (found != nullptr) {
+			ProcBodyTask *gen_task = *found;
+			map_remove(&info->gen_proc_tasks, key);
+			merge_proc_body_task(c, gen_task);
+			proc_body_task_destroy(gen_task);
+			gb_free(heap_allocator(), gen_task);
+		}
+	}
 }
 
-GB_THREAD_PROC(check_proc_info_worker_proc) {
-	if (thread == nullptr) return 0;
-	auto *c = cast(Checker *)thread->user_data;
-	isize index = thread->user_index;
-	check_proc_info(c, c->procs_to_check[index]);
+GB_COMPARE_PROC(entity_order_in_src_cmp) {
+	Entity *x = *cast(Entity **)a;
+	Entity *y = *cast(Entity **)b;
+	if (x->order_in_src < y->order_in_src) {
+		return -1;
+	} else if (x->order_in_src > y->order_in_src) {
+		return +1;
+	}
 	return 0;
 }
 
+GB_COMPARE_PROC(entity_id_cmp) {
+	Entity *x = *cast(Entity **)a;
+	Entity *y = *cast(Entity **)b;
+	if (x->id < y->id) {
+		return -1;
+	} else if (x->id > y->id) {
+		return +1;
+	}
+	return 0;
+}
+
+void check_procedure_bodies(Checker *c) {
+	isize thread_count = gb_max(build_context.thread_count, 1);
+	if (!build_context.parallel_check || thread_count <= 1) {
+		// NOTE(bill): Nested procedures bodies will be added to this "queue"
+		for_array(i, c->procs_to_check) {
+			ProcInfo pi = c->procs_to_check[i];
+			check_proc_info(c, pi, nullptr);
+		}
+		return;
+	}
+
+	// NOTE: Procedures found while checking a batch (nested and generated procedures) form the next batch.
+	// Merging the tasks in order keeps the results, and the order of the errors, the same as checking them serially.
+	isize batch_start = 0;
+	while (batch_start < c->procs_to_check.count) {
+		isize batch_end = c->procs_to_check.count;
+		isize task_count = batch_end - batch_start;
+
+		ProcBodyTask *tasks = gb_alloc_array(heap_allocator(), ProcBodyTask, task_count);
+		defer (gb_free(heap_allocator(), tasks));
+
+		ThreadPool pool = {};
+		thread_pool_init(&pool, heap_allocator(), thread_count-1, "CheckWork");
+		for (isize i = 0; i < task_count; i++) {
+			proc_body_task_init(&tasks[i], c, c->procs_to_check[batch_start+i]);
+			thread_pool_add_task(&pool, check_proc_body_worker_proc, &tasks[i]);
+		}
+		thread_pool_start(&pool);
+		thread_pool_wait_to_process(&pool);
+		thread_pool_destroy(&pool);
+
+		for (isize i = 0; i < task_count; i++) {
+			merge_proc_body_task(c, &tasks[i]);
+			proc_body_task_destroy(&tasks[i]);
+		}
+
+		batch_start = batch_end;
+	}
+
+	// NOTE: Specializations are added to 'gen_procs' and 'gen_types' in the order the threads generate them.
+	// The record types are not in 'entities', but their ids are given in merge order, see 'merge_proc_body_task'.
+	for_array(i, c->info.gen_procs.entries) {
+		auto *procs = &c->info.gen_procs.entries[i].value;
+		gb_sort_array(procs->data, procs->count, entity_order_in_src_cmp);
+	}
+	for_array(i, c->info.gen_types.entries) {
+		auto *types = &c->info.gen_types.entries[i].value;
+		gb_sort_array(types->data, types->count, entity_id_cmp);
+	}
+}
+
+
+void check_collect_package_entities(Checker *c, AstPackage *pkg, ProcBodyTask *task) {
+	u64 trace_start = trace_time_now();
+	defer (trace_add_event("collect entities", pkg->fullpath, trace_start));
+
+	CheckerContext ctx = make_checker_context(c);
+	defer (destroy_checker_context(&ctx));
+	ctx.pkg = pkg;
+	ctx.collect_delayed_decls = false;
+	if (task != nullptr) {
+		ctx.proc_task = task;
+		ctx.untyped   = &task->untyped;
+	}
+
+	for_array(j, pkg->files) {
+		AstFile *f = pkg->files[j];
+		create_scope_from_file(&ctx, f);
+		add_curr_ast_file(&ctx, f);
+		check_collect_entities(&ctx, f->decls);
+	}
+}
+
+WORKER_TASK_PROC(collect_package_entities_worker_proc) {
+	ProcBodyTask *task = cast(ProcBodyTask *)data;
+	set_curr_proc_task(task);
+	check_collect_package_entities(task->checker, task->pkg, task);
+	set_curr_proc_task(nullptr);
+	return 0;
+}
+
+WORKER_TASK_PROC(check_package_global_entities_worker_proc) {
+	ProcBodyTask *task = cast(ProcBodyTask *)data;
+	u64 trace_start = trace_time_now();
+	defer (trace_add_event("check global entities", task->pkg->fullpath, trace_start));
+
+	set_curr_proc_task(task);
+	for_array(i, task->global_entities) {
+		Entity *e = task->global_entities[i];
+		check_single_global_entity(task->checker, e, e->decl_info, task);
+	}
+	set_curr_proc_task(nullptr);
+	return 0;
+}
+
+// NOTE: Runs a task for each package on the thread pool, then merges them in the order of 'packages'
+void check_package_tasks(Checker *c, Array<AstPackage *> const &packages, WorkerTaskProc *worker_proc, Array<Entity *> *global_entities) {
+	isize thread_count = gb_max(build_context.thread_count, 1);
+	ProcBodyTask *tasks = gb_alloc_array(heap_allocator(), ProcBodyTask, packages.count);
+	defer (gb_free(heap_allocator(), tasks));
+
+	ThreadPool pool = {};
+	thread_pool_init(&pool, heap_allocator(), thread_count-1, "CheckWork");
+	for_array(i, packages) {
+		ProcBodyTask *task = &tasks[i];
+		proc_body_task_init(task, c, ProcInfo{});
+		task->pkg = packages[i];
+		if (global_entities != nullptr) {
+			task->global_entities = global_entities[i];
+		}
+		thread_pool_add_task(&pool, worker_proc, task);
+	}
+	thread_pool_start(&pool);
+	thread_pool_wait_to_process(&pool);
+	thread_pool_destroy(&pool);
+
+	for_array(i, packages) {
+		merge_proc_body_task(c, &tasks[i]);
+		proc_body_task_destroy(&tasks[i]);
+	}
+}
+
+void check_collect_all_entities(Checker *c) {
+	for_array(i, c->parser->packages) {
+		AstPackage *pkg = c->parser->packages[i];
+		for_array(j, pkg->files) {
+			AstFile *f = pkg->files[j];
+			map_set(&c->info.files, hash_string(f->fullpath), f);
+		}
+	}
+
+	isize thread_count = gb_max(build_context.thread_count, 1);
+	if (!build_context.parallel_check || thread_count <= 1 || c->parser->packages.count <= 1) {
+		for_array(i, c->parser->packages) {
+			check_collect_package_entities(c, c->parser->packages[i], nullptr);
+		}
+		return;
+	}
+
+	// NOTE: Until the imports are resolved, collecting the entities of a package only touches its own scopes
+	check_package_tasks(c, c->parser->packages, collect_package_entities_worker_proc, nullptr);
+}
+
+// NOTE: With -parallel-check, the groups of each wave of 'package_groups' have their global entities
+// checked on the thread pool. 'check_all_global_entities' then checks anything the waves did not.
+void check_global_entities_in_waves(Checker *c) {
+	isize thread_count = gb_max(build_context.thread_count, 1);
+	if (!build_context.parallel_check || thread_count <= 1 || c->package_groups.count == 0) {
+		return;
+	}
+
+	Map<isize> group_of_package = {}; // Key: AstPackage *
+	map_init(&group_of_package, heap_allocator());
+	defer (map_destroy(&group_of_package));
+	for_array(i, c->package_groups) {
+		PackageGroup *group = &c->package_groups[i];
+		for_array(j, group->packages) {
+			map_set(&group_of_package, hash_pointer(group->packages[j]), i);
+		}
+	}
+
+	auto group_entities = array_make<Array<Entity *> >(heap_allocator(), c->package_groups.count);
+	defer ({
+		for_array(i, group_entities) {
+			array_free(&group_entities[i]);
+		}
+		array_free(&group_entities);
+	});
+	for_array(i, group_entities) {
+		array_init(&group_entities[i], heap_allocator());
+	}
+	for_array(i, c->info.entities) {
+		Entity *e = c->info.entities[i];
+		if (e->pkg == nullptr || e->decl_info == nullptr) {
+			continue;
+		}
+		isize *found = map_get(&group_of_package, hash_pointer(e->pkg));
+		if (found != nullptr) {
+			array_add(&group_entities[*found], e);
+		}
+	}
+
+	auto wave_packages = array_make<AstPackage *>(heap_allocator());
+	defer (array_free(&wave_packages));
+	for (isize wave_start = 0; wave_start < c->package_groups.count; ) {
+		isize wave = c->package_groups[wave_start].wave;
+		isize wave_end = wave_start;
+		while (wave_end < c->package_groups.count && c->package_groups[wave_end].wave == wave) {
+			wave_end += 1;
+		}
+
+		if (wave > 0 && wave_end-wave_start > 1) {
+			array_clear(&wave_packages);
+			for (isize i = wave_start; i < wave_end; i++) {
+				array_add(&wave_packages, c->package_groups[i].packages[0]);
+			}
+			check_package_tasks(c, wave_packages, check_package_global_entities_worker_proc, group_entities.data+wave_start);
+		} else {
+			for (isize i = wave_start; i < wave_end; i++) {
+				for_array(j, group_entities[i]) {
+					Entity *e = group_entities[i][j];
+					check_single_global_entity(c, e, e->decl_info);
+				}
+			}
+		}
+		if (wave == 0) {
+			// NOTE: Otherwise the types of the runtime would be set up lazily by whichever worker needs them first
+			init_preload(c);
+		}
+
+		wave_start = wave_end;
+	}
+}
+
 
 void check_parsed_files(Checker *c) {
-#define TIME_SECTION(str) do { if (build_context.show_more_timings) timings_start_section(&global_timings, str_lit(str)); } while (0)
+#define TIME_SECTION(str) do { if (build_context.show_more_timings) timings_start_section(&global_timings, str_lit(str)); trace_section(str_lit(str)); } while (0)
+	defer (trace_section({}));
 
 	TIME_SECTION("map full filepaths to scope");
 	add_type_info_type(&c->init_ctx, t_invalid);
@@ -3885,29 +4746,13 @@ void check_parsed_files(Checker *c) {
 
 	TIME_SECTION("collect entities");
 	// Collect Entities
-	for_array(i, c->parser->packages) {
-		AstPackage *pkg = c->parser->packages[i];
-
-		CheckerContext ctx = make_checker_context(c);
-		defer (destroy_checker_context(&ctx));
-		ctx.pkg = pkg;
-		ctx.collect_delayed_decls = false;
-
-		for_array(j, pkg->files) {
-			AstFile *f = pkg->files[j];
-			create_scope_from_file(&ctx, f);
-			HashKey key = hash_string(f->fullpath);
-			map_set(&c->info.files, key, f);
-
-			add_curr_ast_file(&ctx, f);
-			check_collect_entities(&ctx, f->decls);
-		}
-	}
+	check_collect_all_entities(c);
 
 	TIME_SECTION("import entities");
 	check_import_entities(c);
 
 	TIME_SECTION("check all global entities");
+	check_global_entities_in_waves(c);
 	check_all_global_entities(c);
 
 	TIME_SECTION("init preload");
@@ -3917,15 +4762,14 @@ void check_parsed_files(Checker *c) {
 	defer (c->init_ctx = prev_context);
 
 	TIME_SECTION("check procedure bodies");
-	// NOTE(bill): Nested procedures bodies will be added to this "queue"
-	for_array(i, c->procs_to_check) {
-		ProcInfo pi = c->procs_to_check[i];
-		check_proc_info(c, pi);
-	}
+	check_procedure_bodies(c);
 
 	TIME_SECTION("check scope usage");
 	for_array(i, c->info.files.entries) {
 		AstFile *f = c->info.files.entries[i].value;
+		if (ptr_set_exists(&c->unchanged_packages, f->pkg)) {
+			continue;
+		}
 		check_scope_usage(c, f->scope);
 	}
 
@@ -3939,11 +4783,9 @@ void check_parsed_files(Checker *c) {
 
 	TIME_SECTION("add untyped expression values");
 	// Add untyped expression values
-	for_array(i, c->info.untyped.entries) {
-		auto *entry = &c->info.untyped.entries[i];
-		HashKey key = entry->key;
-		Ast *expr = cast(Ast *)key.ptr;
-		ExprInfo *info = &entry->value;
+	for_untyped_table(i, c->info.untyped) {
+		Ast *expr = c->info.untyped.exprs[i];
+		ExprInfo *info = &c->info.untyped.infos[i];
 		if (info != nullptr && expr != nullptr) {
 			if (is_type_typed(info->type)) {
 				compiler_error("%s (type %s) is typed!", expr_to_string(expr), type_to_string(info->type));
@@ -4107,8 +4949,15 @@ void check_parsed_files(Checker *c) {
 			token.pos.column = 1;
 			if (s->pkg->files.count > 0) {
 				AstFile *f = s->pkg->files[0];
-				if (f->tokens.count > 0) {
-					token = f->tokens[0];
+				if (!f->stream_tokens && f->tokens.count > 0) {
+					token = ast_file_token(f, 0);
+				} else {
+					// NOTE: Streamed tokens are discarded once parsed, and files
+					// loaded from the parse cache have no tokens at all
+					token.pos.file = f->fullpath;
+					if (f->package_token.kind != Token_Invalid) {
+						token = f->package_token;
+					}
 				}
 			}
 
@@ -29,6 +29,17 @@ gb_inline ExprInfo make_expr_info(AddressingMode mode, Type *type, ExactValue va
 	return ei;
 }
 
+// UntypedTable stores the ExprInfo of the untyped expressions being checked in dense arrays. Each
+// expression records the index of its slot, so finding one is an array access, and the table is
+// iterated through its bitmap of valid slots. A slot is only used by an expression whose
+// 'untyped_index' refers back to it, which cloned expressions and other tables never do.
+struct UntypedTable {
+	Array<Ast *>    exprs;
+	Array<ExprInfo> infos;
+	Array<u64>      valid; // NOTE: A bit per slot, cleared when the expression is removed
+	isize           count; // NOTE: Of valid slots
+};
+
 
 
 
@@ -152,6 +163,35 @@ struct ProcInfo {
 	Ast *     poly_def_node;
 };
 
+// A call to 'add_type_info_type' made while checking a procedure body on a worker thread
+struct DeferredTypeInfo {
+	DeclInfo *decl;
+	Type *    type;
+};
+
+// ProcBodyTask stores what checking a procedure body on a worker thread adds to the shared
+// checker state, which is merged back in 'procs_to_check' order once the batch has finished.
+// It is also used to collect, and then check, the global entities of a package on a worker thread.
+struct ProcBodyTask {
+	Checker *            checker;
+	ProcInfo             info;
+	AstPackage *         pkg;             // NOTE: Set instead of 'info' for the tasks of a package
+	Array<Entity *>      global_entities; // NOTE: To check, of 'pkg' and the rest of its group, not owned by the task
+
+	UntypedTable         untyped;
+	Array<DeferredTypeInfo> type_info_types;
+	Array<Entity *>      definitions;
+	Array<Entity *>      entities;
+	Array<Ast *>         identifier_uses;
+	Array<ProcInfo>      procs_to_check;
+	Array<Entity *>      procs_with_deferred_to_check;
+	Array<DeclInfo *>    child_decls; // Nested procedures whose dependencies are added to their parent
+	Array<Entity *>      required_foreign_imports;
+	Array<DeferredError> errors;
+	Array<Entity *>      new_entities; // NOTE: Allocated by the task, numbered when it is merged
+	Array<Entity *>      gen_procs;    // NOTE: Polymorphic specializations used by the task, in order
+};
+
 
 
 enum ScopeFlag {
@@ -165,6 +205,23 @@ enum ScopeFlag {
 	ScopeFlag_HasBeenImported = 1<<10, // This is only applicable to file scopes
 };
 
+#define SCOPE_SMALL_ELEMENT_COUNT 8
+
+struct ScopeEntry {
+	u64     hash; // NOTE: Of the name, compared before the name itself
+	Atom *  name;
+	Entity *entity;
+};
+
+// NOTE: Most scopes are blocks with a few elements, which are kept inline and searched linearly.
+// Scopes with more elements than fit are promoted to an array with a hash index.
+struct ScopeElements {
+	isize             count;
+	ScopeEntry        small[SCOPE_SMALL_ELEMENT_COUNT];
+	Array<ScopeEntry> large;
+	Map<isize>        index; // Key: Atom, the index into 'large'
+};
+
 struct Scope {
 	Ast *         node;
 	Scope *       parent;
@@ -172,7 +229,7 @@ struct Scope {
 	Scope *       next;
 	Scope *       first_child;
 	Scope *       last_child;
-	Map<Entity *> elements; // Key: String
+	ScopeElements elements;
 
 	Array<Ast *>    delayed_directives;
 	Array<Ast *>    delayed_imports;
@@ -232,11 +289,17 @@ typedef Array<Entity *> CheckerTypePath;
 typedef Array<Type *>   CheckerPolyPath;
 
 
+// NOTE: The arguments a polymorphic procedure was once specialized with. Only the mode, type, and
+// constant value of each operand are kept, as they are all that the specialization depends upon.
+struct PolyProcCacheEntry {
+	u64            hash;
+	Array<Operand> operands;
+	Entity *       entity;
+};
+
 // CheckerInfo stores all the symbol information for a type-checked program
 struct CheckerInfo {
-	Map<ExprInfo>         untyped; // Key: Ast * | Expression -> ExprInfo
-	                               // NOTE(bill): This needs to be a map and not on the Ast
-	                               // as it needs to be iterated across
+	UntypedTable          untyped;
 	Map<AstFile *>        files;           // Key: String (full path)
 	Map<AstPackage *>     packages;        // Key: String (full path)
 	Map<Entity *>         foreigns;        // Key: String
@@ -246,6 +309,8 @@ struct CheckerInfo {
 
 	Map<Array<Entity *> > gen_procs;       // Key: Ast * | Identifier -> Entity
 	Map<Array<Entity *> > gen_types;       // Key: Type *
+	Map<Array<PolyProcCacheEntry> > gen_proc_cache; // Key: Ast * | Identifier of the polymorphic procedure
+	Map<ProcBodyTask *>   gen_proc_tasks;  // Key: Entity * | What generating the specialization on a worker thread added, until merged
 
 	Array<Type *>         type_info_types;
 	Map<isize>            type_info_map;   // Key: Type *
@@ -260,6 +325,10 @@ struct CheckerInfo {
 
 	Array<Entity *>       required_foreign_imports_through_force;
 
+	// NOTE: Only contended when procedure bodies are checked in parallel
+	gbMutex gen_mutex;     // Guards 'gen_procs', 'gen_types', 'gen_proc_cache', and 'gen_proc_tasks' while a specialization is generated
+	gbMutex foreign_mutex; // Guards 'foreigns'
+
 
 	bool allow_identifier_uses;
 	Array<Ast *> identifier_uses; // only used by 'odin query'
@@ -299,6 +368,15 @@ struct CheckerContext {
 	bool       hide_polymorphic_errors;
 	bool       in_polymorphic_specialization;
 	Scope *    polymorphic_scope;
+
+	UntypedTable * untyped;
+	ProcBodyTask * proc_task; // NOTE: Set when the procedure body is checked on a worker thread
+};
+
+// NOTE: Packages which import each other, directly or not, are in the same group
+struct PackageGroup {
+	isize               wave;
+	Array<AstPackage *> packages;
 };
 
 struct Checker {
@@ -308,7 +386,10 @@ struct Checker {
 	Array<ProcInfo> procs_to_check;
 	Array<Entity *> procs_with_deferred_to_check;
 
-	CheckerContext *curr_ctx;
+	Array<PackageGroup> package_groups; // NOTE: In wave order, see 'generate_package_groups'
+
+	PtrSet<AstPackage *> unchanged_packages; // NOTE: Only for 'odin check -watch', see 'find_unchanged_packages'
+
 	gbAllocator    allocator;
 	CheckerContext init_ctx;
 };
@@ -344,22 +425,29 @@ isize        type_info_index        (CheckerInfo *i, Type *type, bool error_on_f
 Entity *entity_of_node(Ast *expr);
 
 
+HashKey scope_key_of_ident(Ast *ident);
+ScopeEntry *scope_entries(Scope *s);
+Entity *scope_lookup_current(Scope *s, HashKey key);
 Entity *scope_lookup_current(Scope *s, String name);
+Entity *scope_lookup (Scope *s, HashKey key);
 Entity *scope_lookup (Scope *s, String name);
+void    scope_lookup_parent (Scope *s, HashKey key, Scope **scope_, Entity **entity_);
 void    scope_lookup_parent (Scope *s, String name, Scope **scope_, Entity **entity_);
 Entity *scope_insert (Scope *s, Entity *entity);
 
 
-ExprInfo *check_get_expr_info     (CheckerInfo *i, Ast *expr);
-void      check_set_expr_info     (CheckerInfo *i, Ast *expr, ExprInfo info);
-void      check_remove_expr_info  (CheckerInfo *i, Ast *expr);
-void      add_untyped             (CheckerInfo *i, Ast *expression, bool lhs, AddressingMode mode, Type *basic_type, ExactValue value);
+ExprInfo *check_get_expr_info     (CheckerContext *c, Ast *expr);
+void      check_set_expr_info     (CheckerContext *c, Ast *expr, ExprInfo info);
+void      check_remove_expr_info  (CheckerContext *c, Ast *expr);
+void      add_untyped             (CheckerContext *c, Ast *expression, bool lhs, AddressingMode mode, Type *basic_type, ExactValue value);
 void      add_type_and_value      (CheckerInfo *i, Ast *expression, AddressingMode mode, Type *type, ExactValue value);
 void      add_entity_use          (CheckerContext *c, Ast *identifier, Entity *entity);
 void      add_implicit_entity     (CheckerContext *c, Ast *node, Entity *e);
 void      add_entity_and_decl_info(CheckerContext *c, Ast *identifier, Entity *e, DeclInfo *d, bool is_exported=true);
 void      add_type_info_type      (CheckerContext *c, Type *t);
 
+void add_deps_from_child_to_parent(DeclInfo *decl);
+
 void check_add_import_decl(CheckerContext *c, Ast *decl);
 void check_add_foreign_import_decl(CheckerContext *c, Ast *decl);
 
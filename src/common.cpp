@@ -46,6 +46,10 @@ gb_inline isize align_formula_isize(isize size, isize align) {
 
 GB_ALLOCATOR_PROC(heap_allocator_proc);
 
+// NOTE: Allocations made through the heap and arena allocators on each thread, for -profile-check
+gb_thread_local i64 thread_allocation_count = 0;
+gb_thread_local i64 thread_allocation_bytes = 0;
+
 gbAllocator heap_allocator(void) {
 	gbAllocator a;
 	a.proc = heap_allocator_proc;
@@ -59,6 +63,11 @@ GB_ALLOCATOR_PROC(heap_allocator_proc) {
 	gb_unused(allocator_data);
 	gb_unused(old_size);
 
+	if (type == gbAllocation_Alloc || type == gbAllocation_Resize) {
+		thread_allocation_count += 1;
+		thread_allocation_bytes += size;
+	}
+
 
 
 // TODO(bill): Throughly test!
@@ -154,6 +163,16 @@ GB_ALLOCATOR_PROC(heap_allocator_proc) {
 
 
 
+u32 fnv32a(void const *data, isize len) {
+	u8 const *bytes = cast(u8 const *)data;
+	u32 h = 0x811c9dc5;
+	for (isize i = 0; i < len; i++) {
+		u32 b = cast(u32)bytes[i];
+		h = (h ^ b) * 0x01000193;
+	}
+	return h;
+}
+
 u64 fnv64a(void const *data, isize len) {
 	u8 const *bytes = cast(u8 const *)data;
 	u64 h = 0xcbf29ce484222325ull;
@@ -359,6 +378,7 @@ typedef struct Arena {
 	gbAllocator backing;
 	isize       block_size;
 	gbMutex     mutex;
+	bool        single_threaded; // NOTE: Skips the mutex, the arena must only be used by one thread
 
 	isize total_used;
 } Arena;
@@ -373,24 +393,26 @@ void arena_init(Arena *arena, gbAllocator backing, isize block_size=ARENA_DEFAUL
 	gb_mutex_init(&arena->mutex);
 }
 
+// NOTE: Must be called with the arena's mutex held, unless it is single threaded
 void arena_grow(Arena *arena, isize min_size) {
-	gb_mutex_lock(&arena->mutex);
-	defer (gb_mutex_unlock(&arena->mutex));
-
 	isize size = gb_max(arena->block_size, min_size);
 	size = ALIGN_UP(size, ARENA_MIN_ALIGNMENT);
+
+	// NOTE: The arena's own allocations are already counted, so its backing blocks are not
+	i64 prev_allocation_count = thread_allocation_count;
+	i64 prev_allocation_bytes = thread_allocation_bytes;
 	void *new_ptr = gb_alloc(arena->backing, size);
+	array_add(&arena->blocks, cast(u8 *)new_ptr);
+	thread_allocation_count = prev_allocation_count;
+	thread_allocation_bytes = prev_allocation_bytes;
+
 	arena->ptr = cast(u8 *)new_ptr;
 	// gb_zero_size(arena->ptr, size); // NOTE(bill): This should already be zeroed
 	GB_ASSERT(arena->ptr == ALIGN_DOWN_PTR(arena->ptr, ARENA_MIN_ALIGNMENT));
 	arena->end = arena->ptr + size;
-	array_add(&arena->blocks, arena->ptr);
 }
 
-void *arena_alloc(Arena *arena, isize size, isize alignment) {
-	gb_mutex_lock(&arena->mutex);
-	defer (gb_mutex_unlock(&arena->mutex));
-
+void *arena_alloc_unlocked(Arena *arena, isize size, isize alignment) {
 	arena->total_used += size;
 
 	if (size > (arena->end - arena->ptr)) {
@@ -408,6 +430,15 @@ void *arena_alloc(Arena *arena, isize size, isize alignment) {
 	return ptr;
 }
 
+void *arena_alloc(Arena *arena, isize size, isize alignment) {
+	if (arena->single_threaded) {
+		return arena_alloc_unlocked(arena, size, alignment);
+	}
+	gb_mutex_lock(&arena->mutex);
+	defer (gb_mutex_unlock(&arena->mutex));
+	return arena_alloc_unlocked(arena, size, alignment);
+}
+
 void arena_free_all(Arena *arena) {
 	gb_mutex_lock(&arena->mutex);
 	defer (gb_mutex_unlock(&arena->mutex));
@@ -440,6 +471,8 @@ GB_ALLOCATOR_PROC(arena_allocator_proc) {
 
 	switch (type) {
 	case gbAllocation_Alloc:
+		thread_allocation_count += 1;
+		thread_allocation_bytes += size;
 		ptr = arena_alloc(arena, size, alignment);
 		break;
 	case gbAllocation_Free:
@@ -729,6 +762,29 @@ wchar_t **command_line_to_wargv(wchar_t *cmd_line, int *_argc) {
 		return (attribs & FILE_ATTRIBUTE_DIRECTORY) != 0;
 	}
 
+	// NOTE: Returns true if the directory already exists
+	bool make_directory(String path) {
+		gbAllocator a = heap_allocator();
+		String16 wstr = string_to_string16(a, path);
+		defer (gb_free(a, wstr.text));
+
+		if (CreateDirectoryW(wstr.text, nullptr)) {
+			return true;
+		}
+		return GetLastError() == ERROR_ALREADY_EXISTS && path_is_directory(path);
+	}
+
+	// NOTE: Atomically replaces 'to' if it already exists
+	bool replace_file(String from, String to) {
+		gbAllocator a = heap_allocator();
+		String16 wfrom = string_to_string16(a, from);
+		String16 wto   = string_to_string16(a, to);
+		defer (gb_free(a, wfrom.text));
+		defer (gb_free(a, wto.text));
+
+		return MoveFileExW(wfrom.text, wto.text, MOVEFILE_REPLACE_EXISTING) != 0;
+	}
+
 #else
 	bool path_is_directory(String path) {
 		gbAllocator a = heap_allocator();
@@ -741,6 +797,29 @@ wchar_t **command_line_to_wargv(wchar_t *cmd_line, int *_argc) {
 		}
 		return false;
 	}
+
+	// NOTE: Returns true if the directory already exists
+	bool make_directory(String path) {
+		gbAllocator a = heap_allocator();
+		char *copy = cast(char *)copy_string(a, path).text;
+		defer (gb_free(a, copy));
+
+		if (mkdir(copy, 0755) == 0) {
+			return true;
+		}
+		return errno == EEXIST && path_is_directory(path);
+	}
+
+	// NOTE: Atomically replaces 'to' if it already exists
+	bool replace_file(String from, String to) {
+		gbAllocator a = heap_allocator();
+		char *cfrom = cast(char *)copy_string(a, from).text;
+		char *cto   = cast(char *)copy_string(a, to).text;
+		defer (gb_free(a, cfrom));
+		defer (gb_free(a, cto));
+
+		return rename(cfrom, cto) == 0;
+	}
 #endif
 
 
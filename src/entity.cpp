@@ -204,8 +204,26 @@ bool entity_has_deferred_procedure(Entity *e) {
 	return false;
 }
 
+// NOTE: Global entities are shared between the threads checking procedure bodies, so their flags are
+// only ever set atomically, and only when not already set
+void entity_set_used(Entity *e) {
+	if ((e->flags & EntityFlag_Used) == 0) {
+		gb_atomic32_fetch_or(cast(gbAtomic32 *)&e->flags, EntityFlag_Used);
+	}
+}
+
+void entity_set_identifier(Entity *e, Ast *identifier) {
+	if (e->identifier == nullptr) {
+		gb_atomic_ptr_compare_exchange(cast(gbAtomicPtr *)&e->identifier, nullptr, identifier);
+	}
+}
+
 
-gb_global u64 global_entity_id = 0;
+gb_global gbAtomic64 global_entity_id = {};
+
+// NOTE: Set while checking in parallel, so that the entities can be numbered in a deterministic order when
+// the work is merged, rather than in the order the threads happen to allocate them
+gb_thread_local Array<Entity *> *thread_new_entities = nullptr;
 
 Entity *alloc_entity(EntityKind kind, Scope *scope, Token token, Type *type) {
 	gbAllocator a = heap_allocator();
@@ -215,7 +233,11 @@ Entity *alloc_entity(EntityKind kind, Scope *scope, Token token, Type *type) {
 	entity->scope  = scope;
 	entity->token  = token;
 	entity->type   = type;
-	entity->id     = ++global_entity_id;
+	if (thread_new_entities != nullptr) {
+		array_add(thread_new_entities, entity);
+	} else {
+		entity->id = cast(u64)gb_atomic64_fetch_add(&global_entity_id, 1) + 1;
+	}
 	return entity;
 }
 
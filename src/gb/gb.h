@@ -8254,7 +8254,7 @@ gb_inline isize gb_printf_err_va(char const *fmt, va_list va) {
 }
 
 gb_inline isize gb_fprintf_va(struct gbFile *f, char const *fmt, va_list va) {
-	gb_local_persist char buf[4096];
+	gb_local_persist gb_thread_local char buf[4096];
 	isize len = gb_snprintf_va(buf, gb_size_of(buf), fmt, va);
 	gb_file_write(f, buf, len-1); // NOTE(bill): prevent extra whitespace
 	return len;
@@ -8262,7 +8262,7 @@ gb_inline isize gb_fprintf_va(struct gbFile *f, char const *fmt, va_list va) {
 
 
 gb_inline char *gb_bprintf_va(char const *fmt, va_list va) {
-	gb_local_persist char buffer[4096];
+	gb_local_persist gb_thread_local char buffer[4096];
 	gb_snprintf_va(buffer, gb_size_of(buffer), fmt, va);
 	return buffer;
 }
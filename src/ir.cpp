@@ -22,6 +22,8 @@ struct irModule {
 	Map<irValue *>        values;              // Key: Entity *
 	Map<irValue *>        members;             // Key: String
 	Map<String>           entity_names;        // Key: Entity * of the typename
+	gbMutex               print_mutex;         // NOTE: Guards the module while procedures are printed concurrently
+	StringSet             suffixed_names;      // Mangled names of polymorphic entities
 	Map<irDebugInfo *>    debug_info;          // Key: Unique pointer
 	Map<irValue *>        anonymous_proc_lits; // Key: Ast *
 
@@ -29,7 +31,6 @@ struct irModule {
 	Array<irDebugInfo *>  debug_location_stack;
 
 
-	i32                   global_string_index;
 	i32                   global_array_index; // For ConstantSlice
 	i32                   global_generated_index;
 
@@ -166,6 +167,7 @@ struct irProcedure {
 	i32                   local_count;
 	i32                   instr_count;
 	i32                   block_count;
+	i32                   global_count; // NOTE: Numbers the globals generated for the procedure's local statics and literals
 };
 
 
@@ -705,9 +707,17 @@ struct irDebugInfo {
 static irDebugInfo IR_DEBUG_INFO_EMPTY = {};
 
 
+// NOTE: A part of the module which is printed to its own .ll file and run through opt and llc separately
+struct irCodegenUnit {
+	String    output_base;
+	gbFile    output_file;
+	Array<u8> output_memory; // NOTE: Holds the printed IR rather than 'output_file' with 'build_context.llvm_in_process'
+	i64       weight;        // NOTE: Instruction count of the procedures defined in this unit
+};
+
 struct irGen {
 	irModule module;
-	gbFile   output_file;
+	Array<irCodegenUnit> units; // NOTE: At least one, the first uses 'output_base' and defines the globals
 	bool     opt_called;
 	String   output_base;
 	String   output_name;
@@ -1496,11 +1506,17 @@ irValue *ir_generate_array(irModule *m, Type *elem_type, i64 count, String prefi
 
 	auto suffix_id = cast(unsigned long long)id;
 	char *text = gb_alloc_array(a, char, name_len+1);
-	gb_snprintf(text, name_len,
-	            "%.*s-%llu", LIT(prefix), suffix_id);
-	text[name_len] = 0;
-
-	String s = make_string_c(text);
+	String s = {};
+	for (;;) {
+		gb_snprintf(text, name_len,
+		            "%.*s-%llu", LIT(prefix), suffix_id);
+		text[name_len] = 0;
+		s = make_string_c(text);
+		if (map_get(&m->members, hash_string(s)) == nullptr) {
+			break;
+		}
+		suffix_id += 1;
+	}
 
 	Entity *e = alloc_entity_variable(nullptr, make_token_ident(s), alloc_type_array(elem_type, count));
 	irValue *value = ir_value_global(e, nullptr);
@@ -1593,7 +1609,8 @@ irDefer ir_add_defer_proc(irProcedure *proc, isize scope_index, irValue *deferre
 
 
 
-irValue *ir_add_module_constant(irModule *m, Type *type, ExactValue value) {
+// NOTE: 'backing_name' names the global backing a constant slice, a counter is used when it is empty
+irValue *ir_add_module_constant(irModule *m, Type *type, ExactValue value, String backing_name = {}) {
 	gbAllocator a = ir_allocator();
 
 	if (is_type_slice(type)) {
@@ -1613,12 +1630,14 @@ irValue *ir_add_module_constant(irModule *m, Type *type, ExactValue value) {
 			irValue *backing_array = ir_add_module_constant(m, t, value);
 
 
-			isize max_len = 7+8+1;
-			u8 *str = cast(u8 *)gb_alloc_array(a, u8, max_len);
-			isize len = gb_snprintf(cast(char *)str, max_len, "csba$%x", m->global_array_index);
-			m->global_array_index++;
-
-			String name = make_string(str, len-1);
+			String name = backing_name;
+			if (name.len == 0) {
+				isize max_len = 7+8+1;
+				u8 *str = cast(u8 *)gb_alloc_array(a, u8, max_len);
+				isize len = gb_snprintf(cast(char *)str, max_len, "csba$%x", m->global_array_index);
+				m->global_array_index++;
+				name = make_string(str, len-1);
+			}
 
 			Entity *e = alloc_entity_constant(nullptr, make_token_ident(name), t, value);
 			irValue *g = ir_value_global(e, backing_array);
@@ -1654,10 +1673,19 @@ irValue *ir_add_global_string_array(irModule *m, String string) {
 	Type *type = alloc_type_array(t_u8, string.len+1);
 
 
-	isize max_len = 6+8+1;
+	// NOTE: Named after the contents rather than a counter, so that the name does not depend on
+	// which strings were generated before it, see the object cache
+	u64 name_hash = hash_string(string).key;
+	isize max_len = 4+16+1;
 	u8 *str = cast(u8 *)gb_alloc_array(ir_allocator(), u8, max_len);
-	isize len = gb_snprintf(cast(char *)str, max_len, "str$%x", m->global_string_index);
-	m->global_string_index++;
+	isize len = 0;
+	for (;;) {
+		len = gb_snprintf(cast(char *)str, max_len, "str$%llx", cast(unsigned long long)name_hash);
+		if (map_get(&m->members, hash_string(make_string(str, len-1))) == nullptr) {
+			break;
+		}
+		name_hash += 1;
+	}
 
 	String name = make_string(str, len-1);
 	Token token = {Token_String};
@@ -6167,6 +6195,43 @@ void ir_emit_dynamic_array_bounds_check(irProcedure *proc, Token token, irValue
 //
 ////////////////////////////////////////////////////////////////
 
+// NOTE: The suffix is a hash of the qualified name and the specialization's type rather than the
+// entity id or declaration position, so the name does not change with unrelated edits, see object_cache.cpp
+String ir_mangle_name_with_suffix(irModule *m, Entity *e, String prefix) {
+	gbString key = gb_string_make_reserve(heap_allocator(), 64);
+	if (e->pkg != nullptr) {
+		key = gb_string_append_length(key, e->pkg->fullpath.text, e->pkg->fullpath.len);
+		key = gb_string_appendc(key, " ");
+	}
+	key = gb_string_append_length(key, prefix.text, prefix.len);
+	key = gb_string_appendc(key, " ");
+	Type *type = e->type;
+	if (e->kind == Entity_TypeName) {
+		// NOTE: Every specialization of a polymorphic record shares the same type name
+		type = base_type(type);
+		TypeTuple *params = get_record_polymorphic_params(type);
+		if (params != nullptr) {
+			key = write_type_to_string(key, type->kind == Type_Struct ? type->Struct.polymorphic_params : type->Union.polymorphic_params);
+			key = gb_string_appendc(key, " ");
+		}
+	}
+	key = write_type_to_string(key, type);
+	u64 suffix = fnv64a(key, gb_string_length(key));
+	gb_string_free(key);
+
+	isize max_len = prefix.len + 1 + 20 + 1;
+	u8 *new_name = gb_alloc_array(ir_allocator(), u8, max_len);
+	for (;;) {
+		isize new_name_len = gb_snprintf(cast(char *)new_name, max_len, "%.*s-%llu", LIT(prefix), cast(unsigned long long)suffix);
+		String name = make_string(new_name, new_name_len-1);
+		if (!string_set_exists(&m->suffixed_names, name)) {
+			string_set_add(&m->suffixed_names, name);
+			return name;
+		}
+		suffix += 1;
+	}
+}
+
 String ir_mangle_name(irGen *s, Entity *e) {
 	irModule *m = &s->module;
 	CheckerInfo *info = m->info;
@@ -6183,23 +6248,17 @@ String ir_mangle_name(irGen *s, Entity *e) {
 
 	isize max_len = pkgn.len + 1 + name.len + 1;
 	bool require_suffix_id = is_type_polymorphic(e->type, true);
-	if (require_suffix_id) {
-		max_len += 21;
-	}
 
 	u8 *new_name = gb_alloc_array(a, u8, max_len);
 	isize new_name_len = gb_snprintf(
 		cast(char *)new_name, max_len,
 		"%.*s.%.*s", LIT(pkgn), LIT(name)
 	);
+	String mangled = make_string(new_name, new_name_len-1);
 	if (require_suffix_id) {
-		char *str = cast(char *)new_name + new_name_len-1;
-		isize len = max_len-new_name_len;
-		isize extra = gb_snprintf(str, len, "-%llu", cast(unsigned long long)e->id);
-		new_name_len += extra-1;
+		return ir_mangle_name_with_suffix(m, e, mangled);
 	}
-
-	return make_string(new_name, new_name_len-1);
+	return mangled;
 }
 
 
@@ -6214,22 +6273,15 @@ void ir_mangle_add_sub_type_name(irModule *m, Entity *field, String parent) {
 	String cn = field->token.string;
 	isize max_len = parent.len + 1 + 16 + 1 + cn.len;
 	bool require_suffix_id = is_type_polymorphic(field->type, true);
-	if (require_suffix_id) {
-		max_len += 21;
-	}
 
 	u8 *new_name = gb_alloc_array(ir_allocator(), u8, max_len);
 	isize new_name_len = gb_snprintf(cast(char *)new_name, max_len,
 	                                 "%.*s.%.*s", LIT(parent), LIT(cn));
 
+	String child = {new_name, new_name_len-1};
 	if (require_suffix_id) {
-		char *str = cast(char *)new_name + new_name_len-1;
-		isize len = max_len-new_name_len;
-		isize extra = gb_snprintf(str, len, "-%llu", cast(unsigned long long)field->id);
-		new_name_len += extra-1;
+		child = ir_mangle_name_with_suffix(m, field, child);
 	}
-
-	String child = {new_name, new_name_len-1};
 	GB_ASSERT(child.len > 0);
 	ir_add_entity_name(m, field, child);
 	ir_gen_global_type_name(m, field, child);
@@ -8816,7 +8868,10 @@ irAddr ir_build_addr(irProcedure *proc, Ast *expr) {
 				ir_emit_runtime_call(proc, "__dynamic_array_reserve", args);
 			}
 
-			irValue *items = ir_generate_array(proc->module, et, item_count, str_lit("dacl$"), cast(i64)cast(intptr)expr);
+			// NOTE: Identified by the enclosing procedure and an ordinal within it rather than its address or position,
+			// to keep the name the same between builds
+			u64 dacl_id = fnv64a(proc->name.text, proc->name.len) + cast(u64)proc->global_count++;
+			irValue *items = ir_generate_array(proc->module, et, item_count, str_lit("dacl$"), cast(i64)dacl_id);
 
 			for_array(i, cl->elems) {
 				Ast *elem = cl->elems[i];
@@ -9624,7 +9679,8 @@ void ir_build_stmt_internal(irProcedure *proc, Ast *node) {
 					{
 						gbString str = gb_string_make_length(heap_allocator(), proc->name.text, proc->name.len);
 						str = gb_string_appendc(str, "-");
-						str = gb_string_append_fmt(str, ".%.*s-%llu", LIT(name), cast(long long)e->id);
+						// NOTE: Numbered within the procedure rather than by the entity id, to keep the name the same between builds
+						str = gb_string_append_fmt(str, ".%.*s-%d", LIT(name), proc->global_count++);
 						mangled_name.text = cast(u8 *)str;
 						mangled_name.len = gb_string_length(str);
 					}
@@ -10971,6 +11027,8 @@ void ir_init_module(irModule *m, Checker *c) {
 	map_init(&m->members,                  heap_allocator());
 	map_init(&m->debug_info,               heap_allocator());
 	map_init(&m->entity_names,             heap_allocator());
+	string_set_init(&m->suffixed_names,    heap_allocator());
+	gb_mutex_init(&m->print_mutex);
 	map_init(&m->anonymous_proc_lits,      heap_allocator());
 	array_init(&m->procs,                  heap_allocator());
 	array_init(&m->procs_to_generate,      heap_allocator());
@@ -11113,6 +11171,8 @@ void ir_destroy_module(irModule *m) {
 	map_destroy(&m->values);
 	map_destroy(&m->members);
 	map_destroy(&m->entity_names);
+	string_set_destroy(&m->suffixed_names);
+	gb_mutex_destroy(&m->print_mutex);
 	map_destroy(&m->anonymous_proc_lits);
 	map_destroy(&m->debug_info);
 	map_destroy(&m->const_strings);
@@ -11167,14 +11227,38 @@ bool ir_gen_init(irGen *s, Checker *c) {
 	gbAllocator ha = heap_allocator();
 	s->output_base = path_to_full_path(ha, s->output_base);
 
-	gbString output_file_path = gb_string_make_length(ha, s->output_base.text, s->output_base.len);
-	output_file_path = gb_string_appendc(output_file_path, ".ll");
-	defer (gb_string_free(output_file_path));
+	isize unit_count = gb_max(build_context.codegen_units, 1);
+	if (s->module.generate_debug_info) {
+		// NOTE: The debug info metadata is numbered for the whole module, so it cannot be split,
+		// and the bitcode writer does not write it
+		unit_count = 1;
+		build_context.llvm_bitcode = false;
+	}
+	array_init(&s->units, ha, unit_count);
+	for_array(i, s->units) {
+		irCodegenUnit *u = &s->units[i];
+		if (i == 0) {
+			u->output_base = s->output_base;
+		} else {
+			char buf[32] = {};
+			isize n = gb_snprintf(buf, gb_size_of(buf), ".cgu%td", i);
+			u->output_base = concatenate_strings(ha, s->output_base, make_string(cast(u8 *)buf, n-1));
+		}
 
-	gbFileError err = gb_file_create(&s->output_file, output_file_path);
-	if (err != gbFileError_None) {
-		gb_printf_err("Failed to create file %s\n", output_file_path);
-		return false;
+		if (build_context.llvm_in_process) {
+			array_init(&u->output_memory, ha);
+			continue;
+		}
+
+		gbString output_file_path = gb_string_make_length(ha, u->output_base.text, u->output_base.len);
+		output_file_path = gb_string_appendc(output_file_path, llvm_ir_file_extension());
+		defer (gb_string_free(output_file_path));
+
+		gbFileError err = gb_file_create(&u->output_file, output_file_path);
+		if (err != gbFileError_None) {
+			gb_printf_err("Failed to create file %s\n", output_file_path);
+			return false;
+		}
 	}
 
 	return true;
@@ -11182,7 +11266,15 @@ bool ir_gen_init(irGen *s, Checker *c) {
 
 void ir_gen_destroy(irGen *s) {
 	ir_destroy_module(&s->module);
-	gb_file_close(&s->output_file);
+	for_array(i, s->units) {
+		irCodegenUnit *u = &s->units[i];
+		if (build_context.llvm_in_process) {
+			array_free(&u->output_memory);
+		} else {
+			gb_file_close(&u->output_file);
+		}
+	}
+	array_free(&s->units);
 }
 
 
@@ -0,0 +1,3379 @@
+// ir_bitcode.cpp
+//
+// Writes each codegen unit as LLVM bitcode, see '-llvm-bitcode', so that 'opt' reads a compact binary
+// module rather than parsing the textual IR of 'ir_print.cpp'. The types and constants are printed
+// with the routines of 'ir_print.cpp' into a scratch buffer and read back by a small parser of LLVM's
+// syntax, so the two writers cannot disagree on how a type or constant is lowered. The instructions
+// are encoded directly. The format is that of LLVM's own writer with typed pointers, which 'opt' reads
+// without LLVM being linked into the compiler.
+
+enum irBcBlockId {
+	irBcBlock_BlockInfo      = 0,
+	irBcBlock_Module         = 8,
+	irBcBlock_ParamAttr      = 9,
+	irBcBlock_ParamAttrGroup = 10,
+	irBcBlock_Constants      = 11,
+	irBcBlock_Function       = 12,
+	irBcBlock_Identification = 13,
+	irBcBlock_ValueSymtab    = 14,
+	irBcBlock_TypeNew        = 17,
+	irBcBlock_Strtab         = 23,
+};
+
+enum irBcAbbrevId {
+	irBcAbbrevId_EndBlock     = 0,
+	irBcAbbrevId_EnterBlock   = 1,
+	irBcAbbrevId_DefineAbbrev = 2,
+	irBcAbbrevId_Unabbrev     = 3,
+	irBcAbbrevId_FirstApp     = 4,
+};
+
+enum irBcBlockInfoCode {
+	irBcBlockInfo_SetBid = 1,
+};
+
+enum irBcModuleCode {
+	irBcModule_Version    = 1,
+	irBcModule_Triple     = 2,
+	irBcModule_Datalayout = 3,
+	irBcModule_GlobalVar  = 7,
+	irBcModule_Function   = 8,
+};
+
+enum irBcTypeCode {
+	irBcTypeCode_NumEntry    = 1,
+	irBcTypeCode_Void        = 2,
+	irBcTypeCode_Float       = 3,
+	irBcTypeCode_Double      = 4,
+	irBcTypeCode_Label       = 5,
+	irBcTypeCode_Opaque      = 6,
+	irBcTypeCode_Integer     = 7,
+	irBcTypeCode_Pointer     = 8,
+	irBcTypeCode_Half        = 10,
+	irBcTypeCode_Array       = 11,
+	irBcTypeCode_Vector      = 12,
+	irBcTypeCode_Metadata    = 16,
+	irBcTypeCode_X86Mmx      = 17,
+	irBcTypeCode_StructAnon  = 18,
+	irBcTypeCode_StructName  = 19,
+	irBcTypeCode_StructNamed = 20,
+	irBcTypeCode_Function    = 21,
+};
+
+enum irBcConstCode {
+	irBcConst_SetType       = 1,
+	irBcConst_Null          = 2,
+	irBcConst_Undef         = 3,
+	irBcConst_Integer       = 4,
+	irBcConst_WideInteger   = 5,
+	irBcConst_Float         = 6,
+	irBcConst_Aggregate     = 7,
+	irBcConst_String        = 8,
+	irBcConst_CString       = 9,
+	irBcConst_CastExpr      = 11,
+	irBcConst_InboundsGep   = 20,
+	irBcConst_Data          = 22,
+	irBcConst_InlineAsm     = 30,
+};
+
+enum irBcFunctionCode {
+	irBcFunc_DeclareBlocks = 1,
+	irBcFunc_Binop         = 2,
+	irBcFunc_Cast          = 3,
+	irBcFunc_Ret           = 10,
+	irBcFunc_Br            = 11,
+	irBcFunc_Unreachable   = 15,
+	irBcFunc_Phi           = 16,
+	irBcFunc_Alloca        = 19,
+	irBcFunc_Load          = 20,
+	irBcFunc_ExtractValue  = 26,
+	irBcFunc_VSelect       = 29,
+	irBcFunc_Cmp2          = 28,
+	irBcFunc_Call          = 34,
+	irBcFunc_Fence         = 36,
+	irBcFunc_LoadAtomic    = 41,
+	irBcFunc_Gep           = 43,
+	irBcFunc_Store         = 44,
+	irBcFunc_StoreAtomic   = 45,
+	irBcFunc_Cmpxchg       = 46,
+	irBcFunc_AtomicRmw     = 59,
+};
+
+enum irBcAtomicOrdering {
+	irBcOrdering_NotAtomic = 0,
+	irBcOrdering_Unordered = 1,
+	irBcOrdering_Monotonic = 2,
+	irBcOrdering_Acquire   = 3,
+	irBcOrdering_Release   = 4,
+	irBcOrdering_AcqRel    = 5,
+	irBcOrdering_SeqCst    = 6,
+};
+
+enum irBcAttrKind {
+	irBcAttr_AlwaysInline = 2,
+	irBcAttr_NoAlias      = 9,
+	irBcAttr_NoCapture    = 11,
+	irBcAttr_NoInline     = 14,
+	irBcAttr_NoReturn     = 17,
+	irBcAttr_NoUnwind     = 18,
+	irBcAttr_StructRet    = 29,
+	irBcAttr_UWTable      = 33,
+	irBcAttr_OptimizeNone = 37,
+	irBcAttr_NonNull      = 39,
+};
+
+#define IR_BC_FUNCTION_ATTR_INDEX 0xffffffffu
+
+// NOTE: The abbreviations of the value symbol tables, constants and functions, which are defined once in
+// the BLOCKINFO block. The numbering follows the order they are defined in, see 'ir_bc_emit_block_info'.
+enum irBcVstAbbrev {
+	irBcVstAbbrev_Entry8 = irBcAbbrevId_FirstApp,
+	irBcVstAbbrev_Entry7,
+	irBcVstAbbrev_Entry6,
+	irBcVstAbbrev_BbEntry6,
+	irBcVstAbbrev_BbEntry8,
+};
+
+enum irBcConstAbbrev {
+	irBcConstAbbrev_SetType = irBcAbbrevId_FirstApp,
+	irBcConstAbbrev_Integer,
+	irBcConstAbbrev_CastExpr,
+	irBcConstAbbrev_Null,
+};
+
+enum irBcFuncAbbrev {
+	irBcFuncAbbrev_None = 0,
+	irBcFuncAbbrev_Load = irBcAbbrevId_FirstApp,
+	irBcFuncAbbrev_Binop,
+	irBcFuncAbbrev_Cast,
+	irBcFuncAbbrev_RetVoid,
+	irBcFuncAbbrev_RetVal,
+	irBcFuncAbbrev_Unreachable,
+	irBcFuncAbbrev_Gep,
+};
+
+
+////////////////////////////////////////////////////////////////
+//
+// Bitstream
+//
+////////////////////////////////////////////////////////////////
+
+enum irBcAbbrevOpKind : u8 {
+	irBcAbbrevOp_Literal,
+	irBcAbbrevOp_Fixed,
+	irBcAbbrevOp_VBR,
+	irBcAbbrevOp_Array,
+	irBcAbbrevOp_Char6,
+	irBcAbbrevOp_Blob,
+
+	irBcAbbrevOp_None, // NOTE: Marks the unused operands of 'ir_bc_abbrev'
+};
+
+struct irBcAbbrevOp {
+	irBcAbbrevOpKind kind;
+	u32              value; // NOTE: The literal, or the width of a fixed or VBR field
+};
+
+struct irBcAbbrev {
+	u32          id;
+	isize        op_count;
+	irBcAbbrevOp ops[8];
+};
+
+struct irBcBlockScope {
+	u32   abbrev_width;
+	isize length_offset; // NOTE: Of the block's length word, which is filled in when the block ends
+};
+
+struct irBitWriter {
+	Array<u8> *           out;
+	u64                   bits;
+	u32                   bit_count;
+	u32                   abbrev_width;
+	Array<irBcBlockScope> scopes;
+};
+
+void ir_bit_write_word(irBitWriter *b, u32 word) {
+	Array<u8> *out = b->out;
+	if (out->count + 4 > out->capacity) {
+		array_set_capacity(out, gb_max(2*out->capacity, out->count + 4));
+	}
+	u8 *p = out->data + out->count;
+	p[0] = cast(u8)(word);
+	p[1] = cast(u8)(word >> 8);
+	p[2] = cast(u8)(word >> 16);
+	p[3] = cast(u8)(word >> 24);
+	out->count += 4;
+}
+
+void ir_bit_emit(irBitWriter *b, u64 value, u32 width) {
+	GB_ASSERT(width <= 32);
+	if (width == 0) {
+		return;
+	}
+	b->bits |= value << b->bit_count;
+	b->bit_count += width;
+	if (b->bit_count >= 32) {
+		ir_bit_write_word(b, cast(u32)b->bits);
+		b->bits >>= 32;
+		b->bit_count -= 32;
+	}
+}
+
+void ir_bit_emit_vbr(irBitWriter *b, u64 value, u32 width) {
+	u64 threshold = 1ull << (width-1);
+	while (value >= threshold) {
+		ir_bit_emit(b, (value & (threshold-1)) | threshold, width);
+		value >>= width-1;
+	}
+	ir_bit_emit(b, value, width);
+}
+
+void ir_bit_align32(irBitWriter *b) {
+	if (b->bit_count > 0) {
+		ir_bit_write_word(b, cast(u32)b->bits);
+		b->bits = 0;
+		b->bit_count = 0;
+	}
+}
+
+void ir_bit_enter_block(irBitWriter *b, u32 block_id, u32 abbrev_width) {
+	ir_bit_emit(b, irBcAbbrevId_EnterBlock, b->abbrev_width);
+	ir_bit_emit_vbr(b, block_id, 8);
+	ir_bit_emit_vbr(b, abbrev_width, 4);
+	ir_bit_align32(b);
+
+	irBcBlockScope scope = {};
+	scope.abbrev_width = b->abbrev_width;
+	scope.length_offset = b->out->count;
+	array_add(&b->scopes, scope);
+	ir_bit_write_word(b, 0);
+	b->abbrev_width = abbrev_width;
+}
+
+void ir_bit_exit_block(irBitWriter *b) {
+	ir_bit_emit(b, irBcAbbrevId_EndBlock, b->abbrev_width);
+	ir_bit_align32(b);
+
+	irBcBlockScope scope = array_pop(&b->scopes);
+	u32 length = cast(u32)((b->out->count - scope.length_offset)/4 - 1);
+	u8 *p = b->out->data + scope.length_offset;
+	p[0] = cast(u8)(length);
+	p[1] = cast(u8)(length >> 8);
+	p[2] = cast(u8)(length >> 16);
+	p[3] = cast(u8)(length >> 24);
+	b->abbrev_width = scope.abbrev_width;
+}
+
+void ir_bit_define_abbrev(irBitWriter *b, irBcAbbrev const *a) {
+	ir_bit_emit(b, irBcAbbrevId_DefineAbbrev, b->abbrev_width);
+	ir_bit_emit_vbr(b, a->op_count, 5);
+	for (isize i = 0; i < a->op_count; i++) {
+		irBcAbbrevOp op = a->ops[i];
+		if (op.kind == irBcAbbrevOp_Literal) {
+			ir_bit_emit(b, 1, 1);
+			ir_bit_emit_vbr(b, op.value, 8);
+			continue;
+		}
+		ir_bit_emit(b, 0, 1);
+		ir_bit_emit(b, op.kind, 3);
+		if (op.kind == irBcAbbrevOp_Fixed || op.kind == irBcAbbrevOp_VBR) {
+			ir_bit_emit_vbr(b, op.value, 5);
+		}
+	}
+}
+
+i32 ir_bc_char6(u8 c) {
+	if ('a' <= c && c <= 'z') return c - 'a';
+	if ('A' <= c && c <= 'Z') return c - 'A' + 26;
+	if ('0' <= c && c <= '9') return c - '0' + 52;
+	if (c == '.') return 62;
+	if (c == '_') return 63;
+	return -1;
+}
+
+void ir_bit_emit_abbrev_op(irBitWriter *b, irBcAbbrevOp op, u64 value) {
+	switch (op.kind) {
+	case irBcAbbrevOp_Literal: GB_ASSERT(value == op.value);  break;
+	case irBcAbbrevOp_Fixed:   ir_bit_emit(b, value, op.value);     break;
+	case irBcAbbrevOp_VBR:     ir_bit_emit_vbr(b, value, op.value); break;
+	case irBcAbbrevOp_Char6:   ir_bit_emit(b, cast(u64)ir_bc_char6(cast(u8)value), 6); break;
+	default: GB_PANIC("Invalid scalar abbreviation operand"); break;
+	}
+}
+
+// NOTE: The record is 'code' followed by 'ops', and only an array may come last in the abbreviation
+void ir_bit_emit_record_abbrev(irBitWriter *b, irBcAbbrev const *a, u32 code, u64 const *ops, isize op_count) {
+	ir_bit_emit(b, a->id, b->abbrev_width);
+	isize value_index = 0;
+	for (isize i = 0; i < a->op_count; i++) {
+		irBcAbbrevOp op = a->ops[i];
+		if (op.kind == irBcAbbrevOp_Array) {
+			irBcAbbrevOp elem = a->ops[i+1];
+			isize first = gb_max(value_index-1, 0);
+			GB_ASSERT(value_index > 0);
+			ir_bit_emit_vbr(b, op_count - first, 6);
+			for (isize j = first; j < op_count; j++) {
+				ir_bit_emit_abbrev_op(b, elem, ops[j]);
+			}
+			return;
+		}
+		u64 value = value_index == 0 ? code : ops[value_index-1];
+		ir_bit_emit_abbrev_op(b, op, value);
+		value_index += 1;
+	}
+	GB_ASSERT(value_index == op_count+1);
+}
+
+void ir_bit_emit_record(irBitWriter *b, u32 code, u64 const *ops, isize op_count) {
+	ir_bit_emit(b, irBcAbbrevId_Unabbrev, b->abbrev_width);
+	ir_bit_emit_vbr(b, code, 6);
+	ir_bit_emit_vbr(b, op_count, 6);
+	for (isize i = 0; i < op_count; i++) {
+		ir_bit_emit_vbr(b, ops[i], 6);
+	}
+}
+
+void ir_bit_emit_record_string(irBitWriter *b, u32 code, String str) {
+	ir_bit_emit(b, irBcAbbrevId_Unabbrev, b->abbrev_width);
+	ir_bit_emit_vbr(b, code, 6);
+	ir_bit_emit_vbr(b, str.len, 6);
+	for (isize i = 0; i < str.len; i++) {
+		ir_bit_emit_vbr(b, str[i], 6);
+	}
+}
+
+gb_inline irBcAbbrevOp ir_bc_op_none(void)         { irBcAbbrevOp op = {irBcAbbrevOp_None, 0};        return op; }
+gb_inline irBcAbbrevOp ir_bc_op_literal(u32 value) { irBcAbbrevOp op = {irBcAbbrevOp_Literal, value}; return op; }
+gb_inline irBcAbbrevOp ir_bc_op_fixed(u32 width)   { irBcAbbrevOp op = {irBcAbbrevOp_Fixed, width};   return op; }
+gb_inline irBcAbbrevOp ir_bc_op_vbr(u32 width)     { irBcAbbrevOp op = {irBcAbbrevOp_VBR, width};     return op; }
+gb_inline irBcAbbrevOp ir_bc_op_array(void)        { irBcAbbrevOp op = {irBcAbbrevOp_Array, 0};       return op; }
+gb_inline irBcAbbrevOp ir_bc_op_char6(void)        { irBcAbbrevOp op = {irBcAbbrevOp_Char6, 0};       return op; }
+gb_inline irBcAbbrevOp ir_bc_op_blob(void)         { irBcAbbrevOp op = {irBcAbbrevOp_Blob, 0};        return op; }
+
+irBcAbbrev ir_bc_abbrev(u32 id, irBcAbbrevOp op0,
+                        irBcAbbrevOp op1 = ir_bc_op_none(), irBcAbbrevOp op2 = ir_bc_op_none(),
+                        irBcAbbrevOp op3 = ir_bc_op_none(), irBcAbbrevOp op4 = ir_bc_op_none()) {
+	irBcAbbrevOp ops[] = {op0, op1, op2, op3, op4};
+	irBcAbbrev a = {};
+	a.id = id;
+	for (isize i = 0; i < gb_count_of(ops) && ops[i].kind != irBcAbbrevOp_None; i++) {
+		a.ops[a.op_count++] = ops[i];
+	}
+	return a;
+}
+
+u64 ir_bc_encode_signed(i64 v) {
+	if (v >= 0) {
+		return cast(u64)v << 1;
+	}
+	if (v == INT64_MIN) {
+		return 1;
+	}
+	return (cast(u64)(-v) << 1) | 1;
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Module
+//
+////////////////////////////////////////////////////////////////
+
+enum irBcTypeKind : u8 {
+	irBcType_Void,
+	irBcType_Half,
+	irBcType_Float,
+	irBcType_Double,
+	irBcType_X86Mmx,
+	irBcType_Label,
+	irBcType_Metadata,
+	irBcType_Integer,
+	irBcType_Pointer,
+	irBcType_Array,
+	irBcType_Vector,
+	irBcType_Struct,
+	irBcType_Function,
+};
+
+struct irBcType {
+	irBcTypeKind kind;
+	bool         is_packed;   // NOTE: Structs only
+	bool         is_vararg;   // NOTE: Functions only
+	bool         has_body;    // NOTE: Named structs only, set once their fields are known
+	i64          count;       // NOTE: Bits of an integer, or elements of an array or vector
+	i32          elem;        // NOTE: Pointee, element or result type
+	i32          fields;      // NOTE: Offset of the struct fields or function parameters in 'type_fields'
+	i32          field_count;
+	String       name;        // NOTE: Named structs only
+	i32          id;          // NOTE: Position in the type table, see 'ir_bc_number_type'
+};
+
+struct irBcConst {
+	i32 type;
+	u32 code;
+	i32 ops;      // NOTE: Offset in 'const_ops', which hold value references rather than IDs where the record has values
+	i32 op_count;
+};
+
+// NOTE: A reference to a module level or function local value, resolved to its ID when it is written
+enum irBcValueKind : u64 {
+	irBcValue_Invalid,
+	irBcValue_Global,
+	irBcValue_Function,
+	irBcValue_Const,
+	irBcValue_Arg,
+	irBcValue_Instr,
+};
+
+#define IR_BC_VALUE(kind, index) ((cast(u64)(kind) << 32) | cast(u64)cast(u32)(index))
+#define IR_BC_VALUE_KIND(ref)    (cast(irBcValueKind)((ref) >> 32))
+#define IR_BC_VALUE_INDEX(ref)   (cast(i32)cast(u32)(ref))
+
+// NOTE: Instruction records are stored as a header, see 'ir_bc_add_record', then their tagged operands
+enum irBcOpKind : u64 {
+	irBcOp_Literal,
+	irBcOp_Type,          // A type index
+	irBcOp_Value,         // A value reference, written relative to the instruction
+	irBcOp_ValueType,     // The same, followed by its type if it is a forward reference
+	irBcOp_ValueSigned,   // The same as a signed number, for phi nodes
+	irBcOp_ValueAbsolute, // A value reference, written as its ID
+};
+
+#define IR_BC_OP(kind, payload) ((cast(u64)(kind) << 60) | (payload))
+#define IR_BC_OP_KIND(op)       (cast(irBcOpKind)((op) >> 60))
+#define IR_BC_OP_PAYLOAD(op)    ((op) & ((1ull << 60) - 1))
+
+struct irBcAttr {
+	u32 index; // NOTE: 0 for the result, 1 for the first parameter, or IR_BC_FUNCTION_ATTR_INDEX
+	u32 kind;
+	i32 type;  // NOTE: The type of a type attribute, otherwise -1
+};
+
+struct irBcAttrGroup {
+	u32 index;
+	i32 attrs;
+	i32 attr_count;
+};
+
+struct irBcAttrList {
+	i32 groups;
+	i32 group_count;
+};
+
+struct irBcFunctionBody {
+	Array<u64>    records;
+	Array<i32>    value_types; // NOTE: The types of the instructions with a value, by 'irValue.index'
+	Array<String> arg_names;
+	Array<i32>    param_args;  // NOTE: The argument of the parameter '%_.N', by N
+	i32           sret_arg;
+	i32           context_arg;
+	isize         block_count;
+};
+
+struct irBcFunction {
+	String            name;
+	irProcedure *     proc;   // NOTE: nullptr for the intrinsics and '__chkstk'
+	i32               type;   // NOTE: The function type rather than a pointer to it
+	u32               cc;
+	i32               attrs;  // NOTE: 1 + the index of its attribute list, 0 for none
+	bool              is_definition;
+	bool              is_dllexport;
+	irBcFunctionBody *body;
+};
+
+struct irBcGlobal {
+	String   name;
+	irValue *value;
+	i32      type;
+	u64      init;              // NOTE: A value reference, only for a definition
+	bool     is_definition;
+	bool     is_other_unit;     // NOTE: Declared for a global another codegen unit defines
+};
+
+struct irBcWriter {
+	irModule *        m;
+	Arena             arena;       // NOTE: The names and keys which outlive the scratch buffers
+	gbAllocator       allocator;
+	bool              is_split;
+
+	irFileBuffer      text;        // NOTE: Types and values are printed into 'text_data' to be parsed back
+	Array<u8>         text_data;
+	Array<u8>         name_data;
+	Array<u8>         key_data;
+	Array<i32>        type_stack;
+	Array<u64>        op_stack;
+	Array<u64>        record;
+
+	Array<irBcType>   types;
+	Array<i32>        type_fields;
+	Array<i32>        type_order;  // NOTE: The types in the order they are written
+	Map<i32>          type_map;    // Key: the structure of a literal type
+	Map<i32>          type_cache;  // Key: Type *
+	Map<i32>          named_types; // Key: String
+	Map<String>       builtin_type_defs; // Key: String, the definitions 'ir_print_builtin_type_names' prints
+	Map<irValue *>    type_names;  // Key: String
+
+	Array<irBcConst>  consts;
+	Array<u64>        const_ops;
+	Map<i32>          const_map;   // Key: the record of the constant
+
+	Array<irBcGlobal>   globals;
+	Array<irBcFunction> functions;
+	Map<u64>            value_map;     // Key: String, the LLVM name of a global or function
+	Map<irValue *>      module_names;  // Key: String, the LLVM name of a member global or procedure
+	isize               module_names_member_count;
+
+	Array<irBcAttr>      attr_scratch;
+	Array<irBcAttr>      attrs;
+	Array<irBcAttrGroup> attr_groups;
+	Map<i32>             attr_group_map; // Key: the attributes of the group
+	Array<i32>           attr_list_groups;
+	Array<irBcAttrList>  attr_lists;
+	Map<i32>             attr_list_map;  // Key: the groups of the list
+
+	irBcFunctionBody *body; // NOTE: Of the procedure being lowered
+	irBcAbbrev        function_abbrevs[7]; // NOTE: Those defined in the BLOCKINFO block for functions
+
+	i32 t_void;
+	i32 t_i1;
+	i32 t_i32;
+};
+
+String ir_bc_copy_string(irBcWriter *w, String s) {
+	u8 *data = cast(u8 *)gb_alloc_copy(w->allocator, s.text, s.len);
+	return make_string(data, s.len);
+}
+
+void ir_bc_key_begin(irBcWriter *w) {
+	array_clear(&w->key_data);
+}
+
+void ir_bc_key_write(irBcWriter *w, void const *data, isize len) {
+	array_add_elems(&w->key_data, cast(u8 const *)data, len);
+}
+
+HashKey ir_bc_key_end(irBcWriter *w) {
+	return hash_string(make_string(w->key_data.data, w->key_data.count));
+}
+
+// NOTE: The key of a new map entry has to outlive 'key_data'
+HashKey ir_bc_key_persist(irBcWriter *w, HashKey key) {
+	key.string = ir_bc_copy_string(w, key.string);
+	return key;
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Types
+//
+////////////////////////////////////////////////////////////////
+
+i32 ir_bc_add_type(irBcWriter *w, irBcTypeKind kind, i64 count, i32 elem, i32 const *fields, isize field_count, bool flag) {
+	// NOTE: Literal types are unique by their structure, as in LLVM
+	ir_bc_key_begin(w);
+	u8 header[2] = {cast(u8)kind, cast(u8)flag};
+	ir_bc_key_write(w, header, gb_size_of(header));
+	ir_bc_key_write(w, &count, gb_size_of(count));
+	ir_bc_key_write(w, &elem, gb_size_of(elem));
+	ir_bc_key_write(w, fields, field_count*gb_size_of(i32));
+	HashKey key = ir_bc_key_end(w);
+	i32 *found = map_get(&w->type_map, key);
+	if (found != nullptr) {
+		return *found;
+	}
+
+	irBcType t = {};
+	t.kind = kind;
+	t.is_packed = kind == irBcType_Struct && flag;
+	t.is_vararg = kind == irBcType_Function && flag;
+	t.count = count;
+	t.elem = elem;
+	t.fields = cast(i32)w->type_fields.count;
+	t.field_count = cast(i32)field_count;
+	t.id = -1;
+	array_add_elems(&w->type_fields, fields, field_count);
+
+	i32 index = cast(i32)w->types.count;
+	array_add(&w->types, t);
+	map_set(&w->type_map, ir_bc_key_persist(w, key), index);
+	return index;
+}
+
+gb_inline i32 ir_bc_type_simple(irBcWriter *w, irBcTypeKind kind) {
+	return ir_bc_add_type(w, kind, 0, -1, nullptr, 0, false);
+}
+gb_inline i32 ir_bc_type_integer(irBcWriter *w, i64 bits) {
+	return ir_bc_add_type(w, irBcType_Integer, bits, -1, nullptr, 0, false);
+}
+gb_inline i32 ir_bc_type_pointer(irBcWriter *w, i32 elem) {
+	return ir_bc_add_type(w, irBcType_Pointer, 0, elem, nullptr, 0, false);
+}
+gb_inline i32 ir_bc_type_array(irBcWriter *w, i64 count, i32 elem) {
+	return ir_bc_add_type(w, irBcType_Array, count, elem, nullptr, 0, false);
+}
+gb_inline i32 ir_bc_type_vector(irBcWriter *w, i64 count, i32 elem) {
+	return ir_bc_add_type(w, irBcType_Vector, count, elem, nullptr, 0, false);
+}
+gb_inline i32 ir_bc_type_struct(irBcWriter *w, i32 const *fields, isize field_count, bool is_packed) {
+	return ir_bc_add_type(w, irBcType_Struct, 0, -1, fields, field_count, is_packed);
+}
+gb_inline i32 ir_bc_type_function(irBcWriter *w, i32 result, i32 const *params, isize param_count, bool is_vararg) {
+	return ir_bc_add_type(w, irBcType_Function, 0, result, params, param_count, is_vararg);
+}
+
+gb_inline i32 ir_bc_type_field(irBcWriter *w, i32 type, i64 index) {
+	irBcType *t = &w->types[type];
+	GB_ASSERT(t->kind == irBcType_Struct && 0 <= index && index < t->field_count);
+	return w->type_fields[t->fields + cast(i32)index];
+}
+
+gb_inline i32 ir_bc_type_elem(irBcWriter *w, i32 type) {
+	irBcType *t = &w->types[type];
+	GB_ASSERT(t->kind == irBcType_Pointer || t->kind == irBcType_Array || t->kind == irBcType_Vector || t->kind == irBcType_Function);
+	return t->elem;
+}
+
+gb_inline bool ir_bc_type_is(irBcWriter *w, i32 type, irBcTypeKind kind) {
+	return w->types[type].kind == kind;
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Parsing of the printed types and constants
+//
+////////////////////////////////////////////////////////////////
+
+// NOTE: A range of 'text_data'. Printing may reallocate it, so this holds offsets rather than pointers.
+struct irBcText {
+	Array<u8> *data;
+	isize      pos;
+	isize      end;
+};
+
+irBcText ir_bc_text(irBcWriter *w, isize start) {
+	irBcText t = {&w->text_data, start, w->text_data.count};
+	return t;
+}
+
+gb_inline u8 ir_bc_peek(irBcText *t, isize offset = 0) {
+	isize i = t->pos + offset;
+	return i < t->end ? t->data->data[i] : 0;
+}
+
+void ir_bc_skip_space(irBcText *t) {
+	for (;;) {
+		u8 c = ir_bc_peek(t);
+		if (c != ' ' && c != '\t' && c != '\n') {
+			break;
+		}
+		t->pos += 1;
+	}
+}
+
+void ir_bc_text_error(irBcText *t, char const *expected) {
+	isize len = gb_clamp(t->end - t->pos, 0, 80);
+	GB_PANIC("Unable to write LLVM bitcode: expected %s at \"%.*s\"", expected, cast(int)len, t->data->data + t->pos);
+}
+
+bool ir_bc_accept(irBcText *t, char const *s) {
+	ir_bc_skip_space(t);
+	isize len = gb_strlen(s);
+	if (t->pos + len > t->end || gb_memcompare(t->data->data + t->pos, s, len) != 0) {
+		return false;
+	}
+	t->pos += len;
+	return true;
+}
+
+void ir_bc_expect(irBcText *t, char const *s) {
+	if (!ir_bc_accept(t, s)) {
+		ir_bc_text_error(t, s);
+	}
+}
+
+String ir_bc_parse_word(irBcText *t) {
+	ir_bc_skip_space(t);
+	isize start = t->pos;
+	for (;;) {
+		u8 c = ir_bc_peek(t);
+		if (!gb_char_is_alphanumeric(c) && c != '_') {
+			break;
+		}
+		t->pos += 1;
+	}
+	return make_string(t->data->data + start, t->pos - start);
+}
+
+u64 ir_bc_parse_u64(irBcText *t) {
+	ir_bc_skip_space(t);
+	if (!gb_char_is_digit(ir_bc_peek(t))) {
+		ir_bc_text_error(t, "a number");
+	}
+	u64 n = 0;
+	while (gb_char_is_digit(ir_bc_peek(t))) {
+		n = n*10 + (ir_bc_peek(t) - '0');
+		t->pos += 1;
+	}
+	return n;
+}
+
+// NOTE: Parses the name after a '%' or '@'. It is only valid until the next name is parsed.
+String ir_bc_parse_name(irBcWriter *w, irBcText *t) {
+	array_clear(&w->name_data);
+	if (ir_bc_peek(t) == '"') {
+		t->pos += 1;
+		for (;;) {
+			if (t->pos >= t->end) {
+				ir_bc_text_error(t, "'\"'");
+			}
+			u8 c = ir_bc_peek(t);
+			t->pos += 1;
+			if (c == '"') {
+				break;
+			}
+			if (c == '\\') {
+				u8 hi = ir_bc_peek(t, 0);
+				u8 lo = ir_bc_peek(t, 1);
+				c = cast(u8)(gb_hex_digit_to_int(hi) << 4 | gb_hex_digit_to_int(lo));
+				t->pos += 2;
+			}
+			array_add(&w->name_data, c);
+		}
+	} else {
+		while (ir_valid_char(ir_bc_peek(t))) {
+			array_add(&w->name_data, ir_bc_peek(t));
+			t->pos += 1;
+		}
+	}
+	return make_string(w->name_data.data, w->name_data.count);
+}
+
+i32 ir_bc_parse_type(irBcWriter *w, irBcText *t);
+
+// NOTE: Pushes the types up to 'close' onto 'type_stack', and returns where they start
+isize ir_bc_parse_type_list(irBcWriter *w, irBcText *t, char const *close) {
+	isize start = w->type_stack.count;
+	if (ir_bc_accept(t, close)) {
+		return start;
+	}
+	for (;;) {
+		i32 type = ir_bc_parse_type(w, t);
+		array_add(&w->type_stack, type);
+		if (ir_bc_accept(t, close)) {
+			break;
+		}
+		ir_bc_expect(t, ",");
+	}
+	return start;
+}
+
+i32 ir_bc_parse_struct_type(irBcWriter *w, irBcText *t, bool is_packed, i32 named) {
+	isize start = ir_bc_parse_type_list(w, t, is_packed ? "}>" : "}");
+	i32 *fields = w->type_stack.data + start;
+	isize field_count = w->type_stack.count - start;
+	i32 type = named;
+	if (named >= 0) {
+		irBcType *nt = &w->types[named];
+		nt->is_packed = is_packed;
+		nt->has_body = true;
+		nt->fields = cast(i32)w->type_fields.count;
+		nt->field_count = cast(i32)field_count;
+		array_add_elems(&w->type_fields, fields, field_count);
+	} else {
+		type = ir_bc_type_struct(w, fields, field_count, is_packed);
+	}
+	w->type_stack.count = start;
+	return type;
+}
+
+// NOTE: Named types are parsed from their definition the first time they are used
+i32 ir_bc_named_type(irBcWriter *w, String name) {
+	i32 *found = map_get(&w->named_types, hash_string(name));
+	if (found != nullptr) {
+		return *found;
+	}
+	name = ir_bc_copy_string(w, name);
+
+	isize start = w->text_data.count;
+	String *builtin = map_get(&w->builtin_type_defs, hash_string(name));
+	if (builtin != nullptr) {
+		array_add_elems(&w->text_data, builtin->text, builtin->len);
+	} else {
+		irValue **type_name = map_get(&w->type_names, hash_string(name));
+		GB_ASSERT_MSG(type_name != nullptr, "Unknown named type '%.*s'", LIT(name));
+		ir_print_type_name(&w->text, w->m, *type_name);
+	}
+	irBcText t = ir_bc_text(w, start);
+	if (builtin == nullptr) {
+		while (t.pos < t.end && ir_bc_peek(&t) != '=') {
+			t.pos += 1;
+		}
+		ir_bc_expect(&t, "=");
+		ir_bc_expect(&t, "type");
+	}
+
+	i32 type = -1;
+	ir_bc_skip_space(&t);
+	bool is_packed = ir_bc_peek(&t) == '<' && ir_bc_peek(&t, 1) == '{';
+	if (ir_bc_peek(&t) == '{' || is_packed) {
+		// NOTE: A named struct is added before its fields, which may refer to it
+		irBcType nt = {};
+		nt.kind = irBcType_Struct;
+		nt.name = name;
+		nt.id = -1;
+		type = cast(i32)w->types.count;
+		array_add(&w->types, nt);
+		map_set(&w->named_types, hash_string(name), type);
+
+		t.pos += is_packed ? 2 : 1;
+		ir_bc_parse_struct_type(w, &t, is_packed, type);
+	} else {
+		type = ir_bc_parse_type(w, &t);
+		map_set(&w->named_types, hash_string(name), type);
+	}
+	w->text_data.count = start;
+	return type;
+}
+
+i32 ir_bc_parse_type(irBcWriter *w, irBcText *t) {
+	ir_bc_skip_space(t);
+	i32 type = -1;
+	u8 c = ir_bc_peek(t);
+	if (c == 'i' && gb_char_is_digit(ir_bc_peek(t, 1))) {
+		t->pos += 1;
+		type = ir_bc_type_integer(w, cast(i64)ir_bc_parse_u64(t));
+	} else if (c == '%') {
+		t->pos += 1;
+		type = ir_bc_named_type(w, ir_bc_parse_name(w, t));
+	} else if (c == '{') {
+		t->pos += 1;
+		type = ir_bc_parse_struct_type(w, t, false, -1);
+	} else if (c == '<' && ir_bc_peek(t, 1) == '{') {
+		t->pos += 2;
+		type = ir_bc_parse_struct_type(w, t, true, -1);
+	} else if (c == '<' || c == '[') {
+		t->pos += 1;
+		u64 count = ir_bc_parse_u64(t);
+		ir_bc_expect(t, "x");
+		i32 elem = ir_bc_parse_type(w, t);
+		if (c == '<') {
+			ir_bc_expect(t, ">");
+			type = ir_bc_type_vector(w, count, elem);
+		} else {
+			ir_bc_expect(t, "]");
+			type = ir_bc_type_array(w, count, elem);
+		}
+	} else {
+		String word = ir_bc_parse_word(t);
+		if (word == "void") {
+			type = w->t_void;
+		} else if (word == "half") {
+			type = ir_bc_type_simple(w, irBcType_Half);
+		} else if (word == "float") {
+			type = ir_bc_type_simple(w, irBcType_Float);
+		} else if (word == "double") {
+			type = ir_bc_type_simple(w, irBcType_Double);
+		} else if (word == "x86_mmx") {
+			type = ir_bc_type_simple(w, irBcType_X86Mmx);
+		} else if (word == "metadata") {
+			type = ir_bc_type_simple(w, irBcType_Metadata);
+		} else {
+			ir_bc_text_error(t, "a type");
+		}
+	}
+
+	for (;;) {
+		ir_bc_skip_space(t);
+		if (ir_bc_peek(t) == '*') {
+			t->pos += 1;
+			type = ir_bc_type_pointer(w, type);
+		} else if (ir_bc_peek(t) == '(') {
+			t->pos += 1;
+			isize start = w->type_stack.count;
+			bool is_vararg = false;
+			while (!ir_bc_accept(t, ")")) {
+				if (ir_bc_accept(t, "...")) {
+					is_vararg = true;
+				} else {
+					array_add(&w->type_stack, ir_bc_parse_type(w, t));
+					ir_bc_accept(t, "noalias");
+				}
+				ir_bc_accept(t, ",");
+			}
+			type = ir_bc_type_function(w, type, w->type_stack.data + start, w->type_stack.count - start, is_vararg);
+			w->type_stack.count = start;
+		} else {
+			break;
+		}
+	}
+	return type;
+}
+
+i32 ir_bc_type(irBcWriter *w, Type *type) {
+	HashKey key = hash_pointer(type);
+	i32 *found = map_get(&w->type_cache, key);
+	if (found != nullptr) {
+		return *found;
+	}
+	isize start = w->text_data.count;
+	ir_print_type(&w->text, w->m, type);
+	irBcText t = ir_bc_text(w, start);
+	i32 result = ir_bc_parse_type(w, &t);
+	w->text_data.count = start;
+	map_set(&w->type_cache, key, result);
+	return result;
+}
+
+// NOTE: The result type of a procedure as it is passed in LLVM, see 'ir_print_proc_results'
+i32 ir_bc_proc_results_type(irBcWriter *w, Type *proc_type) {
+	isize start = w->text_data.count;
+	ir_print_proc_results(&w->text, w->m, proc_type);
+	irBcText t = ir_bc_text(w, start);
+	i32 result = ir_bc_parse_type(w, &t);
+	w->text_data.count = start;
+	return result;
+}
+
+i32 ir_bc_proc_function_type(irBcWriter *w, Type *proc_type) {
+	isize start = w->text_data.count;
+	ir_print_proc_type_without_pointer(&w->text, w->m, proc_type);
+	irBcText t = ir_bc_text(w, start);
+	i32 result = ir_bc_parse_type(w, &t);
+	w->text_data.count = start;
+	GB_ASSERT(ir_bc_type_is(w, result, irBcType_Function));
+	return result;
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Constants
+//
+////////////////////////////////////////////////////////////////
+
+u64 ir_bc_add_const(irBcWriter *w, i32 type, u32 code, u64 const *ops, isize op_count) {
+	ir_bc_key_begin(w);
+	ir_bc_key_write(w, &type, gb_size_of(type));
+	ir_bc_key_write(w, &code, gb_size_of(code));
+	ir_bc_key_write(w, ops, op_count*gb_size_of(u64));
+	HashKey key = ir_bc_key_end(w);
+	i32 *found = map_get(&w->const_map, key);
+	if (found != nullptr) {
+		return IR_BC_VALUE(irBcValue_Const, *found);
+	}
+
+	irBcConst c = {};
+	c.type = type;
+	c.code = code;
+	c.ops = cast(i32)w->const_ops.count;
+	c.op_count = cast(i32)op_count;
+	array_add_elems(&w->const_ops, ops, op_count);
+
+	i32 index = cast(i32)w->consts.count;
+	array_add(&w->consts, c);
+	map_set(&w->const_map, ir_bc_key_persist(w, key), index);
+	return IR_BC_VALUE(irBcValue_Const, index);
+}
+
+u64 ir_bc_const_int(irBcWriter *w, i32 type, i64 value) {
+	u64 op = ir_bc_encode_signed(value);
+	return ir_bc_add_const(w, type, irBcConst_Integer, &op, 1);
+}
+
+u64 ir_bc_const_null(irBcWriter *w, i32 type) {
+	return ir_bc_add_const(w, type, irBcConst_Null, nullptr, 0);
+}
+
+u64 ir_bc_global_ref(irBcWriter *w, String name);
+
+// NOTE: Truncates a 128 bit integer to the width of 'bits'
+void ir_bc_truncate_int(u64 *lo, u64 *hi, i64 bits) {
+	if (bits < 64) {
+		*lo &= (1ull << bits) - 1;
+		*hi = 0;
+	} else if (bits == 64) {
+		*hi = 0;
+	} else if (bits < 128) {
+		*hi &= (1ull << (bits-64)) - 1;
+	}
+}
+
+// NOTE: Parses a scalar of an integer or floating point type into its bits, and leaves the text as it was
+// if it is something else
+bool ir_bc_parse_scalar(irBcWriter *w, irBcText *t, i32 type, u64 *lo_, u64 *hi_) {
+	irBcType *bt = &w->types[type];
+	irBcText start = *t;
+	ir_bc_skip_space(t);
+	u64 lo = 0, hi = 0;
+
+	if (bt->kind == irBcType_Integer) {
+		u8 c = ir_bc_peek(t);
+		if (c == '-' || gb_char_is_digit(c)) {
+			bool negative = c == '-';
+			if (negative) {
+				t->pos += 1;
+			}
+			if (!gb_char_is_digit(ir_bc_peek(t))) {
+				ir_bc_text_error(t, "a number");
+			}
+			while (gb_char_is_digit(ir_bc_peek(t))) {
+				u64 d = ir_bc_peek(t) - '0';
+				u64 lo_lo = (lo & 0xffffffffull)*10 + d;
+				u64 lo_hi = (lo >> 32)*10 + (lo_lo >> 32);
+				lo = (lo_hi << 32) | (lo_lo & 0xffffffffull);
+				hi = hi*10 + (lo_hi >> 32);
+				t->pos += 1;
+			}
+			if (negative) {
+				lo = ~lo + 1;
+				hi = ~hi + (lo == 0 ? 1 : 0);
+			}
+		} else {
+			String word = ir_bc_parse_word(t);
+			if (word == "true") {
+				lo = 1;
+			} else if (word != "false" && word != "zeroinitializer") {
+				*t = start;
+				return false;
+			}
+		}
+		ir_bc_truncate_int(&lo, &hi, bt->count);
+	} else if (bt->kind == irBcType_Float || bt->kind == irBcType_Double) {
+		if (ir_bc_accept(t, "0x")) {
+			while (gb_char_is_hex_digit(ir_bc_peek(t))) {
+				lo = (lo << 4) | cast(u64)gb_hex_digit_to_int(ir_bc_peek(t));
+				t->pos += 1;
+			}
+			if (bt->kind == irBcType_Float) {
+				// NOTE: LLVM writes a float in the hexadecimal form of the double it converts exactly to
+				f64 d = bit_cast<f64>(lo);
+				lo = bit_cast<u32>(cast(f32)d);
+			}
+		} else if (bt->kind == irBcType_Float && ir_bc_accept(t, "bitcast")) {
+			ir_bc_expect(t, "(");
+			ir_bc_expect(t, "i32");
+			lo = ir_bc_parse_u64(t);
+			ir_bc_expect(t, "to");
+			ir_bc_expect(t, "float");
+			ir_bc_expect(t, ")");
+		} else {
+			String word = ir_bc_parse_word(t);
+			if (word != "zeroinitializer") {
+				*t = start;
+				return false;
+			}
+		}
+	} else {
+		return false;
+	}
+	*lo_ = lo;
+	*hi_ = hi;
+	return true;
+}
+
+u64 ir_bc_parse_const(irBcWriter *w, irBcText *t, i32 type);
+
+u64 ir_bc_scalar_const(irBcWriter *w, i32 type, u64 lo, u64 hi) {
+	irBcType *bt = &w->types[type];
+	if (lo == 0 && hi == 0) {
+		return ir_bc_const_null(w, type);
+	}
+	if (bt->kind != irBcType_Integer) {
+		return ir_bc_add_const(w, type, irBcConst_Float, &lo, 1);
+	}
+	if (bt->count <= 64) {
+		// NOTE: Integers are written sign extended from their width
+		i64 v = cast(i64)lo;
+		if (bt->count < 64 && (lo >> (bt->count-1)) & 1) {
+			v = cast(i64)(lo | ~((1ull << bt->count) - 1));
+		}
+		u64 op = ir_bc_encode_signed(v);
+		return ir_bc_add_const(w, type, irBcConst_Integer, &op, 1);
+	}
+	i64 high_bits = bt->count - 64;
+	i64 sign_hi = cast(i64)hi;
+	if (high_bits < 64 && (hi >> (high_bits-1)) & 1) {
+		sign_hi = cast(i64)(hi | ~((1ull << high_bits) - 1));
+	}
+	u64 ops[2] = {ir_bc_encode_signed(cast(i64)lo), ir_bc_encode_signed(sign_hi)};
+	return ir_bc_add_const(w, type, irBcConst_WideInteger, ops, 2);
+}
+
+u64 ir_bc_parse_aggregate_const(irBcWriter *w, irBcText *t, i32 type, char const *close) {
+	irBcType *bt = &w->types[type];
+	isize start = w->op_stack.count;
+
+	// NOTE: Arrays and vectors of scalars are written as their raw elements
+	if (bt->kind == irBcType_Array || bt->kind == irBcType_Vector) {
+		i32 elem = bt->elem;
+		irBcType *et = &w->types[elem];
+		bool is_data = et->kind == irBcType_Float || et->kind == irBcType_Double ||
+		               (et->kind == irBcType_Integer && (et->count == 8 || et->count == 16 || et->count == 32 || et->count == 64));
+		irBcText saved = *t;
+		while (is_data && !ir_bc_accept(t, close)) {
+			ir_bc_parse_type(w, t);
+			u64 lo = 0, hi = 0;
+			if (!ir_bc_parse_scalar(w, t, elem, &lo, &hi)) {
+				is_data = false;
+				break;
+			}
+			array_add(&w->op_stack, lo);
+			ir_bc_accept(t, ",");
+		}
+		if (is_data) {
+			u64 result = ir_bc_add_const(w, type, irBcConst_Data, w->op_stack.data + start, w->op_stack.count - start);
+			w->op_stack.count = start;
+			return result;
+		}
+		*t = saved;
+		w->op_stack.count = start;
+	}
+
+	while (!ir_bc_accept(t, close)) {
+		i32 elem = ir_bc_parse_type(w, t);
+		array_add(&w->op_stack, ir_bc_parse_const(w, t, elem));
+		ir_bc_accept(t, ",");
+	}
+	isize count = w->op_stack.count - start;
+	u64 result = 0;
+	if (count == 0) {
+		result = ir_bc_const_null(w, type);
+	} else {
+		result = ir_bc_add_const(w, type, irBcConst_Aggregate, w->op_stack.data + start, count);
+	}
+	w->op_stack.count = start;
+	return result;
+}
+
+u64 ir_bc_parse_string_const(irBcWriter *w, irBcText *t, i32 type) {
+	isize start = w->op_stack.count;
+	ir_bc_expect(t, "c\"");
+	isize zero_count = 0;
+	for (;;) {
+		if (t->pos >= t->end) {
+			ir_bc_text_error(t, "'\"'");
+		}
+		u8 c = ir_bc_peek(t);
+		t->pos += 1;
+		if (c == '"') {
+			break;
+		}
+		if (c == '\\') {
+			c = cast(u8)(gb_hex_digit_to_int(ir_bc_peek(t, 0)) << 4 | gb_hex_digit_to_int(ir_bc_peek(t, 1)));
+			t->pos += 2;
+		}
+		zero_count += c == 0;
+		array_add(&w->op_stack, cast(u64)c);
+	}
+	isize count = w->op_stack.count - start;
+	GB_ASSERT(w->types[type].kind == irBcType_Array && w->types[type].count == count);
+
+	u64 result = 0;
+	if (count > 0 && w->op_stack[w->op_stack.count-1] == 0 && zero_count == 1) {
+		result = ir_bc_add_const(w, type, irBcConst_CString, w->op_stack.data + start, count-1);
+	} else {
+		result = ir_bc_add_const(w, type, irBcConst_String, w->op_stack.data + start, count);
+	}
+	w->op_stack.count = start;
+	return result;
+}
+
+u32 ir_bc_cast_opcode(String name) {
+	if (name == "trunc")    return 0;
+	if (name == "zext")     return 1;
+	if (name == "sext")     return 2;
+	if (name == "fptoui")   return 3;
+	if (name == "fptosi")   return 4;
+	if (name == "uitofp")   return 5;
+	if (name == "sitofp")   return 6;
+	if (name == "fptrunc")  return 7;
+	if (name == "fpext")    return 8;
+	if (name == "ptrtoint") return 9;
+	if (name == "inttoptr") return 10;
+	if (name == "bitcast")  return 11;
+	return ~0u;
+}
+
+// NOTE: Parses a constant of 'type', which the caller has already parsed from the text
+u64 ir_bc_parse_const(irBcWriter *w, irBcText *t, i32 type) {
+	u64 lo = 0, hi = 0;
+	if (ir_bc_parse_scalar(w, t, type, &lo, &hi)) {
+		return ir_bc_scalar_const(w, type, lo, hi);
+	}
+
+	ir_bc_skip_space(t);
+	u8 c = ir_bc_peek(t);
+	if (c == '{') {
+		t->pos += 1;
+		return ir_bc_parse_aggregate_const(w, t, type, "}");
+	} else if (c == '<' && ir_bc_peek(t, 1) == '{') {
+		t->pos += 2;
+		return ir_bc_parse_aggregate_const(w, t, type, "}>");
+	} else if (c == '<') {
+		t->pos += 1;
+		return ir_bc_parse_aggregate_const(w, t, type, ">");
+	} else if (c == '[') {
+		t->pos += 1;
+		return ir_bc_parse_aggregate_const(w, t, type, "]");
+	} else if (c == 'c' && ir_bc_peek(t, 1) == '"') {
+		return ir_bc_parse_string_const(w, t, type);
+	} else if (c == '@') {
+		t->pos += 1;
+		return ir_bc_global_ref(w, ir_bc_parse_name(w, t));
+	}
+
+	String word = ir_bc_parse_word(t);
+	if (word == "zeroinitializer" || word == "null") {
+		return ir_bc_const_null(w, type);
+	} else if (word == "undef") {
+		return ir_bc_add_const(w, type, irBcConst_Undef, nullptr, 0);
+	} else if (word == "getelementptr") {
+		ir_bc_expect(t, "inbounds");
+		ir_bc_expect(t, "(");
+		isize start = w->op_stack.count;
+		array_add(&w->op_stack, cast(u64)ir_bc_parse_type(w, t));
+		while (ir_bc_accept(t, ",")) {
+			i32 op_type = ir_bc_parse_type(w, t);
+			u64 op = ir_bc_parse_const(w, t, op_type);
+			array_add(&w->op_stack, cast(u64)op_type);
+			array_add(&w->op_stack, op);
+		}
+		ir_bc_expect(t, ")");
+		u64 result = ir_bc_add_const(w, type, irBcConst_InboundsGep, w->op_stack.data + start, w->op_stack.count - start);
+		w->op_stack.count = start;
+		return result;
+	}
+
+	u32 opcode = ir_bc_cast_opcode(word);
+	if (opcode == ~0u) {
+		ir_bc_text_error(t, "a constant");
+	}
+	ir_bc_expect(t, "(");
+	i32 src_type = ir_bc_parse_type(w, t);
+	u64 src = ir_bc_parse_const(w, t, src_type);
+	ir_bc_expect(t, "to");
+	i32 dst_type = ir_bc_parse_type(w, t);
+	ir_bc_expect(t, ")");
+	GB_ASSERT(dst_type == type);
+	u64 ops[3] = {opcode, cast(u64)src_type, src};
+	return ir_bc_add_const(w, type, irBcConst_CastExpr, ops, 3);
+}
+
+// NOTE: Lowers a value which is not local to a procedure, such as a constant or a global, through the printer
+u64 ir_bc_print_value(irBcWriter *w, irValue *value, i32 type, Type *type_hint) {
+	isize start = w->text_data.count;
+	ir_print_value(&w->text, w->m, value, type_hint);
+	irBcText t = ir_bc_text(w, start);
+	u64 result = ir_bc_parse_const(w, &t, type);
+	w->text_data.count = start;
+	return result;
+}
+
+u64 ir_bc_parse_const_cstring(irBcWriter *w, i32 type, char const *text) {
+	isize start = w->text_data.count;
+	array_add_elems(&w->text_data, cast(u8 const *)text, gb_strlen(text));
+	irBcText t = ir_bc_text(w, start);
+	u64 result = ir_bc_parse_const(w, &t, type);
+	w->text_data.count = start;
+	return result;
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Attributes
+//
+////////////////////////////////////////////////////////////////
+
+void ir_bc_attr_add(irBcWriter *w, u32 index, u32 kind, i32 type = -1) {
+	irBcAttr attr = {index, kind, type};
+	array_add(&w->attr_scratch, attr);
+}
+
+GB_COMPARE_PROC(ir_bc_attr_cmp) {
+	irBcAttr const *x = cast(irBcAttr const *)a;
+	irBcAttr const *y = cast(irBcAttr const *)b;
+	// NOTE: The function attributes come first, then the result and the parameters
+	u32 xi = x->index + 1;
+	u32 yi = y->index + 1;
+	if (xi != yi) {
+		return xi < yi ? -1 : +1;
+	}
+	if (x->kind != y->kind) {
+		return x->kind < y->kind ? -1 : +1;
+	}
+	return 0;
+}
+
+i32 ir_bc_attr_group(irBcWriter *w, irBcAttr const *attrs, isize count) {
+	ir_bc_key_begin(w);
+	ir_bc_key_write(w, attrs, count*gb_size_of(irBcAttr));
+	HashKey key = ir_bc_key_end(w);
+	i32 *found = map_get(&w->attr_group_map, key);
+	if (found != nullptr) {
+		return *found;
+	}
+	irBcAttrGroup group = {};
+	group.index = attrs[0].index;
+	group.attrs = cast(i32)w->attrs.count;
+	group.attr_count = cast(i32)count;
+	array_add_elems(&w->attrs, attrs, count);
+
+	i32 index = cast(i32)w->attr_groups.count;
+	array_add(&w->attr_groups, group);
+	map_set(&w->attr_group_map, ir_bc_key_persist(w, key), index);
+	return index;
+}
+
+// NOTE: Turns the attributes added since 'attr_scratch' was cleared into an attribute list, 0 if there are none
+i32 ir_bc_attr_list(irBcWriter *w) {
+	auto *scratch = &w->attr_scratch;
+	if (scratch->count == 0) {
+		return 0;
+	}
+	gb_sort_array(scratch->data, scratch->count, ir_bc_attr_cmp);
+
+	i32 groups[64] = {};
+	isize group_count = 0;
+	for (isize i = 0; i < scratch->count;) {
+		isize j = i+1;
+		while (j < scratch->count && (*scratch)[j].index == (*scratch)[i].index) {
+			j += 1;
+		}
+		GB_ASSERT(group_count < gb_count_of(groups));
+		groups[group_count++] = ir_bc_attr_group(w, scratch->data + i, j - i);
+		i = j;
+	}
+	array_clear(scratch);
+
+	ir_bc_key_begin(w);
+	ir_bc_key_write(w, groups, group_count*gb_size_of(i32));
+	HashKey key = ir_bc_key_end(w);
+	i32 *found = map_get(&w->attr_list_map, key);
+	if (found != nullptr) {
+		return *found;
+	}
+	irBcAttrList list = {};
+	list.groups = cast(i32)w->attr_list_groups.count;
+	list.group_count = cast(i32)group_count;
+	array_add_elems(&w->attr_list_groups, groups, group_count);
+	array_add(&w->attr_lists, list);
+
+	i32 result = cast(i32)w->attr_lists.count;
+	map_set(&w->attr_list_map, ir_bc_key_persist(w, key), result);
+	return result;
+}
+
+void ir_bc_attr_context_param(irBcWriter *w, u32 index) {
+	ir_bc_attr_add(w, index, irBcAttr_NoAlias);
+	ir_bc_attr_add(w, index, irBcAttr_NonNull);
+	ir_bc_attr_add(w, index, irBcAttr_NoCapture);
+}
+
+u32 ir_bc_calling_convention(ProcCallingConvention cc) {
+	switch (cc) {
+	case ProcCC_StdCall:  return 64;
+	case ProcCC_FastCall: return 65;
+	}
+	return 0;
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Globals and functions
+//
+////////////////////////////////////////////////////////////////
+
+// NOTE: The name 'ir_print_encoded_global' prints, without its quotes and escapes
+String ir_bc_llvm_global_name(irBcWriter *w, String name, bool remove_prefix) {
+	if (remove_prefix) {
+		return name;
+	}
+	for (isize i = 0; i < name.len; i++) {
+		if (!ir_valid_char(name[i])) {
+			return concatenate_strings(w->allocator, str_lit("."), name);
+		}
+	}
+	return name;
+}
+
+String ir_bc_global_name(irBcWriter *w, irValue *v) {
+	GB_ASSERT(v->kind == irValue_Global);
+	Scope *scope = v->Global.entity->scope;
+	bool in_global_scope = scope != nullptr && (scope->flags & ScopeFlag_Global) != 0;
+	return ir_bc_llvm_global_name(w, ir_get_global_name(w->m, v), in_global_scope);
+}
+
+String ir_bc_proc_name(irBcWriter *w, irProcedure *proc) {
+	return ir_bc_llvm_global_name(w, proc->name, ir_print_is_proc_global(w->m, proc));
+}
+
+void ir_bc_add_proc_names(irBcWriter *w, irValue *v) {
+	map_set(&w->module_names, hash_string(ir_bc_proc_name(w, &v->Proc)), v);
+	for_array(i, v->Proc.children) {
+		irProcedure *child = v->Proc.children[i];
+		// NOTE: The children are only reachable through their parent's procedure, not an irValue
+		ir_bc_add_proc_names(w, cast(irValue *)(cast(u8 *)child - offsetof(irValue, Proc)));
+	}
+}
+
+// NOTE: Members are added while the procedures are lowered, so this picks up those added since it was last called
+void ir_bc_update_module_names(irBcWriter *w) {
+	irModule *m = w->m;
+	for (isize i = w->module_names_member_count; i < m->members.entries.count; i++) {
+		irValue *v = m->members.entries[i].value;
+		if (v->kind == irValue_Global) {
+			map_set(&w->module_names, hash_string(ir_bc_global_name(w, v)), v);
+		} else if (v->kind == irValue_Proc) {
+			ir_bc_add_proc_names(w, v);
+		}
+	}
+	w->module_names_member_count = m->members.entries.count;
+}
+
+u64 ir_bc_add_global(irBcWriter *w, irValue *v) {
+	String name = ir_bc_global_name(w, v);
+	u64 *found = map_get(&w->value_map, hash_string(name));
+	if (found != nullptr) {
+		return *found;
+	}
+	irBcGlobal g = {};
+	g.name = name;
+	g.value = v;
+	g.type = ir_bc_type(w, type_deref(ir_type(v)));
+	g.is_other_unit = true;
+
+	u64 ref = IR_BC_VALUE(irBcValue_Global, w->globals.count);
+	array_add(&w->globals, g);
+	map_set(&w->value_map, hash_string(name), ref);
+	return ref;
+}
+
+// NOTE: Computes the LLVM function type and attributes of a procedure. For a definition, this also names
+// its arguments and maps its parameters to them, as 'ir_print_proc' does.
+void ir_bc_proc_signature(irBcWriter *w, irBcFunction *fn, irProcedure *proc) {
+	ir_print_set_procedure_abi_types(w->m, proc->type);
+	TypeProc *proc_type = &proc->type->Proc;
+	irBcFunctionBody *body = fn->body;
+
+	isize start = w->type_stack.count;
+	array_clear(&w->attr_scratch);
+
+	if (proc_type->return_by_pointer) {
+		i32 result = ir_bc_type(w, reduce_tuple_to_single_type(proc_type->results));
+		u32 index = cast(u32)(w->type_stack.count - start) + 1;
+		ir_bc_attr_add(w, index, irBcAttr_StructRet, result);
+		ir_bc_attr_add(w, index, irBcAttr_NoAlias);
+		if (body != nullptr) {
+			body->sret_arg = cast(i32)body->arg_names.count;
+			array_add(&body->arg_names, str_lit("agg.result"));
+		}
+		array_add(&w->type_stack, ir_bc_type_pointer(w, result));
+	}
+
+	bool is_vararg = false;
+	isize param_count = proc_type->param_count;
+	if (param_count > 0) {
+		TypeTuple *params = &proc_type->params->Tuple;
+		isize parameter_index = 0;
+		for (isize i = 0; i < param_count; i++, parameter_index++) {
+			Entity *e = params->variables[i];
+			Type *abi_type = proc_type->abi_compat_params[i];
+			if (e->kind != Entity_Variable) continue;
+
+			if (i+1 == params->variables.count && proc_type->c_vararg) {
+				is_vararg = true;
+				continue;
+			}
+
+			isize part_count = is_type_tuple(abi_type) ? abi_type->Tuple.variables.count : 1;
+			for (isize j = 0; j < part_count; j++) {
+				Type *part = is_type_tuple(abi_type) ? abi_type->Tuple.variables[j]->type : abi_type;
+				u32 index = cast(u32)(w->type_stack.count - start) + 1;
+				if (e->flags&EntityFlag_NoAlias) {
+					ir_bc_attr_add(w, index, irBcAttr_NoAlias);
+				}
+				if (body != nullptr) {
+					isize n = parameter_index + j;
+					while (body->param_args.count <= n) {
+						array_add(&body->param_args, cast(i32)-1);
+					}
+					body->param_args[n] = cast(i32)body->arg_names.count;
+
+					char buf[32] = {};
+					isize len = gb_snprintf(buf, gb_size_of(buf), "_.%td", n);
+					array_add(&body->arg_names, ir_bc_copy_string(w, make_string(cast(u8 *)buf, len-1)));
+				}
+				array_add(&w->type_stack, ir_bc_type(w, part));
+			}
+			parameter_index += part_count-1;
+		}
+	}
+
+	if (proc_type->calling_convention == ProcCC_Odin) {
+		u32 index = cast(u32)(w->type_stack.count - start) + 1;
+		ir_bc_attr_context_param(w, index);
+		if (body != nullptr) {
+			body->context_arg = cast(i32)body->arg_names.count;
+			array_add(&body->arg_names, str_lit("__.context_ptr"));
+		}
+		array_add(&w->type_stack, ir_bc_type(w, t_context_ptr));
+	}
+
+	ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_NoUnwind);
+	ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_UWTable);
+	switch (proc->inlining) {
+	case ProcInlining_inline:
+		ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_AlwaysInline);
+		break;
+	case ProcInlining_no_inline:
+		ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_NoInline);
+		ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_OptimizeNone);
+		break;
+	}
+	if (proc_type->diverging) {
+		ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_NoReturn);
+	}
+
+	i32 result = ir_bc_proc_results_type(w, proc->type);
+	fn->type = ir_bc_type_function(w, result, w->type_stack.data + start, w->type_stack.count - start, is_vararg);
+	w->type_stack.count = start;
+	fn->attrs = ir_bc_attr_list(w);
+	fn->cc = ir_bc_calling_convention(proc_type->calling_convention);
+}
+
+u64 ir_bc_add_function(irBcWriter *w, irProcedure *proc, bool is_definition) {
+	String name = ir_bc_proc_name(w, proc);
+	u64 *found = map_get(&w->value_map, hash_string(name));
+	if (found != nullptr) {
+		return *found;
+	}
+
+	irBcFunction fn = {};
+	fn.name = name;
+	fn.proc = proc;
+	fn.is_definition = is_definition;
+	fn.is_dllexport = is_definition && build_context.is_dll && proc->is_export;
+	if (is_definition) {
+		fn.body = gb_alloc_item(w->allocator, irBcFunctionBody);
+		fn.body->sret_arg = -1;
+		fn.body->context_arg = -1;
+		array_init(&fn.body->records, heap_allocator());
+		array_init(&fn.body->value_types, heap_allocator());
+		array_init(&fn.body->arg_names, heap_allocator());
+		array_init(&fn.body->param_args, heap_allocator());
+	}
+	ir_bc_proc_signature(w, &fn, proc);
+
+	u64 ref = IR_BC_VALUE(irBcValue_Function, w->functions.count);
+	array_add(&w->functions, fn);
+	map_set(&w->value_map, hash_string(name), ref);
+	return ref;
+}
+
+void ir_bc_add_proc_tree(irBcWriter *w, irProcedure *proc, bool define) {
+	ir_bc_add_function(w, proc, define && proc->body != nullptr);
+	for_array(i, proc->children) {
+		ir_bc_add_proc_tree(w, proc->children[i], define);
+	}
+}
+
+// NOTE: Declares a function which is not a procedure of the module, such as an intrinsic
+u64 ir_bc_add_external_function(irBcWriter *w, String name, i32 type) {
+	u64 *found = map_get(&w->value_map, hash_string(name));
+	if (found != nullptr) {
+		return *found;
+	}
+	irBcFunction fn = {};
+	fn.name = name;
+	fn.type = type;
+
+	u64 ref = IR_BC_VALUE(irBcValue_Function, w->functions.count);
+	array_add(&w->functions, fn);
+	map_set(&w->value_map, hash_string(name), ref);
+	return ref;
+}
+
+// NOTE: Looks up a global or function by its LLVM name, and declares it the first time it is referred to
+u64 ir_bc_global_ref(irBcWriter *w, String name) {
+	u64 *found = map_get(&w->value_map, hash_string(name));
+	if (found != nullptr) {
+		return *found;
+	}
+	ir_bc_update_module_names(w);
+	irValue **v = map_get(&w->module_names, hash_string(name));
+	GB_ASSERT_MSG(v != nullptr, "Unknown global '%.*s'", LIT(name));
+	if ((*v)->kind == irValue_Global) {
+		return ir_bc_add_global(w, *v);
+	}
+	return ir_bc_add_function(w, &(*v)->Proc, false);
+}
+
+i32 ir_bc_value_type(irBcWriter *w, u64 ref) {
+	i32 index = IR_BC_VALUE_INDEX(ref);
+	switch (IR_BC_VALUE_KIND(ref)) {
+	case irBcValue_Global:   return ir_bc_type_pointer(w, w->globals[index].type);
+	case irBcValue_Function: return ir_bc_type_pointer(w, w->functions[index].type);
+	case irBcValue_Const:    return w->consts[index].type;
+	case irBcValue_Instr:    return w->body->value_types[index];
+	}
+	GB_PANIC("Invalid value reference");
+	return -1;
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Instructions
+//
+////////////////////////////////////////////////////////////////
+
+void ir_bc_record_begin(irBcWriter *w) {
+	array_clear(&w->record);
+}
+
+gb_inline void ir_bc_record_op(irBcWriter *w, irBcOpKind kind, u64 payload) {
+	array_add(&w->record, IR_BC_OP(kind, payload));
+}
+
+gb_inline void ir_bc_record_literal(irBcWriter *w, u64 value) {
+	GB_ASSERT(value < (1ull << 60));
+	ir_bc_record_op(w, irBcOp_Literal, value);
+}
+
+// NOTE: The header is the code, the abbreviation, whether it has a value and the operand count
+void ir_bc_record_end(irBcWriter *w, u32 code, u32 abbrev, irValue *value, i32 value_type) {
+	irBcFunctionBody *body = w->body;
+	bool has_value = value != nullptr && value->index >= 0;
+	u64 header = cast(u64)code | (cast(u64)abbrev << 16) | (cast(u64)has_value << 24) | (cast(u64)w->record.count << 32);
+	array_add(&body->records, header);
+	array_add_elems(&body->records, w->record.data, w->record.count);
+	if (has_value) {
+		GB_ASSERT(value_type >= 0 && value_type != w->t_void);
+		GB_ASSERT_MSG(body->value_types.count == value->index, "%td != %d", body->value_types.count, value->index);
+		array_add(&body->value_types, value_type);
+	} else {
+		GB_ASSERT(value == nullptr || value_type < 0 || value_type == w->t_void);
+	}
+}
+
+// NOTE: Returns the reference of a value used by an instruction, and sets its type
+u64 ir_bc_value(irBcWriter *w, irValue *v, i32 type, Type *type_hint) {
+	irBcFunctionBody *body = w->body;
+	switch (v->kind) {
+	case irValue_Instr:
+		GB_ASSERT(v->index >= 0);
+		return IR_BC_VALUE(irBcValue_Instr, v->index);
+	case irValue_Param: {
+		i32 arg = -1;
+		if (v->Param.index >= 0) {
+			if (v->Param.index < body->param_args.count) {
+				arg = body->param_args[v->Param.index];
+			}
+		} else if (v->Param.entity->token.string == "agg.result") {
+			arg = body->sret_arg;
+		} else if (v->Param.entity->token.string == "__.context_ptr") {
+			arg = body->context_arg;
+		}
+		GB_ASSERT_MSG(arg >= 0, "Unknown parameter '%.*s'", LIT(v->Param.entity->token.string));
+		return IR_BC_VALUE(irBcValue_Arg, arg);
+	}
+	}
+	return ir_bc_print_value(w, v, type, type_hint);
+}
+
+void ir_bc_op_value(irBcWriter *w, irBcOpKind kind, irValue *v, i32 type, Type *type_hint) {
+	ir_bc_record_op(w, kind, ir_bc_value(w, v, type, type_hint));
+}
+
+u64 ir_bc_alignment(i64 align) {
+	if (align <= 0) {
+		return 0;
+	}
+	return cast(u64)floor_log2(cast(u64)align) + 1;
+}
+
+u32 ir_bc_fence_ordering(BuiltinProcId id) {
+	switch (id) {
+	case BuiltinProc_atomic_fence:        return irBcOrdering_SeqCst;
+	case BuiltinProc_atomic_fence_acq:    return irBcOrdering_Acquire;
+	case BuiltinProc_atomic_fence_rel:    return irBcOrdering_Release;
+	case BuiltinProc_atomic_fence_acqrel: return irBcOrdering_AcqRel;
+	}
+	GB_PANIC("Unknown atomic fence");
+	return 0;
+}
+
+// NOTE: Follows the orderings 'ir_print_instr' prints for the atomic instructions
+u32 ir_bc_rmw_ordering(BuiltinProcId id) {
+	switch (id) {
+	case BuiltinProc_atomic_add_acq:
+	case BuiltinProc_atomic_sub_acq:
+	case BuiltinProc_atomic_and_acq:
+	case BuiltinProc_atomic_nand_acq:
+	case BuiltinProc_atomic_or_acq:
+	case BuiltinProc_atomic_xor_acq:
+	case BuiltinProc_atomic_xchg_acq:
+		return irBcOrdering_Acquire;
+	case BuiltinProc_atomic_add_rel:
+	case BuiltinProc_atomic_sub_rel:
+	case BuiltinProc_atomic_and_rel:
+	case BuiltinProc_atomic_nand_rel:
+	case BuiltinProc_atomic_or_rel:
+	case BuiltinProc_atomic_xor_rel:
+	case BuiltinProc_atomic_xchg_rel:
+		return irBcOrdering_Release;
+	case BuiltinProc_atomic_add_acqrel:
+	case BuiltinProc_atomic_sub_acqrel:
+	case BuiltinProc_atomic_and_acqrel:
+	case BuiltinProc_atomic_nand_acqrel:
+	case BuiltinProc_atomic_or_acqrel:
+	case BuiltinProc_atomic_xor_acqrel:
+	case BuiltinProc_atomic_xchg_acqrel:
+		return irBcOrdering_AcqRel;
+	case BuiltinProc_atomic_add_relaxed:
+	case BuiltinProc_atomic_sub_relaxed:
+	case BuiltinProc_atomic_and_relaxed:
+	case BuiltinProc_atomic_nand_relaxed:
+	case BuiltinProc_atomic_or_relaxed:
+	case BuiltinProc_atomic_xor_relaxed:
+	case BuiltinProc_atomic_xchg_relaxed:
+		return irBcOrdering_Monotonic;
+	}
+	return irBcOrdering_SeqCst;
+}
+
+u32 ir_bc_rmw_operation(BuiltinProcId id) {
+	switch (id) {
+	case BuiltinProc_atomic_xchg:
+	case BuiltinProc_atomic_xchg_acq:
+	case BuiltinProc_atomic_xchg_rel:
+	case BuiltinProc_atomic_xchg_acqrel:
+	case BuiltinProc_atomic_xchg_relaxed:
+		return 0;
+	case BuiltinProc_atomic_add:
+	case BuiltinProc_atomic_add_acq:
+	case BuiltinProc_atomic_add_rel:
+	case BuiltinProc_atomic_add_acqrel:
+	case BuiltinProc_atomic_add_relaxed:
+		return 1;
+	case BuiltinProc_atomic_sub:
+	case BuiltinProc_atomic_sub_acq:
+	case BuiltinProc_atomic_sub_rel:
+	case BuiltinProc_atomic_sub_acqrel:
+	case BuiltinProc_atomic_sub_relaxed:
+		return 2;
+	case BuiltinProc_atomic_and:
+	case BuiltinProc_atomic_and_acq:
+	case BuiltinProc_atomic_and_rel:
+	case BuiltinProc_atomic_and_acqrel:
+	case BuiltinProc_atomic_and_relaxed:
+		return 3;
+	case BuiltinProc_atomic_nand:
+	case BuiltinProc_atomic_nand_acq:
+	case BuiltinProc_atomic_nand_rel:
+	case BuiltinProc_atomic_nand_acqrel:
+	case BuiltinProc_atomic_nand_relaxed:
+		return 4;
+	case BuiltinProc_atomic_or:
+	case BuiltinProc_atomic_or_acq:
+	case BuiltinProc_atomic_or_rel:
+	case BuiltinProc_atomic_or_acqrel:
+	case BuiltinProc_atomic_or_relaxed:
+		return 5;
+	case BuiltinProc_atomic_xor:
+	case BuiltinProc_atomic_xor_acq:
+	case BuiltinProc_atomic_xor_rel:
+	case BuiltinProc_atomic_xor_acqrel:
+	case BuiltinProc_atomic_xor_relaxed:
+		return 6;
+	}
+	GB_PANIC("Unknown atomic operation");
+	return 0;
+}
+
+void ir_bc_cxchg_orderings(BuiltinProcId id, u32 *success, u32 *failure, bool *weak) {
+	switch (id) {
+	case BuiltinProc_atomic_cxchgweak:
+	case BuiltinProc_atomic_cxchgweak_acq:
+	case BuiltinProc_atomic_cxchgweak_rel:
+	case BuiltinProc_atomic_cxchgweak_acqrel:
+	case BuiltinProc_atomic_cxchgweak_relaxed:
+	case BuiltinProc_atomic_cxchgweak_failrelaxed:
+	case BuiltinProc_atomic_cxchgweak_failacq:
+	case BuiltinProc_atomic_cxchgweak_acq_failrelaxed:
+	case BuiltinProc_atomic_cxchgweak_acqrel_failrelaxed:
+		*weak = true;
+		break;
+	}
+
+	*success = irBcOrdering_SeqCst;
+	*failure = irBcOrdering_SeqCst;
+	switch (id) {
+	case BuiltinProc_atomic_cxchg_acq:
+	case BuiltinProc_atomic_cxchgweak_acq:
+		*success = irBcOrdering_Acquire;
+		break;
+	case BuiltinProc_atomic_cxchg_rel:
+	case BuiltinProc_atomic_cxchgweak_rel:
+		*success = irBcOrdering_Release;
+		break;
+	case BuiltinProc_atomic_cxchg_acqrel:
+	case BuiltinProc_atomic_cxchgweak_acqrel:
+		*success = irBcOrdering_AcqRel;
+		break;
+	case BuiltinProc_atomic_cxchg_relaxed:
+	case BuiltinProc_atomic_cxchgweak_relaxed:
+		*success = irBcOrdering_Monotonic;
+		*failure = irBcOrdering_Monotonic;
+		break;
+	case BuiltinProc_atomic_cxchg_failrelaxed:
+	case BuiltinProc_atomic_cxchgweak_failrelaxed:
+		*failure = irBcOrdering_Monotonic;
+		break;
+	case BuiltinProc_atomic_cxchg_failacq:
+	case BuiltinProc_atomic_cxchgweak_failacq:
+		*failure = irBcOrdering_Acquire;
+		break;
+	case BuiltinProc_atomic_cxchg_acq_failrelaxed:
+	case BuiltinProc_atomic_cxchgweak_acq_failrelaxed:
+		*success = irBcOrdering_Acquire;
+		*failure = irBcOrdering_Monotonic;
+		break;
+	case BuiltinProc_atomic_cxchg_acqrel_failrelaxed:
+	case BuiltinProc_atomic_cxchgweak_acqrel_failrelaxed:
+		*success = irBcOrdering_AcqRel;
+		*failure = irBcOrdering_Monotonic;
+		break;
+	}
+}
+
+// NOTE: The 'i32 0' first index and the struct field index of the element pointers 'ir_print_instr' prints
+i32 ir_bc_struct_field_index(Type *t, i32 index) {
+	Type *st = base_type(t);
+	if (is_type_struct(st)) {
+		if (st->Struct.custom_align > 0) {
+			index += 1;
+		}
+	} else if (is_type_union(st)) {
+		index += 1;
+	}
+	return index;
+}
+
+void ir_bc_call_inline_asm(irBcWriter *w, irValue *value, String asm_string, String constraints) {
+	i32 fn_type = ir_bc_type_function(w, w->t_void, nullptr, 0, false);
+	isize start = w->op_stack.count;
+	array_add(&w->op_stack, cast(u64)fn_type);
+	array_add(&w->op_stack, cast(u64)1); // NOTE: sideeffect
+	array_add(&w->op_stack, cast(u64)asm_string.len);
+	for (isize i = 0; i < asm_string.len; i++) {
+		array_add(&w->op_stack, cast(u64)asm_string[i]);
+	}
+	array_add(&w->op_stack, cast(u64)constraints.len);
+	for (isize i = 0; i < constraints.len; i++) {
+		array_add(&w->op_stack, cast(u64)constraints[i]);
+	}
+	u64 callee = ir_bc_add_const(w, ir_bc_type_pointer(w, fn_type), irBcConst_InlineAsm, w->op_stack.data + start, w->op_stack.count - start);
+	w->op_stack.count = start;
+
+	ir_bc_record_begin(w);
+	ir_bc_record_literal(w, 0);
+	ir_bc_record_literal(w, 1ull << 15); // NOTE: The explicit function type flag
+	ir_bc_record_op(w, irBcOp_Type, fn_type);
+	ir_bc_record_op(w, irBcOp_Value, callee);
+	ir_bc_record_end(w, irBcFunc_Call, irBcFuncAbbrev_None, value, -1);
+}
+
+void ir_bc_lower_call(irBcWriter *w, irValue *value) {
+	irModule *m = w->m;
+	irInstrCall *call = &value->Instr.Call;
+	Type *proc_type = base_type(ir_type(call->value));
+	GB_ASSERT(is_type_proc(proc_type));
+	ir_print_set_procedure_abi_types(m, proc_type);
+
+	bool is_c_vararg = proc_type->Proc.c_vararg;
+	bool return_by_pointer = proc_type->Proc.return_by_pointer;
+	Type *result_type = call->type;
+
+	// NOTE: The arguments are collected first, as the function type of the call depends on them
+	isize start = w->op_stack.count;
+	isize type_start = w->type_stack.count;
+	isize fixed_count = 0;
+	array_clear(&w->attr_scratch);
+
+	#define IR_BC_CALL_ARG(arg_type, ref) do { \
+		array_add(&w->type_stack, (arg_type)); \
+		array_add(&w->op_stack, (ref));        \
+	} while (0)
+
+	if (return_by_pointer) {
+		GB_ASSERT(call->return_ptr != nullptr);
+		i32 t = ir_bc_type_pointer(w, ir_bc_type(w, proc_type->Proc.results));
+		IR_BC_CALL_ARG(t, ir_bc_value(w, call->return_ptr, t, ir_type(call->return_ptr)));
+	}
+
+	if (call->args.count > 0) {
+		TypeTuple *params = &proc_type->Proc.params->Tuple;
+		isize param_end = is_c_vararg ? params->variables.count-1 : params->variables.count;
+		isize arg_index = 0;
+		for (isize i = 0; i < param_end; i++) {
+			Entity *e = params->variables[i];
+			GB_ASSERT(e != nullptr);
+			if (e->kind != Entity_Variable) {
+				arg_index++;
+				continue;
+			}
+			Type *t = proc_type->Proc.abi_compat_params[i];
+			isize part_count = is_type_tuple(t) ? t->Tuple.variables.count : 1;
+			for (isize j = 0; j < part_count; j++) {
+				Type *part = is_type_tuple(t) ? t->Tuple.variables[j]->type : t;
+				i32 part_type = ir_bc_type(w, part);
+				u32 index = cast(u32)(w->type_stack.count - type_start) + 1;
+				if (e->flags&EntityFlag_NoAlias) {
+					ir_bc_attr_add(w, index, irBcAttr_NoAlias);
+				}
+				// NOTE: The text form has 'dereferenceable' without a size here, which LLVM ignores
+				if (is_c_vararg && !is_type_tuple(t) && (e->flags&EntityFlag_ImplicitReference)) {
+					ir_bc_attr_add(w, index, irBcAttr_NonNull);
+				}
+				irValue *arg = call->args[arg_index++];
+				IR_BC_CALL_ARG(part_type, ir_bc_value(w, arg, part_type, t));
+			}
+		}
+		fixed_count = w->type_stack.count - type_start;
+		if (is_c_vararg) {
+			while (arg_index < call->args.count) {
+				irValue *arg = call->args[arg_index++];
+				Type *t = ir_type(arg);
+				i32 arg_type = ir_bc_type(w, t);
+				IR_BC_CALL_ARG(arg_type, ir_bc_value(w, arg, arg_type, t));
+			}
+		}
+	}
+	if (!is_c_vararg) {
+		fixed_count = w->type_stack.count - type_start;
+	}
+	if (proc_type->Proc.calling_convention == ProcCC_Odin) {
+		i32 t = ir_bc_type(w, t_context_ptr);
+		ir_bc_attr_context_param(w, cast(u32)(w->type_stack.count - type_start) + 1);
+		IR_BC_CALL_ARG(t, ir_bc_value(w, call->context_ptr, t, t_context_ptr));
+		fixed_count += 1;
+	}
+	#undef IR_BC_CALL_ARG
+
+	if (proc_type->Proc.diverging) {
+		ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_NoReturn);
+	}
+	switch (call->inlining) {
+	case ProcInlining_inline:    ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_AlwaysInline); break;
+	case ProcInlining_no_inline: ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_NoInline);     break;
+	}
+	i32 attrs = ir_bc_attr_list(w);
+
+	i32 fn_type = -1;
+	if (is_c_vararg) {
+		fn_type = ir_bc_proc_function_type(w, proc_type);
+	} else {
+		i32 result = w->t_void;
+		if (result_type && !return_by_pointer) {
+			result = ir_bc_proc_results_type(w, proc_type);
+		}
+		fn_type = ir_bc_type_function(w, result, w->type_stack.data + type_start, fixed_count, false);
+	}
+	u64 callee = ir_bc_value(w, call->value, ir_bc_type_pointer(w, fn_type), call->type);
+
+	ir_bc_record_begin(w);
+	ir_bc_record_literal(w, attrs);
+	ir_bc_record_literal(w, (ir_bc_calling_convention(proc_type->Proc.calling_convention) << 1) | (1u << 15));
+	ir_bc_record_op(w, irBcOp_Type, fn_type);
+	ir_bc_record_op(w, irBcOp_ValueType, callee);
+	for (isize i = start; i < w->op_stack.count; i++) {
+		isize arg = i - start;
+		// NOTE: Only the variadic arguments have their type written
+		bool is_fixed = arg < fixed_count - (proc_type->Proc.calling_convention == ProcCC_Odin ? 1 : 0) ||
+		                (proc_type->Proc.calling_convention == ProcCC_Odin && i+1 == w->op_stack.count);
+		ir_bc_record_op(w, is_fixed ? irBcOp_Value : irBcOp_ValueType, w->op_stack[i]);
+	}
+	w->op_stack.count = start;
+	w->type_stack.count = type_start;
+	ir_bc_record_end(w, irBcFunc_Call, irBcFuncAbbrev_None, value, w->types[fn_type].elem);
+}
+
+void ir_bc_lower_instr(irBcWriter *w, irProcedure *proc, irValue *value) {
+	irModule *m = w->m;
+	irInstr *instr = &value->Instr;
+
+	switch (instr->kind) {
+	default:
+		GB_PANIC("<unknown instr> %d\n", instr->kind);
+		break;
+
+	case irInstr_Comment:
+	case irInstr_DebugDeclare:
+		break;
+
+	case irInstr_StartupRuntime: {
+		u64 callee = ir_bc_global_ref(w, ir_bc_llvm_global_name(w, str_lit(IR_STARTUP_RUNTIME_PROC_NAME), false));
+		GB_ASSERT(IR_BC_VALUE_KIND(callee) == irBcValue_Function);
+		i32 fn_type = w->functions[IR_BC_VALUE_INDEX(callee)].type;
+		ir_bc_record_begin(w);
+		ir_bc_record_literal(w, 0);
+		ir_bc_record_literal(w, 1u << 15);
+		ir_bc_record_op(w, irBcOp_Type, fn_type);
+		ir_bc_record_op(w, irBcOp_Value, callee);
+		ir_bc_record_end(w, irBcFunc_Call, irBcFuncAbbrev_None, value, -1);
+		break;
+	}
+
+	case irInstr_Local: {
+		Type *type = instr->Local.entity->type;
+		i64 align = instr->Local.alignment;
+		if (align <= 0) {
+			align = type_align_of(type);
+		}
+		i32 t = ir_bc_type(w, type);
+		ir_bc_record_begin(w);
+		ir_bc_record_op(w, irBcOp_Type, t);
+		ir_bc_record_op(w, irBcOp_Type, w->t_i32);
+		ir_bc_record_op(w, irBcOp_ValueAbsolute, ir_bc_const_int(w, w->t_i32, 1));
+		// NOTE: The alignment, with the flag for the explicit type of the alloca
+		ir_bc_record_literal(w, ir_bc_alignment(align) | (1ull << 6));
+		ir_bc_record_end(w, irBcFunc_Alloca, irBcFuncAbbrev_None, value, ir_bc_type_pointer(w, t));
+		break;
+	}
+
+	case irInstr_ZeroInit: {
+		Type *type = type_deref(ir_type(instr->ZeroInit.address));
+		i32 t = ir_bc_type(w, type);
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->ZeroInit.address, ir_bc_type_pointer(w, t), nullptr);
+		ir_bc_record_op(w, irBcOp_ValueType, ir_bc_const_null(w, t));
+		ir_bc_record_literal(w, ir_bc_alignment(1));
+		ir_bc_record_literal(w, 0);
+		ir_bc_record_end(w, irBcFunc_Store, irBcFuncAbbrev_None, value, -1);
+		break;
+	}
+
+	case irInstr_Store: {
+		Type *type = type_deref(ir_type(instr->Store.address));
+		i32 t = ir_bc_type(w, type);
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->Store.address, ir_bc_type_pointer(w, t), type);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->Store.value, t, type);
+		ir_bc_record_literal(w, 0);
+		ir_bc_record_literal(w, instr->Store.is_volatile);
+		ir_bc_record_end(w, irBcFunc_Store, irBcFuncAbbrev_None, value, -1);
+		break;
+	}
+
+	case irInstr_Load: {
+		Type *type = instr->Load.type;
+		i32 t = ir_bc_type(w, type);
+		i64 align = instr->Load.custom_align > 0 ? instr->Load.custom_align : type_align_of(type);
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->Load.address, ir_bc_type_pointer(w, t), type);
+		ir_bc_record_op(w, irBcOp_Type, t);
+		ir_bc_record_literal(w, ir_bc_alignment(align));
+		ir_bc_record_literal(w, 0);
+		ir_bc_record_end(w, irBcFunc_Load, irBcFuncAbbrev_Load, value, t);
+		break;
+	}
+
+	case irInstr_InlineCode:
+		switch (instr->InlineCode.id) {
+		case BuiltinProc_cpu_relax:
+			ir_bc_call_inline_asm(w, value, str_lit("pause"), str_lit(""));
+			break;
+		default: GB_PANIC("Unknown inline code %d", instr->InlineCode.id); break;
+		}
+		break;
+
+	case irInstr_AtomicFence:
+		ir_bc_record_begin(w);
+		ir_bc_record_literal(w, ir_bc_fence_ordering(instr->AtomicFence.id));
+		ir_bc_record_literal(w, 1); // NOTE: The system synchronization scope
+		ir_bc_record_end(w, irBcFunc_Fence, irBcFuncAbbrev_None, value, -1);
+		break;
+
+	case irInstr_AtomicStore: {
+		Type *type = type_deref(ir_type(instr->AtomicStore.address));
+		i32 t = ir_bc_type(w, type);
+		u32 ordering = 0;
+		switch (instr->AtomicStore.id) {
+		case BuiltinProc_atomic_store:           ordering = irBcOrdering_SeqCst;    break;
+		case BuiltinProc_atomic_store_rel:       ordering = irBcOrdering_Release;   break;
+		case BuiltinProc_atomic_store_relaxed:   ordering = irBcOrdering_Monotonic; break;
+		case BuiltinProc_atomic_store_unordered: ordering = irBcOrdering_Unordered; break;
+		default: GB_PANIC("Unknown atomic store"); break;
+		}
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->AtomicStore.address, ir_bc_type_pointer(w, t), type);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->AtomicStore.value, t, type);
+		ir_bc_record_literal(w, ir_bc_alignment(type_align_of(type)));
+		ir_bc_record_literal(w, 0);
+		ir_bc_record_literal(w, ordering);
+		ir_bc_record_literal(w, 1);
+		ir_bc_record_end(w, irBcFunc_StoreAtomic, irBcFuncAbbrev_None, value, -1);
+		break;
+	}
+
+	case irInstr_AtomicLoad: {
+		Type *type = instr->AtomicLoad.type;
+		i32 t = ir_bc_type(w, type);
+		u32 ordering = 0;
+		switch (instr->AtomicLoad.id) {
+		case BuiltinProc_atomic_load:           ordering = irBcOrdering_SeqCst;    break;
+		case BuiltinProc_atomic_load_acq:       ordering = irBcOrdering_Acquire;   break;
+		case BuiltinProc_atomic_load_relaxed:   ordering = irBcOrdering_Monotonic; break;
+		case BuiltinProc_atomic_load_unordered: ordering = irBcOrdering_Unordered; break;
+		default: GB_PANIC("Unknown atomic load"); break;
+		}
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->AtomicLoad.address, ir_bc_type_pointer(w, t), type);
+		ir_bc_record_op(w, irBcOp_Type, t);
+		ir_bc_record_literal(w, ir_bc_alignment(type_align_of(type)));
+		ir_bc_record_literal(w, 0);
+		ir_bc_record_literal(w, ordering);
+		ir_bc_record_literal(w, 1);
+		ir_bc_record_end(w, irBcFunc_LoadAtomic, irBcFuncAbbrev_None, value, t);
+		break;
+	}
+
+	case irInstr_AtomicRmw: {
+		Type *type = type_deref(ir_type(instr->AtomicRmw.address));
+		i32 t = ir_bc_type(w, type);
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->AtomicRmw.address, ir_bc_type_pointer(w, t), type);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->AtomicRmw.value, t, type);
+		ir_bc_record_literal(w, ir_bc_rmw_operation(instr->AtomicRmw.id));
+		ir_bc_record_literal(w, 0);
+		ir_bc_record_literal(w, ir_bc_rmw_ordering(instr->AtomicRmw.id));
+		ir_bc_record_literal(w, 1);
+		ir_bc_record_end(w, irBcFunc_AtomicRmw, irBcFuncAbbrev_None, value, t);
+		break;
+	}
+
+	case irInstr_AtomicCxchg: {
+		Type *type = type_deref(ir_type(instr->AtomicCxchg.address));
+		i32 t = ir_bc_type(w, type);
+		u32 success = 0, failure = 0;
+		bool weak = false;
+		ir_bc_cxchg_orderings(instr->AtomicCxchg.id, &success, &failure, &weak);
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->AtomicCxchg.address, ir_bc_type_pointer(w, t), type);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->AtomicCxchg.old_value, t, type);
+		ir_bc_op_value(w, irBcOp_Value, instr->AtomicCxchg.new_value, t, type);
+		ir_bc_record_literal(w, 0);
+		ir_bc_record_literal(w, success);
+		ir_bc_record_literal(w, 1);
+		ir_bc_record_literal(w, failure);
+		ir_bc_record_literal(w, weak);
+		i32 fields[2] = {t, w->t_i1};
+		ir_bc_record_end(w, irBcFunc_Cmpxchg, irBcFuncAbbrev_None, value, ir_bc_type_struct(w, fields, 2, false));
+		break;
+	}
+
+	case irInstr_ArrayElementPtr: {
+		Type *et = ir_type(instr->ArrayElementPtr.address);
+		i32 pt = ir_bc_type(w, et);
+		i32 st = ir_bc_type_elem(w, pt);
+		irValue *index = instr->ArrayElementPtr.elem_index;
+		Type *it = ir_type(index);
+		i32 index_type = ir_bc_type(w, it);
+		ir_bc_record_begin(w);
+		ir_bc_record_literal(w, 1);
+		ir_bc_record_op(w, irBcOp_Type, st);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->ArrayElementPtr.address, pt, et);
+		ir_bc_record_op(w, irBcOp_ValueType, ir_bc_const_int(w, w->t_i32, 0));
+		ir_bc_op_value(w, irBcOp_ValueType, index, index_type, it);
+		ir_bc_record_end(w, irBcFunc_Gep, irBcFuncAbbrev_Gep, value, ir_bc_type_pointer(w, ir_bc_type_elem(w, st)));
+		break;
+	}
+
+	case irInstr_StructElementPtr: {
+		Type *et = ir_type(instr->StructElementPtr.address);
+		i32 index = ir_bc_struct_field_index(type_deref(et), instr->StructElementPtr.elem_index);
+		i32 pt = ir_bc_type(w, et);
+		i32 st = ir_bc_type_elem(w, pt);
+		ir_bc_record_begin(w);
+		ir_bc_record_literal(w, 1);
+		ir_bc_record_op(w, irBcOp_Type, st);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->StructElementPtr.address, pt, et);
+		ir_bc_record_op(w, irBcOp_ValueType, ir_bc_const_int(w, w->t_i32, 0));
+		ir_bc_record_op(w, irBcOp_ValueType, ir_bc_const_int(w, w->t_i32, index));
+		ir_bc_record_end(w, irBcFunc_Gep, irBcFuncAbbrev_Gep, value, ir_bc_type_pointer(w, ir_bc_type_field(w, st, index)));
+		break;
+	}
+
+	case irInstr_PtrOffset: {
+		Type *pt_type = ir_type(instr->PtrOffset.address);
+		i32 pt = ir_bc_type(w, pt_type);
+		irValue *offset = instr->PtrOffset.offset;
+		Type *ot = ir_type(offset);
+		ir_bc_record_begin(w);
+		ir_bc_record_literal(w, 1);
+		ir_bc_record_op(w, irBcOp_Type, ir_bc_type_elem(w, pt));
+		ir_bc_op_value(w, irBcOp_ValueType, instr->PtrOffset.address, pt, pt_type);
+		ir_bc_op_value(w, irBcOp_ValueType, offset, ir_bc_type(w, ot), ot);
+		ir_bc_record_end(w, irBcFunc_Gep, irBcFuncAbbrev_Gep, value, pt);
+		break;
+	}
+
+	case irInstr_Phi: {
+		i32 t = ir_bc_type(w, instr->Phi.type);
+		ir_bc_record_begin(w);
+		ir_bc_record_op(w, irBcOp_Type, t);
+		for_array(i, instr->Phi.edges) {
+			irValue *edge = instr->Phi.edges[i];
+			GB_ASSERT(instr->block != nullptr && i < instr->block->preds.count);
+			irBlock *block = instr->block->preds[i];
+			ir_bc_op_value(w, irBcOp_ValueSigned, edge, t, instr->Phi.type);
+			ir_bc_record_literal(w, block->index);
+		}
+		ir_bc_record_end(w, irBcFunc_Phi, irBcFuncAbbrev_None, value, t);
+		break;
+	}
+
+	case irInstr_StructExtractValue: {
+		Type *et = ir_type(instr->StructExtractValue.address);
+		i32 index = ir_bc_struct_field_index(et, instr->StructExtractValue.index);
+		i32 st = ir_bc_type(w, et);
+		i32 result = -1;
+		if (ir_bc_type_is(w, st, irBcType_Struct)) {
+			result = ir_bc_type_field(w, st, index);
+		} else {
+			result = ir_bc_type_elem(w, st);
+		}
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->StructExtractValue.address, st, et);
+		ir_bc_record_literal(w, index);
+		ir_bc_record_end(w, irBcFunc_ExtractValue, irBcFuncAbbrev_None, value, result);
+		break;
+	}
+
+	case irInstr_UnionTagPtr: {
+		Type *et = ir_type(instr->UnionTagPtr.address);
+		GB_ASSERT(!is_type_union_maybe_pointer(type_deref(et)));
+		i32 pt = ir_bc_type(w, et);
+		i32 st = ir_bc_type_elem(w, pt);
+		ir_bc_record_begin(w);
+		ir_bc_record_literal(w, 1);
+		ir_bc_record_op(w, irBcOp_Type, st);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->UnionTagPtr.address, pt, et);
+		ir_bc_record_op(w, irBcOp_ValueType, ir_bc_const_int(w, ir_bc_type(w, t_int), 0));
+		ir_bc_record_op(w, irBcOp_ValueType, ir_bc_const_int(w, w->t_i32, 2));
+		ir_bc_record_end(w, irBcFunc_Gep, irBcFuncAbbrev_Gep, value, ir_bc_type_pointer(w, ir_bc_type_field(w, st, 2)));
+		break;
+	}
+
+	case irInstr_UnionTagValue: {
+		Type *et = ir_type(instr->UnionTagValue.address);
+		GB_ASSERT(!is_type_union_maybe_pointer(base_type(et)));
+		i32 st = ir_bc_type(w, et);
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->UnionTagValue.address, st, et);
+		ir_bc_record_literal(w, 2);
+		ir_bc_record_end(w, irBcFunc_ExtractValue, irBcFuncAbbrev_None, value, ir_bc_type_field(w, st, 2));
+		break;
+	}
+
+	case irInstr_Jump:
+		ir_bc_record_begin(w);
+		ir_bc_record_literal(w, instr->Jump.block->index);
+		ir_bc_record_end(w, irBcFunc_Br, irBcFuncAbbrev_None, value, -1);
+		break;
+
+	case irInstr_If:
+		ir_bc_record_begin(w);
+		ir_bc_record_literal(w, instr->If.true_block->index);
+		ir_bc_record_literal(w, instr->If.false_block->index);
+		ir_bc_op_value(w, irBcOp_Value, instr->If.cond, w->t_i1, t_bool);
+		ir_bc_record_end(w, irBcFunc_Br, irBcFuncAbbrev_None, value, -1);
+		break;
+
+	case irInstr_Return: {
+		irInstrReturn *ret = &instr->Return;
+		ir_bc_record_begin(w);
+		if (ret->value == nullptr) {
+			ir_bc_record_end(w, irBcFunc_Ret, irBcFuncAbbrev_RetVoid, value, -1);
+		} else {
+			Type *t = ir_type(ret->value);
+			ir_bc_op_value(w, irBcOp_ValueType, ret->value, ir_bc_type(w, t), t);
+			ir_bc_record_end(w, irBcFunc_Ret, irBcFuncAbbrev_RetVal, value, -1);
+		}
+		break;
+	}
+
+	case irInstr_Conv: {
+		irInstrConv *c = &instr->Conv;
+		i32 from = ir_bc_type(w, c->from);
+		if (c->kind == irConv_byteswap) {
+			i64 bits = 8*type_size_of(c->from);
+			i32 t = ir_bc_type_integer(w, bits);
+			char buf[32] = {};
+			isize len = gb_snprintf(buf, gb_size_of(buf), "llvm.bswap.i%lld", cast(long long)bits);
+			String name = make_string(cast(u8 *)buf, len-1);
+			i32 fn_type = ir_bc_type_function(w, t, &t, 1, false);
+			u64 *found = map_get(&w->value_map, hash_string(name));
+			u64 callee = 0;
+			if (found != nullptr) {
+				callee = *found;
+			} else {
+				ir_bc_update_module_names(w);
+				if (map_get(&w->module_names, hash_string(name)) != nullptr) {
+					callee = ir_bc_global_ref(w, name);
+				} else {
+					callee = ir_bc_add_external_function(w, ir_bc_copy_string(w, name), fn_type);
+				}
+			}
+			ir_bc_record_begin(w);
+			ir_bc_record_literal(w, 0);
+			ir_bc_record_literal(w, 1u << 15);
+			ir_bc_record_op(w, irBcOp_Type, fn_type);
+			ir_bc_record_op(w, irBcOp_ValueType, callee);
+			ir_bc_op_value(w, irBcOp_Value, c->value, from, c->from);
+			ir_bc_record_end(w, irBcFunc_Call, irBcFuncAbbrev_None, value, t);
+			break;
+		}
+
+		u32 opcode = ir_bc_cast_opcode(ir_conv_strings[c->kind]);
+		GB_ASSERT(opcode != ~0u);
+		i32 to = ir_bc_type(w, c->to);
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, c->value, from, c->from);
+		ir_bc_record_op(w, irBcOp_Type, to);
+		ir_bc_record_literal(w, opcode);
+		ir_bc_record_end(w, irBcFunc_Cast, irBcFuncAbbrev_Cast, value, to);
+		break;
+	}
+
+	case irInstr_Unreachable:
+		ir_bc_record_begin(w);
+		ir_bc_record_end(w, irBcFunc_Unreachable, irBcFuncAbbrev_Unreachable, value, -1);
+		break;
+
+	case irInstr_UnaryOp: {
+		irInstrUnaryOp *uo = &value->Instr.UnaryOp;
+		Type *type = base_type(ir_type(uo->expr));
+		i32 t = ir_bc_type(w, type);
+		u64 lhs = 0;
+		u32 opcode = 0;
+		switch (uo->op) {
+		case Token_Sub:
+			opcode = 1;
+			if (is_type_float(type)) {
+				isize start = w->text_data.count;
+				ir_print_exact_value(&w->text, m, exact_value_float(0), type);
+				irBcText text = ir_bc_text(w, start);
+				lhs = ir_bc_parse_const(w, &text, t);
+				w->text_data.count = start;
+			} else {
+				lhs = ir_bc_parse_const_cstring(w, t, "0");
+			}
+			break;
+		case Token_Xor:
+		case Token_Not:
+			GB_ASSERT(is_type_integer(type) || is_type_boolean(type) || is_type_bit_set(type));
+			opcode = 12;
+			lhs = ir_bc_parse_const_cstring(w, t, "-1");
+			break;
+		default:
+			GB_PANIC("Unknown unary operator");
+			break;
+		}
+		ir_bc_record_begin(w);
+		ir_bc_record_op(w, irBcOp_ValueType, lhs);
+		ir_bc_op_value(w, irBcOp_Value, uo->expr, t, type);
+		ir_bc_record_literal(w, opcode);
+		ir_bc_record_end(w, irBcFunc_Binop, irBcFuncAbbrev_Binop, value, t);
+		break;
+	}
+
+	case irInstr_BinaryOp: {
+		irInstrBinaryOp *bo = &value->Instr.BinaryOp;
+		Type *type = base_type(ir_type(bo->left));
+		Type *elem_type = base_array_type(type);
+		i32 t = ir_bc_type(w, type);
+
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, bo->left, t, type);
+		ir_bc_op_value(w, irBcOp_Value, bo->right, t, type);
+
+		if (gb_is_between(bo->op, Token__ComparisonBegin+1, Token__ComparisonEnd-1)) {
+			u32 predicate = 0;
+			if (is_type_string(elem_type)) {
+				GB_PANIC("Unhandled string type");
+			} else if (is_type_float(elem_type)) {
+				switch (bo->op) {
+				case Token_CmpEq: predicate = 1; break;
+				case Token_NotEq: predicate = 6; break;
+				case Token_Lt:    predicate = 4; break;
+				case Token_Gt:    predicate = 2; break;
+				case Token_LtEq:  predicate = 5; break;
+				case Token_GtEq:  predicate = 3; break;
+				}
+			} else if (is_type_complex(elem_type)) {
+				GB_PANIC("Unhandled complex type");
+			} else {
+				bool is_unsigned = is_type_unsigned(elem_type);
+				switch (bo->op) {
+				case Token_CmpEq: predicate = 32; break;
+				case Token_NotEq: predicate = 33; break;
+				case Token_Gt:    predicate = is_unsigned ? 34 : 38; break;
+				case Token_GtEq:  predicate = is_unsigned ? 35 : 39; break;
+				case Token_Lt:    predicate = is_unsigned ? 36 : 40; break;
+				case Token_LtEq:  predicate = is_unsigned ? 37 : 41; break;
+				default: GB_PANIC("invalid comparison"); break;
+				}
+			}
+			ir_bc_record_literal(w, predicate);
+			i32 result = w->t_i1;
+			if (ir_bc_type_is(w, t, irBcType_Vector)) {
+				result = ir_bc_type_vector(w, w->types[t].count, w->t_i1);
+			}
+			ir_bc_record_end(w, irBcFunc_Cmp2, irBcFuncAbbrev_None, value, result);
+			break;
+		}
+
+		bool is_float = is_type_float(elem_type);
+		bool is_unsigned = is_type_unsigned(elem_type);
+		u32 opcode = 0;
+		switch (bo->op) {
+		case Token_Add: opcode = 0;  break;
+		case Token_Sub: opcode = 1;  break;
+		case Token_Mul: opcode = 2;  break;
+		case Token_Shl: opcode = 7;  break;
+		case Token_Shr: opcode = is_unsigned ? 8 : 9; break;
+		case Token_And: opcode = 10; break;
+		case Token_Or:  opcode = 11; break;
+		case Token_Xor: opcode = 12; break;
+		case Token_Not: opcode = 12; break;
+		case Token_Quo: opcode = (!is_float && is_unsigned) ? 3 : 4; break;
+		case Token_Mod: opcode = (!is_float && is_unsigned) ? 5 : 6; break;
+		case Token_AndNot: GB_PANIC("Token_AndNot Should never be called"); break;
+		default: GB_PANIC("Unknown binary operator"); break;
+		}
+		ir_bc_record_literal(w, opcode);
+		ir_bc_record_end(w, irBcFunc_Binop, irBcFuncAbbrev_Binop, value, t);
+		break;
+	}
+
+	case irInstr_Call:
+		ir_bc_lower_call(w, value);
+		break;
+
+	case irInstr_Select: {
+		Type *tt = ir_type(instr->Select.true_value);
+		Type *ft = ir_type(instr->Select.false_value);
+		i32 t = ir_bc_type(w, tt);
+		ir_bc_record_begin(w);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->Select.true_value, t, tt);
+		ir_bc_op_value(w, irBcOp_Value, instr->Select.false_value, ir_bc_type(w, ft), ft);
+		ir_bc_op_value(w, irBcOp_ValueType, instr->Select.cond, w->t_i1, t_bool);
+		ir_bc_record_end(w, irBcFunc_VSelect, irBcFuncAbbrev_None, value, t);
+		break;
+	}
+	}
+}
+
+void ir_bc_lower_proc(irBcWriter *w, irProcedure *proc) {
+	u64 *found = map_get(&w->value_map, hash_string(ir_bc_proc_name(w, proc)));
+	GB_ASSERT(found != nullptr);
+	irBcFunction *fn = &w->functions[IR_BC_VALUE_INDEX(*found)];
+	if (fn->is_definition) {
+		irBcFunctionBody *body = fn->body;
+		w->body = body;
+		body->block_count = proc->blocks.count;
+		for_array(i, proc->blocks) {
+			irBlock *block = proc->blocks[i];
+			GB_ASSERT(block->index == i);
+			for_array(j, block->instrs) {
+				ir_bc_lower_instr(w, proc, block->instrs[j]);
+			}
+		}
+		w->body = nullptr;
+	}
+	for_array(i, proc->children) {
+		ir_bc_lower_proc(w, proc->children[i]);
+	}
+}
+
+// NOTE: The probe 'ir_print_codegen_unit' defines when '__chkstk' is not linked in
+void ir_bc_add_chkstk(irBcWriter *w) {
+	i32 fn_type = ir_bc_type_function(w, w->t_void, nullptr, 0, false);
+	u64 ref = ir_bc_add_external_function(w, str_lit("__chkstk"), fn_type);
+	irBcFunction *fn = &w->functions[IR_BC_VALUE_INDEX(ref)];
+	array_clear(&w->attr_scratch);
+	ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_NoUnwind);
+	ir_bc_attr_add(w, IR_BC_FUNCTION_ATTR_INDEX, irBcAttr_UWTable);
+	fn->attrs = ir_bc_attr_list(w);
+	fn->is_definition = true;
+	fn->body = gb_alloc_item(w->allocator, irBcFunctionBody);
+	fn->body->sret_arg = -1;
+	fn->body->context_arg = -1;
+	fn->body->block_count = 1;
+	array_init(&fn->body->records, heap_allocator());
+	array_init(&fn->body->value_types, heap_allocator());
+	array_init(&fn->body->arg_names, heap_allocator());
+	array_init(&fn->body->param_args, heap_allocator());
+
+	w->body = fn->body;
+	ir_bc_call_inline_asm(w, nullptr,
+		str_lit("push   %rcx \t\npush   %rax \t\ncmp    $$0x1000,%rax \t\nlea    24(%rsp),%rcx \t\njb     1f \t\n2: \t\nsub    $$0x1000,%rcx \t\norl    $$0,(%rcx) \t\nsub    $$0x1000,%rax \t\ncmp    $$0x1000,%rax \t\nja     2b \t\n1: \t\nsub    %rax,%rcx \t\norl    $$0,(%rcx) \t\npop    %rax \t\npop    %rcx \t\nret \t\n"),
+		str_lit("~{dirflag},~{fpsr},~{flags}"));
+	ir_bc_record_begin(w);
+	ir_bc_record_end(w, irBcFunc_Ret, irBcFuncAbbrev_RetVoid, nullptr, -1);
+	w->body = nullptr;
+}
+
+void ir_bc_define_global(irBcWriter *w, irValue *v) {
+	u64 ref = ir_bc_add_global(w, v);
+	i32 index = IR_BC_VALUE_INDEX(ref);
+	w->globals[index].is_other_unit = false;
+	if (v->Global.is_foreign) {
+		return;
+	}
+
+	irValueGlobal *g = &v->Global;
+	Type *type = type_deref(g->type);
+	i32 t = w->globals[index].type;
+	u64 init = 0;
+	if (g->value != nullptr && ir_print_global_type_allowed(type)) {
+		if (g->value->kind == irValue_Constant) {
+			ExactValue ev = g->value->Constant.value;
+			isize start = w->text_data.count;
+			ir_print_exact_value(&w->text, w->m, ev, type);
+			irBcText text = ir_bc_text(w, start);
+			init = ir_bc_parse_const(w, &text, t);
+			w->text_data.count = start;
+		} else {
+			init = ir_bc_print_value(w, g->value, t, type);
+		}
+	} else {
+		init = ir_bc_const_null(w, t);
+	}
+	w->globals[index].is_definition = true;
+	w->globals[index].init = init;
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Writing
+//
+////////////////////////////////////////////////////////////////
+
+void ir_bc_number_type(irBcWriter *w, i32 index) {
+	irBcType *t = &w->types[index];
+	if (t->id != -1) {
+		return;
+	}
+	bool is_named = t->name.len > 0;
+	if (is_named) {
+		// NOTE: Named structs may be referred to before they are defined, so the recursion stops at them
+		t->id = -2;
+	}
+	if (t->elem >= 0) {
+		ir_bc_number_type(w, t->elem);
+	}
+	for (i32 i = 0; i < w->types[index].field_count; i++) {
+		ir_bc_number_type(w, w->type_fields[w->types[index].fields + i]);
+	}
+	t = &w->types[index];
+	if (t->id >= 0) {
+		return;
+	}
+	t->id = cast(i32)w->type_order.count;
+	array_add(&w->type_order, index);
+}
+
+gb_inline u64 ir_bc_type_id(irBcWriter *w, i32 type) {
+	i32 id = w->types[type].id;
+	GB_ASSERT(id >= 0);
+	return cast(u64)id;
+}
+
+u32 ir_bc_type_bits(irBcWriter *w) {
+	return cast(u32)floor_log2(cast(u64)gb_max(w->type_order.count, 1)) + 1;
+}
+
+void ir_bc_emit_type_table(irBcWriter *w, irBitWriter *b) {
+	u32 type_bits = ir_bc_type_bits(w);
+	ir_bit_enter_block(b, irBcBlock_TypeNew, 4);
+
+	irBcAbbrev pointer_abbrev = ir_bc_abbrev(4, ir_bc_op_literal(irBcTypeCode_Pointer), ir_bc_op_fixed(type_bits), ir_bc_op_literal(0));
+	irBcAbbrev function_abbrev = ir_bc_abbrev(5, ir_bc_op_literal(irBcTypeCode_Function), ir_bc_op_fixed(1), ir_bc_op_array(), ir_bc_op_fixed(type_bits));
+	irBcAbbrev struct_anon_abbrev = ir_bc_abbrev(6, ir_bc_op_literal(irBcTypeCode_StructAnon), ir_bc_op_fixed(1), ir_bc_op_array(), ir_bc_op_fixed(type_bits));
+	irBcAbbrev struct_name_abbrev = ir_bc_abbrev(7, ir_bc_op_literal(irBcTypeCode_StructName), ir_bc_op_array(), ir_bc_op_fixed(8));
+	irBcAbbrev struct_named_abbrev = ir_bc_abbrev(8, ir_bc_op_literal(irBcTypeCode_StructNamed), ir_bc_op_fixed(1), ir_bc_op_array(), ir_bc_op_fixed(type_bits));
+	irBcAbbrev array_abbrev = ir_bc_abbrev(9, ir_bc_op_literal(irBcTypeCode_Array), ir_bc_op_vbr(8), ir_bc_op_fixed(type_bits));
+	ir_bit_define_abbrev(b, &pointer_abbrev);
+	ir_bit_define_abbrev(b, &function_abbrev);
+	ir_bit_define_abbrev(b, &struct_anon_abbrev);
+	ir_bit_define_abbrev(b, &struct_name_abbrev);
+	ir_bit_define_abbrev(b, &struct_named_abbrev);
+	ir_bit_define_abbrev(b, &array_abbrev);
+
+	u64 count = w->type_order.count;
+	ir_bit_emit_record(b, irBcTypeCode_NumEntry, &count, 1);
+
+	auto ops = array_make<u64>(heap_allocator(), 0, 64);
+	defer (array_free(&ops));
+	for_array(i, w->type_order) {
+		irBcType *t = &w->types[w->type_order[i]];
+		array_clear(&ops);
+		switch (t->kind) {
+		case irBcType_Void:     ir_bit_emit_record(b, irBcTypeCode_Void, nullptr, 0);     break;
+		case irBcType_Half:     ir_bit_emit_record(b, irBcTypeCode_Half, nullptr, 0);     break;
+		case irBcType_Float:    ir_bit_emit_record(b, irBcTypeCode_Float, nullptr, 0);    break;
+		case irBcType_Double:   ir_bit_emit_record(b, irBcTypeCode_Double, nullptr, 0);   break;
+		case irBcType_X86Mmx:   ir_bit_emit_record(b, irBcTypeCode_X86Mmx, nullptr, 0);   break;
+		case irBcType_Label:    ir_bit_emit_record(b, irBcTypeCode_Label, nullptr, 0);    break;
+		case irBcType_Metadata: ir_bit_emit_record(b, irBcTypeCode_Metadata, nullptr, 0); break;
+		case irBcType_Integer: {
+			u64 bits = cast(u64)t->count;
+			ir_bit_emit_record(b, irBcTypeCode_Integer, &bits, 1);
+			break;
+		}
+		case irBcType_Pointer:
+			array_add(&ops, ir_bc_type_id(w, t->elem));
+			array_add(&ops, cast(u64)0);
+			ir_bit_emit_record_abbrev(b, &pointer_abbrev, irBcTypeCode_Pointer, ops.data, ops.count);
+			break;
+		case irBcType_Array:
+			array_add(&ops, cast(u64)t->count);
+			array_add(&ops, ir_bc_type_id(w, t->elem));
+			ir_bit_emit_record_abbrev(b, &array_abbrev, irBcTypeCode_Array, ops.data, ops.count);
+			break;
+		case irBcType_Vector:
+			array_add(&ops, cast(u64)t->count);
+			array_add(&ops, ir_bc_type_id(w, t->elem));
+			ir_bit_emit_record(b, irBcTypeCode_Vector, ops.data, ops.count);
+			break;
+		case irBcType_Function:
+			array_add(&ops, cast(u64)t->is_vararg);
+			array_add(&ops, ir_bc_type_id(w, t->elem));
+			for (i32 j = 0; j < t->field_count; j++) {
+				array_add(&ops, ir_bc_type_id(w, w->type_fields[t->fields + j]));
+			}
+			ir_bit_emit_record_abbrev(b, &function_abbrev, irBcTypeCode_Function, ops.data, ops.count);
+			break;
+		case irBcType_Struct: {
+			u32 code = irBcTypeCode_StructAnon;
+			irBcAbbrev *abbrev = &struct_anon_abbrev;
+			if (t->name.len > 0) {
+				for (isize j = 0; j < t->name.len; j++) {
+					array_add(&ops, cast(u64)t->name[j]);
+				}
+				ir_bit_emit_record_abbrev(b, &struct_name_abbrev, irBcTypeCode_StructName, ops.data, ops.count);
+				array_clear(&ops);
+				if (!t->has_body) {
+					u64 zero = 0;
+					ir_bit_emit_record(b, irBcTypeCode_Opaque, &zero, 1);
+					break;
+				}
+				code = irBcTypeCode_StructNamed;
+				abbrev = &struct_named_abbrev;
+			}
+			array_add(&ops, cast(u64)t->is_packed);
+			for (i32 j = 0; j < t->field_count; j++) {
+				array_add(&ops, ir_bc_type_id(w, w->type_fields[t->fields + j]));
+			}
+			ir_bit_emit_record_abbrev(b, abbrev, code, ops.data, ops.count);
+			break;
+		}
+		}
+	}
+
+	ir_bit_exit_block(b);
+}
+
+void ir_bc_emit_attributes(irBcWriter *w, irBitWriter *b) {
+	if (w->attr_lists.count == 0) {
+		return;
+	}
+	auto ops = array_make<u64>(heap_allocator(), 0, 16);
+	defer (array_free(&ops));
+
+	ir_bit_enter_block(b, irBcBlock_ParamAttrGroup, 3);
+	for_array(i, w->attr_groups) {
+		irBcAttrGroup *group = &w->attr_groups[i];
+		array_clear(&ops);
+		array_add(&ops, cast(u64)i+1);
+		array_add(&ops, cast(u64)group->index);
+		for (i32 j = 0; j < group->attr_count; j++) {
+			irBcAttr *attr = &w->attrs[group->attrs + j];
+			if (attr->type >= 0) {
+				array_add(&ops, cast(u64)6);
+				array_add(&ops, cast(u64)attr->kind);
+				array_add(&ops, ir_bc_type_id(w, attr->type));
+			} else {
+				array_add(&ops, cast(u64)0);
+				array_add(&ops, cast(u64)attr->kind);
+			}
+		}
+		ir_bit_emit_record(b, 3, ops.data, ops.count);
+	}
+	ir_bit_exit_block(b);
+
+	ir_bit_enter_block(b, irBcBlock_ParamAttr, 3);
+	for_array(i, w->attr_lists) {
+		irBcAttrList *list = &w->attr_lists[i];
+		array_clear(&ops);
+		for (i32 j = 0; j < list->group_count; j++) {
+			array_add(&ops, cast(u64)w->attr_list_groups[list->groups + j]+1);
+		}
+		ir_bit_emit_record(b, 2, ops.data, ops.count);
+	}
+	ir_bit_exit_block(b);
+}
+
+void ir_bc_emit_block_info(irBcWriter *w, irBitWriter *b) {
+	u32 type_bits = ir_bc_type_bits(w);
+	ir_bit_enter_block(b, irBcBlock_BlockInfo, 2);
+
+	u64 block_id = irBcBlock_ValueSymtab;
+	ir_bit_emit_record(b, irBcBlockInfo_SetBid, &block_id, 1);
+	irBcAbbrev vst[] = {
+		ir_bc_abbrev(irBcVstAbbrev_Entry8,   ir_bc_op_literal(1), ir_bc_op_vbr(8), ir_bc_op_array(), ir_bc_op_fixed(8)),
+		ir_bc_abbrev(irBcVstAbbrev_Entry7,   ir_bc_op_literal(1), ir_bc_op_vbr(8), ir_bc_op_array(), ir_bc_op_fixed(7)),
+		ir_bc_abbrev(irBcVstAbbrev_Entry6,   ir_bc_op_literal(1), ir_bc_op_vbr(8), ir_bc_op_array(), ir_bc_op_char6()),
+		ir_bc_abbrev(irBcVstAbbrev_BbEntry6, ir_bc_op_literal(2), ir_bc_op_vbr(8), ir_bc_op_array(), ir_bc_op_char6()),
+		ir_bc_abbrev(irBcVstAbbrev_BbEntry8, ir_bc_op_literal(2), ir_bc_op_vbr(8), ir_bc_op_array(), ir_bc_op_fixed(8)),
+	};
+	for (isize i = 0; i < gb_count_of(vst); i++) {
+		ir_bit_define_abbrev(b, &vst[i]);
+	}
+
+	block_id = irBcBlock_Constants;
+	ir_bit_emit_record(b, irBcBlockInfo_SetBid, &block_id, 1);
+	irBcAbbrev consts[] = {
+		ir_bc_abbrev(irBcConstAbbrev_SetType,  ir_bc_op_literal(irBcConst_SetType), ir_bc_op_fixed(type_bits)),
+		ir_bc_abbrev(irBcConstAbbrev_Integer,  ir_bc_op_literal(irBcConst_Integer), ir_bc_op_vbr(8)),
+		ir_bc_abbrev(irBcConstAbbrev_CastExpr, ir_bc_op_literal(irBcConst_CastExpr), ir_bc_op_fixed(4), ir_bc_op_fixed(type_bits), ir_bc_op_vbr(8)),
+		ir_bc_abbrev(irBcConstAbbrev_Null,     ir_bc_op_literal(irBcConst_Null)),
+	};
+	for (isize i = 0; i < gb_count_of(consts); i++) {
+		ir_bit_define_abbrev(b, &consts[i]);
+	}
+
+	block_id = irBcBlock_Function;
+	ir_bit_emit_record(b, irBcBlockInfo_SetBid, &block_id, 1);
+	irBcAbbrev *funcs = w->function_abbrevs;
+	irBcAbbrev function_abbrevs[] = {
+		ir_bc_abbrev(irBcFuncAbbrev_Load,        ir_bc_op_literal(irBcFunc_Load), ir_bc_op_vbr(6), ir_bc_op_fixed(type_bits), ir_bc_op_vbr(4), ir_bc_op_fixed(1)),
+		ir_bc_abbrev(irBcFuncAbbrev_Binop,       ir_bc_op_literal(irBcFunc_Binop), ir_bc_op_vbr(6), ir_bc_op_vbr(6), ir_bc_op_fixed(4)),
+		ir_bc_abbrev(irBcFuncAbbrev_Cast,        ir_bc_op_literal(irBcFunc_Cast), ir_bc_op_vbr(6), ir_bc_op_fixed(type_bits), ir_bc_op_fixed(4)),
+		ir_bc_abbrev(irBcFuncAbbrev_RetVoid,     ir_bc_op_literal(irBcFunc_Ret)),
+		ir_bc_abbrev(irBcFuncAbbrev_RetVal,      ir_bc_op_literal(irBcFunc_Ret), ir_bc_op_vbr(6)),
+		ir_bc_abbrev(irBcFuncAbbrev_Unreachable, ir_bc_op_literal(irBcFunc_Unreachable)),
+		ir_bc_abbrev(irBcFuncAbbrev_Gep,         ir_bc_op_literal(irBcFunc_Gep), ir_bc_op_fixed(1), ir_bc_op_fixed(type_bits), ir_bc_op_array(), ir_bc_op_vbr(6)),
+	};
+	GB_ASSERT(gb_count_of(function_abbrevs) == gb_count_of(w->function_abbrevs));
+	for (isize i = 0; i < gb_count_of(function_abbrevs); i++) {
+		funcs[i] = function_abbrevs[i];
+		ir_bit_define_abbrev(b, &funcs[i]);
+	}
+
+	ir_bit_exit_block(b);
+}
+
+struct irBcValueIds {
+	u64 globals;
+	u64 functions;
+	u64 consts;
+	u64 args;
+	u64 instrs;
+};
+
+u64 ir_bc_value_id(irBcWriter *w, irBcValueIds const *ids, u64 ref) {
+	u64 index = cast(u64)IR_BC_VALUE_INDEX(ref);
+	switch (IR_BC_VALUE_KIND(ref)) {
+	case irBcValue_Global:   return ids->globals + index;
+	case irBcValue_Function: return ids->functions + index;
+	case irBcValue_Const:    return ids->consts + index;
+	case irBcValue_Arg:      return ids->args + index;
+	case irBcValue_Instr:    return ids->instrs + index;
+	}
+	GB_PANIC("Invalid value reference");
+	return 0;
+}
+
+void ir_bc_emit_constants(irBcWriter *w, irBitWriter *b, irBcValueIds const *ids) {
+	if (w->consts.count == 0) {
+		return;
+	}
+	u32 type_bits = ir_bc_type_bits(w);
+	ir_bit_enter_block(b, irBcBlock_Constants, 4);
+
+	u64 value_bits = floor_log2(cast(u64)(ids->consts + w->consts.count)) + 1;
+	irBcAbbrev aggregate_abbrev = ir_bc_abbrev(8, ir_bc_op_literal(irBcConst_Aggregate), ir_bc_op_array(), ir_bc_op_fixed(cast(u32)value_bits));
+	irBcAbbrev string_abbrev    = ir_bc_abbrev(9, ir_bc_op_literal(irBcConst_String), ir_bc_op_array(), ir_bc_op_fixed(8));
+	irBcAbbrev cstring7_abbrev  = ir_bc_abbrev(10, ir_bc_op_literal(irBcConst_CString), ir_bc_op_array(), ir_bc_op_fixed(7));
+	irBcAbbrev cstring6_abbrev  = ir_bc_abbrev(11, ir_bc_op_literal(irBcConst_CString), ir_bc_op_array(), ir_bc_op_char6());
+	ir_bit_define_abbrev(b, &aggregate_abbrev);
+	ir_bit_define_abbrev(b, &string_abbrev);
+	ir_bit_define_abbrev(b, &cstring7_abbrev);
+	ir_bit_define_abbrev(b, &cstring6_abbrev);
+
+	irBcAbbrev set_type_abbrev  = ir_bc_abbrev(irBcConstAbbrev_SetType, ir_bc_op_literal(irBcConst_SetType), ir_bc_op_fixed(type_bits));
+	irBcAbbrev integer_abbrev   = ir_bc_abbrev(irBcConstAbbrev_Integer, ir_bc_op_literal(irBcConst_Integer), ir_bc_op_vbr(8));
+	irBcAbbrev cast_abbrev      = ir_bc_abbrev(irBcConstAbbrev_CastExpr, ir_bc_op_literal(irBcConst_CastExpr), ir_bc_op_fixed(4), ir_bc_op_fixed(type_bits), ir_bc_op_vbr(8));
+	irBcAbbrev null_abbrev      = ir_bc_abbrev(irBcConstAbbrev_Null, ir_bc_op_literal(irBcConst_Null));
+
+	auto ops = array_make<u64>(heap_allocator(), 0, 64);
+	defer (array_free(&ops));
+	i32 current_type = -1;
+	for_array(i, w->consts) {
+		irBcConst *c = &w->consts[i];
+		if (c->type != current_type) {
+			current_type = c->type;
+			u64 type_id = ir_bc_type_id(w, c->type);
+			ir_bit_emit_record_abbrev(b, &set_type_abbrev, irBcConst_SetType, &type_id, 1);
+		}
+		u64 const *src = w->const_ops.data + c->ops;
+		array_clear(&ops);
+		switch (c->code) {
+		case irBcConst_Null:
+			ir_bit_emit_record_abbrev(b, &null_abbrev, c->code, nullptr, 0);
+			break;
+		case irBcConst_Integer:
+			ir_bit_emit_record_abbrev(b, &integer_abbrev, c->code, src, c->op_count);
+			break;
+		case irBcConst_Aggregate:
+			for (i32 j = 0; j < c->op_count; j++) {
+				array_add(&ops, ir_bc_value_id(w, ids, src[j]));
+			}
+			ir_bit_emit_record_abbrev(b, &aggregate_abbrev, c->code, ops.data, ops.count);
+			break;
+		case irBcConst_String:
+			ir_bit_emit_record_abbrev(b, &string_abbrev, c->code, src, c->op_count);
+			break;
+		case irBcConst_CString: {
+			bool is_char6 = true;
+			bool is_char7 = true;
+			for (i32 j = 0; j < c->op_count; j++) {
+				is_char6 = is_char6 && ir_bc_char6(cast(u8)src[j]) >= 0;
+				is_char7 = is_char7 && src[j] < 128;
+			}
+			if (is_char6) {
+				ir_bit_emit_record_abbrev(b, &cstring6_abbrev, c->code, src, c->op_count);
+			} else if (is_char7) {
+				ir_bit_emit_record_abbrev(b, &cstring7_abbrev, c->code, src, c->op_count);
+			} else {
+				ir_bit_emit_record(b, c->code, src, c->op_count);
+			}
+			break;
+		}
+		case irBcConst_CastExpr:
+			array_add(&ops, src[0]);
+			array_add(&ops, ir_bc_type_id(w, cast(i32)src[1]));
+			array_add(&ops, ir_bc_value_id(w, ids, src[2]));
+			ir_bit_emit_record_abbrev(b, &cast_abbrev, c->code, ops.data, ops.count);
+			break;
+		case irBcConst_InboundsGep:
+			array_add(&ops, ir_bc_type_id(w, cast(i32)src[0]));
+			for (i32 j = 1; j+1 < c->op_count; j += 2) {
+				array_add(&ops, ir_bc_type_id(w, cast(i32)src[j]));
+				array_add(&ops, ir_bc_value_id(w, ids, src[j+1]));
+			}
+			ir_bit_emit_record(b, c->code, ops.data, ops.count);
+			break;
+		case irBcConst_InlineAsm:
+			array_add_elems(&ops, src, c->op_count);
+			ops[0] = ir_bc_type_id(w, cast(i32)src[0]);
+			ir_bit_emit_record(b, c->code, ops.data, ops.count);
+			break;
+		default:
+			ir_bit_emit_record(b, c->code, src, c->op_count);
+			break;
+		}
+	}
+
+	ir_bit_exit_block(b);
+}
+
+void ir_bc_emit_vst_entry(irBitWriter *b, u32 code, u64 id, String name) {
+	bool is_char6 = true;
+	bool is_char7 = true;
+	for (isize i = 0; i < name.len; i++) {
+		is_char6 = is_char6 && ir_bc_char6(name[i]) >= 0;
+		is_char7 = is_char7 && name[i] < 128;
+	}
+	u32 abbrev_id = 0;
+	if (code == 2) {
+		abbrev_id = is_char6 ? irBcVstAbbrev_BbEntry6 : irBcVstAbbrev_BbEntry8;
+	} else {
+		abbrev_id = is_char6 ? irBcVstAbbrev_Entry6 : is_char7 ? irBcVstAbbrev_Entry7 : irBcVstAbbrev_Entry8;
+	}
+	ir_bit_emit(b, abbrev_id, b->abbrev_width);
+	ir_bit_emit_vbr(b, id, 8);
+	ir_bit_emit_vbr(b, name.len, 6);
+	for (isize i = 0; i < name.len; i++) {
+		if (is_char6) {
+			ir_bit_emit(b, ir_bc_char6(name[i]), 6);
+		} else if (code != 2 && is_char7) {
+			ir_bit_emit(b, name[i], 7);
+		} else {
+			ir_bit_emit(b, name[i], 8);
+		}
+	}
+}
+
+void ir_bc_emit_function_body(irBcWriter *w, irBitWriter *b, irBcFunction *fn, irBcValueIds ids) {
+	irBcFunctionBody *body = fn->body;
+	ids.args = ids.consts + w->consts.count;
+	ids.instrs = ids.args + body->arg_names.count;
+	w->body = body;
+
+	ir_bit_enter_block(b, irBcBlock_Function, 4);
+	u64 block_count = cast(u64)body->block_count;
+	ir_bit_emit_record(b, irBcFunc_DeclareBlocks, &block_count, 1);
+
+	auto ops = array_make<u64>(heap_allocator(), 0, 64);
+	defer (array_free(&ops));
+	u64 inst_id = ids.instrs;
+	for (isize i = 0; i < body->records.count;) {
+		u64 header = body->records[i];
+		u32 code = cast(u32)(header & 0xffff);
+		u32 abbrev = cast(u32)((header >> 16) & 0xff);
+		bool has_value = ((header >> 24) & 1) != 0;
+		isize op_count = cast(isize)(header >> 32);
+		u64 const *src = body->records.data + i + 1;
+		i += 1 + op_count;
+
+		array_clear(&ops);
+		bool is_forward = false;
+		for (isize j = 0; j < op_count; j++) {
+			u64 op = src[j];
+			u64 payload = IR_BC_OP_PAYLOAD(op);
+			switch (IR_BC_OP_KIND(op)) {
+			case irBcOp_Literal:
+				array_add(&ops, payload);
+				break;
+			case irBcOp_Type:
+				array_add(&ops, ir_bc_type_id(w, cast(i32)payload));
+				break;
+			case irBcOp_Value: {
+				u64 id = ir_bc_value_id(w, &ids, payload);
+				array_add(&ops, cast(u64)cast(u32)(inst_id - id));
+				break;
+			}
+			case irBcOp_ValueType: {
+				u64 id = ir_bc_value_id(w, &ids, payload);
+				array_add(&ops, cast(u64)cast(u32)(inst_id - id));
+				if (id >= inst_id) {
+					array_add(&ops, ir_bc_type_id(w, ir_bc_value_type(w, payload)));
+					is_forward = true;
+				}
+				break;
+			}
+			case irBcOp_ValueSigned: {
+				u64 id = ir_bc_value_id(w, &ids, payload);
+				array_add(&ops, ir_bc_encode_signed(cast(i64)inst_id - cast(i64)id));
+				break;
+			}
+			case irBcOp_ValueAbsolute:
+				array_add(&ops, ir_bc_value_id(w, &ids, payload));
+				break;
+			}
+		}
+
+		if (abbrev != irBcFuncAbbrev_None && !is_forward) {
+			ir_bit_emit_record_abbrev(b, &w->function_abbrevs[abbrev - irBcAbbrevId_FirstApp], code, ops.data, ops.count);
+		} else {
+			ir_bit_emit_record(b, code, ops.data, ops.count);
+		}
+		if (has_value) {
+			inst_id += 1;
+		}
+	}
+
+	if (body->arg_names.count > 0 || fn->proc != nullptr) {
+		ir_bit_enter_block(b, irBcBlock_ValueSymtab, 4);
+		for_array(i, body->arg_names) {
+			ir_bc_emit_vst_entry(b, 1, ids.args + i, body->arg_names[i]);
+		}
+		if (fn->proc != nullptr) {
+			irFileBuffer *f = &w->text;
+			for_array(i, fn->proc->blocks) {
+				isize start = w->text_data.count;
+				ir_print_escape_string(f, fn->proc->blocks[i]->label, false, false);
+				ir_write_byte(f, '-');
+				ir_write_i64(f, i);
+				String name = make_string(w->text_data.data + start, w->text_data.count - start);
+				ir_bc_emit_vst_entry(b, 2, i, name);
+				w->text_data.count = start;
+			}
+		}
+		ir_bit_exit_block(b);
+	}
+
+	ir_bit_exit_block(b);
+	w->body = nullptr;
+}
+
+u64 ir_bc_strtab_add(Array<u8> *strtab, String name) {
+	u64 offset = cast(u64)strtab->count;
+	array_add_elems(strtab, name.text, name.len);
+	return offset;
+}
+
+void ir_bc_emit_module(irBcWriter *w, Array<u8> *out) {
+	irBitWriter bw = {}, *b = &bw;
+	b->out = out;
+	b->abbrev_width = 2;
+	array_init(&b->scopes, heap_allocator());
+	defer (array_free(&b->scopes));
+
+	ir_bit_emit(b, 'B', 8);
+	ir_bit_emit(b, 'C', 8);
+	ir_bit_emit(b, 0x0, 4);
+	ir_bit_emit(b, 0xC, 4);
+	ir_bit_emit(b, 0xE, 4);
+	ir_bit_emit(b, 0xD, 4);
+
+	ir_bit_enter_block(b, irBcBlock_Identification, 5);
+	ir_bit_emit_record_string(b, 1, str_lit("Odin"));
+	u64 epoch = 0;
+	ir_bit_emit_record(b, 2, &epoch, 1);
+	ir_bit_exit_block(b);
+
+	for_array(i, w->types) {
+		ir_bc_number_type(w, cast(i32)i);
+	}
+
+	ir_bit_enter_block(b, irBcBlock_Module, 3);
+	u64 version = 2;
+	ir_bit_emit_record(b, irBcModule_Version, &version, 1);
+
+	ir_bc_emit_block_info(w, b);
+	ir_bc_emit_type_table(w, b);
+	ir_bc_emit_attributes(w, b);
+
+	String triple = {};
+	String datalayout = {};
+	ir_target_triple_and_datalayout(&triple, &datalayout);
+	if (triple.len > 0) {
+		ir_bit_emit_record_string(b, irBcModule_Triple, triple);
+	}
+	if (datalayout.len > 0) {
+		ir_bit_emit_record_string(b, irBcModule_Datalayout, datalayout);
+	}
+
+	irBcValueIds ids = {};
+	ids.globals = 0;
+	ids.functions = ids.globals + w->globals.count;
+	ids.consts = ids.functions + w->functions.count;
+
+	Array<u8> strtab = {};
+	array_init(&strtab, heap_allocator());
+	defer (array_free(&strtab));
+
+	auto ops = array_make<u64>(heap_allocator(), 0, 32);
+	defer (array_free(&ops));
+	for_array(i, w->globals) {
+		irBcGlobal *g = &w->globals[i];
+		irValueGlobal *vg = &g->value->Global;
+		bool declaration_only = g->is_other_unit;
+
+		u64 linkage = 0;
+		u64 visibility = 0;
+		if (g->is_definition) {
+			if (w->is_split && (vg->is_private || vg->is_internal)) {
+				// NOTE: Other codegen units may refer to it, so it stays external but hidden outside the program
+				visibility = 1;
+			} else if (vg->is_private) {
+				linkage = 9;
+			} else if (vg->is_internal) {
+				linkage = 3;
+			}
+		}
+		u64 thread_local_mode = 0;
+		if (vg->thread_local_model.len > 0) {
+			String model = vg->thread_local_model;
+			if (model == "default")            thread_local_mode = 1;
+			else if (model == "localdynamic")  thread_local_mode = 2;
+			else if (model == "initialexec")   thread_local_mode = 3;
+			else if (model == "localexec")     thread_local_mode = 4;
+			else GB_PANIC("Unknown thread local model '%.*s'", LIT(model));
+		}
+
+		array_clear(&ops);
+		array_add(&ops, ir_bc_strtab_add(&strtab, g->name));
+		array_add(&ops, cast(u64)g->name.len);
+		array_add(&ops, ir_bc_type_id(w, g->type));
+		array_add(&ops, cast(u64)(vg->is_constant ? 1 : 0) | 2); // NOTE: The explicit type flag
+		array_add(&ops, g->is_definition ? ir_bc_value_id(w, &ids, g->init)+1 : 0);
+		array_add(&ops, linkage);
+		array_add(&ops, cast(u64)0); // NOTE: Alignment
+		array_add(&ops, cast(u64)0); // NOTE: Section
+		array_add(&ops, visibility);
+		array_add(&ops, thread_local_mode);
+		array_add(&ops, cast(u64)(vg->is_unnamed_addr && !declaration_only ? 1 : 0));
+		array_add(&ops, cast(u64)0); // NOTE: Externally initialized
+		array_add(&ops, cast(u64)(build_context.is_dll && !declaration_only && vg->is_export ? 2 : 0));
+		array_add(&ops, cast(u64)0); // NOTE: Comdat
+		array_add(&ops, cast(u64)0); // NOTE: Attributes
+		array_add(&ops, cast(u64)0); // NOTE: Preemption specifier
+		ir_bit_emit_record(b, irBcModule_GlobalVar, ops.data, ops.count);
+	}
+
+	for_array(i, w->functions) {
+		irBcFunction *fn = &w->functions[i];
+		array_clear(&ops);
+		array_add(&ops, ir_bc_strtab_add(&strtab, fn->name));
+		array_add(&ops, cast(u64)fn->name.len);
+		array_add(&ops, ir_bc_type_id(w, fn->type));
+		array_add(&ops, cast(u64)fn->cc);
+		array_add(&ops, cast(u64)(fn->is_definition ? 0 : 1));
+		array_add(&ops, cast(u64)0); // NOTE: External linkage
+		array_add(&ops, cast(u64)fn->attrs);
+		array_add(&ops, cast(u64)0); // NOTE: Alignment
+		array_add(&ops, cast(u64)0); // NOTE: Section
+		array_add(&ops, cast(u64)0); // NOTE: Visibility
+		array_add(&ops, cast(u64)0); // NOTE: GC
+		array_add(&ops, cast(u64)0); // NOTE: unnamed_addr
+		array_add(&ops, cast(u64)0); // NOTE: Prologue data
+		array_add(&ops, cast(u64)(fn->is_dllexport ? 2 : 0));
+		array_add(&ops, cast(u64)0); // NOTE: Comdat
+		array_add(&ops, cast(u64)0); // NOTE: Prefix data
+		array_add(&ops, cast(u64)0); // NOTE: Personality
+		array_add(&ops, cast(u64)0); // NOTE: Preemption specifier
+		ir_bit_emit_record(b, irBcModule_Function, ops.data, ops.count);
+	}
+
+	ir_bc_emit_constants(w, b, &ids);
+
+	for_array(i, w->functions) {
+		irBcFunction *fn = &w->functions[i];
+		if (fn->is_definition) {
+			ir_bc_emit_function_body(w, b, fn, ids);
+		}
+	}
+
+	ir_bit_exit_block(b);
+
+	ir_bit_enter_block(b, irBcBlock_Strtab, 3);
+	irBcAbbrev blob_abbrev = ir_bc_abbrev(4, ir_bc_op_literal(1), ir_bc_op_blob());
+	ir_bit_define_abbrev(b, &blob_abbrev);
+	ir_bit_emit(b, blob_abbrev.id, b->abbrev_width);
+	ir_bit_emit_vbr(b, strtab.count, 6);
+	ir_bit_align32(b);
+	for_array(i, strtab) {
+		ir_bit_emit(b, strtab[i], 8);
+	}
+	ir_bit_align32(b);
+	ir_bit_exit_block(b);
+}
+
+
+////////////////////////////////////////////////////////////////
+//
+// Codegen units
+//
+////////////////////////////////////////////////////////////////
+
+void ir_bc_writer_init(irBcWriter *w, irModule *m, bool is_split) {
+	w->m = m;
+	w->is_split = is_split;
+	arena_init(&w->arena, heap_allocator(), 1<<20);
+	w->allocator = arena_allocator(&w->arena);
+
+	gbAllocator ha = heap_allocator();
+	array_init(&w->text_data, ha, 0, 1<<16);
+	ir_file_buffer_init(&w->text, nullptr, &w->text_data);
+	array_init(&w->name_data, ha);
+	array_init(&w->key_data, ha);
+	array_init(&w->type_stack, ha);
+	array_init(&w->op_stack, ha);
+	array_init(&w->record, ha);
+
+	array_init(&w->types, ha);
+	array_init(&w->type_fields, ha);
+	array_init(&w->type_order, ha);
+	map_init(&w->type_map, ha);
+	map_init(&w->type_cache, ha);
+	map_init(&w->named_types, ha);
+	map_init(&w->builtin_type_defs, ha);
+	map_init(&w->type_names, ha);
+
+	array_init(&w->consts, ha);
+	array_init(&w->const_ops, ha);
+	map_init(&w->const_map, ha);
+
+	array_init(&w->globals, ha);
+	array_init(&w->functions, ha);
+	map_init(&w->value_map, ha);
+	map_init(&w->module_names, ha);
+
+	array_init(&w->attr_scratch, ha);
+	array_init(&w->attrs, ha);
+	array_init(&w->attr_groups, ha);
+	map_init(&w->attr_group_map, ha);
+	array_init(&w->attr_list_groups, ha);
+	array_init(&w->attr_lists, ha);
+	map_init(&w->attr_list_map, ha);
+
+	w->t_void = ir_bc_type_simple(w, irBcType_Void);
+	w->t_i1   = ir_bc_type_integer(w, 1);
+	w->t_i32  = ir_bc_type_integer(w, 32);
+
+	// NOTE: The definitions of the builtin named types are kept as text, and parsed when they are used
+	isize start = w->text_data.count;
+	ir_print_builtin_type_names(&w->text, m);
+	String defs = ir_bc_copy_string(w, make_string(w->text_data.data + start, w->text_data.count - start));
+	w->text_data.count = start;
+	while (defs.len > 0) {
+		isize line_end = 0;
+		while (line_end < defs.len && defs[line_end] != '\n') {
+			line_end += 1;
+		}
+		String line = substring(defs, 0, line_end);
+		defs = substring(defs, gb_min(line_end+1, defs.len), defs.len);
+
+		isize eq = 0;
+		while (eq < line.len && line[eq] != '=') {
+			eq += 1;
+		}
+		GB_ASSERT(line.len > 1 && line[0] == '%' && eq > 0);
+		String name = string_trim_whitespace(substring(line, 1, eq));
+		String def = substring(line, eq+1, line.len);
+		GB_ASSERT(string_starts_with(string_trim_whitespace(def), str_lit("type ")));
+		def = string_trim_whitespace(def);
+		def = substring(def, 5, def.len);
+		map_set(&w->builtin_type_defs, hash_string(name), def);
+	}
+
+	for_array(i, m->members.entries) {
+		irValue *v = m->members.entries[i].value;
+		if (v->kind == irValue_TypeName) {
+			map_set(&w->type_names, hash_string(v->TypeName.name), v);
+		}
+	}
+}
+
+void ir_bc_writer_destroy(irBcWriter *w) {
+	for_array(i, w->functions) {
+		irBcFunctionBody *body = w->functions[i].body;
+		if (body != nullptr) {
+			array_free(&body->records);
+			array_free(&body->value_types);
+			array_free(&body->arg_names);
+			array_free(&body->param_args);
+		}
+	}
+
+	array_free(&w->text_data);
+	array_free(&w->name_data);
+	array_free(&w->key_data);
+	array_free(&w->type_stack);
+	array_free(&w->op_stack);
+	array_free(&w->record);
+
+	array_free(&w->types);
+	array_free(&w->type_fields);
+	array_free(&w->type_order);
+	map_destroy(&w->type_map);
+	map_destroy(&w->type_cache);
+	map_destroy(&w->named_types);
+	map_destroy(&w->builtin_type_defs);
+	map_destroy(&w->type_names);
+
+	array_free(&w->consts);
+	array_free(&w->const_ops);
+	map_destroy(&w->const_map);
+
+	array_free(&w->globals);
+	array_free(&w->functions);
+	map_destroy(&w->value_map);
+	map_destroy(&w->module_names);
+
+	array_free(&w->attr_scratch);
+	array_free(&w->attrs);
+	array_free(&w->attr_groups);
+	map_destroy(&w->attr_group_map);
+	array_free(&w->attr_list_groups);
+	array_free(&w->attr_lists);
+	map_destroy(&w->attr_list_map);
+
+	arena_free_all(&w->arena);
+}
+
+// NOTE: Defines and declares what 'ir_print_codegen_unit' would for the unit, though only the declarations
+// the unit refers to are written
+void ir_write_codegen_unit_bitcode(irGen *ir, isize unit_index, Array<isize> *member_units) {
+	irModule *m = &ir->module;
+	irCodegenUnit *unit = &ir->units[unit_index];
+
+	irBcWriter writer = {}, *w = &writer;
+	ir_bc_writer_init(w, m, ir->units.count > 1);
+	defer (ir_bc_writer_destroy(w));
+
+	for_array(member_index, m->members.entries) {
+		irValue *v = m->members.entries[member_index].value;
+		if (v->kind == irValue_Proc && v->Proc.body == nullptr) {
+			ir_bc_add_proc_tree(w, &v->Proc, false);
+		}
+	}
+	if (ir->print_chkstk && unit_index == 0) {
+		ir_bc_add_chkstk(w);
+	}
+	isize member_count = m->members.entries.count;
+	for (isize member_index = 0; member_index < member_count; member_index++) {
+		irValue *v = m->members.entries[member_index].value;
+		if (v->kind == irValue_Proc && v->Proc.body != nullptr && (*member_units)[member_index] == unit_index) {
+			ir_bc_add_proc_tree(w, &v->Proc, true);
+		}
+	}
+
+	for (isize member_index = 0; member_index < member_count; member_index++) {
+		irValue *v = m->members.entries[member_index].value;
+		if (v->kind == irValue_Proc && v->Proc.body != nullptr && (*member_units)[member_index] == unit_index) {
+			// NOTE: The same names for the constant slices as 'ir_print_procs' gives them
+			w->text.printing_proc = &v->Proc;
+			w->text.constant_slice_count = 0;
+			ir_bc_lower_proc(w, &v->Proc);
+		}
+	}
+	w->text.printing_proc = nullptr;
+
+	for_array(member_index, m->members.entries) {
+		irValue *v = m->members.entries[member_index].value;
+		if (member_index >= member_units->count) {
+			// NOTE: String literals are added while lowering, and are defined by the unit which added them
+			array_add(member_units, unit_index);
+		}
+		if (v->kind != irValue_Global) {
+			continue;
+		}
+		if (v->Global.is_foreign || (*member_units)[member_index] == unit_index) {
+			ir_bc_define_global(w, v);
+		}
+	}
+
+	if (build_context.llvm_in_process) {
+		ir_bc_emit_module(w, &unit->output_memory);
+	} else {
+		auto out = array_make<u8>(heap_allocator(), 0, 1<<20);
+		defer (array_free(&out));
+		ir_bc_emit_module(w, &out);
+		gb_file_write(&unit->output_file, out.data, out.count);
+	}
+}
+
+void write_llvm_bitcode(irGen *ir) {
+	auto member_units = array_make<isize>(heap_allocator());
+	defer (array_free(&member_units));
+	ir_assign_codegen_units(ir, &member_units);
+
+	for_array(i, ir->units) {
+		ir_write_codegen_unit_bitcode(ir, i, &member_units);
+	}
+}
@@ -1,46 +1,80 @@
 #define IR_FILE_BUFFER_BUF_LEN (4096)
+#define IR_FILE_BUFFER_INIT_CAP (1<<20)
+#define IR_FILE_BUFFER_FLUSH_LEN (64<<20) // NOTE: Only when printing to a file
 
 struct irFileBuffer {
-	gbVirtualMemory vm;
-	isize           offset;
+	Array<u8>       data;          // NOTE: Grows as needed, unused when 'output_memory' is set
+	Array<u8> *     out;           // NOTE: Either 'data' or 'output_memory'
 	gbFile *        output;
+	Array<u8> *     output_memory; // NOTE: Used instead of 'output' when set
+	StringSet *     referenced;    // NOTE: When set, collects the names of the procedures and globals the printed code refers to
+
+	// NOTE: Set while printing the procedures, see 'ir_print_procs'
+	Array<irValue *> *printed_globals; // The globals created or looked up while printing, in order
+	irProcedure *     printing_proc;   // Names the constant slices created while it is printed
+	isize             constant_slice_count;
+
 	char            buf[IR_FILE_BUFFER_BUF_LEN];
 };
 
-void ir_file_buffer_init(irFileBuffer *f, gbFile *output) {
-	isize size = 8*gb_virtual_memory_page_size(nullptr);
-	f->vm = gb_vm_alloc(nullptr, size);
-	f->offset = 0;
+void ir_file_buffer_init(irFileBuffer *f, gbFile *output, Array<u8> *output_memory = nullptr) {
 	f->output = output;
+	f->output_memory = output_memory;
+	if (output_memory != nullptr) {
+		f->out = output_memory;
+	} else {
+		array_init(&f->data, heap_allocator(), 0, IR_FILE_BUFFER_INIT_CAP);
+		f->out = &f->data;
+	}
 }
 
-void ir_file_buffer_destroy(irFileBuffer *f) {
-	if (f->offset > 0) {
-		// NOTE(bill): finish writing buffered data
-		gb_file_write(f->output, f->vm.data, f->offset);
+void ir_file_buffer_add_reference(irFileBuffer *f, String const &name) {
+	if (f->referenced != nullptr) {
+		string_set_add(f->referenced, name);
 	}
+}
 
-	gb_vm_free(f->vm);
+void ir_file_buffer_flush(irFileBuffer *f) {
+	if (f->output_memory == nullptr && f->data.count > 0) {
+		gb_file_write(f->output, f->data.data, f->data.count);
+		array_clear(&f->data);
+	}
 }
 
-void ir_file_buffer_write(irFileBuffer *f, void const *data, isize len) {
-	if (len > f->vm.size) {
-		//NOTE(thebirk): Flush the vm data before we print this directly
-		//               otherwise we get out of order printing which is no good
-		gb_file_write(f->output, f->vm.data, f->offset);
-		f->offset = 0;
+void ir_file_buffer_destroy(irFileBuffer *f) {
+	ir_file_buffer_flush(f);
+	if (f->output_memory == nullptr) {
+		array_free(&f->data);
+	}
+}
 
-		gb_file_write(f->output, data, len);
-		return;
+void ir_file_buffer_grow(irFileBuffer *f, isize len) {
+	if (f->output_memory == nullptr && f->data.count >= IR_FILE_BUFFER_FLUSH_LEN) {
+		ir_file_buffer_flush(f);
+	}
+	Array<u8> *out = f->out;
+	if (out->count + len > out->capacity) {
+		array_set_capacity(out, gb_max(2*out->capacity, out->count + len));
 	}
+}
 
-	if ((f->vm.size - f->offset) < len) {
-		gb_file_write(f->output, f->vm.data, f->offset);
-		f->offset = 0;
+// NOTE: Makes room for 'len' bytes and returns where they go, the caller must then call 'ir_file_buffer_commit'
+gb_inline u8 *ir_file_buffer_reserve(irFileBuffer *f, isize len) {
+	Array<u8> *out = f->out;
+	if (out->count + len > out->capacity) {
+		ir_file_buffer_grow(f, len);
 	}
-	u8 *cursor = cast(u8 *)f->vm.data + f->offset;
+	return out->data + out->count;
+}
+
+gb_inline void ir_file_buffer_commit(irFileBuffer *f, isize len) {
+	f->out->count += len;
+}
+
+gb_inline void ir_file_buffer_write(irFileBuffer *f, void const *data, isize len) {
+	u8 *cursor = ir_file_buffer_reserve(f, len);
 	gb_memmove(cursor, data, len);
-	f->offset += len;
+	ir_file_buffer_commit(f, len);
 }
 
 
@@ -51,7 +85,7 @@ void ir_fprintf(irFileBuffer *f, char const *fmt, ...) {
 	ir_file_buffer_write(f, f->buf, len-1);
 	va_end(va);
 }
-void ir_write_string(irFileBuffer *f, String s) {
+gb_inline void ir_write_string(irFileBuffer *f, String s) {
 	ir_file_buffer_write(f, s.text, s.len);
 }
 
@@ -63,16 +97,50 @@ void ir_write_str_lit(irFileBuffer *f, char const *s) {
 	ir_file_buffer_write(f, s, len);
 }
 #endif
-void ir_write_byte(irFileBuffer *f, u8 c) {
-	ir_file_buffer_write(f, &c, 1);
+gb_inline void ir_write_byte(irFileBuffer *f, u8 c) {
+	u8 *cursor = ir_file_buffer_reserve(f, 1);
+	*cursor = c;
+	ir_file_buffer_commit(f, 1);
+}
+void ir_write_u64(irFileBuffer *f, u64 i) {
+	u8 digits[20];
+	isize n = 0;
+	do {
+		digits[gb_size_of(digits)-1-n] = cast(u8)('0' + i%10);
+		i /= 10;
+		n += 1;
+	} while (i != 0);
+	ir_file_buffer_write(f, digits+gb_size_of(digits)-n, n);
 }
 void ir_write_i64(irFileBuffer *f, i64 i) {
-	String str = i64_to_string(i, f->buf, IR_FILE_BUFFER_BUF_LEN-1);
-	ir_write_string(f, str);
+	if (i < 0) {
+		ir_write_byte(f, '-');
+		ir_write_u64(f, 0ull - cast(u64)i);
+	} else {
+		ir_write_u64(f, cast(u64)i);
+	}
 }
-void ir_write_u64(irFileBuffer *f, u64 i) {
-	String str = u64_to_string(i, f->buf, IR_FILE_BUFFER_BUF_LEN-1);
-	ir_write_string(f, str);
+// NOTE: As "0x%016llx", the form LLVM uses for floating point constants
+void ir_write_hex_u64(irFileBuffer *f, u64 i) {
+	char const hex_table[] = "0123456789abcdef";
+	u8 *cursor = ir_file_buffer_reserve(f, 18);
+	cursor[0] = '0';
+	cursor[1] = 'x';
+	for (isize j = 0; j < 16; j++) {
+		cursor[17-j] = hex_table[i & 0xf];
+		i >>= 4;
+	}
+	ir_file_buffer_commit(f, 18);
+}
+// NOTE: An unnamed value, "%<index>"
+void ir_write_register(irFileBuffer *f, i32 index) {
+	ir_write_byte(f, '%');
+	ir_write_i64(f, index);
+}
+// NOTE: "%<index> = ", which starts most instructions
+void ir_write_register_assign(irFileBuffer *f, i32 index) {
+	ir_write_register(f, index);
+	ir_write_str_lit(f, " = ");
 }
 void ir_write_big_int(irFileBuffer *f, BigInt const &x, Type *type, bool swap_endian) {
 	if (x.len == 2) {
@@ -115,6 +183,66 @@ void ir_file_write(irFileBuffer *f, void *data, isize len) {
 }
 
 
+// NOTE: Procedures may be printed concurrently, so everything printing adds to the module goes through
+// these and takes 'm->print_mutex'
+irValue *ir_print_add_global_string_array(irFileBuffer *f, irModule *m, String str) {
+	gb_mutex_lock(&m->print_mutex);
+	defer (gb_mutex_unlock(&m->print_mutex));
+
+	irValue *g = ir_add_global_string_array(m, str);
+	if (f->printed_globals != nullptr) {
+		array_add(f->printed_globals, g);
+	}
+	return g;
+}
+
+irValue *ir_print_add_module_constant(irFileBuffer *f, irModule *m, Type *type, ExactValue value) {
+	gb_mutex_lock(&m->print_mutex);
+	defer (gb_mutex_unlock(&m->print_mutex));
+
+	String backing_name = {};
+	if (f->printing_proc != nullptr) {
+		// NOTE: Named after the procedure rather than a module wide counter, so that the name does not depend
+		// on which procedures were printed before it
+		u64 name_hash = fnv64a(f->printing_proc->name.text, f->printing_proc->name.len);
+		isize max_len = 5+16+1+20+1;
+		u8 *str = cast(u8 *)gb_alloc_array(ir_allocator(), u8, max_len);
+		for (;;) {
+			isize len = gb_snprintf(cast(char *)str, max_len, "csba$%llx.%td", cast(unsigned long long)name_hash, f->constant_slice_count);
+			backing_name = make_string(str, len-1);
+			if (map_get(&m->members, hash_string(backing_name)) == nullptr) {
+				break;
+			}
+			name_hash += 1;
+		}
+		f->constant_slice_count += 1;
+	}
+
+	isize member_count = m->members.entries.count;
+	irValue *v = ir_add_module_constant(m, type, value, backing_name);
+	if (f->printed_globals != nullptr && v->kind == irValue_ConstantSlice && m->members.entries.count > member_count) {
+		array_add(f->printed_globals, v->ConstantSlice.backing_array);
+	}
+	return v;
+}
+
+irValue **ir_print_find_value(irModule *m, Entity *e) {
+	gb_mutex_lock(&m->print_mutex);
+	defer (gb_mutex_unlock(&m->print_mutex));
+	return map_get(&m->values, hash_entity(e));
+}
+
+void ir_print_set_procedure_abi_types(irModule *m, Type *type) {
+	Type *bt = base_type(type);
+	if (bt->kind != Type_Proc || bt->Proc.abi_types_set) {
+		return;
+	}
+	gb_mutex_lock(&m->print_mutex);
+	defer (gb_mutex_unlock(&m->print_mutex));
+	set_procedure_abi_types(heap_allocator(), type);
+}
+
+
 bool ir_valid_char(u8 c) {
 	if (c >= 0x80) {
 		return false;
@@ -152,9 +280,8 @@ void ir_print_escape_string(irFileBuffer *f, String name, bool print_quotes, boo
 	char const hex_table[] = "0123456789ABCDEF";
 	isize buf_len = name.len + extra + 2 + 1;
 
-	gbTempArenaMemory tmp = gb_temp_arena_memory_begin(&string_buffer_arena);
-
-	u8 *buf = gb_alloc_array(string_buffer_allocator, u8, buf_len);
+	// NOTE: Escaped straight into the buffer
+	u8 *buf = ir_file_buffer_reserve(f, buf_len);
 
 	isize j = 0;
 
@@ -182,9 +309,7 @@ void ir_print_escape_string(irFileBuffer *f, String name, bool print_quotes, boo
 		buf[j++] = '"';
 	}
 
-	ir_file_write(f, buf, j);
-
-	gb_temp_arena_memory_end(tmp);
+	ir_file_buffer_commit(f, j);
 }
 
 
@@ -206,9 +331,7 @@ void ir_print_escape_path(irFileBuffer *f, String path) {
 	char hex_table[] = "0123456789ABCDEF";
 	isize buf_len = path.len + extra + 2 + 1;
 
-	gbTempArenaMemory tmp = gb_temp_arena_memory_begin(&string_buffer_arena);
-
-	u8 *buf = gb_alloc_array(string_buffer_allocator, u8, buf_len);
+	u8 *buf = ir_file_buffer_reserve(f, buf_len);
 
 	isize j = 0;
 
@@ -226,9 +349,7 @@ void ir_print_escape_path(irFileBuffer *f, String path) {
 		}
 	}
 
-	ir_file_write(f, buf, j);
-
-	gb_temp_arena_memory_end(tmp);
+	ir_file_buffer_commit(f, j);
 }
 
 
@@ -296,7 +417,7 @@ void ir_print_alignment_prefix_hack(irFileBuffer *f, i64 alignment) {
 
 
 void ir_print_proc_results(irFileBuffer *f, irModule *m, Type *t) {
-	set_procedure_abi_types(heap_allocator(), t);
+	ir_print_set_procedure_abi_types(m, t);
 
 	GB_ASSERT(is_type_proc(t));
 	t = base_type(t);
@@ -325,7 +446,7 @@ void ir_print_proc_results(irFileBuffer *f, irModule *m, Type *t) {
 
 
 void ir_print_proc_type_without_pointer(irFileBuffer *f, irModule *m, Type *t) {
-	set_procedure_abi_types(heap_allocator(), t);
+	ir_print_set_procedure_abi_types(m, t);
 
 	i64 word_bits = 8*build_context.word_size;
 	t = base_type(t);
@@ -338,7 +459,7 @@ void ir_print_proc_type_without_pointer(irFileBuffer *f, irModule *m, Type *t) {
 	ir_write_string(f, str_lit(" ("));
 	if (t->Proc.return_by_pointer) {
 		ir_print_type(f, m, reduce_tuple_to_single_type(t->Proc.results));
-		// ir_fprintf(f, "* sret noalias ");
+		// ir_write_str_lit(f, "* sret noalias ");
 		// ir_write_string(f, str_lit("* noalias "));
 		ir_write_string(f, str_lit("*"));
 		if (param_count > 0 || t->Proc.calling_convention == ProcCC_Odin)  {
@@ -521,10 +642,12 @@ void ir_print_type(irFileBuffer *f, irModule *m, Type *t, bool in_struct) {
 			ir_write_byte(f, '{');
 			ir_print_alignment_prefix_hack(f, align);
 			if (is_type_union_maybe_pointer(t)) {
-				ir_fprintf(f, ", ");
+				ir_write_str_lit(f, ", ");
 				ir_print_type(f, m, t->Union.variants[0]);
 			} else {
-				ir_fprintf(f, ", [%lld x i8], ", block_size);
+				ir_write_str_lit(f, ", [");
+				ir_write_i64(f, block_size);
+				ir_write_str_lit(f, " x i8], ");
 				ir_print_type(f, m, union_tag_type(t));
 			}
 			ir_write_byte(f, '}');
@@ -539,7 +662,9 @@ void ir_print_type(irFileBuffer *f, irModule *m, Type *t, bool in_struct) {
 			i64 align_of_union = type_align_of(t);
 			ir_write_byte(f, '{');
 			ir_print_alignment_prefix_hack(f, align_of_union);
-			ir_fprintf(f, ", [%lld x i8]}", size_of_union);
+			ir_write_str_lit(f, ", [");
+			ir_write_i64(f, size_of_union);
+			ir_write_str_lit(f, " x i8]}");
 			return;
 		} else {
 			if (t->Struct.is_packed) {
@@ -579,6 +704,7 @@ void ir_print_type(irFileBuffer *f, irModule *m, Type *t, bool in_struct) {
 			String name = e->TypeName.ir_mangled_name;
 			if (name.len > 0) {
 				ir_print_encoded_local(f, name);
+				ir_file_buffer_add_reference(f, name);
 			} else {
 				// TODO(bill): Is this correct behaviour?!
 				// GB_ASSERT_MSG(name.len > 0, "%.*s %p", LIT(t->Named.name), e);
@@ -628,7 +754,9 @@ void ir_print_type(irFileBuffer *f, irModule *m, Type *t, bool in_struct) {
 		i64 size  = type_size_of(t);
 		ir_write_string(f, str_lit("<{"));
 		ir_print_alignment_prefix_hack(f, align);
-		ir_fprintf(f, ", [%lld x i8]}>", size);
+		ir_write_str_lit(f, ", [");
+		ir_write_i64(f, size);
+		ir_write_str_lit(f, " x i8]}>");
 		break;
 	}
 
@@ -650,7 +778,9 @@ void ir_print_type(irFileBuffer *f, irModule *m, Type *t, bool in_struct) {
 		if (t->SimdVector.is_x86_mmx) {
 			ir_write_str_lit(f, "x86_mmx");
 		} else {
-			ir_fprintf(f, "<%lld x ", t->SimdVector.count);;
+			ir_write_byte(f, '<');
+			ir_write_i64(f, t->SimdVector.count);
+			ir_write_str_lit(f, " x ");
 			ir_print_type(f, m, t->SimdVector.elem);
 			ir_write_byte(f, '>');
 		}
@@ -695,7 +825,7 @@ void ir_print_compound_element(irFileBuffer *f, irModule *m, ExactValue v, Type
 	ir_write_byte(f, ' ');
 
 	if (v.kind == ExactValue_Invalid || !elem_type_can_be_constant(elem_type)) {
-		ir_fprintf(f, "zeroinitializer");
+		ir_write_str_lit(f, "zeroinitializer");
 	} else {
 		ir_print_exact_value(f, m, v, elem_type);
 	}
@@ -756,18 +886,21 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 			break;
 		}
 		if (is_type_u8_slice(type)) {
-			irValue *str_array = ir_add_global_string_array(m, str);
+			irValue *str_array = ir_print_add_global_string_array(f, m, str);
 			ir_write_str_lit(f, "{i8* getelementptr inbounds (");
 			ir_print_type(f, m, str_array->Global.entity->type);
 			ir_write_str_lit(f, ", ");
 			ir_print_type(f, m, str_array->Global.entity->type);
 			ir_write_str_lit(f, "* ");
+			ir_file_buffer_add_reference(f, str_array->Global.entity->token.string);
 			ir_print_encoded_global(f, str_array->Global.entity->token.string, false);
 			ir_write_str_lit(f, ", ");
 			ir_print_type(f, m, t_i32);
 			ir_write_str_lit(f, " 0, i32 0), ");
 			ir_print_type(f, m, t_int);
-			ir_fprintf(f, " %lld}", cast(i64)str.len);
+			ir_write_byte(f, ' ');
+			ir_write_i64(f, cast(i64)str.len);
+			ir_write_byte(f, '}');
 		} else if (!is_type_string(type)) {
 			GB_ASSERT(is_type_array(type));
 			ir_write_str_lit(f, "c\"");
@@ -776,12 +909,13 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 		} else if (is_type_cstring(t)) {
 			// HACK NOTE(bill): This is a hack but it works because strings are created at the very end
 			// of the .ll file
-			irValue *str_array = ir_add_global_string_array(m, str);
+			irValue *str_array = ir_print_add_global_string_array(f, m, str);
 			ir_write_str_lit(f, "getelementptr inbounds (");
 			ir_print_type(f, m, str_array->Global.entity->type);
 			ir_write_str_lit(f, ", ");
 			ir_print_type(f, m, str_array->Global.entity->type);
 			ir_write_str_lit(f, "* ");
+			ir_file_buffer_add_reference(f, str_array->Global.entity->token.string);
 			ir_print_encoded_global(f, str_array->Global.entity->token.string, false);
 			ir_write_str_lit(f, ", ");
 			ir_print_type(f, m, t_i32);
@@ -789,18 +923,21 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 		}else {
 			// HACK NOTE(bill): This is a hack but it works because strings are created at the very end
 			// of the .ll file
-			irValue *str_array = ir_add_global_string_array(m, str);
+			irValue *str_array = ir_print_add_global_string_array(f, m, str);
 			ir_write_str_lit(f, "{i8* getelementptr inbounds (");
 			ir_print_type(f, m, str_array->Global.entity->type);
 			ir_write_str_lit(f, ", ");
 			ir_print_type(f, m, str_array->Global.entity->type);
 			ir_write_str_lit(f, "* ");
+			ir_file_buffer_add_reference(f, str_array->Global.entity->token.string);
 			ir_print_encoded_global(f, str_array->Global.entity->token.string, false);
 			ir_write_str_lit(f, ", ");
 			ir_print_type(f, m, t_i32);
 			ir_write_str_lit(f, " 0, i32 0), ");
 			ir_print_type(f, m, t_int);
-			ir_fprintf(f, " %lld}", cast(i64)str.len);
+			ir_write_byte(f, ' ');
+			ir_write_i64(f, cast(i64)str.len);
+			ir_write_byte(f, '}');
 		}
 		break;
 	}
@@ -849,7 +986,7 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 		switch (type->Basic.kind) {
 		case 0: break;
 		default:
-			ir_fprintf(f, "0x%016llx", u);
+			ir_write_hex_u64(f, u);
 			break;
 		}
 	#else
@@ -859,10 +996,10 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 			break;
 		}
 		case Basic_f64:
-			ir_fprintf(f, "0x%016llx", u_64);
+			ir_write_hex_u64(f, u_64);
 			break;
 		default:
-			ir_fprintf(f, "0x%016llx", u_64);
+			ir_write_hex_u64(f, u_64);
 			break;
 		}
 	#endif
@@ -912,7 +1049,9 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 		} else {
 			ir_write_str_lit(f, "inttoptr (");
 			ir_print_type(f, m, t_int);
-			ir_fprintf(f, " %llu to ", cast(u64)cast(uintptr)value.value_pointer);
+			ir_write_byte(f, ' ');
+			ir_write_u64(f, cast(u64)cast(uintptr)value.value_pointer);
+			ir_write_str_lit(f, " to ");
 			ir_print_type(f, m, t_rawptr);
 			ir_write_byte(f, ')');
 		}
@@ -920,7 +1059,7 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 	case ExactValue_Compound: {
 		type = base_type(type);
 		if (is_type_slice(type)) {
-			irValue *s = ir_add_module_constant(m, type, value);
+			irValue *s = ir_print_add_module_constant(f, m, type, value);
 			ir_print_value(f, m, s, type);
 		} else if (is_type_array(type)) {
 			ast_node(cl, CompoundLit, value.value_compound);
@@ -1131,9 +1270,6 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 
 			ir_write_byte(f, '>');
 		} else if (is_type_struct(type)) {
-			gbTempArenaMemory tmp = gb_temp_arena_memory_begin(&m->tmp_arena);
-			defer (gb_temp_arena_memory_end(tmp));
-
 			ast_node(cl, CompoundLit, value.value_compound);
 
 			if (cl->elems.count == 0) {
@@ -1144,8 +1280,10 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 			String tstr = make_string_c(type_to_string(original_type));
 
 			isize value_count = type->Struct.fields.count;
-			ExactValue *values = gb_alloc_array(m->tmp_allocator, ExactValue, value_count);
-			bool *visited = gb_alloc_array(m->tmp_allocator, bool, value_count);
+			ExactValue *values = gb_alloc_array(heap_allocator(), ExactValue, value_count);
+			bool *visited = gb_alloc_array(heap_allocator(), bool, value_count);
+			defer (gb_free(heap_allocator(), values));
+			defer (gb_free(heap_allocator(), visited));
 
 			if (cl->elems.count > 0) {
 				if (cl->elems[0]->kind == Ast_FieldValue) {
@@ -1250,7 +1388,7 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 			GB_ASSERT(expr->kind == Ast_Ident);
 			Entity *e = entity_of_ident(expr);
 			GB_ASSERT(e != nullptr);
-			found = map_get(&m->values, hash_entity(e));
+			found = ir_print_find_value(m, e);
 		}
 		GB_ASSERT(found != nullptr);
 		irValue *val = *found;
@@ -1266,7 +1404,8 @@ void ir_print_exact_value(irFileBuffer *f, irModule *m, ExactValue value, Type *
 void ir_print_block_name(irFileBuffer *f, irBlock *b) {
 	if (b != nullptr) {
 		ir_print_escape_string(f, b->label, false, false);
-		ir_fprintf(f, "-%td", b->index);
+		ir_write_byte(f, '-');
+		ir_write_i64(f, b->index);
 	} else {
 		ir_write_str_lit(f, "<INVALID-BLOCK>");
 	}
@@ -1316,7 +1455,9 @@ void ir_print_value(irFileBuffer *f, irModule *m, irValue *value, Type *type_hin
 			ir_print_value(f, m, cs->backing_array, at);
 			ir_write_str_lit(f, ", i32 0, i32 0), ");
 			ir_print_type(f, m, t_int);
-			ir_fprintf(f, " %lld}", cs->count);
+			ir_write_byte(f, ' ');
+			ir_write_i64(f, cs->count);
+			ir_write_byte(f, '}');
 		}
 		break;
 	}
@@ -1331,6 +1472,7 @@ void ir_print_value(irFileBuffer *f, irModule *m, irValue *value, Type *type_hin
 
 	case irValue_TypeName:
 		ir_print_encoded_local(f, value->TypeName.name);
+		ir_file_buffer_add_reference(f, value->TypeName.name);
 		break;
 	case irValue_Global: {
 		Entity *e = value->Global.entity;
@@ -1340,11 +1482,13 @@ void ir_print_value(irFileBuffer *f, irModule *m, irValue *value, Type *type_hin
 			in_global_scope = (scope->flags & ScopeFlag_Global) != 0;
 		}
 		ir_print_encoded_global(f, ir_get_global_name(m, value), in_global_scope);
+		ir_file_buffer_add_reference(f, ir_get_global_name(m, value));
 		break;
 	}
 	case irValue_Param:
 		if (value->Param.index >= 0) {
-			ir_fprintf(f, "%%_.%d", value->Param.index);
+			ir_write_str_lit(f, "%_.");
+			ir_write_i64(f, value->Param.index);
 		} else {
 			ir_print_encoded_local(f, value->Param.entity->token.string);
 		}
@@ -1371,9 +1515,10 @@ void ir_print_value(irFileBuffer *f, irModule *m, irValue *value, Type *type_hin
 	}
 	case irValue_Proc:
 		ir_print_encoded_global(f, value->Proc.name, ir_print_is_proc_global(m, &value->Proc));
+		ir_file_buffer_add_reference(f, value->Proc.name);
 		break;
 	case irValue_Instr:
-		ir_fprintf(f, "%%%d", value->index);
+		ir_write_register(f, value->index);
 		break;
 	}
 }
@@ -1412,6 +1557,7 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 	}
 
 	case irInstr_StartupRuntime: {
+		ir_file_buffer_add_reference(f, str_lit(IR_STARTUP_RUNTIME_PROC_NAME));
 		ir_write_str_lit(f, "call void ");
 		ir_print_encoded_global(f, str_lit(IR_STARTUP_RUNTIME_PROC_NAME), false);
 		ir_write_str_lit(f, "()");
@@ -1429,9 +1575,11 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		if (align <= 0) {
 			align = type_align_of(type);
 		}
-		ir_fprintf(f, "%%%d = alloca ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "alloca ");
 		ir_print_type(f, m, type);
-		ir_fprintf(f, ", align %lld", align);
+		ir_write_str_lit(f, ", align ");
+		ir_write_i64(f, align);
 		break;
 	}
 
@@ -1444,7 +1592,9 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		ir_print_exact_value(f, m, empty_exact_value, type);
 		ir_write_str_lit(f, ", ");
 		ir_print_type(f, m, type);
-		ir_fprintf(f, "* %%%d, align 1", instr->ZeroInit.address->index);
+		ir_write_str_lit(f, "* ");
+		ir_write_register(f, instr->ZeroInit.address->index);
+		ir_write_str_lit(f, ", align 1");
 		// ir_fprintf(f, "* %%%d", instr->ZeroInit.address->index);
 		break;
 	}
@@ -1468,16 +1618,19 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 
 	case irInstr_Load: {
 		Type *type = instr->Load.type;
-		ir_fprintf(f, "%%%d = load ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "load ");
 		ir_print_type(f, m, type);
 		ir_write_str_lit(f, ", ");
 		ir_print_type(f, m, type);
 		ir_write_str_lit(f, "* ");
 		ir_print_value(f, m, instr->Load.address, type);
 		if (instr->Load.custom_align > 0) {
-			ir_fprintf(f, ", align %lld", instr->Load.custom_align);
+			ir_write_str_lit(f, ", align ");
+			ir_write_i64(f, instr->Load.custom_align);
 		} else {
-			ir_fprintf(f, ", align %lld", type_align_of(type));
+			ir_write_str_lit(f, ", align ");
+			ir_write_i64(f, type_align_of(type));
 		}
 		ir_print_debug_location(f, m, value);
 		break;
@@ -1525,7 +1678,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		default: GB_PANIC("Unknown atomic store"); break;
 		}
 
-		ir_fprintf(f, ", align %lld", type_align_of(type));
+		ir_write_str_lit(f, ", align ");
+		ir_write_i64(f, type_align_of(type));
 
 		ir_print_debug_location(f, m, value);
 		break;
@@ -1533,7 +1687,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 
 	case irInstr_AtomicLoad: {
 		Type *type = instr->AtomicLoad.type;
-		ir_fprintf(f, "%%%d = load atomic ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "load atomic ");
 		ir_print_type(f, m, type);
 		ir_write_str_lit(f, ", ");
 		ir_print_type(f, m, type);
@@ -1541,14 +1696,15 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		ir_print_value(f, m, instr->AtomicLoad.address, type);
 
 		switch (instr->AtomicLoad.id) {
-		case BuiltinProc_atomic_load:           ir_fprintf(f, " seq_cst");   break;
-		case BuiltinProc_atomic_load_acq:       ir_fprintf(f, " acquire");   break;
-		case BuiltinProc_atomic_load_relaxed:   ir_fprintf(f, " monotonic"); break;
-		case BuiltinProc_atomic_load_unordered: ir_fprintf(f, " unordered"); break;
+		case BuiltinProc_atomic_load:           ir_write_str_lit(f, " seq_cst");   break;
+		case BuiltinProc_atomic_load_acq:       ir_write_str_lit(f, " acquire");   break;
+		case BuiltinProc_atomic_load_relaxed:   ir_write_str_lit(f, " monotonic"); break;
+		case BuiltinProc_atomic_load_unordered: ir_write_str_lit(f, " unordered"); break;
 		default: GB_PANIC("Unknown atomic load"); break;
 		}
 
-		ir_fprintf(f, ", align %lld", type_align_of(type));
+		ir_write_str_lit(f, ", align ");
+		ir_write_i64(f, type_align_of(type));
 		ir_print_debug_location(f, m, value);
 		break;
 	}
@@ -1743,7 +1899,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 			break;
 		}
 
-		ir_fprintf(f, "%%%d = cmpxchg ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "cmpxchg ");
 		if (weak) {
 			ir_write_str_lit(f, "weak ");
 		}
@@ -1765,7 +1922,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 
 	case irInstr_ArrayElementPtr: {
 		Type *et = ir_type(instr->ArrayElementPtr.address);
-		ir_fprintf(f, "%%%d = getelementptr inbounds ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "getelementptr inbounds ");
 
 		ir_print_type(f, m, type_deref(et));
 		ir_write_str_lit(f, ", ");
@@ -1784,7 +1942,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 
 	case irInstr_StructElementPtr: {
 		Type *et = ir_type(instr->StructElementPtr.address);
-		ir_fprintf(f, "%%%d = getelementptr inbounds ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "getelementptr inbounds ");
 		i32 index = instr->StructElementPtr.elem_index;
 		Type *st = base_type(type_deref(et));
 		if (is_type_struct(st)) {
@@ -1802,13 +1961,15 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		ir_print_value(f, m, instr->StructElementPtr.address, et);
 		ir_write_str_lit(f, ", i32 0, ");
 		ir_print_type(f, m, t_i32);
-		ir_fprintf(f, " %d", index);
+		ir_write_byte(f, ' ');
+		ir_write_i64(f, index);
 		break;
 	}
 
 	case irInstr_PtrOffset: {
 		Type *pt = ir_type(instr->PtrOffset.address);
-		ir_fprintf(f, "%%%d = getelementptr inbounds ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "getelementptr inbounds ");
 		ir_print_type(f, m, type_deref(pt));
 		ir_write_str_lit(f, ", ");
 		ir_print_type(f, m, pt);
@@ -1825,7 +1986,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 	}
 
 	case irInstr_Phi: {
-		ir_fprintf(f, "%%%d = phi ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "phi ");
 		ir_print_type(f, m, instr->Phi.type);
 		// ir_fprintf(f, " ", value->index);
 		ir_write_byte(f, ' ');
@@ -1853,7 +2015,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 
 	case irInstr_StructExtractValue: {
 		Type *et = ir_type(instr->StructExtractValue.address);
-		ir_fprintf(f, "%%%d = extractvalue ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "extractvalue ");
 		i32 index = instr->StructExtractValue.index;
 		Type *st = base_type(et);
 		if (is_type_struct(st)) {
@@ -1868,7 +2031,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		ir_print_type(f, m, et);
 		ir_write_byte(f, ' ');
 		ir_print_value(f, m, instr->StructExtractValue.address, et);
-		ir_fprintf(f, ", %d", index);
+		ir_write_str_lit(f, ", ");
+		ir_write_i64(f, index);
 		break;
 	}
 
@@ -1880,7 +2044,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 			GB_PANIC("union #maybe UnionTagPtr");
 		}
 
-		ir_fprintf(f, "%%%d = getelementptr inbounds ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "getelementptr inbounds ");
 		Type *t = base_type(type_deref(et));
 		GB_ASSERT(is_type_union(t));
 
@@ -1893,7 +2058,7 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		ir_print_type(f, m, t_int);
 		ir_write_str_lit(f, " 0, ");
 		ir_print_type(f, m, t_i32);
-		ir_fprintf(f, " 2 ; UnionTagPtr");
+		ir_write_str_lit(f, " 2 ; UnionTagPtr");
 		break;
 	}
 
@@ -1905,14 +2070,15 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 			GB_PANIC("union #maybe UnionTagValue");
 		}
 
-		ir_fprintf(f, "%%%d = extractvalue ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "extractvalue ");
 		GB_ASSERT(is_type_union(t));
 
 
 		ir_print_type(f, m, et);
 		ir_write_byte(f, ' ');
 		ir_print_value(f, m, instr->UnionTagValue.address, et);
-		ir_fprintf(f, ", 2 ; UnionTagValue");
+		ir_write_str_lit(f, ", 2 ; UnionTagValue");
 		break;
 	}
 
@@ -1960,7 +2126,7 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 			ir_write_byte(f, ')');
 			ir_print_debug_location(f, m, value);
 		} else {
-			ir_fprintf(f, "%%%d = ", value->index);
+			ir_write_register_assign(f, value->index);
 			ir_write_string(f, ir_conv_strings[c->kind]);
 			ir_write_byte(f, ' ');
 			ir_print_type(f, m, c->from);
@@ -1983,7 +2149,7 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		Type *type =  base_type(ir_type(uo->expr));
 		Type *elem_type = type;
 
-		ir_fprintf(f, "%%%d = ", value->index);
+		ir_write_register_assign(f, value->index);
 		switch (uo->op) {
 		case Token_Sub:
 			if (is_type_float(elem_type)) {
@@ -2030,7 +2196,7 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		Type *type = base_type(ir_type(bo->left));
 		Type *elem_type = base_array_type(type);
 
-		ir_fprintf(f, "%%%d = ", value->index);
+		ir_write_register_assign(f, value->index);
 
 		if (gb_is_between(bo->op, Token__ComparisonBegin+1, Token__ComparisonEnd-1)) {
 			if (is_type_string(elem_type)) {
@@ -2125,12 +2291,12 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 		irInstrCall *call = &instr->Call;
 		Type *proc_type = base_type(ir_type(call->value));
 		GB_ASSERT(is_type_proc(proc_type));
-		set_procedure_abi_types(heap_allocator(), proc_type);
+		ir_print_set_procedure_abi_types(m, proc_type);
 
 		bool is_c_vararg = proc_type->Proc.c_vararg;
 		Type *result_type = call->type;
 		if (result_type) {
-			ir_fprintf(f, "%%%d = ", value->index);
+			ir_write_register_assign(f, value->index);
 		}
 		ir_write_str_lit(f, "call ");
 		ir_print_calling_convention(f, m, proc_type->Proc.calling_convention);
@@ -2274,7 +2440,8 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 	}
 
 	case irInstr_Select: {
-		ir_fprintf(f, "%%%d = select i1 ", value->index);
+		ir_write_register_assign(f, value->index);
+		ir_write_str_lit(f, "select i1 ");
 		ir_print_value(f, m, instr->Select.cond, t_bool);
 		ir_write_string(f, str_lit(", "));
 		ir_print_type(f, m, ir_type(instr->Select.true_value));
@@ -2319,10 +2486,12 @@ void ir_print_instr(irFileBuffer *f, irModule *m, irValue *value) {
 }
 
 
-void ir_print_proc(irFileBuffer *f, irModule *m, irProcedure *proc) {
-	set_procedure_abi_types(heap_allocator(), proc->type);
+// NOTE: With 'declaration_only', procedures with a body are printed as a 'declare', for codegen units which do not define them
+void ir_print_proc(irFileBuffer *f, irModule *m, irProcedure *proc, bool declaration_only=false) {
+	ir_print_set_procedure_abi_types(m, proc->type);
 
-	if (proc->body == nullptr) {
+	bool is_definition = proc->body != nullptr && !declaration_only;
+	if (!is_definition) {
 		ir_write_str_lit(f, "declare ");
 		// if (proc->tags & ProcTag_dll_import) {
 			// ir_write_string(f, "dllimport ");
@@ -2391,8 +2560,9 @@ void ir_print_proc(irFileBuffer *f, irModule *m, irProcedure *proc) {
 							ir_write_str_lit(f, " noalias");
 						}
 
-						if (proc->body != nullptr) {
-							ir_fprintf(f, " %%_.%td", parameter_index+j);
+						if (is_definition) {
+							ir_write_str_lit(f, " %_.");
+							ir_write_i64(f, parameter_index+j);
 						}
 					}
 					parameter_index += abi_type->Tuple.variables.count-1;
@@ -2402,8 +2572,9 @@ void ir_print_proc(irFileBuffer *f, irModule *m, irProcedure *proc) {
 					if (e->flags&EntityFlag_NoAlias) {
 						ir_write_str_lit(f, " noalias");
 					}
-					if (proc->body != nullptr) {
-						ir_fprintf(f, " %%_.%td", parameter_index);
+					if (is_definition) {
+						ir_write_str_lit(f, " %_.");
+						ir_write_i64(f, parameter_index);
 					}
 				}
 			}
@@ -2422,15 +2593,15 @@ void ir_print_proc(irFileBuffer *f, irModule *m, irProcedure *proc) {
 
 	switch (proc->inlining) {
 	default:
-		ir_fprintf(f, "#0 ");
+		ir_write_str_lit(f, "#0 ");
 		break;
 	case ProcInlining_inline:
 		ir_write_str_lit(f, "alwaysinline ");
-		ir_fprintf(f, "#1 ");
+		ir_write_str_lit(f, "#1 ");
 		break;
 	case ProcInlining_no_inline:
 		ir_write_str_lit(f, "noinline ");
-		ir_fprintf(f, "#2 ");
+		ir_write_str_lit(f, "#2 ");
 		break;
 	}
 
@@ -2438,7 +2609,7 @@ void ir_print_proc(irFileBuffer *f, irModule *m, irProcedure *proc) {
 		ir_write_str_lit(f, "noreturn ");
 	}
 
-	if (m->generate_debug_info && proc->entity != nullptr && proc->body != nullptr) {
+	if (m->generate_debug_info && proc->entity != nullptr && is_definition) {
 		irDebugInfo **di_ = map_get(&proc->module->debug_info, hash_pointer(proc->entity));
 		if (di_ != nullptr) {
 			irDebugInfo *di = *di_;
@@ -2449,8 +2620,8 @@ void ir_print_proc(irFileBuffer *f, irModule *m, irProcedure *proc) {
 
 
 
-	if (proc->body != nullptr) {
-		// ir_fprintf(f, "nounwind uwtable {\n");
+	if (is_definition) {
+		// ir_write_str_lit(f, "nounwind uwtable {\n");
 
 		ir_write_str_lit(f, "{\n");
 		for_array(i, proc->blocks) {
@@ -2471,7 +2642,7 @@ void ir_print_proc(irFileBuffer *f, irModule *m, irProcedure *proc) {
 	}
 
 	for_array(i, proc->children) {
-		ir_print_proc(f, m, proc->children[i]);
+		ir_print_proc(f, m, proc->children[i], declaration_only);
 	}
 }
 
@@ -2533,26 +2704,347 @@ bool ir_print_global_type_allowed(Type *t) {
 	return true;
 }
 
-void print_llvm_ir(irGen *ir) {
+// NOTE: Declares 'proc', and its nested procedures, if the printed code refers to them
+void ir_print_referenced_proc_declarations(irFileBuffer *f, irModule *m, irProcedure *proc) {
+	if (string_set_exists(f->referenced, proc->name)) {
+		ir_print_proc(f, m, proc, true);
+		// NOTE: 'ir_print_proc' has declared the nested procedures too
+		return;
+	}
+	for_array(i, proc->children) {
+		ir_print_referenced_proc_declarations(f, m, proc->children[i]);
+	}
+}
+
+// NOTE: When the module is split into several codegen units ('is_split'), globals are defined by the
+// first unit and only declared by the others. Private and internal globals become hidden instead,
+// as they may be referenced from procedures in another unit.
+void ir_print_global(irFileBuffer *f, irModule *m, irValue *v, bool declaration_only, bool is_split) {
+	irValueGlobal *g = &v->Global;
+	Scope *scope = g->entity->scope;
+	bool in_global_scope = false;
+	if (scope != nullptr) {
+		// TODO(bill): Fix this rule. What should it be?
+		in_global_scope = (scope->flags & ScopeFlag_Global) != 0;
+	}
+
+	ir_print_encoded_global(f, ir_get_global_name(m, v), in_global_scope);
+	ir_write_string(f, str_lit(" = "));
+	if (g->is_foreign || declaration_only) {
+		ir_write_string(f, str_lit("external "));
+	}
+	if (build_context.is_dll && !declaration_only) {
+		if (g->is_export) {
+			ir_write_string(f, str_lit("dllexport "));
+		}
+	}
+
+	if (declaration_only) {
+		// NOTE: No linkage, defined in another codegen unit
+	} else if (is_split && (g->is_private || g->is_internal)) {
+		ir_write_string(f, str_lit("hidden "));
+	} else if (g->is_private) {
+		ir_write_string(f, str_lit("private "));
+	} else if (g->is_internal) {
+		ir_write_string(f, str_lit("internal "));
+	}
+	if (g->thread_local_model.len > 0) {
+		String model = g->thread_local_model;
+		if (model == "default") {
+			ir_write_string(f, str_lit("thread_local "));
+		} else {
+			ir_fprintf(f, "thread_local(%.*s) ", LIT(model));
+
+		}
+	}
+	if (g->is_constant) {
+		if (g->is_unnamed_addr && !declaration_only) {
+			ir_write_string(f, str_lit("unnamed_addr "));
+		}
+		ir_write_string(f, str_lit("constant "));
+	} else {
+		ir_write_string(f, str_lit("global "));
+	}
+
+
+	ir_print_type(f, m, g->entity->type);
+	ir_write_byte(f, ' ');
+	if (!g->is_foreign && !declaration_only) {
+		if (g->value != nullptr && ir_print_global_type_allowed(g->entity->type)) {
+			ir_print_value(f, m, g->value, g->entity->type);
+		} else {
+			ir_write_string(f, str_lit("zeroinitializer"));
+		}
+		if (m->generate_debug_info) {
+			irDebugInfo **di_lookup = map_get(&m->debug_info, hash_entity(g->entity));
+			if (di_lookup != nullptr) {
+				irDebugInfo *di = *di_lookup;
+				GB_ASSERT(di);
+				GB_ASSERT(di->kind == irDebugInfo_GlobalVariableExpression);
+				ir_fprintf(f, ", !dbg !%d", di->id);
+			}
+		}
+	}
+	ir_write_byte(f, '\n');
+}
+
+i64 ir_proc_instr_count(irProcedure *proc) {
+	i64 count = 0;
+	for_array(i, proc->blocks) {
+		count += proc->blocks[i]->instrs.count;
+	}
+	for_array(i, proc->children) {
+		count += ir_proc_instr_count(proc->children[i]);
+	}
+	return count;
+}
+
+struct irUnitProc {
+	isize member_index;
+	i64   weight;
+};
+
+GB_COMPARE_PROC(ir_unit_proc_cmp) {
+	irUnitProc const *x = cast(irUnitProc const *)a;
+	irUnitProc const *y = cast(irUnitProc const *)b;
+	if (x->weight != y->weight) {
+		return x->weight > y->weight ? -1 : +1;
+	}
+	return x->member_index < y->member_index ? -1 : +1;
+}
+
+// NOTE: Hashes a procedure's name without the "-<id>" suffixes of polymorphic and nested procedures,
+// as the ids change whenever an entity is added before them
+u64 ir_proc_unit_hash(String name) {
+	u64 h = 0xcbf29ce484222325ull;
+	for (isize i = 0; i < name.len; i++) {
+		if (name[i] == '-' && i+1 < name.len && gb_char_is_digit(name[i+1])) {
+			i += 1;
+			while (i+1 < name.len && gb_char_is_digit(name[i+1])) {
+				i += 1;
+			}
+			continue;
+		}
+		h = (h ^ cast(u64)name[i]) * 0x100000001b3ull;
+	}
+	return h;
+}
+
+// NOTE: Assigns each procedure with a body to a codegen unit, heaviest first to the lightest unit, and
+// the globals to the first unit. 'member_units' is indexed like 'm->members.entries'.
+// With the object cache, a procedure is assigned by its name instead, so that it stays in the same unit
+// from one build to the next and an edit elsewhere does not move it.
+void ir_assign_codegen_units(irGen *ir, Array<isize> *member_units) {
 	irModule *m = &ir->module;
+	array_resize(member_units, m->members.entries.count);
 
-	irFileBuffer buf = {}, *f = &buf;
-	ir_file_buffer_init(f, &ir->output_file);
-	defer (ir_file_buffer_destroy(f));
+	auto procs = array_make<irUnitProc>(heap_allocator(), 0, m->members.entries.count);
+	defer (array_free(&procs));
+
+	i64 global_count = 0;
+	for_array(member_index, m->members.entries) {
+		(*member_units)[member_index] = -1;
+		irValue *v = m->members.entries[member_index].value;
+		if (v->kind == irValue_Global) {
+			(*member_units)[member_index] = 0;
+			global_count += 1;
+		} else if (v->kind == irValue_Proc && v->Proc.body != nullptr) {
+			irUnitProc up = {member_index, ir_proc_instr_count(&v->Proc)};
+			array_add(&procs, up);
+		}
+	}
+	for_array(i, ir->units) {
+		ir->units[i].weight = 0;
+	}
+	// NOTE: The first unit also holds the globals
+	ir->units[0].weight = global_count;
+
+	if (build_context.cache_dir.len > 0) {
+		for_array(i, procs) {
+			irValue *v = m->members.entries[procs[i].member_index].value;
+			isize unit_index = cast(isize)(ir_proc_unit_hash(v->Proc.name) % cast(u64)ir->units.count);
+			(*member_units)[procs[i].member_index] = unit_index;
+			ir->units[unit_index].weight += procs[i].weight;
+		}
+		return;
+	}
+
+	gb_sort_array(procs.data, procs.count, ir_unit_proc_cmp);
+
+	for_array(i, procs) {
+		isize lightest = 0;
+		for_array(j, ir->units) {
+			if (ir->units[j].weight < ir->units[lightest].weight) {
+				lightest = j;
+			}
+		}
+		(*member_units)[procs[i].member_index] = lightest;
+		ir->units[lightest].weight += procs[i].weight;
+	}
+}
+
+#define IR_PRINT_TASKS_PER_THREAD 4
 
+struct irPrintProcsTask {
+	irModule *       module;
+	Array<irValue *> procs;
+	Array<u8>        text;
+	Array<irValue *> printed_globals;
+	StringSet        referenced;
+	bool             collect_references;
+};
+
+WORKER_TASK_PROC(ir_print_procs_worker_proc) {
+	irPrintProcsTask *task = cast(irPrintProcsTask *)data;
+
+	irFileBuffer buf = {};
+	ir_file_buffer_init(&buf, nullptr, &task->text);
+	buf.printed_globals = &task->printed_globals;
+	if (task->collect_references) {
+		buf.referenced = &task->referenced;
+	}
+	for_array(i, task->procs) {
+		irProcedure *proc = &task->procs[i]->Proc;
+		buf.printing_proc = proc;
+		buf.constant_slice_count = 0;
+		u64 trace_start = trace_time_now();
+		ir_print_proc(&buf, task->module, proc);
+		trace_add_event("print proc", proc->name, trace_start);
+	}
+	ir_file_buffer_destroy(&buf);
+	return 0;
+}
+
+// NOTE: The globals printing creates are added to 'm->members' in whichever order the tasks get to them.
+// This puts them back in the order printing the procedures one after another would have added them.
+void ir_print_restore_member_order(irModule *m, isize member_count, Array<irPrintProcsTask> const &tasks) {
+	if (m->members.entries.count == member_count) {
+		return;
+	}
+
+	Map<isize> added = {}; // Key: irValue *
+	map_init(&added, heap_allocator());
+	defer (map_destroy(&added));
+	for (isize i = member_count; i < m->members.entries.count; i++) {
+		map_set(&added, hash_pointer(m->members.entries[i].value), i);
+	}
+
+	Map<irValue *> members = {};
+	map_init(&members, heap_allocator(), m->members.entries.count);
+	for (isize i = 0; i < member_count; i++) {
+		auto *entry = &m->members.entries[i];
+		map_set(&members, entry->key, entry->value);
+	}
+	for_array(i, tasks) {
+		for_array(j, tasks[i].printed_globals) {
+			irValue *g = tasks[i].printed_globals[j];
+			HashKey key = hash_pointer(g);
+			isize *found = map_get(&added, key);
+			if (found != nullptr) {
+				auto *entry = &m->members.entries[*found];
+				map_set(&members, entry->key, entry->value);
+				map_remove(&added, key);
+			}
+		}
+	}
+	GB_ASSERT(members.entries.count == m->members.entries.count);
+
+	map_destroy(&m->members);
+	m->members = members;
+}
+
+// NOTE: Prints the procedures with bodies of a unit on the thread pool, each task into its own buffer.
+// The buffers are written out in order, so the output is the same for any thread count.
+void ir_print_procs(irFileBuffer *f, irModule *m, isize unit_index, Array<isize> *member_units) {
+	auto procs = array_make<irValue *>(heap_allocator(), 0, m->members.entries.count);
+	defer (array_free(&procs));
+	i64 total_weight = 0;
+	for_array(member_index, m->members.entries) {
+		irValue *v = m->members.entries[member_index].value;
+		if (v->kind == irValue_Proc && v->Proc.body != nullptr && (*member_units)[member_index] == unit_index) {
+			array_add(&procs, v);
+			total_weight += ir_proc_instr_count(&v->Proc);
+		}
+	}
+	if (procs.count == 0) {
+		return;
+	}
+
+	// NOTE: Consecutive procedures are grouped into tasks of about the same number of instructions
+	isize thread_count = gb_max(build_context.thread_count, 1);
+	isize task_count = gb_min(procs.count, thread_count*IR_PRINT_TASKS_PER_THREAD);
+	i64 task_weight = gb_max(total_weight/task_count, 1);
+
+	auto tasks = array_make<irPrintProcsTask>(heap_allocator(), 0, task_count);
+	defer (array_free(&tasks));
+	i64 weight = 0;
+	for_array(i, procs) {
+		if (tasks.count == 0 || weight >= task_weight) {
+			irPrintProcsTask task = {};
+			task.module = m;
+			task.collect_references = f->referenced != nullptr;
+			array_init(&task.procs, heap_allocator());
+			array_init(&task.text, heap_allocator());
+			array_init(&task.printed_globals, heap_allocator());
+			if (task.collect_references) {
+				string_set_init(&task.referenced, heap_allocator());
+			}
+			array_add(&tasks, task);
+			weight = 0;
+		}
+		array_add(&tasks[tasks.count-1].procs, procs[i]);
+		weight += ir_proc_instr_count(&procs[i]->Proc);
+	}
+
+	isize member_count = m->members.entries.count;
+	if (thread_count <= 1 || tasks.count <= 1) {
+		for_array(i, tasks) {
+			ir_print_procs_worker_proc(&tasks[i]);
+		}
+	} else {
+		ThreadPool pool = {};
+		thread_pool_init(&pool, heap_allocator(), gb_min(thread_count, tasks.count)-1, "IRPrint");
+		for_array(i, tasks) {
+			thread_pool_add_task(&pool, ir_print_procs_worker_proc, &tasks[i]);
+		}
+		thread_pool_start(&pool);
+		thread_pool_wait_to_process(&pool);
+		thread_pool_destroy(&pool);
+	}
+	ir_print_restore_member_order(m, member_count, tasks);
+
+	for_array(i, tasks) {
+		irPrintProcsTask *task = &tasks[i];
+		ir_file_buffer_write(f, task->text.data, task->text.count);
+		if (task->collect_references) {
+			for_array(j, task->referenced.entries) {
+				string_set_add(f->referenced, task->referenced.entries[j].value);
+			}
+			string_set_destroy(&task->referenced);
+		}
+		array_free(&task->procs);
+		array_free(&task->text);
+		array_free(&task->printed_globals);
+	}
+}
+
+// NOTE: Empty when LLVM's defaults are used
+void ir_target_triple_and_datalayout(String *triple, String *datalayout) {
 	i32 word_bits = cast(i32)(8*build_context.word_size);
 	if (build_context.ODIN_OS == "darwin") {
 		GB_ASSERT(word_bits == 64);
-		ir_write_str_lit(f, "target datalayout = \"e-m:o-i64:64-f80:128-n8:16:32:64-S128\"\n");
-		ir_write_str_lit(f, "target triple = \"x86_64-apple-macosx10.8\"\n");
-		ir_write_str_lit(f, "\n");
+		*datalayout = str_lit("e-m:o-i64:64-f80:128-n8:16:32:64-S128");
+		*triple     = str_lit("x86_64-apple-macosx10.8");
 	} else if (build_context.ODIN_OS == "windows") {
-		ir_fprintf(f, "target triple = \"x86%s-pc-windows-msvc\"\n\n", word_bits == 64 ? "_64" : "");
+		*triple = word_bits == 64 ? str_lit("x86_64-pc-windows-msvc") : str_lit("x86-pc-windows-msvc");
 		if (word_bits == 64 && build_context.metrics.arch == TargetArch_amd64) {
-			ir_fprintf(f, "target datalayout = \"e-m:w-i64:64-f80:128-n8:16:32:64-S128\"\n\n");
+			*datalayout = str_lit("e-m:w-i64:64-f80:128-n8:16:32:64-S128");
 		}
 	}
+}
 
+// NOTE: The named types 'ir_print_type' uses for the basic types, one per line
+void ir_print_builtin_type_names(irFileBuffer *f, irModule *m) {
 	ir_print_encoded_local(f, str_lit("..opaque"));
 	ir_write_str_lit(f, " = type {};\n");
 	ir_print_encoded_local(f, str_lit("..string"));
@@ -2587,6 +3079,43 @@ void print_llvm_ir(irGen *ir) {
 	ir_write_str_lit(f, ", ");
 	ir_print_type(f, m, t_typeid);
 	ir_write_str_lit(f, "} ; Basic_any\n");
+}
+
+void ir_print_codegen_unit(irGen *ir, isize unit_index, Array<isize> *member_units) {
+	irModule *m = &ir->module;
+	irCodegenUnit *unit = &ir->units[unit_index];
+	bool is_split = ir->units.count > 1;
+
+	irFileBuffer buf = {}, *f = &buf;
+	if (build_context.llvm_in_process) {
+		ir_file_buffer_init(&buf, nullptr, &unit->output_memory);
+	} else {
+		ir_file_buffer_init(&buf, &unit->output_file);
+	}
+	defer (ir_file_buffer_destroy(&buf));
+
+	// NOTE: A split unit only prints the named types and declarations it refers to. Its procedures
+	// and globals are printed to 'body' first, as the named types have to come before their uses.
+	StringSet referenced = {};
+	Array<u8> body = {};
+	irFileBuffer body_buf = {};
+	if (is_split) {
+		string_set_init(&referenced, heap_allocator());
+		buf.referenced = &referenced;
+	}
+	defer (string_set_destroy(&referenced));
+
+	String triple = {};
+	String datalayout = {};
+	ir_target_triple_and_datalayout(&triple, &datalayout);
+	if (datalayout.len > 0) {
+		ir_fprintf(f, "target datalayout = \"%.*s\"\n", LIT(datalayout));
+	}
+	if (triple.len > 0) {
+		ir_fprintf(f, "target triple = \"%.*s\"\n\n", LIT(triple));
+	}
+
+	ir_print_builtin_type_names(f, m);
 
 	ir_write_str_lit(f, "declare void @llvm.dbg.declare(metadata, metadata, metadata) #3 \n");
 
@@ -2608,7 +3137,7 @@ void print_llvm_ir(irGen *ir) {
 	for_array(member_index, m->members.entries) {
 		auto *entry = &m->members.entries[member_index];
 		irValue *v = entry->value;
-		if (v->kind != irValue_TypeName) {
+		if (v->kind != irValue_TypeName || is_split) {
 			continue;
 		}
 		ir_print_type_name(f, m, v);
@@ -2616,6 +3145,13 @@ void print_llvm_ir(irGen *ir) {
 
 	ir_write_byte(f, '\n');
 
+	if (is_split) {
+		array_init(&body, heap_allocator());
+		ir_file_buffer_init(&body_buf, nullptr, &body);
+		body_buf.referenced = &referenced;
+		f = &body_buf;
+	}
+
 	bool dll_main_found = false;
 
 	// NOTE(bill): Print foreign prototypes first
@@ -2631,7 +3167,7 @@ void print_llvm_ir(irGen *ir) {
 		}
 	}
 
-	if (ir->print_chkstk) {
+	if (ir->print_chkstk && unit_index == 0) {
 		// TODO(bill): Clean up this code
 		ir_write_str_lit(f, "\n\n");
 		ir_write_str_lit(f, "define void @__chkstk() #0 {\n");
@@ -2641,93 +3177,75 @@ void print_llvm_ir(irGen *ir) {
 	}
 
 	// NOTE(bill): Print procedures with bodies next
-	for_array(member_index, m->members.entries) {
-		auto *entry = &m->members.entries[member_index];
-		irValue *v = entry->value;
-		if (v->kind != irValue_Proc) {
-			continue;
-		}
-
-		if (v->Proc.body != nullptr) {
-			ir_print_proc(f, m, &v->Proc);
-		}
-	}
+	ir_print_procs(f, m, unit_index, member_units);
 
 	for_array(member_index, m->members.entries) {
 		auto *entry = &m->members.entries[member_index];
 		irValue *v = entry->value;
+		if (member_index >= member_units->count) {
+			// NOTE: String literals are added while printing, and are defined by the unit which added them
+			array_add(member_units, unit_index);
+		}
 		if (v->kind != irValue_Global) {
 			continue;
 		}
-		irValueGlobal *g = &v->Global;
-		Scope *scope = g->entity->scope;
-		bool in_global_scope = false;
-		if (scope != nullptr) {
-			// TODO(bill): Fix this rule. What should it be?
-			in_global_scope = (scope->flags & ScopeFlag_Global) != 0;
+		if (v->Global.is_foreign || (*member_units)[member_index] == unit_index) {
+			ir_print_global(f, m, v, false, is_split);
 		}
+	}
 
-		ir_print_encoded_global(f, ir_get_global_name(m, v), in_global_scope);
-		ir_write_string(f, str_lit(" = "));
-		if (g->is_foreign) {
-			ir_write_string(f, str_lit("external "));
-		}
-		if (build_context.is_dll) {
-			if (g->is_export) {
-				ir_write_string(f, str_lit("dllexport "));
+	if (is_split) {
+		// NOTE: Only what this unit refers to is declared, so that its IR, and its object cache
+		// entry, does not change when unrelated procedures are added elsewhere
+		for_array(member_index, m->members.entries) {
+			auto *entry = &m->members.entries[member_index];
+			irValue *v = entry->value;
+			if (v->kind == irValue_Proc) {
+				if (v->Proc.body != nullptr && (*member_units)[member_index] != unit_index) {
+					ir_print_referenced_proc_declarations(f, m, &v->Proc);
+				}
+			} else if (v->kind == irValue_Global) {
+				if (!v->Global.is_foreign && (*member_units)[member_index] != unit_index &&
+				    string_set_exists(f->referenced, ir_get_global_name(m, v))) {
+					ir_print_global(f, m, v, true, is_split);
+				}
 			}
 		}
 
-		if (g->is_private) {
-			ir_write_string(f, str_lit("private "));
-		} else if (g->is_internal) {
-			ir_write_string(f, str_lit("internal "));
-		}
-		if (g->thread_local_model.len > 0) {
-			String model = g->thread_local_model;
-			if (model == "default") {
-				ir_write_string(f, str_lit("thread_local "));
-			} else {
-				ir_fprintf(f, "thread_local(%.*s) ", LIT(model));
+		ir_file_buffer_destroy(&body_buf);
+		f = &buf;
 
+		// NOTE: A named type may use other named types, so this repeats until no more are found
+		auto type_printed = array_make<bool>(heap_allocator(), m->members.entries.count);
+		defer (array_free(&type_printed));
+		for (;;) {
+			bool printed_any = false;
+			for_array(member_index, type_printed) {
+				irValue *v = m->members.entries[member_index].value;
+				if (v->kind != irValue_TypeName || type_printed[member_index]) {
+					continue;
+				}
+				if (string_set_exists(f->referenced, v->TypeName.name)) {
+					ir_print_type_name(f, m, v);
+					type_printed[member_index] = true;
+					printed_any = true;
+				}
 			}
-		}
-		if (g->is_constant) {
-			if (g->is_unnamed_addr) {
-				ir_write_string(f, str_lit("unnamed_addr "));
+			if (!printed_any) {
+				break;
 			}
-			ir_write_string(f, str_lit("constant "));
-		} else {
-			ir_write_string(f, str_lit("global "));
 		}
 
-
-		ir_print_type(f, m, g->entity->type);
-		ir_write_byte(f, ' ');
-		if (!g->is_foreign) {
-			if (g->value != nullptr && ir_print_global_type_allowed(g->entity->type)) {
-				ir_print_value(f, m, g->value, g->entity->type);
-			} else {
-				ir_write_string(f, str_lit("zeroinitializer"));
-			}
-			if (m->generate_debug_info) {
-				irDebugInfo **di_lookup = map_get(&m->debug_info, hash_entity(g->entity));
-				if (di_lookup != nullptr) {
-					irDebugInfo *di = *di_lookup;
-					GB_ASSERT(di);
-					GB_ASSERT(di->kind == irDebugInfo_GlobalVariableExpression);
-					ir_fprintf(f, ", !dbg !%d", di->id);
-				}
-			}
-		}
 		ir_write_byte(f, '\n');
+		ir_file_buffer_write(f, body.data, body.count);
+		array_free(&body);
 	}
 
 	// TODO(lachsinc): Attribute map inside ir module?
-	ir_fprintf(f, "attributes #0 = {nounwind uwtable}\n");
-	ir_fprintf(f, "attributes #1 = {nounwind alwaysinline uwtable}\n");
-	ir_fprintf(f, "attributes #2 = {nounwind noinline optnone uwtable}\n");
-	ir_fprintf(f, "attributes #3 = {nounwind readnone}\n");
+	ir_write_str_lit(f, "attributes #0 = {nounwind uwtable}\n");
+	ir_write_str_lit(f, "attributes #1 = {nounwind alwaysinline uwtable}\n");
+	ir_write_str_lit(f, "attributes #2 = {nounwind noinline optnone uwtable}\n");
+	ir_write_str_lit(f, "attributes #3 = {nounwind readnone}\n");
 
 	if (m->generate_debug_info) {
 		ir_write_byte(f, '\n');
@@ -2745,7 +3263,7 @@ void print_llvm_ir(irGen *ir) {
 		ir_fprintf(f, "!llvm.ident = !{!%d}\n", di_version);
 		ir_fprintf(f, "!llvm.module.flags = !{!%d, !%d, !%d}\n", di_debug_info, di_code_view, di_wchar_size);
 
-		ir_fprintf(f, "!0 = !{}\n");
+		ir_write_str_lit(f, "!0 = !{}\n");
 
 		for_array(di_index, m->debug_info.entries) {
 			irDebugInfo *di = m->debug_info.entries[di_index].value;
@@ -2775,10 +3293,10 @@ void print_llvm_ir(irGen *ir) {
 				break;
 			}
 			case irDebugInfo_File:
-				ir_fprintf(f, "!DIFile(filename: \""); ir_print_escape_path(f, di->File.filename);
-				ir_fprintf(f, "\", directory: \""); ir_print_escape_path(f, di->File.directory);
-				ir_fprintf(f, "\"");
-				ir_fprintf(f, ")");
+				ir_write_str_lit(f, "!DIFile(filename: \""); ir_print_escape_path(f, di->File.filename);
+				ir_write_str_lit(f, "\", directory: \""); ir_print_escape_path(f, di->File.directory);
+				ir_write_str_lit(f, "\"");
+				ir_write_str_lit(f, ")");
 				break;
 			case irDebugInfo_Proc:
 				// TODO(lachsinc): We need to store scope info inside di, not just file info, for procs.
@@ -2972,14 +3490,14 @@ void print_llvm_ir(irGen *ir) {
 				break;
 			}
 			case irDebugInfo_DebugInfoArray:
-				ir_fprintf(f, "!{");
+				ir_write_str_lit(f, "!{");
 				for_array(element_index, di->DebugInfoArray.elements) {
 					irDebugInfo *elem = di->DebugInfoArray.elements[element_index];
 					if (element_index > 0) ir_write_str_lit(f, ", ");
 					if (elem != nullptr) {
 						ir_fprintf(f, "!%d", elem->id);
 					} else {
-						ir_fprintf(f, "null"); // NOTE(lachsinc): Proc's can contain "nullptr" entries to represent void return values.
+						ir_write_str_lit(f, "null"); // NOTE(lachsinc): Proc's can contain "nullptr" entries to represent void return values.
 					}
 				}
 				ir_write_byte(f, '}');
@@ -3000,3 +3518,13 @@ void print_llvm_ir(irGen *ir) {
 		ir_fprintf(f, "!%d = !{i32 1, !\"wchar_size\", i32 2}\n",         di_wchar_size);
 	}
 }
+
+void print_llvm_ir(irGen *ir) {
+	auto member_units = array_make<isize>(heap_allocator());
+	defer (array_free(&member_units));
+	ir_assign_codegen_units(ir, &member_units);
+
+	for_array(i, ir->units) {
+		ir_print_codegen_unit(ir, i, &member_units);
+	}
+}
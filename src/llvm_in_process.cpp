@@ -0,0 +1,147 @@
+// llvm_in_process.cpp
+//
+// Optimizes the printed LLVM IR and emits the object file through the LLVM C API, rather than
+// writing it to disk and running 'opt' and 'llc' on it. Enabled by building with ODIN_LLVM_C_API
+// defined and linking against LLVM, see the 'debug-llvm-api' target in the Makefile.
+
+#include <llvm-c/Core.h>
+#include <llvm-c/Error.h>
+#include <llvm-c/IRReader.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+
+struct LLVMInProcess {
+	LLVMContextRef       ctx;
+	LLVMModuleRef        mod;
+	LLVMTargetMachineRef tm;
+};
+
+void llvm_in_process_destroy(LLVMInProcess *p) {
+	if (p->tm  != nullptr) LLVMDisposeTargetMachine(p->tm);
+	if (p->mod != nullptr) LLVMDisposeModule(p->mod);
+	if (p->ctx != nullptr) LLVMContextDispose(p->ctx);
+	gb_zero_item(p);
+}
+
+void llvm_in_process_report(char const *what, char *msg) {
+	gb_printf_err("LLVM %s failed: %s\n", what, msg ? msg : "unknown error");
+	if (msg != nullptr) {
+		LLVMDisposeMessage(msg);
+	}
+}
+
+// NOTE: Must be called once before any 'llvm_in_process_init'
+void llvm_in_process_init_targets(void) {
+	LLVMInitializeAllTargetInfos();
+	LLVMInitializeAllTargets();
+	LLVMInitializeAllTargetMCs();
+	LLVMInitializeAllAsmPrinters();
+}
+
+// NOTE: 'ir' must be followed by a NUL byte which is not included in its length.
+// Each codegen unit has its own context, so units may be initialized on different threads.
+bool llvm_in_process_init(LLVMInProcess *p, String ir, String output_base) {
+	p->ctx = LLVMContextCreate();
+
+	char *name = alloc_cstring(heap_allocator(), output_base);
+	defer (gb_free(heap_allocator(), name));
+	// NOTE: LLVMParseIRInContext takes ownership of the buffer
+	LLVMMemoryBufferRef buffer = LLVMCreateMemoryBufferWithMemoryRange(cast(char const *)ir.text, ir.len, name, true);
+	char *msg = nullptr;
+	if (LLVMParseIRInContext(p->ctx, buffer, &p->mod, &msg)) {
+		llvm_in_process_report("IR parsing", msg);
+		return false;
+	}
+
+	char *triple = nullptr;
+	if (build_context.cross_compiling) {
+		triple = alloc_cstring(heap_allocator(), build_context.target_triplet);
+	} else {
+		char const *module_triple = LLVMGetTarget(p->mod);
+		if (module_triple != nullptr && module_triple[0] != 0) {
+			triple = alloc_cstring(heap_allocator(), make_string_c(cast(char *)module_triple));
+		} else {
+			char *default_triple = LLVMGetDefaultTargetTriple();
+			triple = alloc_cstring(heap_allocator(), make_string_c(default_triple));
+			LLVMDisposeMessage(default_triple);
+		}
+	}
+	defer (gb_free(heap_allocator(), triple));
+
+	LLVMTargetRef target = nullptr;
+	if (LLVMGetTargetFromTriple(triple, &target, &msg)) {
+		llvm_in_process_report("target lookup", msg);
+		return false;
+	}
+
+	LLVMCodeGenOptLevel code_gen_level = LLVMCodeGenLevelNone;
+	switch (build_context.optimization_level) {
+	case 1: code_gen_level = LLVMCodeGenLevelLess;       break;
+	case 2: code_gen_level = LLVMCodeGenLevelDefault;    break;
+	case 3: code_gen_level = LLVMCodeGenLevelAggressive; break;
+	}
+
+	// NOTE: The same settings 'exec_llvm_llc' passes to 'llc'
+	LLVMRelocMode reloc_mode = LLVMRelocDefault;
+#if !defined(GB_SYSTEM_WINDOWS)
+	reloc_mode = LLVMRelocPIC;
+#endif
+
+	p->tm = LLVMCreateTargetMachine(target, triple, "generic", "", code_gen_level, reloc_mode, LLVMCodeModelDefault);
+	if (p->tm == nullptr) {
+		gb_printf_err("LLVM failed to create a target machine for '%s'\n", triple);
+		return false;
+	}
+	LLVMSetTarget(p->mod, triple);
+	return true;
+}
+
+// NOTE: Runs the passes 'exec_llvm_opt' asks 'opt' for, see 'build_context.opt_flags'
+bool llvm_in_process_optimize(LLVMInProcess *p) {
+	gbString passes = gb_string_make_reserve(heap_allocator(), 64);
+	defer (gb_string_free(passes));
+	if (build_context.optimization_level != 0) {
+		passes = gb_string_append_fmt(passes, "default<O%d>", build_context.optimization_level);
+	}
+	if (build_context.ODIN_DEBUG == false) {
+		// NOTE: 'dce' replaces '-die' which the new pass manager does not have
+		if (gb_string_length(passes) > 0) {
+			passes = gb_string_appendc(passes, ",");
+		}
+		passes = gb_string_appendc(passes, "memcpyopt,dce");
+	}
+	if (gb_string_length(passes) == 0) {
+		return true;
+	}
+
+	LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+	defer (LLVMDisposePassBuilderOptions(options));
+
+	LLVMErrorRef err = LLVMRunPasses(p->mod, passes, p->tm, options);
+	if (err != nullptr) {
+		char *msg = LLVMGetErrorMessage(err);
+		gb_printf_err("LLVM optimization failed: %s\n", msg);
+		LLVMDisposeErrorMessage(msg);
+		return false;
+	}
+	return true;
+}
+
+bool llvm_in_process_emit_object(LLVMInProcess *p, String output_base) {
+#if defined(GB_SYSTEM_WINDOWS)
+	char const *ext = ".obj";
+#else
+	char const *ext = ".o";
+#endif
+	gbString path = gb_string_make_length(heap_allocator(), output_base.text, output_base.len);
+	path = gb_string_appendc(path, ext);
+	defer (gb_string_free(path));
+
+	char *msg = nullptr;
+	if (LLVMTargetMachineEmitToFile(p->tm, p->mod, path, LLVMObjectFile, &msg)) {
+		llvm_in_process_report("object emission", msg);
+		return false;
+	}
+	return true;
+}
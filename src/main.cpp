@@ -1,7 +1,9 @@
 // #define NO_ARRAY_BOUNDS_CHECK
 
 #include "common.cpp"
+#include "atom.cpp"
 #include "timings.cpp"
+#include "trace.cpp"
 #include "tokenizer.cpp"
 #include "big_int.cpp"
 #include "exact_value.cpp"
@@ -14,14 +16,23 @@ gb_global Timings global_timings = {0};
 #include "parser.hpp"
 #include "checker.hpp"
 
+#include "server.cpp"
+#include "watch.cpp"
+#include "parse_cache.cpp"
 #include "parser.cpp"
 #include "docs.cpp"
 #include "checker.cpp"
 #include "ir.cpp"
 #include "ir_opt.cpp"
 #include "ir_print.cpp"
+#include "ir_bitcode.cpp"
+#include "object_cache.cpp"
 #include "query_data.cpp"
 
+#if defined(ODIN_LLVM_C_API)
+#include "llvm_in_process.cpp"
+#endif
+
 #if defined(GB_SYSTEM_WINDOWS)
 // NOTE(IC): In order to find Visual C++ paths without relying on environment variables.
 #include "microsoft_craziness.h"
@@ -36,7 +47,6 @@ i32 system_exec_command_line_app(char const *name, char const *fmt, ...) {
 	char cmd_line[4*1024] = {0};
 	isize cmd_len;
 	va_list va;
-	gbTempArenaMemory tmp;
 	String16 cmd;
 	i32 exit_code = 0;
 
@@ -52,10 +62,9 @@ i32 system_exec_command_line_app(char const *name, char const *fmt, ...) {
 
 	// gb_printf_err("%.*s\n", cast(int)cmd_len, cmd_line);
 
-	tmp = gb_temp_arena_memory_begin(&string_buffer_arena);
-	defer (gb_temp_arena_memory_end(tmp));
-
-	cmd = string_to_string16(string_buffer_allocator, make_string(cast(u8 *)cmd_line, cmd_len-1));
+	// NOTE: Not the temporary string arena, as codegen units may run commands from several threads
+	cmd = string_to_string16(heap_allocator(), make_string(cast(u8 *)cmd_line, cmd_len-1));
+	defer (gb_free(heap_allocator(), cmd.text));
 	if (CreateProcessW(nullptr, cmd.text,
 	                   nullptr, nullptr, true, 0, nullptr, nullptr,
 	                   &start_info, &pi)) {
@@ -176,7 +185,10 @@ void usage(String argv0) {
 	print_usage_line(1, "check     parse and type check .odin file");
 	print_usage_line(1, "query     parse, type check, and output a .json file containing information about the program");
 	print_usage_line(1, "docs      generate documentation for a .odin file");
+	print_usage_line(1, "server    stay resident and serve the build, check, and query commands of clients with ODIN_SERVER set to its socket");
+	print_usage_line(1, "          keeping the files they parsed, each command still checks the whole program");
 	print_usage_line(1, "version   print version");
+	print_usage_line(1, "bench-tokenizer  lex every .odin file under a directory, core/ by default, and report the tokenizer's throughput");
 	print_usage_line(0, "");
 	print_usage_line(0, "For more information of flags, apply the flag to see what is possible");
 	print_usage_line(1, "-help");
@@ -223,7 +235,9 @@ enum BuildFlagKind {
 	BuildFlag_ShowTimings,
 	BuildFlag_ShowMoreTimings,
 	BuildFlag_ThreadCount,
+	BuildFlag_CodegenUnits,
 	BuildFlag_KeepTempFiles,
+	BuildFlag_LLVMBitcode,
 	BuildFlag_Collection,
 	BuildFlag_Define,
 	BuildFlag_BuildMode,
@@ -235,6 +249,12 @@ enum BuildFlagKind {
 	BuildFlag_UseLLD,
 	BuildFlag_Vet,
 	BuildFlag_IgnoreUnknownAttributes,
+	BuildFlag_StreamTokens,
+	BuildFlag_CacheDir,
+	BuildFlag_ParallelCheck,
+	BuildFlag_Watch,
+	BuildFlag_Trace,
+	BuildFlag_ProfileCheck,
 
 	BuildFlag_Compact,
 	BuildFlag_GlobalDefinitions,
@@ -314,7 +334,9 @@ bool parse_build_flags(Array<String> args) {
 	add_flag(&build_flags, BuildFlag_ShowTimings,       str_lit("show-timings"),      BuildFlagParam_None);
 	add_flag(&build_flags, BuildFlag_ShowMoreTimings,   str_lit("show-more-timings"), BuildFlagParam_None);
 	add_flag(&build_flags, BuildFlag_ThreadCount,       str_lit("thread-count"),      BuildFlagParam_Integer);
+	add_flag(&build_flags, BuildFlag_CodegenUnits,      str_lit("codegen-units"),     BuildFlagParam_Integer);
 	add_flag(&build_flags, BuildFlag_KeepTempFiles,     str_lit("keep-temp-files"),   BuildFlagParam_None);
+	add_flag(&build_flags, BuildFlag_LLVMBitcode,       str_lit("llvm-bitcode"),      BuildFlagParam_None);
 	add_flag(&build_flags, BuildFlag_Collection,        str_lit("collection"),        BuildFlagParam_String);
 	add_flag(&build_flags, BuildFlag_Define,            str_lit("define"),            BuildFlagParam_String);
 	add_flag(&build_flags, BuildFlag_BuildMode,         str_lit("build-mode"),        BuildFlagParam_String);
@@ -326,6 +348,12 @@ bool parse_build_flags(Array<String> args) {
 	add_flag(&build_flags, BuildFlag_UseLLD,            str_lit("lld"),               BuildFlagParam_None);
 	add_flag(&build_flags, BuildFlag_Vet,               str_lit("vet"),               BuildFlagParam_None);
 	add_flag(&build_flags, BuildFlag_IgnoreUnknownAttributes, str_lit("ignore-unknown-attributes"), BuildFlagParam_None);
+	add_flag(&build_flags, BuildFlag_StreamTokens,      str_lit("stream-tokens"),     BuildFlagParam_None);
+	add_flag(&build_flags, BuildFlag_CacheDir,          str_lit("cache-dir"),         BuildFlagParam_String);
+	add_flag(&build_flags, BuildFlag_ParallelCheck,     str_lit("parallel-check"),    BuildFlagParam_None);
+	add_flag(&build_flags, BuildFlag_Watch,             str_lit("watch"),             BuildFlagParam_None);
+	add_flag(&build_flags, BuildFlag_Trace,             str_lit("trace"),             BuildFlagParam_String);
+	add_flag(&build_flags, BuildFlag_ProfileCheck,      str_lit("profile-check"),     BuildFlagParam_String);
 
 	add_flag(&build_flags, BuildFlag_Compact, str_lit("compact"), BuildFlagParam_None);
 	add_flag(&build_flags, BuildFlag_GlobalDefinitions, str_lit("global-definitions"), BuildFlagParam_None);
@@ -503,10 +531,25 @@ bool parse_build_flags(Array<String> args) {
 							}
 							break;
 						}
+						case BuildFlag_CodegenUnits: {
+							GB_ASSERT(value.kind == ExactValue_Integer);
+							isize count = cast(isize)big_int_to_i64(&value.value_integer);
+							if (count <= 0) {
+								gb_printf_err("%.*s expected a positive non-zero number, got %.*s\n", LIT(name), LIT(param));
+								bad_flags = true;
+							} else {
+								build_context.codegen_units = count;
+							}
+							break;
+						}
 						case BuildFlag_KeepTempFiles:
 							GB_ASSERT(value.kind == ExactValue_Invalid);
 							build_context.keep_temp_files = true;
 							break;
+						case BuildFlag_LLVMBitcode:
+							GB_ASSERT(value.kind == ExactValue_Invalid);
+							build_context.llvm_bitcode = true;
+							break;
 
 						case BuildFlag_Collection: {
 							GB_ASSERT(value.kind == ExactValue_String);
@@ -698,6 +741,67 @@ bool parse_build_flags(Array<String> args) {
 							build_context.ignore_unknown_attributes = true;
 							break;
 
+						case BuildFlag_StreamTokens:
+							if (build_context.query_data_set_settings.ok) {
+								gb_printf_err("Invalid use of -stream-tokens flag, 'odin query' requires the full token array\n");
+								bad_flags = true;
+							} else {
+								build_context.stream_tokens = true;
+							}
+							break;
+
+						case BuildFlag_CacheDir: {
+							GB_ASSERT(value.kind == ExactValue_String);
+							String path = value.value_string;
+							if (path.len == 0) {
+								gb_printf_err("Invalid -cache-dir path, got empty path\n");
+								bad_flags = true;
+								break;
+							}
+							while (path.len > 1 && (path[path.len-1] == '/' || path[path.len-1] == '\\')) {
+								path.len -= 1;
+							}
+							build_context.cache_dir = path;
+							break;
+						}
+
+						case BuildFlag_ParallelCheck:
+							build_context.parallel_check = true;
+							break;
+
+						case BuildFlag_Watch:
+							if (build_context.command != "check") {
+								gb_printf_err("Invalid use of -watch flag, only allowed with 'odin check'\n");
+								bad_flags = true;
+							} else {
+								build_context.watch = true;
+							}
+							break;
+
+						case BuildFlag_Trace: {
+							GB_ASSERT(value.kind == ExactValue_String);
+							String path = value.value_string;
+							if (path.len == 0) {
+								gb_printf_err("Invalid -trace path, got empty path\n");
+								bad_flags = true;
+								break;
+							}
+							build_context.trace_file = path;
+							break;
+						}
+
+						case BuildFlag_ProfileCheck: {
+							GB_ASSERT(value.kind == ExactValue_String);
+							String path = value.value_string;
+							if (path.len == 0) {
+								gb_printf_err("Invalid -profile-check path, got empty path\n");
+								bad_flags = true;
+								break;
+							}
+							build_context.check_profile_file = path;
+							break;
+						}
+
 						case BuildFlag_Compact:
 							if (!build_context.query_data_set_settings.ok) {
 								gb_printf_err("Invalid use of -compact flag, only allowed with 'odin query'\n");
@@ -827,6 +931,54 @@ void show_timings(Checker *c, Timings *t) {
 	}
 #if 1
 	timings_print_all(t);
+	{
+		TokenizerLoadStats *stats = &global_tokenizer_load_stats;
+		i64 mapped_count = gb_atomic64_load(&stats->mapped_file_count);
+		i64 copied_count = gb_atomic64_load(&stats->copied_file_count);
+		f64 mapped_kb = cast(f64)gb_atomic64_load(&stats->mapped_bytes)/1024.0;
+		f64 copied_kb = cast(f64)gb_atomic64_load(&stats->copied_bytes)/1024.0;
+		f64 mapped_ms = 1000.0*cast(f64)gb_atomic64_load(&stats->mapped_time)/cast(f64)t->freq;
+		f64 copied_ms = 1000.0*cast(f64)gb_atomic64_load(&stats->copied_time)/cast(f64)t->freq;
+
+		gb_printf("\n");
+		gb_printf("Source files mapped - %lld files - % 9.3f KiB not copied - % 9.3f ms\n", cast(long long)mapped_count, mapped_kb, mapped_ms);
+		gb_printf("Source files copied - %lld files - % 9.3f KiB copied     - % 9.3f ms\n", cast(long long)copied_count, copied_kb, copied_ms);
+	}
+	if (parse_cache_enabled()) {
+		// NOTE: Load and store times are summed across all of the parser threads
+		ParseCacheStats *stats = &global_parse_cache_stats;
+		f64 load_ms  = 1000.0*cast(f64)gb_atomic64_load(&stats->load_time)/cast(f64)t->freq;
+		f64 store_ms = 1000.0*cast(f64)gb_atomic64_load(&stats->store_time)/cast(f64)t->freq;
+
+		gb_printf("Parse cache         - %lld hits - %lld misses - %lld stored - % 9.3f ms load - % 9.3f ms store\n",
+		          cast(long long)gb_atomic64_load(&stats->hit_count),
+		          cast(long long)gb_atomic64_load(&stats->miss_count),
+		          cast(long long)gb_atomic64_load(&stats->store_count),
+		          load_ms, store_ms);
+	}
+	if (object_cache_enabled()) {
+		ObjectCacheStats *stats = &global_object_cache_stats;
+		gb_printf("Object cache        - %lld hits - %lld misses - %lld stored\n",
+		          cast(long long)stats->hit_count,
+		          cast(long long)stats->miss_count,
+		          cast(long long)stats->store_count);
+	}
+	if (build_context.show_more_timings) {
+		// NOTE: Tokenizer time is summed across all of the parser threads
+		f64 tokenize_time = cast(f64)p->total_tokenize_time/cast(f64)t->freq;
+		gb_printf("\n");
+		gb_printf("Tokenizer\n");
+		gb_printf("Total Files  - %td\n", files);
+		gb_printf("Total Bytes  - %td\n", total_file_size);
+		gb_printf("Total Tokens - %td\n", tokens);
+		if (build_context.stream_tokens) {
+			gb_printf("Time         - included in the parse time with -stream-tokens\n");
+		} else {
+			gb_printf("Time         - %.3f ms\n", 1.0e3*tokenize_time);
+			gb_printf("Tokens/s     - %.3f\n", cast(f64)tokens/tokenize_time);
+			gb_printf("bytes/s      - %.3f\n", cast(f64)total_file_size/tokenize_time);
+		}
+	}
 #else
 	{
 		timings_print_all(t);
@@ -879,6 +1031,107 @@ void show_timings(Checker *c, Timings *t) {
 #endif
 }
 
+// NOTE: Every .odin file under 'dir'. 'read_directory' is not used, as it leaves out the subdirectories on *nix.
+void bench_tokenizer_collect_files(String dir, Array<String> *files) {
+#if defined(GB_SYSTEM_WINDOWS)
+	Array<FileInfo> list = {};
+	if (read_directory(dir, &list) != ReadDirectory_None) {
+		return;
+	}
+	defer (array_free(&list));
+	for_array(i, list) {
+		FileInfo *fi = &list[i];
+		if (fi->is_dir) {
+			bench_tokenizer_collect_files(fi->fullpath, files);
+		} else if (string_ends_with(fi->name, str_lit(".odin"))) {
+			array_add(files, fi->fullpath);
+		}
+	}
+#else
+	char *dir_c = alloc_cstring(heap_allocator(), dir);
+	defer (gb_free(heap_allocator(), dir_c));
+	DIR *d = opendir(dir_c);
+	if (d == nullptr) {
+		return;
+	}
+	defer (closedir(d));
+	String prefix = concatenate_strings(heap_allocator(), dir, str_lit("/"));
+	defer (gb_free(heap_allocator(), prefix.text));
+	for (struct dirent *entry = readdir(d); entry != nullptr; entry = readdir(d)) {
+		String name = make_string_c(entry->d_name);
+		if (name == "." || name == "..") {
+			continue;
+		}
+		String path = concatenate_strings(heap_allocator(), prefix, name);
+		struct stat path_stat = {};
+		if (stat(cast(char const *)path.text, &path_stat) != 0) {
+			continue;
+		}
+		if (S_ISDIR(path_stat.st_mode)) {
+			bench_tokenizer_collect_files(path, files);
+		} else if (string_ends_with(name, str_lit(".odin"))) {
+			array_add(files, path);
+		}
+	}
+#endif
+}
+
+// NOTE: 'odin bench-tokenizer [<directory>]' lexes every .odin file under the directory, core/ by default,
+// several times over in-process and reports the fastest pass. Only the tokenizer loop is timed, not the
+// loading of the files.
+i32 bench_tokenizer(String dir) {
+	isize const pass_count = 30;
+
+	auto files = array_make<String>(heap_allocator());
+	defer (array_free(&files));
+	bench_tokenizer_collect_files(dir, &files);
+	if (files.count == 0) {
+		gb_printf_err("No .odin files found in '%.*s'\n", LIT(dir));
+		return 1;
+	}
+
+	isize total_tokens = 0;
+	isize total_bytes = 0;
+	f64 best_time = 0;
+	for (isize pass = 0; pass < pass_count; pass++) {
+		isize tokens = 0;
+		isize bytes = 0;
+		u64 time = 0;
+		for_array(i, files) {
+			Tokenizer t = {};
+			if (init_tokenizer(&t, files[i]) != TokenizerInit_None) {
+				continue;
+			}
+			u64 start = time_stamp_time_now();
+			for (;;) {
+				Token token = tokenizer_get_token(&t);
+				tokens += 1;
+				if (token.kind == Token_EOF) {
+					break;
+				}
+			}
+			time += time_stamp_time_now() - start;
+			bytes += t.end - t.start;
+			destroy_tokenizer(&t);
+		}
+		f64 pass_time = cast(f64)time/cast(f64)time_stamp__freq();
+		if (pass == 0 || pass_time < best_time) {
+			best_time = pass_time;
+		}
+		total_tokens = tokens;
+		total_bytes = bytes;
+	}
+
+	gb_printf("Tokenizer - fastest of %td passes\n", pass_count);
+	gb_printf("Total Files  - %td\n", files.count);
+	gb_printf("Total Bytes  - %td\n", total_bytes);
+	gb_printf("Total Tokens - %td\n", total_tokens);
+	gb_printf("Time         - %.3f ms\n", 1.0e3*best_time);
+	gb_printf("Tokens/s     - %.3f\n", cast(f64)total_tokens/best_time);
+	gb_printf("bytes/s      - %.3f\n", cast(f64)total_bytes/best_time);
+	return 0;
+}
+
 void remove_temp_files(String output_base) {
 	if (build_context.keep_temp_files) return;
 
@@ -892,7 +1145,9 @@ void remove_temp_files(String output_base) {
 		gb_file_remove(cast(char const *)data.data);     \
 	} while (0)
 	EXT_REMOVE(".ll");
+	EXT_REMOVE(".ir.bc");
 	EXT_REMOVE(".bc");
+	EXT_REMOVE(".rsp");
 #if defined(GB_SYSTEM_WINDOWS)
 	EXT_REMOVE(".obj");
 	EXT_REMOVE(".res");
@@ -910,18 +1165,18 @@ i32 exec_llvm_opt(String output_base) {
 #if defined(GB_SYSTEM_WINDOWS)
 	// For more passes arguments: http://llvm.org/docs/Passes.html
 	return system_exec_command_line_app("llvm-opt",
-		"\"%.*sbin/opt\" \"%.*s.ll\" -o \"%.*s.bc\" %.*s "
+		"\"%.*sbin/opt\" \"%.*s%s\" -o \"%.*s.bc\" %.*s "
 		"",
 		LIT(build_context.ODIN_ROOT),
-		LIT(output_base), LIT(output_base),
+		LIT(output_base), llvm_ir_file_extension(), LIT(output_base),
 		LIT(build_context.opt_flags));
 #else
 	// NOTE(zangent): This is separate because it seems that LLVM tools are packaged
 	//   with the Windows version, while they will be system-provided on MacOS and GNU/Linux
 	return system_exec_command_line_app("llvm-opt",
-		"opt \"%.*s.ll\" -o \"%.*s.bc\" %.*s "
+		"opt \"%.*s%s\" -o \"%.*s.bc\" %.*s "
 		"",
-		LIT(output_base), LIT(output_base),
+		LIT(output_base), llvm_ir_file_extension(), LIT(output_base),
 		LIT(build_context.opt_flags));
 #endif
 }
@@ -954,6 +1209,115 @@ i32 exec_llvm_llc(String output_base) {
 #endif
 }
 
+struct CodegenUnitTask {
+	irCodegenUnit *unit;
+	i32            exit_code;
+	bool           has_cache_hash;
+	bool           cached; // NOTE: The object file was copied from the object cache
+	u64            cache_hash[2];
+#if defined(ODIN_LLVM_C_API)
+	LLVMInProcess  llvm;
+#endif
+};
+
+WORKER_TASK_PROC(llvm_opt_worker_proc) {
+	CodegenUnitTask *task = cast(CodegenUnitTask *)data;
+	if (task->cached) {
+		return 0;
+	}
+	u64 trace_start = trace_time_now();
+	defer (trace_add_event("llvm opt", task->unit->output_base, trace_start));
+#if defined(ODIN_LLVM_C_API)
+	if (build_context.llvm_in_process) {
+		Array<u8> *memory = &task->unit->output_memory;
+		String ir = make_string(memory->data, memory->count-1);
+		if (!llvm_in_process_init(&task->llvm, ir, task->unit->output_base) ||
+		    !llvm_in_process_optimize(&task->llvm)) {
+			task->exit_code = 1;
+		}
+		return 0;
+	}
+#endif
+	task->exit_code = exec_llvm_opt(task->unit->output_base);
+	return 0;
+}
+
+WORKER_TASK_PROC(llvm_llc_worker_proc) {
+	CodegenUnitTask *task = cast(CodegenUnitTask *)data;
+	if (task->cached) {
+		return 0;
+	}
+	u64 trace_start = trace_time_now();
+	defer (trace_add_event("llvm llc", task->unit->output_base, trace_start));
+#if defined(ODIN_LLVM_C_API)
+	if (build_context.llvm_in_process) {
+		if (!llvm_in_process_emit_object(&task->llvm, task->unit->output_base)) {
+			task->exit_code = 1;
+		}
+		return 0;
+	}
+#endif
+	task->exit_code = exec_llvm_llc(task->unit->output_base);
+	return 0;
+}
+
+// NOTE: Runs 'proc' for every codegen unit, on the thread pool when there is more than one
+i32 run_codegen_unit_tasks(Array<CodegenUnitTask> &tasks, WorkerTaskProc *proc) {
+	isize thread_count = gb_min(gb_max(build_context.thread_count, 1), tasks.count);
+	if (thread_count <= 1) {
+		for_array(i, tasks) {
+			proc(&tasks[i]);
+		}
+	} else {
+		ThreadPool pool = {};
+		thread_pool_init(&pool, heap_allocator(), thread_count-1, "CodegenWork");
+		for_array(i, tasks) {
+			thread_pool_add_task(&pool, proc, &tasks[i]);
+		}
+		thread_pool_start(&pool);
+		thread_pool_wait_to_process(&pool);
+		thread_pool_destroy(&pool);
+	}
+
+	for_array(i, tasks) {
+		if (tasks[i].exit_code != 0) {
+			return tasks[i].exit_code;
+		}
+	}
+	return 0;
+}
+
+// NOTE: The object files of the codegen units for the link step. With more than one unit, they are passed
+// through a response file, as the list can be longer than the command line 'system_exec_command_line_app'
+// formats into. Returns nullptr if the response file could not be written.
+gbString codegen_unit_object_files(irGen *ir) {
+#if defined(GB_SYSTEM_WINDOWS)
+	char const *ext = "obj";
+#else
+	char const *ext = "o";
+#endif
+	gbString objects = gb_string_make(heap_allocator(), "");
+	for_array(i, ir->units) {
+		String base = ir->units[i].output_base;
+		objects = gb_string_append_fmt(objects, "%s\"%.*s.%s\"", i > 0 ? " " : "", LIT(base), ext);
+	}
+	if (ir->units.count == 1) {
+		return objects;
+	}
+	defer (gb_string_free(objects));
+
+	String path = concatenate_strings(heap_allocator(), ir->output_base, str_lit(".rsp"));
+	defer (gb_free(heap_allocator(), path.text));
+	gbFile f = {};
+	if (gb_file_create(&f, cast(char const *)path.text) != gbFileError_None) {
+		gb_printf_err("Unable to create the linker response file '%.*s'\n", LIT(path));
+		return nullptr;
+	}
+	gb_file_write(&f, objects, gb_string_length(objects));
+	gb_file_close(&f);
+	return gb_string_make(heap_allocator(), gb_bprintf("@\"%.*s\"", LIT(path)));
+}
+
 void print_show_help(String const arg0, String const &command) {
 	print_usage_line(0, "%.*s is a tool for managing Odin source code", LIT(arg0));
 	print_usage_line(0, "Usage");
@@ -1012,8 +1376,20 @@ void print_show_help(String const arg0, String const &command) {
 	}
 
 	if (run_or_build) {
+		print_usage_line(1, "-codegen-units:<integer>");
+		print_usage_line(2, "Splits the generated code into this many modules which are optimized and compiled in parallel");
+		print_usage_line(2, "Ignored with -debug, defaults to 1");
+		print_usage_line(2, "Example: -codegen-units:4");
+		print_usage_line(0, "");
+
 		print_usage_line(1, "-keep-temp-files");
 		print_usage_line(2, "Keeps the temporary files generated during compilation");
+		print_usage_line(2, "When built with the LLVM C API, this uses the textual IR with 'opt' and 'llc' instead");
+		print_usage_line(0, "");
+
+		print_usage_line(1, "-llvm-bitcode");
+		print_usage_line(2, "Writes LLVM bitcode for 'opt' directly, rather than textual IR it has to parse");
+		print_usage_line(2, "Ignored with -debug");
 		print_usage_line(0, "");
 	}
 
@@ -1081,6 +1457,40 @@ void print_show_help(String const arg0, String const &command) {
 		print_usage_line(2, "Ignores unknown attributes");
 		print_usage_line(2, "This can be used with metaprogramming tools");
 		print_usage_line(0, "");
+
+		print_usage_line(1, "-stream-tokens");
+		print_usage_line(2, "Tokenize files on demand while parsing rather than storing every token up front");
+		print_usage_line(2, "This lowers peak memory usage for large source files");
+		print_usage_line(0, "");
+
+		print_usage_line(1, "-cache-dir:<string>");
+		print_usage_line(2, "Directory used to cache the results of parsing, and the object files of each codegen unit, between runs");
+		print_usage_line(2, "Use with -codegen-units so that an edit only recompiles the units it changed");
+		print_usage_line(2, "Example: -cache-dir:.odin-cache");
+		print_usage_line(0, "");
+
+		print_usage_line(1, "-parallel-check");
+		print_usage_line(2, "Check procedure bodies on multiple threads, see -thread-count");
+		print_usage_line(0, "");
+
+		print_usage_line(1, "-trace:<filepath>");
+		print_usage_line(2, "Writes the phases of the compiler, and the work of each thread, as Chrome trace events");
+		print_usage_line(2, "The file can be opened with chrome://tracing or https://ui.perfetto.dev");
+		print_usage_line(2, "Example: -trace:odin-trace.json");
+		print_usage_line(0, "");
+
+		print_usage_line(1, "-profile-check:<filepath>");
+		print_usage_line(2, "Writes the time, expressions, and allocations spent checking each declaration, procedure body, and polymorphic specialization");
+		print_usage_line(2, "The costliest come first, as JSON when the file ends in .json and as CSV otherwise");
+		print_usage_line(2, "Example: -profile-check:check-profile.csv");
+		print_usage_line(0, "");
+	}
+
+	if (command == "check") {
+		print_usage_line(1, "-watch");
+		print_usage_line(2, "Keeps running and checks again every time a .odin file of the program changes");
+		print_usage_line(2, "Only the changed files are parsed again");
+		print_usage_line(0, "");
 	}
 
 	if (run_or_build) {
@@ -1113,8 +1523,10 @@ int main(int arg_count, char const **arg_ptr) {
 
 	init_string_buffer_memory();
 	init_global_error_collector();
+	init_keyword_hash_table();
+	init_global_atom_table();
 	global_big_int_init();
-	arena_init(&global_ast_arena, heap_allocator());
+	init_global_ast_arenas();
 
 	array_init(&library_collections, heap_allocator());
 	// NOTE(bill): 'core' cannot be (re)defined by the user
@@ -1124,6 +1536,20 @@ int main(int arg_count, char const **arg_ptr) {
 
 	Array<String> args = setup_args(arg_count, arg_ptr);
 
+	if (args[1] == "server") {
+		// NOTE: Only returns in the worker forked for a request, with the request's arguments
+		if (!server_run(&args)) {
+			return 1;
+		}
+		timings_destroy(timings);
+		timings_init(timings, str_lit("Total Time"), 128);
+	} else {
+		i32 exit_code = 0;
+		if (server_client_run(args, &exit_code)) {
+			return exit_code;
+		}
+	}
+
 	String command = args[1];
 	String init_filename = {};
 	String run_args_string = {};
@@ -1135,7 +1561,7 @@ int main(int arg_count, char const **arg_ptr) {
 			return 1;
 		}
 
-		Array<String> run_args = array_make<String>(heap_allocator(), 0, arg_count);
+		Array<String> run_args = array_make<String>(heap_allocator(), 0, args.count);
 		defer (array_free(&run_args));
 
 		isize last_non_run_arg = args.count;
@@ -1189,6 +1615,12 @@ int main(int arg_count, char const **arg_ptr) {
 	} else if (command == "version") {
 		gb_printf("%.*s version %.*s\n", LIT(args[0]), LIT(ODIN_VERSION));
 		return 0;
+	} else if (command == "bench-tokenizer") {
+		String dir = get_fullpath_relative(heap_allocator(), odin_root_dir(), str_lit("core"));
+		if (args.count >= 3) {
+			dir = path_to_full_path(heap_allocator(), args[2]);
+		}
+		return bench_tokenizer(dir);
 	} else {
 		usage(args[0]);
 		return 1;
@@ -1227,8 +1659,29 @@ int main(int arg_count, char const **arg_ptr) {
 	init_universal();
 	// TODO(bill): prevent compiling without a linker
 
+	if (build_context.watch) {
+		// NOTE: Only returns in the process forked for each check
+		if (!watch_run(init_filename)) {
+			return 1;
+		}
+		timings_destroy(timings);
+		timings_init(timings, str_lit("Total Time"), 128);
+	}
+
+	if (build_context.trace_file.len > 0) {
+		trace_init();
+	}
+	if (build_context.check_profile_file.len > 0) {
+		check_profile_init();
+	}
+	defer (trace_write(timings, build_context.trace_file));
+
 	timings_start_section(timings, str_lit("parse files"));
 
+	if (build_context.cache_dir.len > 0) {
+		parse_cache_init(build_context.cache_dir);
+	}
+
 	Parser parser = {0};
 	if (!init_parser(&parser)) {
 		return 1;
@@ -1254,6 +1707,8 @@ int main(int arg_count, char const **arg_ptr) {
 
 	if (checked_inited) {
 		check_parsed_files(&checker);
+		check_profile_write(build_context.check_profile_file);
+		watch_worker_send_packages(&parser);
 	}
 
 
@@ -1290,8 +1745,13 @@ int main(int arg_count, char const **arg_ptr) {
 	timings_start_section(timings, str_lit("llvm ir opt tree"));
 	ir_opt_tree(&ir_gen);
 
-	timings_start_section(timings, str_lit("llvm ir print"));
-	print_llvm_ir(&ir_gen);
+	if (build_context.llvm_bitcode) {
+		timings_start_section(timings, str_lit("llvm bitcode write"));
+		write_llvm_bitcode(&ir_gen);
+	} else {
+		timings_start_section(timings, str_lit("llvm ir print"));
+		print_llvm_ir(&ir_gen);
+	}
 
 
 	String output_name = ir_gen.output_name;
@@ -1301,22 +1761,69 @@ int main(int arg_count, char const **arg_ptr) {
 
 	i32 exit_code = 0;
 
+	auto codegen_tasks = array_make<CodegenUnitTask>(heap_allocator(), ir_gen.units.count);
+	defer (array_free(&codegen_tasks));
+	if (build_context.cache_dir.len > 0) {
+		timings_start_section(timings, str_lit("object cache"));
+		object_cache_init(build_context.cache_dir);
+	}
+	for_array(i, ir_gen.units) {
+		CodegenUnitTask *task = &codegen_tasks[i];
+		task->unit = &ir_gen.units[i];
+		if (object_cache_enabled()) {
+			task->has_cache_hash = object_cache_hash_unit(task->unit, task->cache_hash);
+			task->cached = task->has_cache_hash && object_cache_load(task->unit, task->cache_hash);
+		}
+#if defined(ODIN_LLVM_C_API)
+		if (build_context.llvm_in_process) {
+			// NOTE: LLVMParseIRInContext expects the buffer to be NUL terminated
+			array_add(&ir_gen.units[i].output_memory, cast(u8)0);
+		}
+#endif
+	}
+#if defined(ODIN_LLVM_C_API)
+	if (build_context.llvm_in_process) {
+		llvm_in_process_init_targets();
+	}
+	defer ({
+		for_array(i, codegen_tasks) {
+			llvm_in_process_destroy(&codegen_tasks[i].llvm);
+		}
+	});
+#endif
+
 	timings_start_section(timings, str_lit("llvm-opt"));
-	exit_code = exec_llvm_opt(output_base);
+	exit_code = run_codegen_unit_tasks(codegen_tasks, llvm_opt_worker_proc);
 	if (exit_code != 0) {
 		return exit_code;
 	}
 
 	timings_start_section(timings, str_lit("llvm-llc"));
-	exit_code = exec_llvm_llc(output_base);
+	exit_code = run_codegen_unit_tasks(codegen_tasks, llvm_llc_worker_proc);
 	if (exit_code != 0) {
 		return exit_code;
 	}
 
+	if (object_cache_enabled()) {
+		timings_start_section(timings, str_lit("object cache"));
+		for_array(i, codegen_tasks) {
+			CodegenUnitTask *task = &codegen_tasks[i];
+			if (task->has_cache_hash && !task->cached) {
+				object_cache_store(task->unit, task->cache_hash);
+			}
+		}
+	}
+
+	gbString object_files = codegen_unit_object_files(&ir_gen);
+	if (object_files == nullptr) {
+		return 1;
+	}
+	defer (gb_string_free(object_files));
+
 	if (build_context.cross_compiling && selected_target_metrics->metrics == &target_essence_amd64) {
 #ifdef GB_SYSTEM_UNIX
-		system_exec_command_line_app("linker", "x86_64-essence-gcc \"%.*s.o\" -o \"%.*s\" %.*s",
-				LIT(output_base), LIT(output_base), LIT(build_context.link_flags));
+		system_exec_command_line_app("linker", "x86_64-essence-gcc %s -o \"%.*s\" %.*s",
+				object_files, LIT(output_base), LIT(build_context.link_flags));
 #else
 		gb_printf_err("Don't know how to cross compile to selected target.\n");
 #endif
@@ -1405,12 +1912,12 @@ int main(int arg_count, char const **arg_ptr) {
 				}
 
 				exit_code = system_exec_command_line_app("msvc-link",
-					"\"%.*slink.exe\" \"%.*s.obj\" \"%.*s.res\" -OUT:\"%.*s.%s\" %s "
+					"\"%.*slink.exe\" %s \"%.*s.res\" -OUT:\"%.*s.%s\" %s "
 					"/nologo /incremental:no /opt:ref /subsystem:%s "
 					" %.*s "
 					" %s "
 					"",
-					LIT(find_result.vs_exe_path), LIT(output_base), LIT(output_base), LIT(output_base), output_ext,
+					LIT(find_result.vs_exe_path), object_files, LIT(output_base), LIT(output_base), output_ext,
 					link_settings,
 					subsystem_str,
 					LIT(build_context.link_flags),
@@ -1418,12 +1925,12 @@ int main(int arg_count, char const **arg_ptr) {
 				);
 			} else {
 				exit_code = system_exec_command_line_app("msvc-link",
-					"\"%.*slink.exe\" \"%.*s.obj\" -OUT:\"%.*s.%s\" %s "
+					"\"%.*slink.exe\" %s -OUT:\"%.*s.%s\" %s "
 					"/nologo /incremental:no /opt:ref /subsystem:%s "
 					" %.*s "
 					" %s "
 					"",
-					LIT(find_result.vs_exe_path), LIT(output_base), LIT(output_base), output_ext,
+					LIT(find_result.vs_exe_path), object_files, LIT(output_base), output_ext,
 					link_settings,
 					subsystem_str,
 					LIT(build_context.link_flags),
@@ -1432,13 +1939,13 @@ int main(int arg_count, char const **arg_ptr) {
 			}
 		} else { // lld
 			exit_code = system_exec_command_line_app("msvc-link",
-				"\"%.*s\\bin\\lld-link\" \"%.*s.obj\" -OUT:\"%.*s.%s\" %s "
+				"\"%.*s\\bin\\lld-link\" %s -OUT:\"%.*s.%s\" %s "
 				"/nologo /incremental:no /opt:ref /subsystem:%s "
 				" %.*s "
 				" %s "
 				"",
 				LIT(build_context.ODIN_ROOT),
-				LIT(output_base), LIT(output_base), output_ext,
+				object_files, LIT(output_base), output_ext,
 				link_settings,
 				subsystem_str,
 				LIT(build_context.link_flags),
@@ -1454,7 +1961,9 @@ int main(int arg_count, char const **arg_ptr) {
 			show_timings(&checker, timings);
 		}
 
-		remove_temp_files(output_base);
+		for_array(i, ir_gen.units) {
+			remove_temp_files(ir_gen.units[i].output_base);
+		}
 
 		if (run_output) {
 			return system_exec_command_line_app("odin run", "%.*s.exe %.*s", LIT(output_base), LIT(run_args_string));
@@ -1553,7 +2062,7 @@ int main(int arg_count, char const **arg_ptr) {
 		#endif
 
 		exit_code = system_exec_command_line_app("ld-link",
-			"%s \"%.*s.o\" -o \"%.*s%.*s\" %s "
+			"%s %s -o \"%.*s%.*s\" %s "
 			" %s "
 			" %.*s "
 			" %s "
@@ -1565,7 +2074,7 @@ int main(int arg_count, char const **arg_ptr) {
 				// This points the linker to where the entry point is
 				" -e _main "
 			#endif
-			, linker, LIT(output_base), LIT(output_base), LIT(output_ext),
+			, linker, object_files, LIT(output_base), LIT(output_ext),
 			lib_str,
 			"-lc -lm",
 			LIT(build_context.link_flags),
@@ -1593,7 +2102,9 @@ int main(int arg_count, char const **arg_ptr) {
 			show_timings(&checker, timings);
 		}
 
-		remove_temp_files(output_base);
+		for_array(i, ir_gen.units) {
+			remove_temp_files(ir_gen.units[i].output_base);
+		}
 
 		if (run_output) {
 			//NOTE(thebirk): This whole thing is a little leaky
@@ -16,6 +16,7 @@ struct MapFindResult {
 enum HashKeyKind {
 	HashKey_Default,
 	HashKey_String,
+	HashKey_Atom, // NOTE: An interned String, see 'atom.cpp'
 	HashKey_Ptr,
 	HashKey_PtrAndId,
 };
@@ -30,7 +31,7 @@ struct HashKey {
 	// u128        key;
 	u64         key;
 	union {
-		String   string; // if String, s.len > 0
+		String   string; // if String or Atom, s.len > 0
 		void *   ptr;
 		PtrAndId ptr_and_id;
 	};
@@ -79,8 +80,12 @@ gb_inline HashKey hash_f64(f64 f) {
 bool hash_key_equal(HashKey a, HashKey b) {
 	if (a.key == b.key) {
 		// NOTE(bill): If two string's hashes collide, compare the strings themselves
-		if (a.kind == HashKey_String) {
-			if (b.kind == HashKey_String) {
+		if (a.kind == HashKey_String || a.kind == HashKey_Atom) {
+			if (a.kind == HashKey_Atom && b.kind == HashKey_Atom) {
+				// NOTE: Atoms are unique, so only the same atom has the same string
+				return a.string.text == b.string.text;
+			}
+			if (b.kind == HashKey_String || b.kind == HashKey_Atom) {
 				return a.string == b.string;
 			}
 			return false;
@@ -284,13 +289,16 @@ void map__erase(Map<T> *h, MapFindResult fr) {
 		array_pop(&h->entries);
 		return;
 	}
-	h->entries[fr.entry_index] = h->entries[h->entries.count-1];
-	last = map__find(h, h->entries[fr.entry_index].key);
+	// NOTE: Moves the last entry into the erased one's place, relinking whatever pointed to the last entry
+	// and then dropping it, otherwise a later erase could link its stale copy back in
+	last = map__find_from_entry(h, &h->entries[h->entries.count-1]);
 	if (last.entry_prev >= 0) {
 		h->entries[last.entry_prev].next = fr.entry_index;
 	} else {
 		h->hashes[last.hash_index] = fr.entry_index;
 	}
+	h->entries[fr.entry_index] = h->entries[h->entries.count-1];
+	array_pop(&h->entries);
 }
 
 template <typename T>
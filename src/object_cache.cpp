@@ -0,0 +1,113 @@
+// object_cache.cpp
+//
+// On-disk cache of the object files of the codegen units, keyed by a hash of a unit's printed IR
+// and of the settings which affect code generation. A unit found in the cache skips 'opt' and 'llc'.
+// The printed IR of a unit only declares what the unit refers to, so with several codegen units an
+// edit to one procedure only recompiles the unit which defines it.
+
+#define OBJECT_CACHE_VERSION 1
+
+struct ObjectCacheStats {
+	i64 hit_count;
+	i64 miss_count;
+	i64 store_count;
+};
+
+gb_global ObjectCacheStats global_object_cache_stats = {};
+gb_global String           global_object_cache_dir = {};
+
+
+void object_cache_init(String cache_dir) {
+	String dir = concatenate_strings(heap_allocator(), cache_dir, str_lit("/objects"));
+	if (!make_directory(cache_dir) || !make_directory(dir)) {
+		gb_printf_err("Unable to create the object cache directory '%.*s'\n", LIT(dir));
+		return;
+	}
+	global_object_cache_dir = dir;
+}
+
+bool object_cache_enabled(void) {
+	return global_object_cache_dir.len > 0;
+}
+
+void object_cache_file_path(char *buf, isize buf_len, u64 const hash[2]) {
+	gb_snprintf(buf, buf_len, "%.*s/%016llx%016llx.o", LIT(global_object_cache_dir),
+	            cast(unsigned long long)hash[0], cast(unsigned long long)hash[1]);
+}
+
+void object_cache_unit_object_path(char *buf, isize buf_len, irCodegenUnit *unit) {
+#if defined(GB_SYSTEM_WINDOWS)
+	gb_snprintf(buf, buf_len, "%.*s.obj", LIT(unit->output_base));
+#else
+	gb_snprintf(buf, buf_len, "%.*s.o", LIT(unit->output_base));
+#endif
+}
+
+// NOTE: Must be called before the NUL terminator is appended to 'output_memory'
+bool object_cache_hash_unit(irCodegenUnit *unit, u64 hash[2]) {
+	gbString settings = gb_string_make_reserve(heap_allocator(), 256);
+	defer (gb_string_free(settings));
+	settings = gb_string_append_fmt(settings, "%d %.*s %.*s %.*s %.*s %d %d %d",
+	                                OBJECT_CACHE_VERSION,
+	                                LIT(build_context.ODIN_VERSION),
+	                                LIT(build_context.target_triplet),
+	                                LIT(build_context.opt_flags),
+	                                LIT(build_context.llc_flags),
+	                                build_context.optimization_level,
+	                                build_context.ODIN_DEBUG,
+	                                build_context.llvm_in_process);
+	u64 settings_hash[2] = {};
+	MurmurHash3_x64_128(settings, gb_string_length(settings), OBJECT_CACHE_VERSION, settings_hash);
+
+	if (build_context.llvm_in_process) {
+		MurmurHash3_x64_128(unit->output_memory.data, unit->output_memory.count, cast(u32)settings_hash[0], hash);
+	} else {
+		char path[4096] = {};
+		gb_snprintf(path, gb_size_of(path), "%.*s%s", LIT(unit->output_base), llvm_ir_file_extension());
+		gbFileContents fc = gb_file_read_contents(heap_allocator(), false, path);
+		if (fc.data == nullptr) {
+			return false;
+		}
+		MurmurHash3_x64_128(fc.data, fc.size, cast(u32)settings_hash[0], hash);
+		gb_file_free_contents(&fc);
+	}
+	hash[1] ^= settings_hash[1];
+	return true;
+}
+
+// NOTE: Copies the cached object file into place for the unit, if there is one
+bool object_cache_load(irCodegenUnit *unit, u64 const hash[2]) {
+	char path[4096] = {};
+	char object_path[4096] = {};
+	object_cache_file_path(path, gb_size_of(path), hash);
+	object_cache_unit_object_path(object_path, gb_size_of(object_path), unit);
+
+	if (gb_file_exists(path)) {
+		// NOTE: 'gb_file_copy' does not truncate an existing file
+		gb_file_remove(object_path);
+		if (gb_file_copy(path, object_path, false)) {
+			global_object_cache_stats.hit_count += 1;
+			return true;
+		}
+	}
+	global_object_cache_stats.miss_count += 1;
+	return false;
+}
+
+void object_cache_store(irCodegenUnit *unit, u64 const hash[2]) {
+	char path[4096] = {};
+	char tmp_path[4096] = {};
+	char object_path[4096] = {};
+	object_cache_file_path(path, gb_size_of(path), hash);
+	object_cache_unit_object_path(object_path, gb_size_of(object_path), unit);
+
+	// NOTE: Copy to a temporary file and move it into place so other builds never see a partial file
+	gb_snprintf(tmp_path, gb_size_of(tmp_path), "%s.%u.%llu.tmp", path, gb_thread_current_id(), cast(unsigned long long)time_stamp_time_now());
+	if (gb_file_exists(object_path) &&
+	    gb_file_copy(object_path, tmp_path, false) &&
+	    replace_file(make_string_c(tmp_path), make_string_c(path))) {
+		global_object_cache_stats.store_count += 1;
+	} else {
+		gb_file_remove(tmp_path);
+	}
+}
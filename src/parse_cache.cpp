@@ -0,0 +1,915 @@
+// parse_cache.cpp
+//
+// On-disk cache of parsed files, keyed by a hash of the file's contents.
+// The AST is stored position independently: nodes and comment groups are referenced by index,
+// strings which live in the source file are stored as offsets into it, and the file path
+// is rebound on load. Only files which parsed without any diagnostics are stored.
+
+#define PARSE_CACHE_MAGIC   0x3143504f // "OPC1"
+#define PARSE_CACHE_VERSION 1
+
+struct ParseCacheHeader {
+	u32 magic;
+	u32 version;
+	u32 ast_size;
+	u32 token_kind_count;
+	u64 content_hash[2];
+	i64 content_len;
+	i64 token_count;
+	i64 line_count;
+	i64 comment_group_count;
+	i64 node_count;
+};
+
+struct ParseCacheStats {
+	gbAtomic64 hit_count;
+	gbAtomic64 miss_count;
+	gbAtomic64 store_count;
+	gbAtomic64 load_time;
+	gbAtomic64 store_time;
+};
+
+gb_global ParseCacheStats global_parse_cache_stats = {};
+gb_global String          global_parse_cache_dir = {};
+
+
+enum ParseCacheMode {
+	ParseCache_Collect, // Assign indices to every reachable node
+	ParseCache_Write,
+	ParseCache_Read,
+};
+
+enum ParseCacheStringKind : u8 {
+	ParseCacheString_Empty,
+	ParseCacheString_Source, // offset into the file's contents
+	ParseCacheString_File,   // the file's full path
+	ParseCacheString_Inline,
+};
+
+struct ParseCacheCodec {
+	ParseCacheMode mode;
+	AstFile *      file;
+	String         source;
+
+	Map<isize>     node_ids;    // Key: Ast *
+	Map<isize>     comment_ids; // Key: CommentGroup *
+	Array<Ast *>   nodes;
+	Array<CommentGroup *> comments;
+
+	Array<u8>      buf;
+	u8 *           read_curr;
+	u8 *           read_end;
+	bool           read_failed;
+};
+
+
+void parse_cache_init(String cache_dir) {
+	String dir = concatenate_strings(heap_allocator(), cache_dir, str_lit("/parse"));
+	if (!make_directory(cache_dir) || !make_directory(dir)) {
+		gb_printf_err("Unable to create the parse cache directory '%.*s'\n", LIT(dir));
+		return;
+	}
+	global_parse_cache_dir = dir;
+}
+
+// NOTE: A worker of 'odin server' keeps the parsed files in the server's memory, see 'server.cpp'
+bool parse_cache_enabled(void) {
+	return global_parse_cache_dir.len > 0 || server_worker_active();
+}
+
+void parse_cache_file_path(char *buf, isize buf_len, u64 const hash[2]) {
+	gb_snprintf(buf, buf_len, "%.*s/%016llx%016llx.ast", LIT(global_parse_cache_dir),
+	            cast(unsigned long long)hash[0], cast(unsigned long long)hash[1]);
+}
+
+
+void pcc_bytes(ParseCacheCodec *c, void *data, isize size) {
+	switch (c->mode) {
+	case ParseCache_Write:
+		array_add_elems(&c->buf, cast(u8 *)data, size);
+		break;
+	case ParseCache_Read:
+		if (c->read_failed || c->read_end-c->read_curr < size) {
+			c->read_failed = true;
+			gb_zero_size(data, size);
+			break;
+		}
+		gb_memmove(data, c->read_curr, size);
+		c->read_curr += size;
+		break;
+	}
+}
+
+template <typename T>
+void pcc_value(ParseCacheCodec *c, T *value) {
+	pcc_bytes(c, value, gb_size_of(T));
+}
+
+void pcc_string(ParseCacheCodec *c, String *s) {
+	if (c->mode == ParseCache_Collect) {
+		return;
+	}
+
+	u8 kind = ParseCacheString_Empty;
+	u32 offset = 0;
+	u32 len = 0;
+	if (c->mode == ParseCache_Write) {
+		len = cast(u32)s->len;
+		if (s->len == 0) {
+			kind = ParseCacheString_Empty;
+		} else if (s->text >= c->source.text && s->text+s->len <= c->source.text+c->source.len) {
+			kind = ParseCacheString_Source;
+			offset = cast(u32)(s->text - c->source.text);
+		} else if (*s == c->file->fullpath) {
+			kind = ParseCacheString_File;
+		} else {
+			kind = ParseCacheString_Inline;
+		}
+	}
+
+	pcc_value(c, &kind);
+	switch (kind) {
+	case ParseCacheString_Empty:
+		if (c->mode == ParseCache_Read) {
+			*s = {};
+		}
+		break;
+	case ParseCacheString_Source:
+		pcc_value(c, &offset);
+		pcc_value(c, &len);
+		if (c->mode == ParseCache_Read) {
+			if (cast(isize)offset + cast(isize)len > c->source.len) {
+				c->read_failed = true;
+				break;
+			}
+			*s = make_string(c->source.text+offset, len);
+		}
+		break;
+	case ParseCacheString_File:
+		if (c->mode == ParseCache_Read) {
+			*s = c->file->fullpath;
+		}
+		break;
+	case ParseCacheString_Inline:
+		pcc_value(c, &len);
+		if (c->mode == ParseCache_Write) {
+			array_add_elems(&c->buf, s->text, s->len);
+		} else {
+			// NOTE: Points into the loaded cache data, which lives as long as the file
+			if (c->read_end-c->read_curr < len) {
+				c->read_failed = true;
+				break;
+			}
+			*s = make_string(c->read_curr, len);
+			c->read_curr += len;
+		}
+		break;
+	default:
+		c->read_failed = true;
+		break;
+	}
+}
+
+void pcc_token(ParseCacheCodec *c, Token *t) {
+	if (c->mode == ParseCache_Collect) {
+		return;
+	}
+	u32 kind = cast(u32)t->kind;
+	pcc_value(c, &kind);
+	if (kind >= Token_Count) {
+		c->read_failed = true;
+	}
+	t->kind = cast(TokenKind)kind;
+	pcc_string(c, &t->string);
+	pcc_string(c, &t->pos.file);
+	pcc_value(c, &t->pos.offset);
+	pcc_value(c, &t->pos.line);
+	pcc_value(c, &t->pos.column);
+}
+
+void pcc_node(ParseCacheCodec *c, Ast **node) {
+	u32 id = 0;
+	switch (c->mode) {
+	case ParseCache_Collect:
+		if (*node != nullptr && map_get(&c->node_ids, hash_pointer(*node)) == nullptr) {
+			array_add(&c->nodes, *node);
+			map_set(&c->node_ids, hash_pointer(*node), c->nodes.count);
+		}
+		break;
+	case ParseCache_Write:
+		if (*node != nullptr) {
+			isize *found = map_get(&c->node_ids, hash_pointer(*node));
+			GB_ASSERT(found != nullptr);
+			id = cast(u32)*found;
+		}
+		pcc_value(c, &id);
+		break;
+	case ParseCache_Read:
+		pcc_value(c, &id);
+		if (id > c->nodes.count) {
+			c->read_failed = true;
+			id = 0;
+		}
+		*node = id ? c->nodes[id-1] : nullptr;
+		break;
+	}
+}
+
+void pcc_nodes(ParseCacheCodec *c, Array<Ast *> *nodes) {
+	i64 count = nodes->count;
+	pcc_value(c, &count);
+	if (c->mode == ParseCache_Read) {
+		if (count < 0 || count > c->read_end-c->read_curr) {
+			c->read_failed = true;
+			count = 0;
+		}
+		*nodes = array_make<Ast *>(heap_allocator(), count);
+	}
+	for_array(i, *nodes) {
+		pcc_node(c, &(*nodes)[i]);
+	}
+}
+
+void pcc_tokens(ParseCacheCodec *c, Array<Token> *tokens) {
+	i64 count = tokens->count;
+	pcc_value(c, &count);
+	if (c->mode == ParseCache_Read) {
+		if (count < 0 || count > c->read_end-c->read_curr) {
+			c->read_failed = true;
+			count = 0;
+		}
+		*tokens = array_make<Token>(heap_allocator(), count);
+	}
+	for_array(i, *tokens) {
+		pcc_token(c, &(*tokens)[i]);
+	}
+}
+
+void pcc_strings(ParseCacheCodec *c, Array<String> *strings) {
+	i64 count = strings->count;
+	pcc_value(c, &count);
+	if (c->mode == ParseCache_Read) {
+		if (count < 0 || count > c->read_end-c->read_curr) {
+			c->read_failed = true;
+			count = 0;
+		}
+		*strings = array_make<String>(heap_allocator(), count);
+	}
+	for_array(i, *strings) {
+		pcc_string(c, &(*strings)[i]);
+	}
+}
+
+void pcc_comment_group(ParseCacheCodec *c, CommentGroup **cg) {
+	u32 id = 0;
+	switch (c->mode) {
+	case ParseCache_Write:
+		if (*cg != nullptr) {
+			isize *found = map_get(&c->comment_ids, hash_pointer(*cg));
+			GB_ASSERT(found != nullptr);
+			id = cast(u32)*found;
+		}
+		pcc_value(c, &id);
+		break;
+	case ParseCache_Read:
+		pcc_value(c, &id);
+		if (id > c->comments.count) {
+			c->read_failed = true;
+			id = 0;
+		}
+		*cg = id ? c->comments[id-1] : nullptr;
+		break;
+	}
+}
+
+
+void pcc_node_fields(ParseCacheCodec *c, Ast *node) {
+	pcc_value(c, &node->state_flags);
+	pcc_value(c, &node->viral_state_flags);
+
+	switch (node->kind) {
+	case_ast_node(n, Ident, node);
+		pcc_token(c, &n->token);
+		if (c->mode == ParseCache_Read && !c->read_failed) {
+			n->atom = atom_intern(n->token.string);
+		}
+	case_end;
+	case_ast_node(n, Implicit, node);
+		pcc_token(c, n);
+	case_end;
+	case_ast_node(n, Undef, node);
+		pcc_token(c, n);
+	case_end;
+	case_ast_node(n, BasicLit, node);
+		pcc_token(c, &n->token);
+		if (c->mode == ParseCache_Read && !c->read_failed) {
+			n->value = exact_value_from_basic_literal(n->token);
+		}
+	case_end;
+	case_ast_node(n, BasicDirective, node);
+		pcc_token(c, &n->token);
+		pcc_string(c, &n->name);
+	case_end;
+	case_ast_node(n, Ellipsis, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->expr);
+	case_end;
+	case_ast_node(n, ProcGroup, node);
+		pcc_token(c, &n->token);
+		pcc_token(c, &n->open);
+		pcc_token(c, &n->close);
+		pcc_nodes(c, &n->args);
+	case_end;
+	case_ast_node(n, ProcLit, node);
+		pcc_node(c, &n->type);
+		pcc_node(c, &n->body);
+		pcc_value(c, &n->tags);
+		pcc_value(c, &n->inlining);
+		pcc_token(c, &n->where_token);
+		pcc_nodes(c, &n->where_clauses);
+	case_end;
+	case_ast_node(n, CompoundLit, node);
+		pcc_node(c, &n->type);
+		pcc_nodes(c, &n->elems);
+		pcc_token(c, &n->open);
+		pcc_token(c, &n->close);
+		pcc_value(c, &n->max_count);
+	case_end;
+
+	case_ast_node(n, BadExpr, node);
+		pcc_token(c, &n->begin);
+		pcc_token(c, &n->end);
+	case_end;
+	case_ast_node(n, TagExpr, node);
+		pcc_token(c, &n->token);
+		pcc_token(c, &n->name);
+		pcc_node(c, &n->expr);
+	case_end;
+	case_ast_node(n, UnaryExpr, node);
+		pcc_token(c, &n->op);
+		pcc_node(c, &n->expr);
+	case_end;
+	case_ast_node(n, BinaryExpr, node);
+		pcc_token(c, &n->op);
+		pcc_node(c, &n->left);
+		pcc_node(c, &n->right);
+	case_end;
+	case_ast_node(n, ParenExpr, node);
+		pcc_node(c, &n->expr);
+		pcc_token(c, &n->open);
+		pcc_token(c, &n->close);
+	case_end;
+	case_ast_node(n, SelectorExpr, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->expr);
+		pcc_node(c, &n->selector);
+	case_end;
+	case_ast_node(n, ImplicitSelectorExpr, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->selector);
+	case_end;
+	case_ast_node(n, IndexExpr, node);
+		pcc_node(c, &n->expr);
+		pcc_node(c, &n->index);
+		pcc_token(c, &n->open);
+		pcc_token(c, &n->close);
+	case_end;
+	case_ast_node(n, DerefExpr, node);
+		pcc_token(c, &n->op);
+		pcc_node(c, &n->expr);
+	case_end;
+	case_ast_node(n, SliceExpr, node);
+		pcc_node(c, &n->expr);
+		pcc_token(c, &n->open);
+		pcc_token(c, &n->close);
+		pcc_token(c, &n->interval);
+		pcc_node(c, &n->low);
+		pcc_node(c, &n->high);
+	case_end;
+	case_ast_node(n, CallExpr, node);
+		pcc_node(c, &n->proc);
+		pcc_nodes(c, &n->args);
+		pcc_token(c, &n->open);
+		pcc_token(c, &n->close);
+		pcc_token(c, &n->ellipsis);
+		pcc_value(c, &n->inlining);
+	case_end;
+	case_ast_node(n, FieldValue, node);
+		pcc_token(c, &n->eq);
+		pcc_node(c, &n->field);
+		pcc_node(c, &n->value);
+	case_end;
+	case_ast_node(n, TernaryExpr, node);
+		pcc_node(c, &n->cond);
+		pcc_node(c, &n->x);
+		pcc_node(c, &n->y);
+	case_end;
+	case_ast_node(n, TernaryIfExpr, node);
+		pcc_node(c, &n->x);
+		pcc_node(c, &n->cond);
+		pcc_node(c, &n->y);
+	case_end;
+	case_ast_node(n, TernaryWhenExpr, node);
+		pcc_node(c, &n->x);
+		pcc_node(c, &n->cond);
+		pcc_node(c, &n->y);
+	case_end;
+	case_ast_node(n, TypeAssertion, node);
+		pcc_node(c, &n->expr);
+		pcc_token(c, &n->dot);
+		pcc_node(c, &n->type);
+	case_end;
+	case_ast_node(n, TypeCast, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->type);
+		pcc_node(c, &n->expr);
+	case_end;
+	case_ast_node(n, AutoCast, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->expr);
+	case_end;
+
+	case_ast_node(n, BadStmt, node);
+		pcc_token(c, &n->begin);
+		pcc_token(c, &n->end);
+	case_end;
+	case_ast_node(n, EmptyStmt, node);
+		pcc_token(c, &n->token);
+	case_end;
+	case_ast_node(n, ExprStmt, node);
+		pcc_node(c, &n->expr);
+	case_end;
+	case_ast_node(n, TagStmt, node);
+		pcc_token(c, &n->token);
+		pcc_token(c, &n->name);
+		pcc_node(c, &n->stmt);
+	case_end;
+	case_ast_node(n, AssignStmt, node);
+		pcc_token(c, &n->op);
+		pcc_nodes(c, &n->lhs);
+		pcc_nodes(c, &n->rhs);
+	case_end;
+	case_ast_node(n, IncDecStmt, node);
+		pcc_token(c, &n->op);
+		pcc_node(c, &n->expr);
+	case_end;
+	case_ast_node(n, BlockStmt, node);
+		pcc_nodes(c, &n->stmts);
+		pcc_node(c, &n->label);
+		pcc_token(c, &n->open);
+		pcc_token(c, &n->close);
+	case_end;
+	case_ast_node(n, IfStmt, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->label);
+		pcc_node(c, &n->init);
+		pcc_node(c, &n->cond);
+		pcc_node(c, &n->body);
+		pcc_node(c, &n->else_stmt);
+	case_end;
+	case_ast_node(n, WhenStmt, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->cond);
+		pcc_node(c, &n->body);
+		pcc_node(c, &n->else_stmt);
+		pcc_value(c, &n->is_cond_determined);
+		pcc_value(c, &n->determined_cond);
+	case_end;
+	case_ast_node(n, ReturnStmt, node);
+		pcc_token(c, &n->token);
+		pcc_nodes(c, &n->results);
+	case_end;
+	case_ast_node(n, ForStmt, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->label);
+		pcc_node(c, &n->init);
+		pcc_node(c, &n->cond);
+		pcc_node(c, &n->post);
+		pcc_node(c, &n->body);
+	case_end;
+	case_ast_node(n, RangeStmt, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->label);
+		pcc_node(c, &n->val0);
+		pcc_node(c, &n->val1);
+		pcc_token(c, &n->in_token);
+		pcc_node(c, &n->expr);
+		pcc_node(c, &n->body);
+	case_end;
+	case_ast_node(n, InlineRangeStmt, node);
+		pcc_token(c, &n->inline_token);
+		pcc_token(c, &n->for_token);
+		pcc_node(c, &n->val0);
+		pcc_node(c, &n->val1);
+		pcc_token(c, &n->in_token);
+		pcc_node(c, &n->expr);
+		pcc_node(c, &n->body);
+	case_end;
+	case_ast_node(n, CaseClause, node);
+		pcc_token(c, &n->token);
+		pcc_nodes(c, &n->list);
+		pcc_nodes(c, &n->stmts);
+	case_end;
+	case_ast_node(n, SwitchStmt, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->label);
+		pcc_node(c, &n->init);
+		pcc_node(c, &n->tag);
+		pcc_node(c, &n->body);
+		pcc_value(c, &n->partial);
+	case_end;
+	case_ast_node(n, TypeSwitchStmt, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->label);
+		pcc_node(c, &n->tag);
+		pcc_node(c, &n->body);
+		pcc_value(c, &n->partial);
+	case_end;
+	case_ast_node(n, DeferStmt, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->stmt);
+	case_end;
+	case_ast_node(n, BranchStmt, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->label);
+	case_end;
+	case_ast_node(n, UsingStmt, node);
+		pcc_token(c, &n->token);
+		pcc_nodes(c, &n->list);
+	case_end;
+
+	case_ast_node(n, BadDecl, node);
+		pcc_token(c, &n->begin);
+		pcc_token(c, &n->end);
+	case_end;
+	case_ast_node(n, ForeignBlockDecl, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->foreign_library);
+		pcc_node(c, &n->body);
+		pcc_nodes(c, &n->attributes);
+		pcc_comment_group(c, &n->docs);
+	case_end;
+	case_ast_node(n, Label, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->name);
+	case_end;
+	case_ast_node(n, ValueDecl, node);
+		pcc_nodes(c, &n->names);
+		pcc_node(c, &n->type);
+		pcc_nodes(c, &n->values);
+		pcc_nodes(c, &n->attributes);
+		pcc_comment_group(c, &n->docs);
+		pcc_comment_group(c, &n->comment);
+		pcc_value(c, &n->is_using);
+		pcc_value(c, &n->is_mutable);
+	case_end;
+	case_ast_node(n, PackageDecl, node);
+		pcc_token(c, &n->token);
+		pcc_token(c, &n->name);
+		pcc_comment_group(c, &n->docs);
+		pcc_comment_group(c, &n->comment);
+	case_end;
+	case_ast_node(n, ImportDecl, node);
+		pcc_token(c, &n->token);
+		pcc_token(c, &n->relpath);
+		pcc_string(c, &n->fullpath);
+		pcc_token(c, &n->import_name);
+		pcc_comment_group(c, &n->docs);
+		pcc_comment_group(c, &n->comment);
+		pcc_value(c, &n->is_using);
+	case_end;
+	case_ast_node(n, ForeignImportDecl, node);
+		pcc_token(c, &n->token);
+		pcc_tokens(c, &n->filepaths);
+		pcc_token(c, &n->library_name);
+		pcc_string(c, &n->collection_name);
+		pcc_strings(c, &n->fullpaths);
+		pcc_nodes(c, &n->attributes);
+		pcc_comment_group(c, &n->docs);
+		pcc_comment_group(c, &n->comment);
+	case_end;
+
+	case_ast_node(n, Attribute, node);
+		pcc_token(c, &n->token);
+		pcc_nodes(c, &n->elems);
+		pcc_token(c, &n->open);
+		pcc_token(c, &n->close);
+	case_end;
+	case_ast_node(n, Field, node);
+		pcc_nodes(c, &n->names);
+		pcc_node(c, &n->type);
+		pcc_node(c, &n->default_value);
+		pcc_token(c, &n->tag);
+		pcc_value(c, &n->flags);
+		pcc_comment_group(c, &n->docs);
+		pcc_comment_group(c, &n->comment);
+	case_end;
+	case_ast_node(n, FieldList, node);
+		pcc_token(c, &n->token);
+		pcc_nodes(c, &n->list);
+	case_end;
+
+	case_ast_node(n, TypeidType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->specialization);
+	case_end;
+	case_ast_node(n, HelperType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->type);
+	case_end;
+	case_ast_node(n, DistinctType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->type);
+	case_end;
+	case_ast_node(n, OpaqueType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->type);
+	case_end;
+	case_ast_node(n, PolyType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->type);
+		pcc_node(c, &n->specialization);
+	case_end;
+	case_ast_node(n, ProcType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->params);
+		pcc_node(c, &n->results);
+		pcc_value(c, &n->tags);
+		pcc_value(c, &n->calling_convention);
+		pcc_value(c, &n->generic);
+		pcc_value(c, &n->diverging);
+	case_end;
+	case_ast_node(n, PointerType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->type);
+	case_end;
+	case_ast_node(n, ArrayType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->count);
+		pcc_node(c, &n->elem);
+		pcc_node(c, &n->tag);
+	case_end;
+	case_ast_node(n, DynamicArrayType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->elem);
+		pcc_node(c, &n->tag);
+	case_end;
+	case_ast_node(n, StructType, node);
+		pcc_token(c, &n->token);
+		pcc_nodes(c, &n->fields);
+		pcc_value(c, &n->field_count);
+		pcc_node(c, &n->polymorphic_params);
+		pcc_node(c, &n->align);
+		pcc_token(c, &n->where_token);
+		pcc_nodes(c, &n->where_clauses);
+		pcc_value(c, &n->is_packed);
+		pcc_value(c, &n->is_raw_union);
+	case_end;
+	case_ast_node(n, UnionType, node);
+		pcc_token(c, &n->token);
+		pcc_nodes(c, &n->variants);
+		pcc_node(c, &n->polymorphic_params);
+		pcc_node(c, &n->align);
+		pcc_value(c, &n->maybe);
+		pcc_value(c, &n->no_nil);
+		pcc_token(c, &n->where_token);
+		pcc_nodes(c, &n->where_clauses);
+	case_end;
+	case_ast_node(n, EnumType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->base_type);
+		pcc_nodes(c, &n->fields);
+		pcc_value(c, &n->is_using);
+	case_end;
+	case_ast_node(n, BitFieldType, node);
+		pcc_token(c, &n->token);
+		pcc_nodes(c, &n->fields);
+		pcc_node(c, &n->align);
+	case_end;
+	case_ast_node(n, BitSetType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->elem);
+		pcc_node(c, &n->underlying);
+	case_end;
+	case_ast_node(n, MapType, node);
+		pcc_token(c, &n->token);
+		pcc_node(c, &n->count);
+		pcc_node(c, &n->key);
+		pcc_node(c, &n->value);
+	case_end;
+
+	default:
+		GB_PANIC("Unhandled node kind in the parse cache: %.*s", LIT(ast_strings[node->kind]));
+		break;
+	}
+}
+
+// NOTE: The file level fields are visited in the same order for every mode
+void pcc_file_roots(ParseCacheCodec *c, AstFile *f) {
+	pcc_node(c, &f->pkg_decl);
+	pcc_nodes(c, &f->decls);
+	pcc_nodes(c, &f->imports);
+	pcc_token(c, &f->package_token);
+	pcc_string(c, &f->package_name);
+}
+
+
+void parse_cache_codec_init(ParseCacheCodec *c, ParseCacheMode mode, AstFile *f) {
+	c->mode = mode;
+	c->file = f;
+	c->source = make_string(f->tokenizer.start, f->tokenizer.end - f->tokenizer.start);
+	map_init(&c->node_ids, heap_allocator());
+	map_init(&c->comment_ids, heap_allocator());
+	array_init(&c->nodes, heap_allocator());
+	array_init(&c->comments, heap_allocator());
+	array_init(&c->buf, heap_allocator());
+}
+
+void parse_cache_codec_destroy(ParseCacheCodec *c) {
+	map_destroy(&c->node_ids);
+	map_destroy(&c->comment_ids);
+	array_free(&c->nodes);
+	array_free(&c->comments);
+	array_free(&c->buf);
+}
+
+void parse_cache_hash_source(AstFile *f, u64 hash[2]) {
+	isize len = f->tokenizer.end - f->tokenizer.start;
+	MurmurHash3_x64_128(f->tokenizer.start, len, PARSE_CACHE_VERSION, hash);
+}
+
+
+// NOTE: Called after 'parse_file' has parsed the declarations but before they are set up,
+// which resolves import paths relative to the file's location
+void parse_cache_store(AstFile *f) {
+	u64 start_time = time_stamp_time_now();
+
+	ParseCacheCodec c = {};
+	parse_cache_codec_init(&c, ParseCache_Collect, f);
+	defer (parse_cache_codec_destroy(&c));
+
+	for_array(i, f->comments) {
+		map_set(&c.comment_ids, hash_pointer(f->comments[i]), i+1);
+	}
+	pcc_file_roots(&c, f);
+	for (isize i = 0; i < c.nodes.count; i++) {
+		pcc_node_fields(&c, c.nodes[i]);
+	}
+
+	ParseCacheHeader header = {};
+	header.magic               = PARSE_CACHE_MAGIC;
+	header.version             = PARSE_CACHE_VERSION;
+	header.ast_size            = gb_size_of(Ast);
+	header.token_kind_count    = Token_Count;
+	header.content_len         = c.source.len;
+	header.token_count         = f->token_count;
+	header.line_count          = f->tokenizer.line_count;
+	header.comment_group_count = f->comments.count;
+	header.node_count          = c.nodes.count;
+	parse_cache_hash_source(f, header.content_hash);
+
+	c.mode = ParseCache_Write;
+	pcc_value(&c, &header);
+	for_array(i, f->comments) {
+		pcc_tokens(&c, &f->comments[i]->list);
+	}
+	for_array(i, c.nodes) {
+		u16 kind = cast(u16)c.nodes[i]->kind;
+		pcc_value(&c, &kind);
+	}
+	for_array(i, c.nodes) {
+		pcc_node_fields(&c, c.nodes[i]);
+	}
+	pcc_file_roots(&c, f);
+
+	if (server_worker_active()) {
+		server_worker_send_parsed_file(f->fullpath, header.content_hash, c.buf.data, c.buf.count);
+		gb_atomic64_fetch_add(&global_parse_cache_stats.store_count, 1);
+	}
+
+	if (global_parse_cache_dir.len > 0) {
+		// NOTE: Write to a temporary file and move it into place so readers never see a partial file
+		char path[4096] = {};
+		char tmp_path[4096] = {};
+		parse_cache_file_path(path, gb_size_of(path), header.content_hash);
+		gb_snprintf(tmp_path, gb_size_of(tmp_path), "%s.%u.%llu.tmp", path, gb_thread_current_id(), cast(unsigned long long)start_time);
+
+		gbFile file = {};
+		if (gb_file_create(&file, tmp_path) == gbFileError_None) {
+			bool ok = gb_file_write(&file, c.buf.data, c.buf.count) != 0;
+			gb_file_close(&file);
+			if (ok && replace_file(make_string_c(tmp_path), make_string_c(path))) {
+				gb_atomic64_fetch_add(&global_parse_cache_stats.store_count, 1);
+			} else {
+				gb_file_remove(tmp_path);
+			}
+		}
+	}
+
+	gb_atomic64_fetch_add(&global_parse_cache_stats.store_time, cast(i64)(time_stamp_time_now() - start_time));
+}
+
+// NOTE: Fills in the AstFile as 'parse_file' would have before 'parse_setup_file_decls'
+bool parse_cache_load(AstFile *f) {
+	u64 start_time = time_stamp_time_now();
+	defer (gb_atomic64_fetch_add(&global_parse_cache_stats.load_time, cast(i64)(time_stamp_time_now() - start_time)));
+
+	u64 hash[2] = {};
+	parse_cache_hash_source(f, hash);
+
+	// NOTE: The server's resident files are not owned by 'f'
+	gbFileContents fc = {};
+	bool owns_data = true;
+	ServerParsedFile *resident = server_find_parsed_file(hash);
+	if (resident != nullptr) {
+		fc.data = resident->data;
+		fc.size = resident->size;
+		owns_data = false;
+	} else if (global_parse_cache_dir.len > 0) {
+		char path[4096] = {};
+		parse_cache_file_path(path, gb_size_of(path), hash);
+		fc = gb_file_read_contents(heap_allocator(), false, path);
+	}
+	if (fc.data == nullptr) {
+		gb_atomic64_fetch_add(&global_parse_cache_stats.miss_count, 1);
+		return false;
+	}
+	if (fc.size < gb_size_of(ParseCacheHeader)) {
+		if (owns_data) {
+			gb_file_free_contents(&fc);
+		}
+		gb_atomic64_fetch_add(&global_parse_cache_stats.miss_count, 1);
+		return false;
+	}
+
+	ParseCacheCodec c = {};
+	parse_cache_codec_init(&c, ParseCache_Read, f);
+	defer (parse_cache_codec_destroy(&c));
+	c.read_curr = cast(u8 *)fc.data;
+	c.read_end  = c.read_curr + fc.size;
+
+	ParseCacheHeader header = {};
+	pcc_value(&c, &header);
+	if (header.magic               != PARSE_CACHE_MAGIC   ||
+	    header.version             != PARSE_CACHE_VERSION ||
+	    header.ast_size            != gb_size_of(Ast)     ||
+	    header.token_kind_count    != Token_Count         ||
+	    header.content_hash[0]     != hash[0]             ||
+	    header.content_hash[1]     != hash[1]             ||
+	    header.content_len         != c.source.len        ||
+	    header.comment_group_count < 0                    ||
+	    header.node_count          < 0                    ||
+	    header.node_count          > c.read_end-c.read_curr) {
+		if (owns_data) {
+			gb_file_free_contents(&fc);
+		}
+		gb_atomic64_fetch_add(&global_parse_cache_stats.miss_count, 1);
+		return false;
+	}
+
+	for (i64 i = 0; i < header.comment_group_count && !c.read_failed; i++) {
+		CommentGroup *cg = gb_alloc_item(ast_allocator(), CommentGroup);
+		pcc_tokens(&c, &cg->list);
+		array_add(&c.comments, cg);
+	}
+	array_resize(&c.nodes, cast(isize)header.node_count);
+	for_array(i, c.nodes) {
+		u16 kind = 0;
+		pcc_value(&c, &kind);
+		// NOTE: The begin/end markers of the node ranges have no name and are never allocated
+		if (kind == Ast_Invalid || kind >= Ast_COUNT || ast_strings[kind].len == 0) {
+			c.read_failed = true;
+			break;
+		}
+		c.nodes[i] = alloc_ast_node(f, cast(AstKind)kind);
+	}
+	for (isize i = 0; i < c.nodes.count && !c.read_failed; i++) {
+		pcc_node_fields(&c, c.nodes[i]);
+	}
+	pcc_file_roots(&c, f);
+
+	if (c.read_failed || c.read_curr != c.read_end) {
+		// NOTE: Corrupt or stale entry, parse the file normally
+		f->pkg_decl = nullptr;
+		array_free(&f->decls);
+		array_free(&f->imports);
+		array_init(&f->imports, heap_allocator());
+		f->package_token = {};
+		f->package_name = {};
+		if (owns_data) {
+			gb_file_free_contents(&fc);
+		}
+		gb_atomic64_fetch_add(&global_parse_cache_stats.miss_count, 1);
+		return false;
+	}
+
+	for_array(i, c.comments) {
+		array_add(&f->comments, c.comments[i]);
+	}
+	f->token_count = cast(isize)header.token_count;
+	f->tokenizer.line_count = cast(isize)header.line_count;
+	f->parse_cache_data = owns_data ? fc.data : nullptr;
+
+	gb_atomic64_fetch_add(&global_parse_cache_stats.hit_count, 1);
+	return true;
+}
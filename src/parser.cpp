@@ -569,6 +569,7 @@ Ast *ast_deref_expr(AstFile *f, Ast *expr, Token op) {
 Ast *ast_ident(AstFile *f, Token token) {
 	Ast *result = alloc_ast_node(f, Ast_Ident);
 	result->Ident.token = token;
+	result->Ident.atom  = atom_intern(token.string);
 	return result;
 }
 
@@ -1082,9 +1083,72 @@ Ast *ast_attribute(AstFile *f, Token token, Token open, Token close, Array<Ast *
 }
 
 
+Token ast_file_lex_token(AstFile *f) {
+	Token token = tokenizer_get_token(&f->tokenizer);
+	if (token.kind == Token_Invalid) {
+		// NOTE: Report it like the array mode does and end the file here
+		if (f->stream_error == ParseFile_None) {
+			f->stream_error = ParseFile_InvalidToken;
+			String name = remove_directory_from_path(f->fullpath);
+			syntax_error(token, "Failed to parse file: %.*s; invalid token found in file", LIT(name));
+		}
+		token.kind = Token_EOF;
+	}
+	f->token_count += 1;
+	return token;
+}
+
+void ast_file_grow_token_ring(AstFile *f) {
+	isize new_cap = gb_max(2*f->token_ring_cap, AST_FILE_TOKEN_RING_INIT_CAP);
+	Token *new_ring = gb_alloc_array(heap_allocator(), Token, new_cap);
+	for (isize i = f->token_ring_start; i < f->token_ring_start+f->token_ring_count; i++) {
+		new_ring[i & (new_cap-1)] = f->token_ring[i & (f->token_ring_cap-1)];
+	}
+	gb_free(heap_allocator(), f->token_ring);
+	f->token_ring = new_ring;
+	f->token_ring_cap = new_cap;
+}
+
+Token ast_file_stream_token(AstFile *f, isize index) {
+	GB_ASSERT_MSG(index >= f->token_ring_start, "Streamed token %td has already been discarded", index);
+	while (index >= f->token_ring_start+f->token_ring_count) {
+		// NOTE: Only the current token and the lookahead are kept
+		while (f->token_ring_count > 0 && f->token_ring_start < f->curr_token_index) {
+			f->token_ring_start += 1;
+			f->token_ring_count -= 1;
+		}
+		if (f->token_ring_count == f->token_ring_cap) {
+			ast_file_grow_token_ring(f);
+		}
+		isize next = f->token_ring_start+f->token_ring_count;
+		f->token_ring[next & (f->token_ring_cap-1)] = ast_file_lex_token(f);
+		f->token_ring_count += 1;
+	}
+	return f->token_ring[index & (f->token_ring_cap-1)];
+}
+
+Token ast_file_token(AstFile *f, isize index) {
+	if (f->stream_tokens) {
+		return ast_file_stream_token(f, index);
+	}
+	return token_from_compact(&f->tokenizer, f->tokens[index], &f->curr_token_line_hint);
+}
+
+TokenKind ast_file_token_kind(AstFile *f, isize index) {
+	if (f->stream_tokens) {
+		return ast_file_stream_token(f, index).kind;
+	}
+	return cast(TokenKind)f->tokens[index].kind;
+}
+
 bool next_token0(AstFile *f) {
-	if (f->curr_token_index+1 < f->tokens.count) {
-		f->curr_token = f->tokens[++f->curr_token_index];
+	if (f->stream_tokens) {
+		if (f->curr_token.kind != Token_EOF) {
+			f->curr_token = ast_file_token(f, ++f->curr_token_index);
+			return true;
+		}
+	} else if (f->curr_token_index+1 < f->tokens.count) {
+		f->curr_token = ast_file_token(f, ++f->curr_token_index);
 		return true;
 	}
 	syntax_error(f->curr_token, "Token is EOF");
@@ -1170,12 +1234,13 @@ Token advance_token(AstFile *f) {
 }
 
 bool peek_token_kind(AstFile *f, TokenKind kind) {
-	for (isize i = f->curr_token_index+1; i < f->tokens.count; i++) {
-		Token tok = f->tokens[i];
-		if (kind != Token_Comment && tok.kind == Token_Comment) {
+	isize count = f->stream_tokens ? ISIZE_MAX : f->tokens.count;
+	for (isize i = f->curr_token_index+1; i < count; i++) {
+		TokenKind tok_kind = ast_file_token_kind(f, i);
+		if (kind != Token_Comment && tok_kind == Token_Comment) {
 			continue;
 		}
-		return tok.kind == kind;
+		return tok_kind == kind;
 	}
 	return false;
 }
@@ -1648,8 +1713,8 @@ Ast *convert_stmt_to_expr(AstFile *f, Ast *statement, String kind) {
 
 	syntax_error(f->curr_token, "Expected '%.*s', found a simple statement.", LIT(kind));
 	Token end = f->curr_token;
-	if (f->tokens.count < f->curr_token_index) {
-		end = f->tokens[f->curr_token_index+1];
+	if (f->token_count < f->curr_token_index) {
+		end = ast_file_token(f, f->curr_token_index+1);
 	}
 	return ast_bad_expr(f, f->curr_token, end);
 }
@@ -3536,7 +3601,7 @@ Ast *parse_if_stmt(AstFile *f) {
 		} break;
 		default:
 			syntax_error(f->curr_token, "Expected if statement block statement");
-			else_stmt = ast_bad_stmt(f, f->curr_token, f->tokens[f->curr_token_index+1]);
+			else_stmt = ast_bad_stmt(f, f->curr_token, ast_file_token(f, f->curr_token_index+1));
 			break;
 		}
 	}
@@ -3581,7 +3646,7 @@ Ast *parse_when_stmt(AstFile *f) {
 		} break;
 		default:
 			syntax_error(f->curr_token, "Expected when statement block statement");
-			else_stmt = ast_bad_stmt(f, f->curr_token, f->tokens[f->curr_token_index+1]);
+			else_stmt = ast_bad_stmt(f, f->curr_token, ast_file_token(f, f->curr_token_index+1));
 			break;
 		}
 	}
@@ -4252,39 +4317,70 @@ ParseFileError init_ast_file(AstFile *f, String fullpath, TokenPos *err_pos) {
 
 	}
 
-	isize file_size = f->tokenizer.end - f->tokenizer.start;
-	isize init_token_cap = cast(isize)gb_max(next_pow2(cast(i64)(file_size/2ll)), 16);
-	array_init(&f->tokens, heap_allocator(), 0, gb_max(init_token_cap, 16));
+	array_init(&f->comments, heap_allocator());
+	array_init(&f->imports, heap_allocator());
+	f->init_diagnostic_count = thread_diagnostic_count;
 
-	if (err == TokenizerInit_Empty) {
-		Token token = {Token_EOF};
-		token.pos.file   = fullpath;
-		token.pos.line   = 1;
-		token.pos.column = 1;
-		array_add(&f->tokens, token);
+	if (err == TokenizerInit_None && parse_cache_enabled() && parse_cache_load(f)) {
+		f->from_parse_cache = true;
 		return ParseFile_None;
 	}
 
-	while (f->curr_token.kind != Token_EOF) {
-		Token token = tokenizer_get_token(&f->tokenizer);
-		if (token.kind == Token_Invalid) {
-			err_pos->line   = token.pos.line;
-			err_pos->column = token.pos.column;
-			return ParseFile_InvalidToken;
+	if (build_context.stream_tokens) {
+		// NOTE: Tokens are pulled on demand by the parser through 'token_ring'
+		f->stream_tokens = true;
+		ast_file_grow_token_ring(f);
+
+		Token token = {};
+		token.kind = Token_EOF;
+		if (err != TokenizerInit_Empty) {
+			token = tokenizer_get_token(&f->tokenizer);
+			if (token.kind == Token_Invalid) {
+				err_pos->line   = token.pos.line;
+				err_pos->column = token.pos.column;
+				return ParseFile_InvalidToken;
+			}
+		}
+		f->token_ring[0] = token;
+		f->token_ring_count = 1;
+		f->token_count = 1;
+		if (err == TokenizerInit_Empty) {
+			return ParseFile_None;
+		}
+	} else {
+		isize file_size = f->tokenizer.end - f->tokenizer.start;
+		isize init_token_cap = cast(isize)gb_max(next_pow2(cast(i64)(file_size/2ll)), 16);
+		array_init(&f->tokens, heap_allocator(), 0, gb_max(init_token_cap, 16));
+
+		if (err == TokenizerInit_Empty) {
+			CompactToken token = {};
+			token.kind = Token_EOF;
+			array_add(&f->tokens, token);
+			tokenizer_init_line_offsets(&f->tokenizer);
+			f->token_count = f->tokens.count;
+			return ParseFile_None;
 		}
-		array_add(&f->tokens, token);
 
-		if (token.kind == Token_EOF) {
-			break;
+		for (;;) {
+			Token token = tokenizer_get_token(&f->tokenizer);
+			if (token.kind == Token_Invalid) {
+				err_pos->line   = token.pos.line;
+				err_pos->column = token.pos.column;
+				return ParseFile_InvalidToken;
+			}
+			array_add(&f->tokens, compact_token(&f->tokenizer, token));
+
+			if (token.kind == Token_EOF) {
+				break;
+			}
 		}
+		tokenizer_init_line_offsets(&f->tokenizer);
+		f->token_count = f->tokens.count;
 	}
 
 	f->curr_token_index = 0;
-	f->prev_token = f->tokens[f->curr_token_index];
-	f->curr_token = f->tokens[f->curr_token_index];
-
-	array_init(&f->comments, heap_allocator());
-	array_init(&f->imports, heap_allocator());
+	f->prev_token = ast_file_token(f, f->curr_token_index);
+	f->curr_token = f->prev_token;
 
 	f->curr_proc = nullptr;
 
@@ -4294,6 +4390,8 @@ ParseFileError init_ast_file(AstFile *f, String fullpath, TokenPos *err_pos) {
 void destroy_ast_file(AstFile *f) {
 	GB_ASSERT(f != nullptr);
 	array_free(&f->tokens);
+	gb_free(heap_allocator(), f->token_ring);
+	gb_free(heap_allocator(), f->parse_cache_data);
 	array_free(&f->comments);
 	array_free(&f->imports);
 	gb_free(heap_allocator(), f->tokenizer.fullpath.text);
@@ -4306,6 +4404,7 @@ bool init_parser(Parser *p) {
 	map_init(&p->package_map, heap_allocator());
 	array_init(&p->packages, heap_allocator());
 	array_init(&p->package_imports, heap_allocator());
+	array_init(&p->files_to_process, heap_allocator());
 	gb_mutex_init(&p->file_add_mutex);
 	gb_mutex_init(&p->file_decl_mutex);
 	return true;
@@ -4328,6 +4427,10 @@ void destroy_parser(Parser *p) {
 #endif
 	array_free(&p->packages);
 	array_free(&p->package_imports);
+	for_array(i, p->files_to_process) {
+		gb_free(heap_allocator(), p->files_to_process[i]);
+	}
+	array_free(&p->files_to_process);
 	string_set_destroy(&p->imported_files);
 	map_destroy(&p->package_map);
 	gb_mutex_destroy(&p->file_add_mutex);
@@ -4358,8 +4461,10 @@ ParseFileError process_imported_file(Parser *p, ImportedFile const &imported_fil
 
 WORKER_TASK_PROC(parser_worker_proc) {
 	ParserWorkerData *wd = cast(ParserWorkerData *)data;
-	ParseFileError err = process_imported_file(wd->parser, wd->imported_file);
-	return cast(isize)err;
+	u64 trace_start = trace_time_now();
+	wd->err = process_imported_file(wd->parser, wd->imported_file);
+	trace_add_event("parse", wd->imported_file.fi.fullpath, trace_start);
+	return cast(isize)wd->err;
 }
 
 
@@ -4369,6 +4474,7 @@ void parser_add_file_to_process(Parser *p, AstPackage *pkg, FileInfo fi, TokenPo
 	auto wd = gb_alloc_item(heap_allocator(), ParserWorkerData);
 	wd->parser = p;
 	wd->imported_file = f;
+	array_add(&p->files_to_process, wd);
 	thread_pool_add_task(&parser_thread_pool, parser_worker_proc, wd);
 }
 
@@ -4797,25 +4903,9 @@ String dir_from_path(String path) {
 	return base_dir;
 }
 
-bool parse_file(Parser *p, AstFile *f) {
-	if (f->tokens.count == 0) {
-		return true;
-	}
-	if (f->tokens.count > 0 && f->tokens[0].kind == Token_EOF) {
-		return true;
-	}
-
-	String filepath = f->tokenizer.fullpath;
-	String base_dir = dir_from_path(filepath);
-	comsume_comment_groups(f, f->prev_token);
-
-	CommentGroup *docs = f->lead_comment;
-
-	f->package_token = expect_token(f, Token_package);
-	if (f->package_token.kind != Token_package) {
-		return false;
-	}
-	Token package_name = expect_token_after(f, Token_Ident, "package");
+// NOTE: Checks which depend on where the file is used rather than on its contents,
+// so they are also run for files loaded from the parse cache
+bool parse_file_check_package_header(AstFile *f, Token package_name, CommentGroup *docs) {
 	if (package_name.kind == Token_Ident) {
 		if (package_name.string == "_") {
 			syntax_error(package_name, "Invalid package name '_'");
@@ -4843,6 +4933,48 @@ bool parse_file(Parser *p, AstFile *f) {
 			}
 		}
 	}
+	return true;
+}
+
+bool parse_file_from_cache(Parser *p, AstFile *f) {
+	String base_dir = dir_from_path(f->tokenizer.fullpath);
+	GB_ASSERT(f->pkg_decl != nullptr && f->pkg_decl->kind == Ast_PackageDecl);
+	ast_node(pd, PackageDecl, f->pkg_decl);
+	if (!parse_file_check_package_header(f, pd->name, pd->docs)) {
+		return false;
+	}
+	if (f->error_count > 0) {
+		return false;
+	}
+	parse_setup_file_decls(p, f, base_dir, f->decls);
+	return true;
+}
+
+bool parse_file(Parser *p, AstFile *f) {
+	if (f->from_parse_cache) {
+		return parse_file_from_cache(p, f);
+	}
+	if (f->token_count == 0) {
+		return true;
+	}
+	if (f->token_count > 0 && ast_file_token_kind(f, 0) == Token_EOF) {
+		return true;
+	}
+
+	String filepath = f->tokenizer.fullpath;
+	String base_dir = dir_from_path(filepath);
+	comsume_comment_groups(f, f->prev_token);
+
+	CommentGroup *docs = f->lead_comment;
+
+	f->package_token = expect_token(f, Token_package);
+	if (f->package_token.kind != Token_package) {
+		return false;
+	}
+	Token package_name = expect_token_after(f, Token_Ident, "package");
+	if (!parse_file_check_package_header(f, package_name, docs)) {
+		return false;
+	}
 
 	Ast *pd = ast_package_decl(f, f->package_token, package_name, docs, f->line_comment);
 	expect_semicolon(f, pd);
@@ -4866,6 +4998,10 @@ bool parse_file(Parser *p, AstFile *f) {
 		}
 	}
 
+	if (parse_cache_enabled() && thread_diagnostic_count == f->init_diagnostic_count) {
+		parse_cache_store(f);
+	}
+
 	parse_setup_file_decls(p, f, base_dir, f->decls);
 
 	return true;
@@ -4883,7 +5019,9 @@ ParseFileError process_imported_file(Parser *p, ImportedFile const &imported_fil
 	file->id = imported_file.index+1;
 
 	TokenPos err_pos = {0};
+	u64 tokenize_start = time_stamp_time_now();
 	ParseFileError err = init_ast_file(file, fi->fullpath, &err_pos);
+	u64 tokenize_time = time_stamp_time_now() - tokenize_start;
 	err_pos.file = fi->fullpath;
 
 	if (err != ParseFile_None) {
@@ -4918,7 +5056,13 @@ ParseFileError process_imported_file(Parser *p, ImportedFile const &imported_fil
 		}
 	}
 
-	if (parse_file(p, file)) {
+	bool parsed = parse_file(p, file);
+	if (file->stream_error != ParseFile_None) {
+		// NOTE: Already reported when the streamed token was lexed
+		return file->stream_error;
+	}
+
+	if (parsed) {
 		gb_mutex_lock(&p->file_add_mutex);
 		defer (gb_mutex_unlock(&p->file_add_mutex));
 
@@ -4926,18 +5070,57 @@ ParseFileError process_imported_file(Parser *p, ImportedFile const &imported_fil
 
 		if (pkg->name.len == 0) {
 			pkg->name = file->package_name;
-		} else if (file->tokens.count > 0 && pkg->name != file->package_name) {
+		} else if (file->token_count > 0 && pkg->name != file->package_name) {
 			syntax_error(file->package_token, "Different package name, expected '%.*s', got '%.*s'", LIT(pkg->name), LIT(file->package_name));
 		}
 
 		p->total_line_count += file->tokenizer.line_count;
-		p->total_token_count += file->tokens.count;
+		p->total_token_count += file->token_count;
+		p->total_tokenize_time += tokenize_time;
 	}
 
 	return ParseFile_None;
 }
 
 
+// NOTE: 'string_compare' treats a prefix as equal, which would leave "core/strconv" and
+// "core/strconv/decimal" in an arbitrary order
+int ast_path_compare(String const &x, String const &y) {
+	int cmp = string_compare(x, y);
+	if (cmp == 0 && x.len != y.len) {
+		cmp = x.len < y.len ? -1 : +1;
+	}
+	return cmp;
+}
+
+GB_COMPARE_PROC(ast_package_path_cmp) {
+	AstPackage *x = *cast(AstPackage **)a;
+	AstPackage *y = *cast(AstPackage **)b;
+	return ast_path_compare(x->fullpath, y->fullpath);
+}
+
+GB_COMPARE_PROC(ast_file_path_cmp) {
+	AstFile *x = *cast(AstFile **)a;
+	AstFile *y = *cast(AstFile **)b;
+	return ast_path_compare(x->fullpath, y->fullpath);
+}
+
+// NOTE: Packages and files are added in the order the parser threads finish them. Sorting them by path,
+// and renumbering them, makes the checker and the generated code the same from one build to the next.
+void parser_sort_packages(Parser *p) {
+	gb_sort_array(p->packages.data, p->packages.count, ast_package_path_cmp);
+
+	isize file_id = 0;
+	for_array(i, p->packages) {
+		AstPackage *pkg = p->packages[i];
+		pkg->id = i+1;
+		gb_sort_array(pkg->files.data, pkg->files.count, ast_file_path_cmp);
+		for_array(j, pkg->files) {
+			pkg->files[j]->id = ++file_id;
+		}
+	}
+}
+
 ParseFileError parse_packages(Parser *p, String init_filename) {
 	GB_ASSERT(init_filename.text[init_filename.len] == 0);
 
@@ -4966,10 +5149,11 @@ ParseFileError parse_packages(Parser *p, String init_filename) {
 	thread_pool_start(&parser_thread_pool);
 	thread_pool_wait_to_process(&parser_thread_pool);
 
+	parser_sort_packages(p);
+
 	// NOTE(bill): Get the last error and use that
-	for (isize i = parser_thread_pool.task_tail-1; i >= 0; i--) {
-		WorkerTask *task = &parser_thread_pool.tasks[i];
-		ParseFileError err = cast(ParseFileError)task->result;
+	for (isize i = p->files_to_process.count-1; i >= 0; i--) {
+		ParseFileError err = p->files_to_process[i]->err;
 		if (err != ParseFile_None) {
 			return err;
 		}
@@ -43,6 +43,8 @@ enum ParseFileError {
 	ParseFile_Count,
 };
 
+#define AST_FILE_TOKEN_RING_INIT_CAP 16
+
 struct CommentGroup {
 	Array<Token> list; // Token_Comment
 };
@@ -78,8 +80,24 @@ struct AstFile {
 	Ast *        pkg_decl;
 	String       fullpath;
 	Tokenizer    tokenizer;
-	Array<Token> tokens;
+	Array<CompactToken> tokens; // NOTE: Expand with 'ast_file_token'
+	isize        token_count;
+
+	// NOTE: Used instead of 'tokens' when tokens are pulled from the tokenizer on demand
+	bool           stream_tokens;
+	ParseFileError stream_error;
+	Token *        token_ring; // NOTE: Indexed with 'index & (token_ring_cap-1)'
+	isize          token_ring_cap;
+	isize          token_ring_start;
+	isize          token_ring_count;
+
+	// NOTE: Set when the AST was loaded from the on-disk parse cache instead of being parsed
+	bool         from_parse_cache;
+	void *       parse_cache_data;
+	i64          init_diagnostic_count;
+
 	isize        curr_token_index;
+	isize        curr_token_line_hint;
 	Token        curr_token;
 	Token        prev_token; // previous non-comment
 	Token        package_token;
@@ -128,6 +146,8 @@ struct AstPackage {
 };
 
 
+struct ParserWorkerData;
+
 struct Parser {
 	String                 init_fullpath;
 	StringSet              imported_files; // fullpath
@@ -135,8 +155,10 @@ struct Parser {
 	Array<AstPackage *>    packages;
 	Array<ImportedPackage> package_imports;
 	isize                  file_to_process_count;
+	Array<ParserWorkerData *> files_to_process; // NOTE: Guarded by 'file_add_mutex'
 	isize                  total_token_count;
 	isize                  total_line_count;
+	u64                    total_tokenize_time; // summed across all parser threads
 	gbMutex                file_add_mutex;
 	gbMutex                file_decl_mutex;
 };
@@ -147,6 +169,7 @@ gb_global ThreadPool parser_thread_pool = {};
 struct ParserWorkerData {
 	Parser *parser;
 	ImportedFile imported_file;
+	ParseFileError err;
 };
 
 
@@ -223,6 +246,7 @@ enum StmtAllowFlag {
 	AST_KIND(Ident,          "identifier",      struct { \
 		Token   token;  \
 		Entity *entity; \
+		Atom *  atom;   \
 	}) \
 	AST_KIND(Implicit,       "implicit",        Token) \
 	AST_KIND(Undef,          "undef",           Token) \
@@ -580,6 +604,7 @@ struct Ast {
 	u32          state_flags;
 	u32          viral_state_flags;
 	bool         been_handled;
+	i32          untyped_index; // NOTE: Of the slot in the 'UntypedTable' which holds this expression, if any
 	AstFile *    file;
 	Scope *      scope;
 	TypeAndValue tav;
@@ -620,11 +645,36 @@ gb_inline bool is_ast_when_stmt(Ast *node) {
 	return node->kind == Ast_WhenStmt;
 }
 
-gb_global Arena global_ast_arena = {};
+// NOTE: Each thread bump allocates AST nodes from its own arena without locking.
+// The arenas are registered globally and live for the rest of the build.
+gb_global gbMutex        global_ast_arenas_mutex;
+gb_global Array<Arena *> global_ast_arenas;
+gb_thread_local Arena *  thread_ast_arena = nullptr;
+
+void init_global_ast_arenas(void) {
+	gb_mutex_init(&global_ast_arenas_mutex);
+	array_init(&global_ast_arenas, heap_allocator());
+}
+
+Arena *get_thread_ast_arena(void) {
+	Arena *arena = thread_ast_arena;
+	if (arena == nullptr) {
+		arena = gb_alloc_item(heap_allocator(), Arena);
+		gb_zero_item(arena);
+		arena_init(arena, heap_allocator());
+		arena->single_threaded = true;
+
+		gb_mutex_lock(&global_ast_arenas_mutex);
+		array_add(&global_ast_arenas, arena);
+		gb_mutex_unlock(&global_ast_arenas_mutex);
+
+		thread_ast_arena = arena;
+	}
+	return arena;
+}
 
 gbAllocator ast_allocator(void) {
-	Arena *arena = &global_ast_arena;
-	return arena_allocator(arena);
+	return arena_allocator(get_thread_ast_arena());
 }
 
 Ast *alloc_ast_node(AstFile *f, AstKind kind);
@@ -0,0 +1,556 @@
+// server.cpp
+//
+// 'odin server' stays resident and serves the 'build', 'check' and 'query' commands of the clients which
+// find it through the ODIN_SERVER environment variable, which holds the path of its socket. Only the parsed
+// files are kept resident: each request runs in a worker process forked from the server, which checks and
+// builds the whole program from scratch. A worker sends back the AST of each file it parsed, in the format
+// of 'parse_cache.cpp', and the later workers load any file whose contents hash the same rather than parsing
+// it again. The entries of files whose modification time changed are dropped before each request.
+
+#define SERVER_PROTOCOL_MAGIC 0x3153444f // "ODS1"
+
+enum ServerFrameKind : u8 {
+	ServerFrame_Stdout = 1,
+	ServerFrame_Stderr = 2,
+	ServerFrame_Exit   = 3,
+};
+
+struct ServerParsedFile {
+	String     fullpath;
+	gbFileTime last_write_time;
+	u64        hash[2];
+	u8 *       data;
+	isize      size;
+};
+
+struct ServerState {
+	Map<ServerParsedFile *> parsed_files;         // Key: the contents hash
+	Map<ServerParsedFile *> parsed_files_by_path; // Key: String
+	bool    is_worker;
+	int     worker_fd;  // NOTE: The pipe a worker sends the files it parsed back to the server on
+	gbMutex worker_mutex;
+};
+
+gb_global ServerState global_server = {};
+
+
+bool server_worker_active(void) {
+	return global_server.is_worker;
+}
+
+HashKey server_hash_key(u64 const hash[2]) {
+	return hash_string(make_string(cast(u8 *)hash, 2*gb_size_of(u64)));
+}
+
+// NOTE: The resident AST of a file with these contents, if a previous request parsed it
+ServerParsedFile *server_find_parsed_file(u64 const hash[2]) {
+	if (!global_server.is_worker) {
+		return nullptr;
+	}
+	ServerParsedFile **found = map_get(&global_server.parsed_files, server_hash_key(hash));
+	if (found == nullptr) {
+		return nullptr;
+	}
+	ServerParsedFile *pf = *found;
+	if (pf->hash[0] != hash[0] || pf->hash[1] != hash[1]) {
+		return nullptr;
+	}
+	return pf;
+}
+
+#if defined(GB_SYSTEM_WINDOWS)
+
+void server_worker_send_parsed_file(String fullpath, u64 const hash[2], u8 const *data, isize size) {
+	GB_PANIC("'odin server' workers are not supported on this platform");
+}
+
+bool server_run(Array<String> *args) {
+	gb_printf_err("'odin server' is not supported on this platform\n");
+	return false;
+}
+
+bool server_client_run(Array<String> const &args, i32 *exit_code) {
+	char const *env = getenv("ODIN_SERVER");
+	if (env == nullptr || env[0] == 0) {
+		return false;
+	}
+	gb_printf_err("ODIN_SERVER is set, but 'odin server' is not supported on this platform\n");
+	*exit_code = 1;
+	return true;
+}
+
+#else
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+
+bool server_write_all(int fd, void const *data, isize size) {
+	u8 const *p = cast(u8 const *)data;
+	while (size > 0) {
+		isize n = write(fd, p, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool server_read_all(int fd, void *data, isize size) {
+	u8 *p = cast(u8 *)data;
+	while (size > 0) {
+		isize n = read(fd, p, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+void server_write_string(Array<u8> *buf, String s) {
+	u32 len = cast(u32)s.len;
+	array_add_elems(buf, cast(u8 *)&len, gb_size_of(len));
+	array_add_elems(buf, s.text, s.len);
+}
+
+bool server_read_string(int fd, String *s) {
+	u32 len = 0;
+	if (!server_read_all(fd, &len, gb_size_of(len)) || len > (1u<<20)) {
+		return false;
+	}
+	u8 *text = cast(u8 *)gb_alloc(heap_allocator(), len+1);
+	text[len] = 0;
+	if (!server_read_all(fd, text, len)) {
+		gb_free(heap_allocator(), text);
+		return false;
+	}
+	*s = make_string(text, len);
+	return true;
+}
+
+bool server_write_frame(int fd, ServerFrameKind kind, void const *data, u32 size) {
+	u8 header[5] = {kind};
+	gb_memmove(header+1, &size, gb_size_of(size));
+	return server_write_all(fd, header, gb_size_of(header)) && server_write_all(fd, data, size);
+}
+
+String server_default_socket_path(void) {
+	char const *env = getenv("ODIN_SERVER");
+	if (env != nullptr && env[0] != 0) {
+		return make_string_c(cast(char *)env);
+	}
+	char buf[256] = {};
+	isize len = gb_snprintf(buf, gb_size_of(buf), "/tmp/odin-server-%u.sock", cast(unsigned)getuid());
+	return copy_string(heap_allocator(), make_string(cast(u8 *)buf, len-1));
+}
+
+bool server_socket_address(String path, struct sockaddr_un *addr) {
+	gb_zero_item(addr);
+	addr->sun_family = AF_UNIX;
+	if (path.len >= gb_size_of(addr->sun_path)) {
+		gb_printf_err("The server socket path is too long: '%.*s'\n", LIT(path));
+		return false;
+	}
+	gb_memmove(addr->sun_path, path.text, path.len);
+	return true;
+}
+
+
+void server_init_parsed_files(void) {
+	map_init(&global_server.parsed_files, heap_allocator());
+	map_init(&global_server.parsed_files_by_path, heap_allocator());
+}
+
+// NOTE: Called in a forked process, which will send the files it parses back on 'files_fd'
+void server_worker_init(int files_fd) {
+	global_server.is_worker = true;
+	global_server.worker_fd = files_fd;
+	gb_mutex_init(&global_server.worker_mutex);
+}
+
+// NOTE: Called from the parser threads of a worker with the encoded AST of a file which parsed cleanly
+void server_worker_send_parsed_file(String fullpath, u64 const hash[2], u8 const *data, isize size) {
+	if (!global_server.is_worker) {
+		return;
+	}
+	char *path_c = alloc_cstring(heap_allocator(), fullpath);
+	defer (gb_free(heap_allocator(), path_c));
+	i64 last_write_time = cast(i64)gb_file_last_write_time(path_c);
+
+	u32 path_len = cast(u32)fullpath.len;
+	u64 data_len = cast(u64)size;
+
+	gb_mutex_lock(&global_server.worker_mutex);
+	defer (gb_mutex_unlock(&global_server.worker_mutex));
+	int fd = global_server.worker_fd;
+	server_write_all(fd, hash, 2*gb_size_of(u64));
+	server_write_all(fd, &last_write_time, gb_size_of(last_write_time));
+	server_write_all(fd, &path_len, gb_size_of(path_len));
+	server_write_all(fd, &data_len, gb_size_of(data_len));
+	server_write_all(fd, fullpath.text, fullpath.len);
+	server_write_all(fd, data, size);
+}
+
+void server_remove_parsed_file(ServerParsedFile *pf) {
+	ServerState *s = &global_server;
+	ServerParsedFile **by_hash = map_get(&s->parsed_files, server_hash_key(pf->hash));
+	if (by_hash != nullptr && *by_hash == pf) {
+		map_remove(&s->parsed_files, server_hash_key(pf->hash));
+	}
+	ServerParsedFile **by_path = map_get(&s->parsed_files_by_path, hash_string(pf->fullpath));
+	if (by_path != nullptr && *by_path == pf) {
+		map_remove(&s->parsed_files_by_path, hash_string(pf->fullpath));
+	}
+	gb_free(heap_allocator(), pf->data);
+	gb_free(heap_allocator(), pf->fullpath.text);
+	gb_free(heap_allocator(), pf);
+}
+
+// NOTE: Takes in the files a worker sent back, replacing older entries for the same paths
+void server_add_parsed_files(Array<u8> const &records) {
+	ServerState *s = &global_server;
+	isize header_size = 2*gb_size_of(u64) + gb_size_of(i64) + gb_size_of(u32) + gb_size_of(u64);
+	isize offset = 0;
+	while (records.count - offset >= header_size) {
+		u8 const *p = records.data + offset;
+		u64 hash[2] = {};
+		i64 last_write_time = 0;
+		u32 path_len = 0;
+		u64 data_len = 0;
+		gb_memmove(hash, p, gb_size_of(hash));                          p += gb_size_of(hash);
+		gb_memmove(&last_write_time, p, gb_size_of(last_write_time));   p += gb_size_of(last_write_time);
+		gb_memmove(&path_len, p, gb_size_of(path_len));                 p += gb_size_of(path_len);
+		gb_memmove(&data_len, p, gb_size_of(data_len));                 p += gb_size_of(data_len);
+		if (cast(u64)(records.count - offset - header_size) < path_len + data_len) {
+			break;
+		}
+		String fullpath = make_string(cast(u8 *)p, path_len);
+		u8 const *data = p + path_len;
+		offset += header_size + path_len + cast(isize)data_len;
+
+		ServerParsedFile **old = map_get(&s->parsed_files_by_path, hash_string(fullpath));
+		if (old != nullptr) {
+			server_remove_parsed_file(*old);
+		}
+		ServerParsedFile **same = map_get(&s->parsed_files, server_hash_key(hash));
+		if (same != nullptr) {
+			// NOTE: One entry per contents is kept, as a file's path is rebound when its AST is loaded
+			server_remove_parsed_file(*same);
+		}
+
+		ServerParsedFile *pf = gb_alloc_item(heap_allocator(), ServerParsedFile);
+		pf->fullpath = copy_string(heap_allocator(), fullpath);
+		pf->last_write_time = cast(gbFileTime)last_write_time;
+		pf->hash[0] = hash[0];
+		pf->hash[1] = hash[1];
+		pf->size = cast(isize)data_len;
+		pf->data = cast(u8 *)gb_alloc_copy(heap_allocator(), data, pf->size);
+		map_set(&s->parsed_files, server_hash_key(pf->hash), pf);
+		map_set(&s->parsed_files_by_path, hash_string(pf->fullpath), pf);
+	}
+}
+
+// NOTE: Drops the resident files which changed on disk since they were parsed
+void server_remove_changed_files(void) {
+	ServerState *s = &global_server;
+	auto changed = array_make<ServerParsedFile *>(heap_allocator());
+	defer (array_free(&changed));
+	for_array(i, s->parsed_files_by_path.entries) {
+		ServerParsedFile *pf = s->parsed_files_by_path.entries[i].value;
+		char *path_c = alloc_cstring(heap_allocator(), pf->fullpath);
+		gbFileTime last_write_time = gb_file_exists(path_c) ? gb_file_last_write_time(path_c) : 0;
+		gb_free(heap_allocator(), path_c);
+		if (last_write_time != pf->last_write_time) {
+			array_add(&changed, pf);
+		}
+	}
+	for_array(i, changed) {
+		server_remove_parsed_file(changed[i]);
+	}
+}
+
+// NOTE: Forwards the worker's output to the client as it comes, and collects the files it parsed
+i32 server_serve_worker(int client_fd, pid_t pid, int out_fd, int err_fd, int files_fd) {
+	auto records = array_make<u8>(heap_allocator(), 0, 1<<20);
+	defer (array_free(&records));
+
+	struct pollfd fds[3] = {};
+	fds[0].fd = out_fd;
+	fds[1].fd = err_fd;
+	fds[2].fd = files_fd;
+	for (isize i = 0; i < gb_count_of(fds); i++) {
+		fds[i].events = POLLIN;
+	}
+	bool client_ok = true;
+	isize open_count = gb_count_of(fds);
+	u8 buf[1<<16];
+	while (open_count > 0) {
+		if (poll(fds, gb_count_of(fds), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		for (isize i = 0; i < gb_count_of(fds); i++) {
+			if (fds[i].fd < 0 || fds[i].revents == 0) {
+				continue;
+			}
+			isize n = read(fds[i].fd, buf, gb_size_of(buf));
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				close(fds[i].fd);
+				fds[i].fd = -1;
+				open_count -= 1;
+				continue;
+			}
+			if (i == 2) {
+				array_add_elems(&records, buf, n);
+			} else if (client_ok) {
+				ServerFrameKind kind = i == 0 ? ServerFrame_Stdout : ServerFrame_Stderr;
+				client_ok = server_write_frame(client_fd, kind, buf, cast(u32)n);
+			}
+		}
+	}
+
+	int status = 0;
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+	}
+	i32 exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+	if (client_ok) {
+		server_write_frame(client_fd, ServerFrame_Exit, &exit_code, gb_size_of(exit_code));
+	}
+
+	// NOTE: A worker which crashed may have left a partial record, which is ignored
+	server_add_parsed_files(records);
+	return exit_code;
+}
+
+// NOTE: Serves requests until it fails. In a worker process forked for a request, it returns true with
+// 'args' set to the request's arguments, for 'main' to carry on with.
+bool server_run(Array<String> *args) {
+	String socket_path = server_default_socket_path();
+	for (isize i = 2; i < args->count; i++) {
+		String arg = (*args)[i];
+		String prefix = str_lit("-socket:");
+		if (string_starts_with(arg, prefix)) {
+			socket_path = substring(arg, prefix.len, arg.len);
+		} else {
+			gb_printf_err("Unknown flag for 'odin server': '%.*s'\n", LIT(arg));
+			return false;
+		}
+	}
+
+	struct sockaddr_un addr = {};
+	if (!server_socket_address(socket_path, &addr)) {
+		return false;
+	}
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		gb_printf_err("Unable to create the server socket\n");
+		return false;
+	}
+	unlink(addr.sun_path);
+	if (bind(listen_fd, cast(struct sockaddr *)&addr, gb_size_of(addr)) != 0 || listen(listen_fd, 16) != 0) {
+		gb_printf_err("Unable to listen on '%.*s'\n", LIT(socket_path));
+		close(listen_fd);
+		return false;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	ServerState *s = &global_server;
+	server_init_parsed_files();
+	gb_printf("Odin server listening on '%.*s'\n", LIT(socket_path));
+
+	for (;;) {
+		int client_fd = accept(listen_fd, nullptr, nullptr);
+		if (client_fd < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			gb_printf_err("Unable to accept a connection on '%.*s'\n", LIT(socket_path));
+			break;
+		}
+
+		u32 header[2] = {};
+		String cwd = {};
+		auto request_args = array_make<String>(heap_allocator());
+		bool ok = server_read_all(client_fd, header, gb_size_of(header)) &&
+		          header[0] == SERVER_PROTOCOL_MAGIC && header[1] >= 2 && header[1] < 4096 &&
+		          server_read_string(client_fd, &cwd);
+		for (u32 i = 0; ok && i < header[1]; i++) {
+			String arg = {};
+			ok = server_read_string(client_fd, &arg);
+			array_add(&request_args, arg);
+		}
+		if (!ok || request_args.count < 2 || request_args[1] == "server") {
+			close(client_fd);
+			continue;
+		}
+
+		u64 start_time = time_stamp_time_now();
+		server_remove_changed_files();
+
+		int out_pipe[2] = {-1, -1};
+		int err_pipe[2] = {-1, -1};
+		int files_pipe[2] = {-1, -1};
+		if (pipe(out_pipe) != 0 || pipe(err_pipe) != 0 || pipe(files_pipe) != 0) {
+			gb_printf_err("Unable to create the pipes for a worker\n");
+			break;
+		}
+
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(listen_fd);
+			close(client_fd);
+			close(out_pipe[0]);
+			close(err_pipe[0]);
+			close(files_pipe[0]);
+			dup2(out_pipe[1], 1);
+			dup2(err_pipe[1], 2);
+			close(out_pipe[1]);
+			close(err_pipe[1]);
+			signal(SIGPIPE, SIG_DFL);
+
+			server_worker_init(files_pipe[1]);
+
+			char *cwd_c = alloc_cstring(heap_allocator(), cwd);
+			if (chdir(cwd_c) != 0) {
+				gb_printf_err("Unable to change to the directory '%.*s'\n", LIT(cwd));
+				gb_exit(1);
+			}
+			*args = request_args;
+			return true;
+		}
+
+		close(out_pipe[1]);
+		close(err_pipe[1]);
+		close(files_pipe[1]);
+		i32 exit_code = 1;
+		if (pid < 0) {
+			close(out_pipe[0]);
+			close(err_pipe[0]);
+			close(files_pipe[0]);
+			String msg = str_lit("The server was unable to start a worker\n");
+			server_write_frame(client_fd, ServerFrame_Stderr, msg.text, cast(u32)msg.len);
+			server_write_frame(client_fd, ServerFrame_Exit, &exit_code, gb_size_of(exit_code));
+		} else {
+			exit_code = server_serve_worker(client_fd, pid, out_pipe[0], err_pipe[0], files_pipe[0]);
+		}
+		close(client_fd);
+
+		f64 ms = 1000.0*cast(f64)(time_stamp_time_now() - start_time)/cast(f64)time_stamp__freq();
+		gb_printf("%.*s %.*s - exit %d - %.3f ms - %td files resident\n",
+		          LIT(request_args[1]), LIT(request_args.count > 2 ? request_args[2] : str_lit("")),
+		          exit_code, ms, s->parsed_files_by_path.entries.count);
+
+		for_array(i, request_args) {
+			gb_free(heap_allocator(), request_args[i].text);
+		}
+		array_free(&request_args);
+		gb_free(heap_allocator(), cwd.text);
+	}
+
+	close(listen_fd);
+	return false;
+}
+
+// NOTE: Forwards the command to the server named by ODIN_SERVER, if there is one running. Returns false
+// when the command should run in this process.
+bool server_client_run(Array<String> const &args, i32 *exit_code) {
+	if (args.count < 3) {
+		return false;
+	}
+	String command = args[1];
+	if (command != "build" && command != "check" && command != "query") {
+		return false;
+	}
+	for_array(i, args) {
+		if (args[i] == "-watch") {
+			// NOTE: 'check -watch' stays running itself, see 'watch.cpp'
+			return false;
+		}
+	}
+	char const *env = getenv("ODIN_SERVER");
+	if (env == nullptr || env[0] == 0) {
+		return false;
+	}
+
+	struct sockaddr_un addr = {};
+	if (!server_socket_address(make_string_c(cast(char *)env), &addr)) {
+		return false;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return false;
+	}
+	if (connect(fd, cast(struct sockaddr *)&addr, gb_size_of(addr)) != 0) {
+		close(fd);
+		return false;
+	}
+	defer (close(fd));
+	signal(SIGPIPE, SIG_IGN);
+
+	char cwd[4096] = {};
+	if (getcwd(cwd, gb_size_of(cwd)) == nullptr) {
+		return false;
+	}
+	auto request = array_make<u8>(heap_allocator());
+	defer (array_free(&request));
+	u32 header[2] = {SERVER_PROTOCOL_MAGIC, cast(u32)args.count};
+	array_add_elems(&request, cast(u8 *)header, gb_size_of(header));
+	server_write_string(&request, make_string_c(cwd));
+	for_array(i, args) {
+		server_write_string(&request, args[i]);
+	}
+	if (!server_write_all(fd, request.data, request.count)) {
+		return false;
+	}
+
+	auto buf = array_make<u8>(heap_allocator(), 0, 1<<16);
+	defer (array_free(&buf));
+	for (;;) {
+		u8 frame[5] = {};
+		u32 size = 0;
+		if (!server_read_all(fd, frame, gb_size_of(frame))) {
+			break;
+		}
+		gb_memmove(&size, frame+1, gb_size_of(size));
+		array_resize(&buf, size);
+		if (!server_read_all(fd, buf.data, size)) {
+			break;
+		}
+		switch (frame[0]) {
+		case ServerFrame_Stdout:
+			server_write_all(1, buf.data, size);
+			break;
+		case ServerFrame_Stderr:
+			server_write_all(2, buf.data, size);
+			break;
+		case ServerFrame_Exit:
+			GB_ASSERT(size == gb_size_of(i32));
+			gb_memmove(exit_code, buf.data, gb_size_of(i32));
+			return true;
+		}
+	}
+
+	gb_printf_err("The connection to the server at '%s' was lost\n", env);
+	*exit_code = 1;
+	return true;
+}
+
+#endif
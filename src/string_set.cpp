@@ -152,6 +152,8 @@ void string_set__erase(StringSet *s, StringSetFindResult fr) {
 	} else {
 		s->hashes[last.hash_index] = fr.entry_index;
 	}
+	// NOTE: The last entry has been moved, see 'map__erase'
+	array_pop(&s->entries);
 }
 
 void string_set_remove(StringSet *s, String str) {
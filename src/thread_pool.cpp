@@ -10,18 +10,40 @@ struct WorkerTask {
 };
 
 
+// NOTE: Chase-Lev work-stealing deque
+// The owning thread pushes and pops at 'bottom', any other thread steals from 'top'
+struct WorkerTaskRing {
+	isize       capacity; // NOTE: Power of two
+	WorkerTask *tasks;
+};
+
+struct WorkerDeque {
+	gbAtomic64  top;
+	gbAtomic64  bottom;
+	gbAtomicPtr ring; // WorkerTaskRing *
+
+	// NOTE: Rings that have been grown out of, a thief may still be reading from them
+	Array<WorkerTaskRing *> old_rings;
+};
+
+#define WORKER_DEQUE_INIT_CAPACITY 64
+
+
 struct ThreadPool {
-	gbMutex     mutex;
 	gbSemaphore sem_available;
-	gbAtomic32  processing_work_count;
+	gbAtomic64  outstanding_task_count; // NOTE: Added but not yet finished
 	bool        is_running;
 
 	gbAllocator allocator;
 
-	WorkerTask *tasks;
-	isize volatile task_head;
-	isize volatile task_tail;
-	isize volatile task_capacity;
+	// NOTE: One deque per worker thread, plus one for the thread calling 'thread_pool_wait_to_process'
+	WorkerDeque *deques;
+	isize        deque_count;
+
+	// NOTE: Tasks added from threads which are not part of the pool
+	gbMutex           inject_mutex;
+	Array<WorkerTask> inject_queue;
+	isize             inject_head;
 
 	gbThread *threads;
 	isize thread_count;
@@ -30,24 +52,116 @@ struct ThreadPool {
 	i32 worker_prefix_len;
 };
 
+gb_thread_local ThreadPool *current_thread_pool = nullptr;
+gb_thread_local isize       current_thread_pool_index = -1;
+
 void thread_pool_init(ThreadPool *pool, gbAllocator const &a, isize thread_count, char const *worker_prefix = nullptr);
 void thread_pool_destroy(ThreadPool *pool);
 void thread_pool_start(ThreadPool *pool);
 void thread_pool_join(ThreadPool *pool);
 void thread_pool_add_task(ThreadPool *pool, WorkerTaskProc *proc, void *data);
-void thread_pool_kick(ThreadPool *pool);
-void thread_pool_kick_and_wait(ThreadPool *pool);
+void thread_pool_wait_to_process(ThreadPool *pool);
 GB_THREAD_PROC(worker_thread_internal);
 
+
+WorkerTaskRing *worker_task_ring_make(gbAllocator const &a, isize capacity) {
+	GB_ASSERT(gb_is_power_of_two(capacity));
+	WorkerTaskRing *ring = gb_alloc_item(a, WorkerTaskRing);
+	ring->capacity = capacity;
+	ring->tasks = gb_alloc_array(a, WorkerTask, capacity);
+	return ring;
+}
+
+void worker_deque_init(WorkerDeque *d, gbAllocator const &a) {
+	gb_atomic64_store(&d->top, 0);
+	gb_atomic64_store(&d->bottom, 0);
+	gb_atomic_ptr_store(&d->ring, worker_task_ring_make(a, WORKER_DEQUE_INIT_CAPACITY));
+	array_init(&d->old_rings, a);
+}
+
+void worker_deque_destroy(WorkerDeque *d, gbAllocator const &a) {
+	array_add(&d->old_rings, cast(WorkerTaskRing *)gb_atomic_ptr_load(&d->ring));
+	for_array(i, d->old_rings) {
+		gb_free(a, d->old_rings[i]->tasks);
+		gb_free(a, d->old_rings[i]);
+	}
+	array_free(&d->old_rings);
+}
+
+// NOTE: Only called by the owning thread
+void worker_deque_push(WorkerDeque *d, gbAllocator const &a, WorkerTask const &task) {
+	i64 b = gb_atomic64_load(&d->bottom);
+	i64 t = gb_atomic64_load(&d->top);
+	WorkerTaskRing *ring = cast(WorkerTaskRing *)gb_atomic_ptr_load(&d->ring);
+	if (b-t >= ring->capacity) {
+		WorkerTaskRing *new_ring = worker_task_ring_make(a, 2*ring->capacity);
+		for (i64 i = t; i < b; i++) {
+			new_ring->tasks[i & (new_ring->capacity-1)] = ring->tasks[i & (ring->capacity-1)];
+		}
+		array_add(&d->old_rings, ring);
+		gb_mfence();
+		gb_atomic_ptr_store(&d->ring, new_ring);
+		ring = new_ring;
+	}
+	ring->tasks[b & (ring->capacity-1)] = task;
+	gb_mfence();
+	gb_atomic64_store(&d->bottom, b+1);
+}
+
+// NOTE: Only called by the owning thread
+bool worker_deque_pop(WorkerDeque *d, WorkerTask *task) {
+	i64 b = gb_atomic64_load(&d->bottom) - 1;
+	WorkerTaskRing *ring = cast(WorkerTaskRing *)gb_atomic_ptr_load(&d->ring);
+	gb_atomic64_exchanged(&d->bottom, b); // NOTE: Full barrier before reading 'top'
+	i64 t = gb_atomic64_load(&d->top);
+	if (t > b) {
+		gb_atomic64_store(&d->bottom, b+1);
+		return false;
+	}
+
+	*task = ring->tasks[b & (ring->capacity-1)];
+	if (t == b) {
+		// NOTE: Last task, race any thieves for it
+		bool won = gb_atomic64_compare_exchange(&d->top, t, t+1) == t;
+		gb_atomic64_store(&d->bottom, b+1);
+		return won;
+	}
+	return true;
+}
+
+bool worker_deque_steal(WorkerDeque *d, WorkerTask *task) {
+	i64 t = gb_atomic64_load(&d->top);
+	gb_mfence();
+	i64 b = gb_atomic64_load(&d->bottom);
+	if (t >= b) {
+		return false;
+	}
+
+	WorkerTaskRing *ring = cast(WorkerTaskRing *)gb_atomic_ptr_load(&d->ring);
+	WorkerTask stolen = ring->tasks[t & (ring->capacity-1)];
+	gb_mfence();
+	// NOTE: If another thread got there first, 'stolen' may be stale and is discarded
+	if (gb_atomic64_compare_exchange(&d->top, t, t+1) != t) {
+		return false;
+	}
+	*task = stolen;
+	return true;
+}
+
+
 void thread_pool_init(ThreadPool *pool, gbAllocator const &a, isize thread_count, char const *worker_prefix) {
 	pool->allocator = a;
-	pool->task_head = 0;
-	pool->task_tail = 0;
-	pool->task_capacity = 1024;
-	pool->tasks = gb_alloc_array(a, WorkerTask, pool->task_capacity);
+	gb_atomic64_store(&pool->outstanding_task_count, 0);
 	pool->thread_count = gb_max(thread_count, 0);
 	pool->threads = gb_alloc_array(a, gbThread, pool->thread_count);
-	gb_mutex_init(&pool->mutex);
+	pool->deque_count = pool->thread_count+1;
+	pool->deques = gb_alloc_array(a, WorkerDeque, pool->deque_count);
+	for (isize i = 0; i < pool->deque_count; i++) {
+		worker_deque_init(&pool->deques[i], a);
+	}
+	gb_mutex_init(&pool->inject_mutex);
+	array_init(&pool->inject_queue, a);
+	pool->inject_head = 0;
 	gb_semaphore_init(&pool->sem_available);
 	pool->is_running = true;
 
@@ -99,86 +213,109 @@ void thread_pool_destroy(ThreadPool *pool) {
 	thread_pool_join(pool);
 
 	gb_semaphore_destroy(&pool->sem_available);
-	gb_mutex_destroy(&pool->mutex);
 	gb_free(pool->allocator, pool->threads);
 	pool->thread_count = 0;
-	gb_free(pool->allocator, pool->tasks);
-	pool->task_head = 0;
-	pool->task_tail = 0;
-	pool->task_capacity = 0;
+	for (isize i = 0; i < pool->deque_count; i++) {
+		worker_deque_destroy(&pool->deques[i], pool->allocator);
+	}
+	gb_free(pool->allocator, pool->deques);
+	pool->deque_count = 0;
+	gb_mutex_destroy(&pool->inject_mutex);
+	array_free(&pool->inject_queue);
+	pool->inject_head = 0;
 }
 
 
 void thread_pool_add_task(ThreadPool *pool, WorkerTaskProc *proc, void *data) {
-	gb_mutex_lock(&pool->mutex);
-
-	if (pool->task_tail == pool->task_capacity) {
-		isize new_cap = 2*pool->task_capacity + 8;
-		WorkerTask *new_tasks = gb_alloc_array(pool->allocator, WorkerTask, new_cap);
-		gb_memmove(new_tasks, pool->tasks, (pool->task_tail)*gb_size_of(WorkerTask));
-		pool->tasks = new_tasks;
-		pool->task_capacity = new_cap;
-	}
 	WorkerTask task = {};
 	task.do_work = proc;
 	task.data = data;
 
-	pool->tasks[pool->task_tail++] = task;
+	gb_atomic64_fetch_add(&pool->outstanding_task_count, +1);
+
+	if (current_thread_pool == pool) {
+		// NOTE: Subtasks go to the local deque, idle threads will steal them
+		worker_deque_push(&pool->deques[current_thread_pool_index], pool->allocator, task);
+	} else {
+		gb_mutex_lock(&pool->inject_mutex);
+		array_add(&pool->inject_queue, task);
+		gb_mutex_unlock(&pool->inject_mutex);
+	}
 	gb_semaphore_post(&pool->sem_available, 1);
-	gb_mutex_unlock(&pool->mutex);
 }
 
-bool thread_pool_try_and_pop_task(ThreadPool *pool, WorkerTask *task) {
+bool thread_pool_try_pop_injected_task(ThreadPool *pool, WorkerTask *task) {
 	bool got_task = false;
-	if (gb_mutex_try_lock(&pool->mutex)) {
-		if (pool->task_tail > pool->task_head) {
-			gb_atomic32_fetch_add(&pool->processing_work_count, +1);
-			*task = pool->tasks[pool->task_head++];
-			got_task = true;
+	gb_mutex_lock(&pool->inject_mutex);
+	if (pool->inject_head < pool->inject_queue.count) {
+		*task = pool->inject_queue[pool->inject_head++];
+		got_task = true;
+		if (pool->inject_head == pool->inject_queue.count) {
+			array_clear(&pool->inject_queue);
+			pool->inject_head = 0;
 		}
-		gb_mutex_unlock(&pool->mutex);
 	}
+	gb_mutex_unlock(&pool->inject_mutex);
 	return got_task;
 }
+
+bool thread_pool_try_get_task(ThreadPool *pool, isize index, WorkerTask *task) {
+	if (worker_deque_pop(&pool->deques[index], task)) {
+		return true;
+	}
+	if (thread_pool_try_pop_injected_task(pool, task)) {
+		return true;
+	}
+	for (isize i = 1; i < pool->deque_count; i++) {
+		if (worker_deque_steal(&pool->deques[(index+i) % pool->deque_count], task)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void thread_pool_do_work(ThreadPool *pool, WorkerTask *task) {
 	task->result = task->do_work(task->data);
-	gb_atomic32_fetch_add(&pool->processing_work_count, -1);
+	gb_atomic64_fetch_add(&pool->outstanding_task_count, -1);
 }
 
 void thread_pool_wait_to_process(ThreadPool *pool) {
-	while (pool->task_tail > pool->task_head || gb_atomic32_load(&pool->processing_work_count) != 0) {
+	ThreadPool *prev_pool  = current_thread_pool;
+	isize       prev_index = current_thread_pool_index;
+	current_thread_pool       = pool;
+	current_thread_pool_index = pool->deque_count-1;
+
+	while (gb_atomic64_load(&pool->outstanding_task_count) != 0) {
 		WorkerTask task = {};
-		if (thread_pool_try_and_pop_task(pool, &task)) {
+		if (thread_pool_try_get_task(pool, current_thread_pool_index, &task)) {
 			thread_pool_do_work(pool, &task);
+		} else {
+			gb_yield();
 		}
-
-		// Safety-kick
-		if (pool->task_tail > pool->task_head && gb_atomic32_load(&pool->processing_work_count) == 0) {
-			gb_mutex_lock(&pool->mutex);
-			gb_semaphore_post(&pool->sem_available, cast(i32)(pool->task_tail-pool->task_head));
-			gb_mutex_unlock(&pool->mutex);
-		}
-
-		gb_yield();
 	}
 
+	current_thread_pool       = prev_pool;
+	current_thread_pool_index = prev_index;
+
 	thread_pool_join(pool);
 }
 
 
 GB_THREAD_PROC(worker_thread_internal) {
 	ThreadPool *pool = cast(ThreadPool *)thread->user_data;
-	while (pool->is_running) {
-		gb_semaphore_wait(&pool->sem_available);
+	current_thread_pool       = pool;
+	current_thread_pool_index = thread->user_index;
 
+	while (pool->is_running) {
 		WorkerTask task = {};
-		if (thread_pool_try_and_pop_task(pool, &task)) {
+		if (thread_pool_try_get_task(pool, current_thread_pool_index, &task)) {
 			thread_pool_do_work(pool, &task);
+			continue;
 		}
+		gb_semaphore_wait(&pool->sem_available);
 	}
 	// Cascade
 	gb_semaphore_release(&pool->sem_available);
 
 	return 0;
 }
-
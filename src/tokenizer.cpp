@@ -139,6 +139,65 @@ String const token_strings[] = {
 };
 
 
+
+// NOTE: Keywords are classified with a single probe into a hash table indexed by the low bits
+// of the identifier's FNV-1a hash. The table size is chosen such that every keyword lands in a
+// distinct slot, which 'init_keyword_hash_table' asserts on startup.
+#define KEYWORD_HASH_TABLE_COUNT (1<<9)
+#define KEYWORD_HASH_TABLE_MASK  (KEYWORD_HASH_TABLE_COUNT-1)
+
+struct KeywordHashEntry {
+	u32       hash;
+	TokenKind kind;
+	String    text;
+};
+
+GB_STATIC_ASSERT(Token__KeywordEnd-Token__KeywordBegin <= KEYWORD_HASH_TABLE_COUNT);
+
+gb_global KeywordHashEntry keyword_hash_table[KEYWORD_HASH_TABLE_COUNT] = {};
+gb_global isize min_keyword_size = 0;
+gb_global isize max_keyword_size = 0;
+
+gb_inline u32 keyword_hash(u8 const *text, isize len) {
+	return fnv32a(text, len);
+}
+
+void add_keyword_hash_entry(String const &s, TokenKind kind) {
+	if (min_keyword_size == 0 || s.len < min_keyword_size) {
+		min_keyword_size = s.len;
+	}
+	max_keyword_size = gb_max(max_keyword_size, s.len);
+
+	u32 hash = keyword_hash(s.text, s.len);
+	u32 index = hash & KEYWORD_HASH_TABLE_MASK;
+	KeywordHashEntry *entry = &keyword_hash_table[index];
+	GB_ASSERT_MSG(entry->kind == Token_Invalid, "Keyword hash table initialization collision: %.*s %.*s", LIT(s), LIT(entry->text));
+	entry->hash = hash;
+	entry->kind = kind;
+	entry->text = s;
+}
+
+void init_keyword_hash_table(void) {
+	for (i32 kind = Token__KeywordBegin+1; kind < Token__KeywordEnd; kind++) {
+		add_keyword_hash_entry(token_strings[kind], cast(TokenKind)kind);
+	}
+
+	// NOTE: Legacy spelling of 'not_in'
+	add_keyword_hash_entry(str_lit("notin"), Token_not_in);
+}
+
+gb_inline TokenKind keyword_kind_from_string(String const &s) {
+	if (gb_is_between(s.len, min_keyword_size, max_keyword_size)) {
+		u32 hash = keyword_hash(s.text, s.len);
+		KeywordHashEntry *entry = &keyword_hash_table[hash & KEYWORD_HASH_TABLE_MASK];
+		if (entry->kind != Token_Invalid && entry->hash == hash && entry->text == s) {
+			return entry->kind;
+		}
+	}
+	return Token_Ident;
+}
+
+
 struct TokenPos {
 	String file;
 	isize  offset; // starting at 0
@@ -194,9 +253,35 @@ struct ErrorCollector {
 
 gb_global ErrorCollector global_error_collector;
 
+// NOTE: Errors and warnings reported by the current thread, used to tell whether a file parsed cleanly
+gb_thread_local i64 thread_diagnostic_count = 0;
+
 #define MAX_ERROR_COLLECTOR_COUNT (36)
 
 
+enum DeferredErrorKind {
+	DeferredError_Warning,
+	DeferredError_Error,
+	DeferredError_ErrorNoNewline,
+	DeferredError_SyntaxError,
+	DeferredError_SyntaxWarning,
+	DeferredError_Line, // 'error_line' with no error before it
+};
+
+struct DeferredError {
+	DeferredErrorKind kind;
+	Token             token;
+	String            msg;
+	String            lines; // Text from the 'error_line' calls which followed it
+	bool              in_block;
+};
+
+// NOTE: When set, errors and warnings on this thread are stored rather than printed,
+// so that work done in parallel can report them in a deterministic order, see 'report_deferred_errors'
+gb_thread_local Array<DeferredError> *thread_deferred_errors = nullptr;
+gb_thread_local bool                  thread_deferred_in_block = false;
+
+
 void init_global_error_collector(void) {
 	gb_mutex_init(&global_error_collector.mutex);
 	array_init(&global_error_collector.errors, heap_allocator());
@@ -205,11 +290,19 @@ void init_global_error_collector(void) {
 
 
 void begin_error_block(void) {
+	if (thread_deferred_errors != nullptr) {
+		thread_deferred_in_block = true;
+		return;
+	}
 	gb_mutex_lock(&global_error_collector.mutex);
 	global_error_collector.in_block = true;
 }
 
 void end_error_block(void) {
+	if (thread_deferred_errors != nullptr) {
+		thread_deferred_in_block = false;
+		return;
+	}
 	if (global_error_collector.error_buffer.count > 0) {
 		isize n = global_error_collector.error_buffer.count;
 		u8 *text = gb_alloc_array(heap_allocator(), u8, n+1);
@@ -259,6 +352,38 @@ ERROR_OUT_PROC(default_error_out_va) {
 
 ErrorOutProc *error_out_va = default_error_out_va;
 
+
+bool defer_error_va(DeferredErrorKind kind, Token token, char const *fmt, va_list va) {
+	Array<DeferredError> *errors = thread_deferred_errors;
+	if (errors == nullptr) {
+		return false;
+	}
+
+	char buf[4096] = {};
+	isize len = gb_snprintf_va(buf, gb_size_of(buf), fmt, va);
+	String text = make_string(cast(u8 *)buf, gb_clamp(len-1, 0, gb_size_of(buf)-1));
+
+	if (kind == DeferredError_Line && errors->count > 0) {
+		DeferredError *last = &(*errors)[errors->count-1];
+		String lines = concatenate_strings(heap_allocator(), last->lines, text);
+		gb_free(heap_allocator(), last->lines.text);
+		last->lines = lines;
+		return true;
+	}
+
+	DeferredError e = {};
+	e.kind     = kind;
+	e.token    = token;
+	e.in_block = thread_deferred_in_block;
+	if (kind == DeferredError_Line) {
+		e.lines = copy_string(heap_allocator(), text);
+	} else {
+		e.msg = copy_string(heap_allocator(), text);
+	}
+	array_add(errors, e);
+	return true;
+}
+
 void error_out(char const *fmt, ...) {
 	va_list va;
 	va_start(va, fmt);
@@ -267,6 +392,10 @@ void error_out(char const *fmt, ...) {
 }
 
 void warning_va(Token token, char const *fmt, va_list va) {
+	thread_diagnostic_count += 1;
+	if (defer_error_va(DeferredError_Warning, token, fmt, va)) {
+		return;
+	}
 	gb_mutex_lock(&global_error_collector.mutex);
 	global_error_collector.warning_count++;
 	// NOTE(bill): Duplicate error, skip it
@@ -284,6 +413,10 @@ void warning_va(Token token, char const *fmt, va_list va) {
 
 
 void error_va(Token token, char const *fmt, va_list va) {
+	thread_diagnostic_count += 1;
+	if (defer_error_va(DeferredError_Error, token, fmt, va)) {
+		return;
+	}
 	gb_mutex_lock(&global_error_collector.mutex);
 	global_error_collector.count++;
 	// NOTE(bill): Duplicate error, skip it
@@ -302,12 +435,20 @@ void error_va(Token token, char const *fmt, va_list va) {
 }
 
 void error_line_va(char const *fmt, va_list va) {
+	Token token = {};
+	if (defer_error_va(DeferredError_Line, token, fmt, va)) {
+		return;
+	}
 	gb_mutex_lock(&global_error_collector.mutex);
 	error_out_va(fmt, va);
 	gb_mutex_unlock(&global_error_collector.mutex);
 }
 
 void error_no_newline_va(Token token, char const *fmt, va_list va) {
+	thread_diagnostic_count += 1;
+	if (defer_error_va(DeferredError_ErrorNoNewline, token, fmt, va)) {
+		return;
+	}
 	gb_mutex_lock(&global_error_collector.mutex);
 	global_error_collector.count++;
 	// NOTE(bill): Duplicate error, skip it
@@ -327,6 +468,10 @@ void error_no_newline_va(Token token, char const *fmt, va_list va) {
 
 
 void syntax_error_va(Token token, char const *fmt, va_list va) {
+	thread_diagnostic_count += 1;
+	if (defer_error_va(DeferredError_SyntaxError, token, fmt, va)) {
+		return;
+	}
 	gb_mutex_lock(&global_error_collector.mutex);
 	global_error_collector.count++;
 	// NOTE(bill): Duplicate error, skip it
@@ -346,6 +491,10 @@ void syntax_error_va(Token token, char const *fmt, va_list va) {
 }
 
 void syntax_warning_va(Token token, char const *fmt, va_list va) {
+	thread_diagnostic_count += 1;
+	if (defer_error_va(DeferredError_SyntaxWarning, token, fmt, va)) {
+		return;
+	}
 	gb_mutex_lock(&global_error_collector.mutex);
 	global_error_collector.warning_count++;
 	// NOTE(bill): Duplicate error, skip it
@@ -418,6 +567,41 @@ void syntax_warning(Token token, char const *fmt, ...) {
 }
 
 
+void report_deferred_error(DeferredErrorKind kind, Token token, char const *fmt, ...) {
+	va_list va;
+	va_start(va, fmt);
+	switch (kind) {
+	case DeferredError_Warning:        warning_va(token, fmt, va);          break;
+	case DeferredError_Error:          error_va(token, fmt, va);            break;
+	case DeferredError_ErrorNoNewline: error_no_newline_va(token, fmt, va); break;
+	case DeferredError_SyntaxError:    syntax_error_va(token, fmt, va);     break;
+	case DeferredError_SyntaxWarning:  syntax_warning_va(token, fmt, va);   break;
+	case DeferredError_Line:           break;
+	}
+	va_end(va);
+}
+
+// NOTE: Reports the errors in the order they were stored, as if they had never been deferred
+void report_deferred_errors(Array<DeferredError> *errors) {
+	GB_ASSERT(thread_deferred_errors == nullptr);
+	for_array(i, *errors) {
+		DeferredError *e = &(*errors)[i];
+		if (e->in_block) {
+			begin_error_block();
+		}
+		report_deferred_error(e->kind, e->token, "%.*s", LIT(e->msg));
+		if (e->lines.len > 0) {
+			error_line("%.*s", LIT(e->lines));
+		}
+		if (e->in_block) {
+			end_error_block();
+		}
+		gb_free(heap_allocator(), e->msg.text);
+		gb_free(heap_allocator(), e->lines.text);
+	}
+	array_clear(errors);
+}
+
 void compiler_error(char const *fmt, ...) {
 	va_list va;
 
@@ -484,8 +668,25 @@ struct Tokenizer {
 
 	isize error_count;
 	Array<String> allocated_strings;
+
+	bool  is_mapped;   // NOTE: 'start' is a private file mapping rather than a heap copy
+	isize mapped_size;
+
+	Array<u32> line_offsets; // Byte offset of the start of each line, see 'tokenizer_init_line_offsets'
+};
+
+
+struct TokenizerLoadStats {
+	gbAtomic64 mapped_file_count;
+	gbAtomic64 mapped_bytes;
+	gbAtomic64 mapped_time; // time_stamp_time_now() ticks
+	gbAtomic64 copied_file_count;
+	gbAtomic64 copied_bytes;
+	gbAtomic64 copied_time; // time_stamp_time_now() ticks
 };
 
+gb_global TokenizerLoadStats global_tokenizer_load_stats = {};
+
 
 TokenizerState save_tokenizer_state(Tokenizer *t) {
 	TokenizerState state = {};
@@ -556,23 +757,115 @@ void advance_to_next_rune(Tokenizer *t) {
 	}
 }
 
+// NOTE: Maps the file as a private (copy-on-write) view rather than copying its contents
+// The bytes past the end of the file up to the page boundary are guaranteed to be zero, which
+// gives the same NUL sentinel as 'gb_file_read_contents(a, true, ...)' without a copy. If the file
+// size is an exact multiple of the page size, there is no such slack so the caller must copy instead.
+bool tokenizer_map_file(Tokenizer *t, char const *c_str) {
+	isize page_size = gb_virtual_memory_page_size(nullptr);
+
+#if defined(GB_SYSTEM_WINDOWS)
+	String16 wpath = string_to_string16(heap_allocator(), make_string_c(c_str));
+	defer (gb_free(heap_allocator(), wpath.text));
+
+	HANDLE file = CreateFileW(cast(wchar_t const *)wpath.text, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	defer (CloseHandle(file));
+
+	LARGE_INTEGER file_size = {};
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+		return false;
+	}
+	isize size = cast(isize)file_size.QuadPart;
+	if (size % page_size == 0) {
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		return false;
+	}
+	defer (CloseHandle(mapping));
+
+	void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (data == nullptr) {
+		return false;
+	}
+#else
+	int fd = open(c_str, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	defer (close(fd));
+
+	struct stat st = {};
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		return false;
+	}
+	isize size = cast(isize)st.st_size;
+	if (size % page_size == 0) {
+		return false;
+	}
+
+	void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+#endif
+
+	t->start = cast(u8 *)data;
+	t->end = t->start + size;
+	t->is_mapped = true;
+	t->mapped_size = size;
+	GB_ASSERT(*t->end == 0);
+	return true;
+}
+
+void tokenizer_unmap_file(Tokenizer *t) {
+	GB_ASSERT(t->is_mapped);
+#if defined(GB_SYSTEM_WINDOWS)
+	UnmapViewOfFile(t->start);
+#else
+	munmap(t->start, t->mapped_size);
+#endif
+	t->is_mapped = false;
+	t->mapped_size = 0;
+}
+
 TokenizerInitError init_tokenizer(Tokenizer *t, String fullpath) {
 	TokenizerInitError err = TokenizerInit_None;
 
 	char *c_str = alloc_cstring(heap_allocator(), fullpath);
 	defer (gb_free(heap_allocator(), c_str));
 
-	// TODO(bill): Memory map rather than copy contents
-	gbFileContents fc = gb_file_read_contents(heap_allocator(), true, c_str);
 	gb_zero_item(t);
 
 	t->fullpath = fullpath;
 	t->line_count = 1;
 
-	if (fc.data != nullptr) {
-		t->start = cast(u8 *)fc.data;
+	u64 load_start = time_stamp_time_now();
+	if (tokenizer_map_file(t, c_str)) {
+		TokenizerLoadStats *stats = &global_tokenizer_load_stats;
+		gb_atomic64_fetch_add(&stats->mapped_file_count, 1);
+		gb_atomic64_fetch_add(&stats->mapped_bytes, t->end - t->start);
+		gb_atomic64_fetch_add(&stats->mapped_time, cast(i64)(time_stamp_time_now() - load_start));
+	} else {
+		gbFileContents fc = gb_file_read_contents(heap_allocator(), true, c_str);
+		if (fc.data != nullptr) {
+			t->start = cast(u8 *)fc.data;
+			t->end = t->start + fc.size;
+
+			TokenizerLoadStats *stats = &global_tokenizer_load_stats;
+			gb_atomic64_fetch_add(&stats->copied_file_count, 1);
+			gb_atomic64_fetch_add(&stats->copied_bytes, fc.size);
+			gb_atomic64_fetch_add(&stats->copied_time, cast(i64)(time_stamp_time_now() - load_start));
+		}
+	}
+
+	if (t->start != nullptr) {
 		t->line = t->read_curr = t->curr = t->start;
-		t->end = t->start + fc.size;
 
 		advance_to_next_rune(t);
 		if (t->curr_rune == GB_RUNE_BOM) {
@@ -600,13 +893,204 @@ TokenizerInitError init_tokenizer(Tokenizer *t, String fullpath) {
 }
 
 gb_inline void destroy_tokenizer(Tokenizer *t) {
-	if (t->start != nullptr) {
+	if (t->is_mapped) {
+		tokenizer_unmap_file(t);
+	} else if (t->start != nullptr) {
 		gb_free(heap_allocator(), t->start);
 	}
 	for_array(i, t->allocated_strings) {
 		gb_free(heap_allocator(), t->allocated_strings[i].text);
 	}
 	array_free(&t->allocated_strings);
+	array_free(&t->line_offsets);
+}
+
+// NOTE: ASCII fast paths for the tokenizer
+// Each 'tokenizer_*_run' procedure returns the number of bytes starting at 'p' which belong to its
+// byte class, stopping at the first byte which does not, at 'end', or at any byte >= 0x80 so that
+// non-ASCII text always goes through 'advance_to_next_rune'. 16 bytes are classified at a time
+// with SSE2 when it is available, otherwise (and for the tail of the file) one byte at a time.
+#if defined(GB_CPU_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TOKENIZER_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+gb_inline u32 tokenizer__lowest_bit_index(u32 x) {
+	GB_ASSERT(x != 0);
+#if defined(GB_COMPILER_MSVC)
+	unsigned long index = 0;
+	_BitScanForward(&index, x);
+	return cast(u32)index;
+#else
+	return cast(u32)__builtin_ctz(x);
+#endif
+}
+
+gb_inline u32 tokenizer__highest_bit_index(u32 x) {
+	GB_ASSERT(x != 0);
+#if defined(GB_COMPILER_MSVC)
+	unsigned long index = 0;
+	_BitScanReverse(&index, x);
+	return cast(u32)index;
+#else
+	return cast(u32)(31 - __builtin_clz(x));
+#endif
+}
+
+gb_inline bool tokenizer__is_ascii_identifier_byte(u8 b) {
+	return gb_is_between(b, 'a', 'z') ||
+	       gb_is_between(b, 'A', 'Z') ||
+	       gb_is_between(b, '0', '9') ||
+	       b == '_';
+}
+
+// [A-Za-z0-9_]
+isize tokenizer_identifier_run(u8 const *p, u8 const *end) {
+	u8 const *start = p;
+#if defined(TOKENIZER_USE_SSE2)
+	__m128i const lower_a    = _mm_set1_epi8('a'-1);
+	__m128i const lower_z    = _mm_set1_epi8('z'+1);
+	__m128i const digit_0    = _mm_set1_epi8('0'-1);
+	__m128i const digit_9    = _mm_set1_epi8('9'+1);
+	__m128i const case_bit   = _mm_set1_epi8(0x20);
+	__m128i const underscore = _mm_set1_epi8('_');
+	while (end-p >= 16) {
+		__m128i x = _mm_loadu_si128(cast(__m128i const *)p);
+		// NOTE: Setting the case bit folds 'A'..'Z' onto 'a'..'z' without moving any other byte into that range,
+		// and the signed compares reject every byte >= 0x80
+		__m128i lx = _mm_or_si128(x, case_bit);
+		__m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lx, lower_a), _mm_cmplt_epi8(lx, lower_z));
+		__m128i digit  = _mm_and_si128(_mm_cmpgt_epi8(x, digit_0), _mm_cmplt_epi8(x, digit_9));
+		__m128i ident  = _mm_or_si128(_mm_or_si128(letter, digit), _mm_cmpeq_epi8(x, underscore));
+		u32 stop = ~cast(u32)_mm_movemask_epi8(ident) & 0xffff;
+		if (stop != 0) {
+			return (p-start) + tokenizer__lowest_bit_index(stop);
+		}
+		p += 16;
+	}
+#endif
+	while (p < end && tokenizer__is_ascii_identifier_byte(*p)) {
+		p++;
+	}
+	return p-start;
+}
+
+// [ \t\r\n], also counting the newlines within the run and the position of the last one
+isize tokenizer_whitespace_run(u8 const *p, u8 const *end, isize *newline_count_, u8 const **last_newline_) {
+	u8 const *start = p;
+	isize newline_count = 0;
+	u8 const *last_newline = nullptr;
+#if defined(TOKENIZER_USE_SSE2)
+	__m128i const space   = _mm_set1_epi8(' ');
+	__m128i const tab     = _mm_set1_epi8('\t');
+	__m128i const cr      = _mm_set1_epi8('\r');
+	__m128i const newline = _mm_set1_epi8('\n');
+	while (end-p >= 16) {
+		__m128i x  = _mm_loadu_si128(cast(__m128i const *)p);
+		__m128i nl = _mm_cmpeq_epi8(x, newline);
+		__m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, tab)),
+		                          _mm_or_si128(_mm_cmpeq_epi8(x, cr), nl));
+		u32 nl_mask = cast(u32)_mm_movemask_epi8(nl);
+		u32 stop = ~cast(u32)_mm_movemask_epi8(ws) & 0xffff;
+		isize n = 16;
+		if (stop != 0) {
+			n = tokenizer__lowest_bit_index(stop);
+			nl_mask &= (1u<<n)-1;
+		}
+		if (nl_mask != 0) {
+			newline_count += bit_set_count(nl_mask);
+			last_newline = p + tokenizer__highest_bit_index(nl_mask);
+		}
+		p += n;
+		if (n < 16) {
+			goto end;
+		}
+	}
+#endif
+	while (p < end) {
+		u8 b = *p;
+		if (b == '\n') {
+			newline_count += 1;
+			last_newline = p;
+		} else if (b != ' ' && b != '\t' && b != '\r') {
+			break;
+		}
+		p++;
+	}
+#if defined(TOKENIZER_USE_SSE2)
+end:
+#endif
+	*newline_count_ = newline_count;
+	*last_newline_ = last_newline;
+	return p-start;
+}
+
+// Anything but '\n' and NUL
+isize tokenizer_line_comment_run(u8 const *p, u8 const *end) {
+	u8 const *start = p;
+#if defined(TOKENIZER_USE_SSE2)
+	__m128i const zero    = _mm_setzero_si128();
+	__m128i const newline = _mm_set1_epi8('\n');
+	while (end-p >= 16) {
+		__m128i x = _mm_loadu_si128(cast(__m128i const *)p);
+		__m128i special = _mm_or_si128(_mm_cmpeq_epi8(x, newline), _mm_cmpeq_epi8(x, zero));
+		// NOTE: The high bit of every byte >= 0x80 also stops the run
+		u32 stop = cast(u32)_mm_movemask_epi8(_mm_or_si128(special, x));
+		if (stop != 0) {
+			return (p-start) + tokenizer__lowest_bit_index(stop);
+		}
+		p += 16;
+	}
+#endif
+	while (p < end) {
+		u8 b = *p;
+		if (b == '\n' || b == 0 || b >= 0x80) {
+			break;
+		}
+		p++;
+	}
+	return p-start;
+}
+
+// Anything but '/', '*', '\n' and NUL
+isize tokenizer_block_comment_run(u8 const *p, u8 const *end) {
+	u8 const *start = p;
+#if defined(TOKENIZER_USE_SSE2)
+	__m128i const zero    = _mm_setzero_si128();
+	__m128i const newline = _mm_set1_epi8('\n');
+	__m128i const slash   = _mm_set1_epi8('/');
+	__m128i const star    = _mm_set1_epi8('*');
+	while (end-p >= 16) {
+		__m128i x = _mm_loadu_si128(cast(__m128i const *)p);
+		__m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, newline), _mm_cmpeq_epi8(x, zero)),
+		                               _mm_or_si128(_mm_cmpeq_epi8(x, slash), _mm_cmpeq_epi8(x, star)));
+		u32 stop = cast(u32)_mm_movemask_epi8(_mm_or_si128(special, x));
+		if (stop != 0) {
+			return (p-start) + tokenizer__lowest_bit_index(stop);
+		}
+		p += 16;
+	}
+#endif
+	while (p < end) {
+		u8 b = *p;
+		if (b == '\n' || b == 0 || b == '/' || b == '*' || b >= 0x80) {
+			break;
+		}
+		p++;
+	}
+	return p-start;
+}
+
+// NOTE: Skips the 'n' bytes after the current rune and then advances onto the rune following them.
+// The current rune must not be '\n' and the skipped bytes must be ASCII and contain neither '\n' nor NUL,
+// so there is no line bookkeeping or error reporting that the rune path would have done for them.
+gb_inline void tokenizer_skip_ascii_run(Tokenizer *t, isize n) {
+	GB_ASSERT(t->curr_rune != '\n');
+	if (n > 0) {
+		t->read_curr += n;
+		t->curr_rune = t->read_curr[-1];
+	}
+	advance_to_next_rune(t);
 }
 
 void tokenizer_skip_whitespace(Tokenizer *t) {
@@ -614,6 +1098,28 @@ void tokenizer_skip_whitespace(Tokenizer *t) {
 	       t->curr_rune == '\t' ||
 	       t->curr_rune == '\n' ||
 	       t->curr_rune == '\r') {
+		isize newline_count = 0;
+		u8 const *last_newline = nullptr;
+		isize n = tokenizer_whitespace_run(t->read_curr, t->end, &newline_count, &last_newline);
+		if (n == 0) {
+			advance_to_next_rune(t);
+			continue;
+		}
+
+		// NOTE: Do the line bookkeeping for the current rune and the whole run up front, as if
+		// 'advance_to_next_rune' had stepped over each byte, then step onto the byte after the run
+		if (t->curr_rune == '\n') {
+			newline_count += 1;
+			if (last_newline == nullptr) {
+				last_newline = t->curr;
+			}
+		}
+		if (newline_count > 0) {
+			t->line_count += newline_count;
+			t->line = cast(u8 *)last_newline + 1;
+		}
+		t->read_curr += n;
+		t->curr_rune = ' ';
 		advance_to_next_rune(t);
 	}
 }
@@ -889,24 +1395,12 @@ Token tokenizer_get_token(Tokenizer *t) {
 	if (rune_is_letter(curr_rune)) {
 		token.kind = Token_Ident;
 		while (rune_is_letter(t->curr_rune) || rune_is_digit(t->curr_rune)) {
-			advance_to_next_rune(t);
+			isize n = tokenizer_identifier_run(t->read_curr, t->end);
+			tokenizer_skip_ascii_run(t, n);
 		}
 
 		token.string.len = t->curr - token.string.text;
-
-		// NOTE(bill): All keywords are > 1
-		if (token.string.len > 1) {
-			for (i32 k = Token__KeywordBegin+1; k < Token__KeywordEnd; k++) {
-				if (token.string == token_strings[k]) {
-					token.kind = cast(TokenKind)k;
-					break;
-				}
-			}
-
-			if (token.kind == Token_Ident && token.string == "notin") {
-				token.kind = Token_not_in; 
-			}
-		}
+		token.kind = keyword_kind_from_string(token.string);
 
 	} else if (gb_is_between(curr_rune, '0', '9')) {
 		token = scan_number_to_token(t, false);
@@ -1085,7 +1579,8 @@ Token tokenizer_get_token(Tokenizer *t) {
 		case '/': {
 			if (t->curr_rune == '/') {
 				while (t->curr_rune != '\n' && t->curr_rune != GB_RUNE_EOF) {
-					advance_to_next_rune(t);
+					isize n = tokenizer_line_comment_run(t->read_curr, t->end);
+					tokenizer_skip_ascii_run(t, n);
 				}
 				token.kind = Token_Comment;
 			} else if (t->curr_rune == '*') {
@@ -1106,6 +1601,9 @@ Token tokenizer_get_token(Tokenizer *t) {
 							advance_to_next_rune(t);
 							comment_scope--;
 						}
+					} else if (t->curr_rune != '\n') {
+						isize n = tokenizer_block_comment_run(t->read_curr, t->end);
+						tokenizer_skip_ascii_run(t, n);
 					} else {
 						advance_to_next_rune(t);
 					}
@@ -1156,3 +1654,121 @@ Token tokenizer_get_token(Tokenizer *t) {
 	token.string.len = t->curr - token.string.text;
 	return token;
 }
+
+
+
+// NOTE: A 'Token' carries its own file path and decoded line and column, which makes it 64 bytes.
+// Whole files of tokens are instead stored as 'CompactToken's which only record where the token
+// is within its file; the line and column are recovered from the file's line offset table and the
+// file path from the owning tokenizer when the parser expands one back into a 'Token'.
+enum CompactTokenFlag {
+	CompactTokenFlag_Unquoted  = 1<<0, // text starts one byte after the token (quotes removed in place)
+	CompactTokenFlag_Allocated = 1<<1, // 'len' is an index into 'Tokenizer::allocated_strings'
+};
+
+struct CompactToken {
+	u32 offset; // byte offset of the start of the token within the file
+	u32 len;    // byte length of the token's text
+	u16 kind;   // TokenKind
+	u16 flags;  // CompactTokenFlag
+};
+
+GB_STATIC_ASSERT(Token_Count <= U16_MAX);
+GB_STATIC_ASSERT(gb_size_of(CompactToken) == 12);
+
+
+void tokenizer_init_line_offsets(Tokenizer *t) {
+	isize size = t->end - t->start;
+	GB_ASSERT_MSG(size <= cast(isize)U32_MAX, "%.*s is too large", LIT(t->fullpath));
+
+	array_init(&t->line_offsets, heap_allocator(), 0, gb_max(t->line_count, 1));
+	array_add(&t->line_offsets, cast(u32)0);
+	if (t->start == nullptr) {
+		return;
+	}
+
+	u8 const *curr = t->start;
+	for (;;) {
+		u8 const *nl = cast(u8 const *)gb_memchr(curr, '\n', t->end - curr);
+		if (nl == nullptr) {
+			break;
+		}
+		curr = nl+1;
+		array_add(&t->line_offsets, cast(u32)(curr - t->start));
+	}
+}
+
+CompactToken compact_token(Tokenizer *t, Token const &token) {
+	CompactToken ct = {};
+	ct.kind = cast(u16)token.kind;
+
+	u8 *text = token.string.text;
+	if (token.kind == Token_String || token.kind == Token_Rune) {
+		// NOTE: Only string and rune literals have text which is not just a slice of the source
+		ct.offset = cast(u32)token.pos.offset;
+		if (text < t->start || text > t->end) {
+			GB_ASSERT(t->allocated_strings.count > 0);
+			GB_ASSERT(t->allocated_strings[t->allocated_strings.count-1].text == text);
+			ct.flags |= CompactTokenFlag_Allocated;
+			ct.len = cast(u32)(t->allocated_strings.count-1);
+			return ct;
+		}
+		isize delta = (text - t->start) - token.pos.offset;
+		GB_ASSERT(delta == 0 || delta == 1);
+		if (delta == 1) {
+			ct.flags |= CompactTokenFlag_Unquoted;
+		}
+	} else if (text != nullptr) {
+		GB_ASSERT(t->start <= text && text <= t->end);
+		ct.offset = cast(u32)(text - t->start);
+	}
+	ct.len = cast(u32)token.string.len;
+	return ct;
+}
+
+// NOTE: 'line_hint' is the line index of the previously expanded token; tokens are mostly expanded
+// in order so the line is usually found without a binary search
+Token token_from_compact(Tokenizer *t, CompactToken const &ct, isize *line_hint) {
+	Token token = {};
+	token.kind = cast(TokenKind)ct.kind;
+	if (ct.flags & CompactTokenFlag_Allocated) {
+		token.string = t->allocated_strings[ct.len];
+	} else {
+		isize text_offset = ct.offset + ((ct.flags & CompactTokenFlag_Unquoted) ? 1 : 0);
+		token.string = make_string(t->start + text_offset, ct.len);
+		if (t->start == nullptr) {
+			token.string.text = nullptr;
+		}
+	}
+
+	Array<u32> const &lines = t->line_offsets;
+	GB_ASSERT(lines.count > 0);
+	isize line = gb_clamp(*line_hint, 0, lines.count-1);
+	if (lines[line] > ct.offset) {
+		line = 0;
+	}
+	for (isize i = 0; i < 4 && line+1 < lines.count && lines[line+1] <= ct.offset; i++) {
+		line += 1;
+	}
+	if (line+1 < lines.count && lines[line+1] <= ct.offset) {
+		// NOTE: Largest line whose start is <= offset
+		isize lo = line+1;
+		isize hi = lines.count-1;
+		while (lo < hi) {
+			isize mid = lo + (hi-lo+1)/2;
+			if (lines[mid] <= ct.offset) {
+				lo = mid;
+			} else {
+				hi = mid-1;
+			}
+		}
+		line = lo;
+	}
+	*line_hint = line;
+
+	token.pos.file   = t->fullpath;
+	token.pos.offset = ct.offset;
+	token.pos.line   = line+1;
+	token.pos.column = ct.offset - lines[line] + 1;
+	return token;
+}
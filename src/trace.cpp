@@ -0,0 +1,170 @@
+// trace.cpp
+//
+// -trace:<file.json> writes the phases of the compiler, and the work done on every thread, as Chrome trace
+// events, which chrome://tracing and Perfetto can open. Each thread records into its own buffer, so only a
+// thread's first event takes a lock. Every thread pool worker appears on its own track.
+
+struct TraceEvent {
+	char const *category;
+	isize       name_offset; // NOTE: Into the 'names' of the thread, as the AST may be freed before the trace is written
+	isize       name_len;
+	u64         start;
+	u64         finish;
+};
+
+struct TraceThread {
+	u32               id;
+	char              name[32];
+	Array<TraceEvent> events;
+	Array<u8>         names;
+};
+
+struct TraceState {
+	bool                 enabled;
+	u32                  main_thread_id;
+	u64                  start;
+	gbMutex              mutex;
+	Array<TraceThread *> threads;
+
+	// NOTE: The section of 'check_parsed_files' which is open, see 'trace_section'
+	String section_name;
+	u64    section_start;
+};
+
+gb_global TraceState global_trace = {};
+gb_thread_local TraceThread *trace_current_thread = nullptr;
+
+
+void trace_init(void) {
+	global_trace.enabled = true;
+	global_trace.main_thread_id = gb_thread_current_id();
+	global_trace.start = time_stamp_time_now();
+	gb_mutex_init(&global_trace.mutex);
+	array_init(&global_trace.threads, heap_allocator());
+}
+
+// NOTE: Zero when tracing is disabled, to keep the untraced path cheap
+gb_inline u64 trace_time_now(void) {
+	return global_trace.enabled ? time_stamp_time_now() : 0;
+}
+
+TraceThread *trace_thread(void) {
+	if (trace_current_thread != nullptr) {
+		return trace_current_thread;
+	}
+	TraceThread *t = gb_alloc_item(heap_allocator(), TraceThread);
+	t->id = gb_thread_current_id();
+	ThreadPool *pool = current_thread_pool;
+	if (t->id == global_trace.main_thread_id) {
+		gb_snprintf(t->name, gb_size_of(t->name), "main");
+	} else if (pool != nullptr && pool->worker_prefix_len > 0) {
+		gb_snprintf(t->name, gb_size_of(t->name), "%.*s %td", pool->worker_prefix_len, pool->worker_prefix, current_thread_pool_index);
+	} else {
+		gb_snprintf(t->name, gb_size_of(t->name), "worker");
+	}
+	array_init(&t->events, heap_allocator(), 0, 1024);
+	array_init(&t->names, heap_allocator(), 0, 1<<16);
+
+	gb_mutex_lock(&global_trace.mutex);
+	array_add(&global_trace.threads, t);
+	gb_mutex_unlock(&global_trace.mutex);
+
+	trace_current_thread = t;
+	return t;
+}
+
+// NOTE: Records an event on the current thread from 'start' until now
+void trace_add_event(char const *category, String name, u64 start) {
+	if (!global_trace.enabled) {
+		return;
+	}
+	TraceThread *t = trace_thread();
+	TraceEvent e = {category, t->names.count, name.len, start, time_stamp_time_now()};
+	array_add_elems(&t->names, name.text, name.len);
+	array_add(&t->events, e);
+}
+
+// NOTE: Ends the open section of the main thread, and starts a section called 'name' unless it is empty
+void trace_section(String name) {
+	if (!global_trace.enabled) {
+		return;
+	}
+	if (global_trace.section_name.len > 0) {
+		trace_add_event("section", global_trace.section_name, global_trace.section_start);
+	}
+	global_trace.section_name = name;
+	global_trace.section_start = time_stamp_time_now();
+}
+
+gbString trace_append_json_string(gbString s, String str) {
+	s = gb_string_appendc(s, "\"");
+	for (isize i = 0; i < str.len; i++) {
+		u8 c = str[i];
+		if (c == '"' || c == '\\') {
+			s = gb_string_append_fmt(s, "\\%c", c);
+		} else if (c < 0x20) {
+			s = gb_string_append_fmt(s, "\\u%04x", c);
+		} else {
+			s = gb_string_append_length(s, &c, 1);
+		}
+	}
+	return gb_string_appendc(s, "\"");
+}
+
+gbString trace_append_event(gbString s, u32 tid, char const *category, String name, u64 start, u64 finish, u64 base, u64 freq) {
+	f64 ts  = 1000000.0*cast(f64)(start - base)/cast(f64)freq;
+	f64 dur = 1000000.0*cast(f64)(finish - start)/cast(f64)freq;
+	s = gb_string_appendc(s, ",\n{\"name\":");
+	s = trace_append_json_string(s, name);
+	s = gb_string_append_fmt(s, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", category, ts, dur, tid);
+	return s;
+}
+
+// NOTE: Called once the worker threads are done, with the phases from 'timings' placed on the main thread
+void trace_write(Timings *t, String path) {
+	if (!global_trace.enabled) {
+		return;
+	}
+	trace_section({});
+	timings__stop_current_section(t);
+	u64 base = gb_min(global_trace.start, t->total.start);
+	u64 freq = t->freq;
+
+	gbString s = gb_string_make_reserve(heap_allocator(), 1<<20);
+	defer (gb_string_free(s));
+	s = gb_string_appendc(s, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	s = gb_string_appendc(s, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"odin\"}}");
+	s = gb_string_append_fmt(s, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"main\"}}",
+	                         global_trace.main_thread_id);
+	for_array(i, global_trace.threads) {
+		TraceThread *thread = global_trace.threads[i];
+		if (thread->id != global_trace.main_thread_id) {
+			s = gb_string_append_fmt(s, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			                         thread->id, thread->name);
+		}
+	}
+
+	for_array(i, t->sections) {
+		TimeStamp ts = t->sections[i];
+		s = trace_append_event(s, global_trace.main_thread_id, "phase", ts.label, ts.start, ts.finish, base, freq);
+	}
+	for_array(i, global_trace.threads) {
+		TraceThread *thread = global_trace.threads[i];
+		for_array(j, thread->events) {
+			TraceEvent e = thread->events[j];
+			String name = make_string(thread->names.data + e.name_offset, e.name_len);
+			s = trace_append_event(s, thread->id, e.category, name, e.start, e.finish, base, freq);
+		}
+	}
+	s = gb_string_appendc(s, "\n]}\n");
+
+	char *path_c = alloc_cstring(heap_allocator(), path);
+	defer (gb_free(heap_allocator(), path_c));
+	gbFile f = {};
+	if (gb_file_create(&f, path_c) != gbFileError_None) {
+		gb_printf_err("Unable to create the trace file '%.*s'\n", LIT(path));
+		return;
+	}
+	gb_file_write(&f, s, gb_string_length(s));
+	gb_file_close(&f);
+}
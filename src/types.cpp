@@ -587,6 +587,30 @@ gb_global Type *t_map_header                     = nullptr;
 gb_global Type *t_vector_x86_mmx                 = nullptr;
 
 
+// NOTE: Anonymous pointer, slice, array, dynamic array and map types with the same element types
+// share one canonical 'Type *'. The element types are keyed by pointer, so '^^T' is canonical once '^T' is.
+struct TypeInternTable {
+	gbMutex     mutex;
+	Map<Type *> pointers;       // Key: elem
+	Map<Type *> slices;         // Key: elem
+	Map<Type *> dynamic_arrays; // Key: elem
+	Map<Type *> arrays;         // Key: elem and count
+	Map<Type *> maps;           // Key: key and value
+};
+
+gb_global TypeInternTable type_intern_table = {};
+
+void init_type_intern_table(void) {
+	gbAllocator a = heap_allocator();
+	gb_mutex_init(&type_intern_table.mutex);
+	map_init(&type_intern_table.pointers,       a);
+	map_init(&type_intern_table.slices,         a);
+	map_init(&type_intern_table.dynamic_arrays, a);
+	map_init(&type_intern_table.arrays,         a);
+	map_init(&type_intern_table.maps,           a);
+}
+
+
 
 i64      type_size_of               (Type *t);
 i64      type_align_of              (Type *t);
@@ -711,12 +735,30 @@ Type *alloc_type_opaque(Type *elem) {
 	return t;
 }
 
-Type *alloc_type_pointer(Type *elem) {
-	Type *t = alloc_type(Type_Pointer);
-	t->Pointer.elem = elem;
+// NOTE: Returns the canonical type for 'key' in 'table', allocating it with 'kind' and 'elem' if needed
+Type *intern_type_with_elem(Map<Type *> *table, HashKey key, TypeKind kind, Type *elem) {
+	gb_mutex_lock(&type_intern_table.mutex);
+	defer (gb_mutex_unlock(&type_intern_table.mutex));
+
+	Type **found = map_get(table, key);
+	if (found != nullptr) {
+		return *found;
+	}
+	Type *t = alloc_type(kind);
+	switch (kind) {
+	case Type_Pointer:      t->Pointer.elem      = elem; break;
+	case Type_Slice:        t->Slice.elem        = elem; break;
+	case Type_DynamicArray: t->DynamicArray.elem = elem; break;
+	default: GB_PANIC("Unsupported type kind for interning"); break;
+	}
+	map_set(table, key, t);
 	return t;
 }
 
+Type *alloc_type_pointer(Type *elem) {
+	return intern_type_with_elem(&type_intern_table.pointers, hash_pointer(elem), Type_Pointer, elem);
+}
+
 Type *alloc_type_array(Type *elem, i64 count, Type *generic_count = nullptr) {
 	if (generic_count != nullptr) {
 		Type *t = alloc_type(Type_Array);
@@ -725,9 +767,26 @@ Type *alloc_type_array(Type *elem, i64 count, Type *generic_count = nullptr) {
 		t->Array.generic_count = generic_count;
 		return t;
 	}
+	if (count < 0) {
+		// NOTE: The count of '[?]T' is set once the compound literal has been checked, so it cannot be shared
+		Type *t = alloc_type(Type_Array);
+		t->Array.elem = elem;
+		t->Array.count = count;
+		return t;
+	}
+
+	gb_mutex_lock(&type_intern_table.mutex);
+	defer (gb_mutex_unlock(&type_intern_table.mutex));
+
+	HashKey key = hash_ptr_and_id(elem, cast(u64)count);
+	Type **found = map_get(&type_intern_table.arrays, key);
+	if (found != nullptr) {
+		return *found;
+	}
 	Type *t = alloc_type(Type_Array);
 	t->Array.elem = elem;
 	t->Array.count = count;
+	map_set(&type_intern_table.arrays, key, t);
 	return t;
 }
 
@@ -745,15 +804,11 @@ Type *alloc_type_enumerated_array(Type *elem, Type *index, ExactValue min_value,
 
 
 Type *alloc_type_slice(Type *elem) {
-	Type *t = alloc_type(Type_Slice);
-	t->Array.elem = elem;
-	return t;
+	return intern_type_with_elem(&type_intern_table.slices, hash_pointer(elem), Type_Slice, elem);
 }
 
 Type *alloc_type_dynamic_array(Type *elem) {
-	Type *t = alloc_type(Type_DynamicArray);
-	t->DynamicArray.elem = elem;
-	return t;
+	return intern_type_with_elem(&type_intern_table.dynamic_arrays, hash_pointer(elem), Type_DynamicArray, elem);
 }
 
 
@@ -816,6 +871,27 @@ Type *alloc_type_proc(Scope *scope, Type *params, isize param_count, Type *resul
 
 bool is_type_valid_for_keys(Type *t);
 
+HashKey hash_map_type_key(Type *key, Type *value) {
+	return hash_ptr_and_id(key, cast(u64)cast(uintptr)value);
+}
+
+// NOTE: Returns the canonical map type with the same key and value as 'type', which becomes
+// the canonical one if there is none yet
+Type *intern_map_type(Type *type) {
+	GB_ASSERT(type->kind == Type_Map);
+	gb_mutex_lock(&type_intern_table.mutex);
+	defer (gb_mutex_unlock(&type_intern_table.mutex));
+
+	HashKey key = hash_map_type_key(type->Map.key, type->Map.value);
+	Type **found = map_get(&type_intern_table.maps, key);
+	if (found != nullptr) {
+		return *found;
+	}
+	map_set(&type_intern_table.maps, key, type);
+	init_map_internal_types(type);
+	return type;
+}
+
 Type *alloc_type_map(i64 count, Type *key, Type *value) {
 	if (key != nullptr) {
 		GB_ASSERT(is_type_valid_for_keys(key));
@@ -824,6 +900,9 @@ Type *alloc_type_map(i64 count, Type *key, Type *value) {
 	Type *t = alloc_type(Type_Map);
 	t->Map.key   = key;
 	t->Map.value = value;
+	if (key != nullptr) {
+		t = intern_map_type(t);
+	}
 	return t;
 }
 
@@ -2590,9 +2669,13 @@ i64 type_size_of(Type *t) {
 	}
 	TypePath path = {0};
 	type_path_init(&path);
-	t->cached_size = type_size_of_internal(t, &path);
+	i64 size = type_size_of_internal(t, &path);
 	type_path_free(&path);
-	return t->cached_size;
+	// NOTE: Types are shared between the threads checking procedure bodies, which compute the same size
+	if (t->cached_size != size) {
+		gb_atomic64_exchanged(cast(gbAtomic64 *)&t->cached_size, size);
+	}
+	return size;
 }
 
 i64 type_align_of(Type *t) {
@@ -2608,9 +2691,12 @@ i64 type_align_of(Type *t) {
 
 	TypePath path = {0};
 	type_path_init(&path);
-	t->cached_align = type_align_of_internal(t, &path);
+	i64 align = type_align_of_internal(t, &path);
 	type_path_free(&path);
-	return t->cached_align;
+	if (t->cached_align != align) {
+		gb_atomic64_exchanged(cast(gbAtomic64 *)&t->cached_align, align);
+	}
+	return align;
 }
 
 
@@ -0,0 +1,269 @@
+// watch.cpp
+//
+// 'odin check -watch' checks the program again every time one of its .odin files changes. The watcher keeps
+// the parsed files resident, in the same way as 'odin server', so a check only parses the files which
+// changed. It also keeps the directories of the packages which passed the last check and have not changed
+// since: the check only goes through the procedure bodies of the other packages and of those which import
+// them, following the import graph, see 'find_unchanged_packages'. The directories of every file the last
+// check parsed are watched, so the watched set follows the imports.
+
+// NOTE: Set in the process forked for each check
+gb_global StringSet watch_clean_dirs = {};  // NOTE: Of the packages which passed the last check, and have not changed since
+gb_global int       watch_worker_fd  = -1;  // NOTE: The pipe the check sends the directories of its packages back on
+
+bool watch_worker_active(void) {
+	return watch_worker_fd >= 0;
+}
+
+// NOTE: The directory of a package as the watcher sees it, which for a package of a single file is the file's
+String watch_package_dir(AstPackage *pkg) {
+	if (pkg->files.count == 0) {
+		return pkg->fullpath;
+	}
+	return directory_from_path(pkg->files[0]->fullpath);
+}
+
+#if defined(GB_SYSTEM_LINUX)
+
+#include <sys/inotify.h>
+
+struct WatchState {
+	int         inotify_fd;
+	StringSet   watched_dirs;
+	Map<String> dirs_by_wd; // Key: the inotify watch descriptor
+};
+
+void watch_add_directory(WatchState *w, String dir) {
+	if (dir.len == 0 || string_set_exists(&w->watched_dirs, dir)) {
+		return;
+	}
+	dir = copy_string(heap_allocator(), dir);
+	char *dir_c = alloc_cstring(heap_allocator(), dir);
+	defer (gb_free(heap_allocator(), dir_c));
+	u32 mask = IN_CLOSE_WRITE|IN_MOVED_TO|IN_MOVED_FROM|IN_CREATE|IN_DELETE;
+	int wd = inotify_add_watch(w->inotify_fd, dir_c, mask);
+	if (wd < 0) {
+		gb_printf_err("Unable to watch the directory '%.*s'\n", LIT(dir));
+	} else {
+		map_set(&w->dirs_by_wd, hash_integer(cast(u64)wd), dir);
+	}
+	// NOTE: Added even on failure, so the error is only reported once
+	string_set_add(&w->watched_dirs, dir);
+}
+
+// NOTE: Blocks until a .odin file in a watched directory changes, then waits for the changes to settle
+// so that an editor saving several files only causes one check. The directories of the changed files are
+// no longer clean.
+bool watch_wait_for_change(WatchState *w) {
+	alignas(struct inotify_event) u8 buf[1<<14];
+	bool changed = false;
+	for (;;) {
+		struct pollfd pfd = {};
+		pfd.fd = w->inotify_fd;
+		pfd.events = POLLIN;
+		int ready = poll(&pfd, 1, changed ? 50 : -1);
+		if (ready < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		if (ready == 0) {
+			return true;
+		}
+
+		isize n = read(w->inotify_fd, buf, gb_size_of(buf));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		for (isize offset = 0; offset < n; ) {
+			struct inotify_event *event = cast(struct inotify_event *)(buf + offset);
+			offset += gb_size_of(struct inotify_event) + event->len;
+			if (event->mask & IN_Q_OVERFLOW) {
+				// NOTE: Events were lost, so nothing can be assumed to be unchanged
+				string_set_clear(&watch_clean_dirs);
+				changed = true;
+				continue;
+			}
+			if (event->len == 0) {
+				continue;
+			}
+			String name = make_string_c(event->name);
+			if (!(event->mask & IN_ISDIR) && string_ends_with(name, str_lit(".odin"))) {
+				changed = true;
+				String *dir = map_get(&w->dirs_by_wd, hash_integer(cast(u64)event->wd));
+				if (dir != nullptr) {
+					string_set_remove(&watch_clean_dirs, *dir);
+				}
+			}
+		}
+	}
+}
+
+// NOTE: Called at the end of the check in the process forked for it. The directories of its packages are
+// only sent back if it passed.
+void watch_worker_send_packages(Parser *p) {
+	if (!watch_worker_active()) {
+		return;
+	}
+	if (global_error_collector.count == 0) {
+		auto buf = array_make<u8>(heap_allocator());
+		defer (array_free(&buf));
+		for_array(i, p->packages) {
+			String dir = watch_package_dir(p->packages[i]);
+			array_add_elems(&buf, dir.text, dir.len);
+			array_add(&buf, cast(u8)'\n');
+		}
+		server_write_all(watch_worker_fd, buf.data, buf.count);
+	}
+	close(watch_worker_fd);
+	watch_worker_fd = -1;
+}
+
+// NOTE: Reads everything a check sends back until it exits
+void watch_read_worker(int files_fd, int packages_fd, Array<u8> *records, Array<u8> *packages) {
+	struct pollfd fds[2] = {};
+	fds[0].fd = files_fd;
+	fds[1].fd = packages_fd;
+	fds[0].events = POLLIN;
+	fds[1].events = POLLIN;
+	isize open_count = gb_count_of(fds);
+	u8 buf[1<<16];
+	while (open_count > 0) {
+		if (poll(fds, gb_count_of(fds), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		for (isize i = 0; i < gb_count_of(fds); i++) {
+			if (fds[i].fd < 0 || fds[i].revents == 0) {
+				continue;
+			}
+			isize n = read(fds[i].fd, buf, gb_size_of(buf));
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				close(fds[i].fd);
+				fds[i].fd = -1;
+				open_count -= 1;
+				continue;
+			}
+			array_add_elems(i == 0 ? records : packages, buf, n);
+		}
+	}
+}
+
+// NOTE: Checks until it fails. In the process forked for each check, it returns true for 'main' to carry
+// on with the check.
+bool watch_run(String init_filename) {
+	WatchState w = {};
+	w.inotify_fd = inotify_init1(IN_CLOEXEC);
+	if (w.inotify_fd < 0) {
+		gb_printf_err("Unable to watch for file changes\n");
+		return false;
+	}
+	string_set_init(&w.watched_dirs, heap_allocator());
+	map_init(&w.dirs_by_wd, heap_allocator());
+	string_set_init(&watch_clean_dirs, heap_allocator());
+	server_init_parsed_files();
+
+	String init_fullpath = path_to_full_path(heap_allocator(), init_filename);
+	if (path_is_directory(init_fullpath)) {
+		watch_add_directory(&w, init_fullpath);
+	} else {
+		watch_add_directory(&w, directory_from_path(init_fullpath));
+	}
+
+	auto records = array_make<u8>(heap_allocator(), 0, 1<<20);
+	defer (array_free(&records));
+	auto packages = array_make<u8>(heap_allocator());
+	defer (array_free(&packages));
+
+	for (;;) {
+		u64 start_time = time_stamp_time_now();
+		server_remove_changed_files();
+		isize clean_count = watch_clean_dirs.entries.count;
+
+		int files_pipe[2] = {-1, -1};
+		int packages_pipe[2] = {-1, -1};
+		if (pipe(files_pipe) != 0 || pipe(packages_pipe) != 0) {
+			gb_printf_err("Unable to create the pipes for a check\n");
+			break;
+		}
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(w.inotify_fd);
+			close(files_pipe[0]);
+			close(packages_pipe[0]);
+			server_worker_init(files_pipe[1]);
+			watch_worker_fd = packages_pipe[1];
+			return true;
+		}
+		close(files_pipe[1]);
+		close(packages_pipe[1]);
+		if (pid < 0) {
+			close(files_pipe[0]);
+			close(packages_pipe[0]);
+			gb_printf_err("Unable to start a check\n");
+			break;
+		}
+
+		array_clear(&records);
+		array_clear(&packages);
+		watch_read_worker(files_pipe[0], packages_pipe[0], &records, &packages);
+
+		int status = 0;
+		while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+		}
+		i32 exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+		server_add_parsed_files(records);
+
+		// NOTE: Only a check which passed leaves its packages clean, otherwise the next one goes through all of them
+		string_set_clear(&watch_clean_dirs);
+		if (exit_code == 0) {
+			isize start = 0;
+			for_array(i, packages) {
+				if (packages[i] == '\n') {
+					String dir = make_string(packages.data+start, i-start);
+					string_set_add(&watch_clean_dirs, copy_string(heap_allocator(), dir));
+					start = i+1;
+				}
+			}
+		}
+
+		auto *entries = &global_server.parsed_files_by_path.entries;
+		for_array(i, *entries) {
+			watch_add_directory(&w, directory_from_path((*entries)[i].value->fullpath));
+		}
+
+		f64 ms = 1000.0*cast(f64)(time_stamp_time_now() - start_time)/cast(f64)time_stamp__freq();
+		gb_printf("%s - %.3f ms - %td unchanged packages - watching %td directories for changes\n",
+		          exit_code == 0 ? "Check passed" : "Check failed", ms, clean_count, w.watched_dirs.entries.count);
+
+		if (!watch_wait_for_change(&w)) {
+			gb_printf_err("Unable to watch for file changes\n");
+			break;
+		}
+	}
+
+	close(w.inotify_fd);
+	return false;
+}
+
+#else
+
+void watch_worker_send_packages(Parser *p) {
+	GB_ASSERT_MSG(!watch_worker_active(), "'odin check -watch' is only supported on Linux");
+}
+
+bool watch_run(String init_filename) {
+	gb_printf_err("'odin check -watch' is only supported on Linux\n");
+	return false;
+}
+
+#endif